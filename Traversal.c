@@ -7,9 +7,13 @@
  * 3. Recursion
  * 4. String Manipulation
  * 5. Hash Functions (FNV-1a)
+ * 6. Work Sharing (workers pull files from one atomic counter)
  */
 
 #include "common.h"
+#ifdef _WIN32
+#include <io.h>    // _get_osfhandle
+#endif
 
 // ============================================================================
 // DIRECTORY LIST INITIALIZATION
@@ -55,8 +59,8 @@ bool is_excluded(const ExclusionList* list, const char* path) {
     
     for (int i = 0; i < list->count; i++) {
         size_t excl_len = strlen(list->paths[i]);
-        // Use _strnicmp for Windows compatibility
-        if (_strnicmp(path, list->paths[i], excl_len) == 0) {
+        // Case-insensitive on Windows, like its file names
+        if (path_ncompare(path, list->paths[i], excl_len) == 0) {
             // Check if it's an exact match or has a path separator
             if (strlen(path) == excl_len || path[excl_len] == '\\' || path[excl_len] == '/') {
                 return true;
@@ -66,7 +70,7 @@ bool is_excluded(const ExclusionList* list, const char* path) {
     return false;
 }
 
-static time_t FileTimeToTimeT(const FILETIME* ft) {
+time_t FileTimeToTimeT(const FILETIME* ft) {
     if (!ft) return 0;
     
     const long long EPOCH_DIFF = 116444736000000000LL;
@@ -78,16 +82,54 @@ static time_t FileTimeToTimeT(const FILETIME* ft) {
     return (time_t)((li.QuadPart - EPOCH_DIFF) / 10000000LL);
 }
 
-void compute_hash(const char* filename, char* output, ScanMode mode) {
+uint64_t compute_hash(const char* filename, char* output, ScanMode mode) {
+    return compute_hash_ex(filename, output, mode, NULL, NULL, NULL);
+}
+
+// ============================================================================
+// COMPUTE HASH WITH CONTENT VISITOR
+// 
+// Same digest as compute_hash; every buffer read is also passed to
+// visit (may be NULL), so other per-file summaries (MinHash signatures)
+// are built from the same single read of the file.
+//
+// record (may be NULL) gets the file's identity and hard link count from
+// the already open handle, so the action planner (planner.c) never has
+// to go back to the disk for them.
+// ============================================================================
+uint64_t compute_hash_ex(const char* filename, char* output, ScanMode mode,
+                         ContentVisitor visit, void* context, FileInfo* record) {
     if (!filename || !output) {
         if (output) strcpy(output, "ERROR_NULL");
-        return;
+        return 0;
     }
     
+    TELEMETRY_START(t);
     FILE* file = fopen(filename, "rb");
+    TELEMETRY_COUNT(TELEMETRY_SYSCALLS, 1);
     if (!file) {
         strcpy(output, "ERROR_OPEN");
-        return;
+        return 0;
+    }
+    
+    if (record) {
+        BY_HANDLE_FILE_INFORMATION info;
+        HANDLE h = (HANDLE)_get_osfhandle(_fileno(file));
+        if (h != INVALID_HANDLE_VALUE && GetFileInformationByHandle(h, &info)) {
+            record->id.volume = info.dwVolumeSerialNumber;
+            record->id.index = ((uint64_t)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+            record->links = info.nNumberOfLinks;
+        }
+        TELEMETRY_COUNT(TELEMETRY_SYSCALLS, 1);
+    }
+    TELEMETRY_LAP(TELEMETRY_OPEN, t);
+    
+    // Large buffer: the visitor is called per buffer, not per 64 bytes
+    unsigned char* buffer = (unsigned char*)malloc(READ_BUFFER_SIZE);
+    if (!buffer) {
+        fclose(file);
+        strcpy(output, "ERROR_MEMORY");
+        return 0;
     }
     
     // Determine bytes to hash
@@ -95,16 +137,22 @@ void compute_hash(const char* filename, char* output, ScanMode mode) {
     
     // Initialize FNV-1a
     uint64_t hash = FNV_OFFSET_BASIS;
-    unsigned char buffer[64];
     size_t total_read = 0;
     size_t bytes_read;
     
     // Read and hash file in chunks
-    while ((bytes_read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    while ((bytes_read = fread(buffer, 1, READ_BUFFER_SIZE, file)) > 0) {
+        TELEMETRY_LAP(TELEMETRY_READ, t);
+        TELEMETRY_COUNT(TELEMETRY_SYSCALLS, 1);
+        TELEMETRY_COUNT(TELEMETRY_BYTES_READ, bytes_read);
+        
         // Stop if we've read enough (quick mode)
         if (bytes_to_hash > 0 && total_read >= bytes_to_hash) {
             break;
         }
+        if (bytes_to_hash > 0 && total_read + bytes_read > bytes_to_hash) {
+            bytes_read = bytes_to_hash - total_read;
+        }
         
         // FNV-1a: XOR then multiply
         for (size_t i = 0; i < bytes_read; i++) {
@@ -112,34 +160,75 @@ void compute_hash(const char* filename, char* output, ScanMode mode) {
             hash *= FNV_PRIME;
         }
         
+        if (visit) {
+            visit(context, buffer, bytes_read);
+        }
+        
         total_read += bytes_read;
+        TELEMETRY_LAP(TELEMETRY_HASH, t);
     }
     
+    free(buffer);
     fclose(file);
+    TELEMETRY_COUNT(TELEMETRY_SYSCALLS, 1);
     
     // Convert to hexadecimal string
     sprintf(output, "%016llx", (unsigned long long)hash);
+    return hash;
 }
 
+// ============================================================================
+// SHARD MEMBERSHIP
+// 
+// With shard_count > 1 (and not sharding by root), a file belongs to
+// shard FNV-1a(lowercased path) mod shard_count. Every worker walks the
+// whole tree, which is cheap, but only hashes its own files, which is
+// where the time goes. The hash depends only on the path, so any process
+// given the same roots makes the same split.
+// ============================================================================
+static bool in_path_shard(const ScanConfig* config, const char* path) {
+    if (config->shard_count <= 1 || config->shard_by_root) return true;
+    
+    uint64_t h = FNV_OFFSET_BASIS;
+    for (const unsigned char* p = (const unsigned char*)path; *p; p++) {
+        unsigned char c = *p;
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        h ^= c;
+        h *= FNV_PRIME;
+    }
+    return (int)(h % (uint64_t)config->shard_count) == config->shard_index;
+}
+
+// Bytes compute_hash_ex reads for a file of this size
+static long long hashed_size(long long size, ScanMode mode) {
+    return (mode == SCAN_QUICK && size > QUICK_HASH_SIZE) ? QUICK_HASH_SIZE : size;
+}
+
+// ============================================================================
+// PHASE 1: ENUMERATE (DFS over the directory tree)
+// 
+// Records path, size and modification time only; FindFirstFile returns
+// them with the name, so no file is opened. Knowing every file and size
+// before hashing starts is what gives the progress display a total.
+// ============================================================================
 static int scan_directory_internal(
     const char* path,
     FileInfo* files,
     int current_count,
     int max_files,
-    bool recurse,
-    ScanMode mode,
-    const ExclusionList* exclusions
+    const ScanConfig* config,
+    ProgressSlot* progress
 ) {
     // Build search pattern
     char search_path[MAX_PATH_LENGTH];
-    int len = snprintf(search_path, MAX_PATH_LENGTH, "%s\\*", path);
+    int len = snprintf(search_path, MAX_PATH_LENGTH, "%s" PATH_SEP_STR "*", path);
     
     if (len >= MAX_PATH_LENGTH - 1) {
         return current_count;
     }
     
     // Check exclusions
-    if (is_excluded(exclusions, path)) {
+    if (is_excluded(&config->exclusions, path)) {
         return current_count;
     }
     
@@ -148,6 +237,7 @@ static int scan_directory_internal(
     HANDLE hFind = FindFirstFileA(search_path, &ffd);
     
     if (hFind == INVALID_HANDLE_VALUE) {
+        TELEMETRY_COUNT(TELEMETRY_SYSCALLS, 1);
         return current_count;
     }
     
@@ -155,6 +245,9 @@ static int scan_directory_internal(
     
     // Iterate through directory
     do {
+        // The FindFirstFileA / FindNextFileA call that returned this entry
+        TELEMETRY_COUNT(TELEMETRY_SYSCALLS, 1);
+        
         // Skip . and ..
         if (strcmp(ffd.cFileName, ".") == 0 || 
             strcmp(ffd.cFileName, "..") == 0) {
@@ -163,7 +256,7 @@ static int scan_directory_internal(
         
         // Build full path
         char full_path[MAX_PATH_LENGTH];
-        len = snprintf(full_path, MAX_PATH_LENGTH, "%s\\%s", path, ffd.cFileName);
+        len = snprintf(full_path, MAX_PATH_LENGTH, "%s" PATH_SEP_STR "%s", path, ffd.cFileName);
         
         if (len >= MAX_PATH_LENGTH - 1) {
             continue;
@@ -171,11 +264,17 @@ static int scan_directory_internal(
         
         // Check if directory
         if (ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            // Junctions and directory symlinks lead to folders scanned
+            // under their real path: following them would report each
+            // file there as a duplicate of itself (and can loop)
+            if (ffd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) {
+                continue;
+            }
+            
             // Recurse into subdirectory
-            if (recurse && count < max_files) {
+            if (config->directories.include_subdirs && count < max_files) {
                 count = scan_directory_internal(
-                    full_path, files, count, max_files,
-                    true, mode, exclusions
+                    full_path, files, count, max_files, config, progress
                 );
             }
         } else {
@@ -184,10 +283,10 @@ static int scan_directory_internal(
                 break;
             }
             
-            // Update progress
-            EnterCriticalSection(&g_dataLock);
-            g_progress.files_scanned++;
-            LeaveCriticalSection(&g_dataLock);
+            // Another worker hashes this file
+            if (!in_path_shard(config, full_path)) {
+                continue;
+            }
             
             // Store path
             strncpy(files[count].path, full_path, MAX_PATH_LENGTH - 1);
@@ -199,9 +298,12 @@ static int scan_directory_internal(
             
             // Get modification time
             files[count].modified = FileTimeToTimeT(&ffd.ftLastWriteTime);
+            files[count].links = 0;
             
-            // Compute hash
-            compute_hash(full_path, files[count].hash, mode);
+            // Update progress
+            InterlockedIncrement64(&progress->files_enumerated);
+            InterlockedExchangeAdd64(&progress->bytes_enumerated,
+                                     hashed_size(files[count].size, config->scan_mode));
             
             count++;
         }
@@ -209,44 +311,186 @@ static int scan_directory_internal(
     } while (FindNextFileA(hFind, &ffd) && count < max_files);
     
     FindClose(hFind);
+    TELEMETRY_COUNT(TELEMETRY_SYSCALLS, 2);   // The last FindNextFileA, FindClose
     return count;
 }
 
+// ============================================================================
+// PHASE 2: HASH (one task per worker)
+// 
+// Workers take files from a shared counter, so a few huge files do not
+// leave the others idle, and each counts its progress in its own slot.
+// ============================================================================
+typedef struct {
+    const ScanConfig* config;
+    FileInfo* files;
+    int count;
+    const ScanHooks* hooks;
+    volatile LONG next;
+} HashJob;
+
+static void hash_worker(void* context, int worker) {
+    HashJob* job = (HashJob*)context;
+    const ScanHooks* hooks = job->hooks;
+    ProgressSlot* progress = progress_slot(worker);
+    LONG i;
+    
+    while ((i = InterlockedIncrement(&job->next) - 1) < job->count) {
+        FileInfo* file = &job->files[i];
+        
+        // Compute hash (and the MinHash signature from the same read)
+        if (hooks && hooks->near) {
+            MinHashState minhash;
+            minhash_init(&minhash);
+            file->digest = compute_hash_ex(file->path, file->hash, job->config->scan_mode,
+                                           minhash_update, &minhash, file);
+            if (strncmp(file->hash, "ERROR", 5) != 0) {
+                near_index_add(hooks->near, i, &minhash);
+            }
+        } else {
+            file->digest = compute_hash_ex(file->path, file->hash, job->config->scan_mode,
+                                           NULL, NULL, file);
+        }
+        
+        // Record is complete: let the online index see it
+        if (hooks && hooks->stream) {
+            stream_index_add(hooks->stream, job->files, i);
+        }
+        
+        InterlockedIncrement64(&progress->files_hashed);
+        InterlockedExchangeAdd64(&progress->bytes_hashed,
+                                 hashed_size(file->size, job->config->scan_mode));
+    }
+}
+
 
 int scan_directories(const ScanConfig* config, FileInfo* files, int max_files) {
+    return scan_directories_ex(config, files, max_files, NULL);
+}
+
+// ============================================================================
+// SCAN WITH HOOKS
+// 
+// Same as scan_directories, but every hashed file is also fed to the
+// hooks (each may be NULL): the online index reports duplicate groups as
+// they form, the near index keeps the file's MinHash signature.
+// 
+// Step 1: Enumerate every root (one thread: directory listing is cheap)
+// Step 2: Hash the files on config->threads workers (0 = one per
+//         logical processor, see get_worker_count)
+// ============================================================================
+int scan_directories_ex(const ScanConfig* config, FileInfo* files, int max_files,
+                        const ScanHooks* hooks) {
     if (!config || !files || max_files <= 0) return 0;
     
-    // Initialize progress
-    EnterCriticalSection(&g_dataLock);
-    g_progress.files_scanned = 0;
-    g_progress.current_percent = 0;
-    g_progress.is_complete = false;
-    LeaveCriticalSection(&g_dataLock);
+    progress_reset();
     
     int total = 0;
     
     // Scan each directory
     for (int i = 0; i < config->directories.count && total < max_files; i++) {
+        // Sharding by root: whole roots go to workers round-robin
+        if (config->shard_count > 1 && config->shard_by_root &&
+            i % config->shard_count != config->shard_index) {
+            continue;
+        }
+        
+        TELEMETRY_START(t);
         total = scan_directory_internal(
             config->directories.paths[i],
             files,
             total,
             max_files,
-            config->directories.include_subdirs,
-            config->scan_mode,
-            &config->exclusions
+            config,
+            progress_slot(0)
         );
+        TELEMETRY_STOP(TELEMETRY_ENUMERATE, t);
     }
     
+    // Listing only (benchmarks time enumeration on its own)
+    if (config->skip_hash) {
+        progress_phase(PROGRESS_COMPLETE);
+        return total;
+    }
+    
+    progress_phase(PROGRESS_HASHING);
+    
+    HashJob job = {config, files, total, hooks, 0};
+    int workers = config->threads > 0 ? config->threads : get_worker_count();
+    if (workers > MAX_WORKER_THREADS) workers = MAX_WORKER_THREADS;
+    parallel_for(workers, workers, hash_worker, &job);
+    
     // Mark complete
-    EnterCriticalSection(&g_dataLock);
-    g_progress.is_complete = true;
-    g_progress.current_percent = 100;
-    LeaveCriticalSection(&g_dataLock);
+    progress_phase(PROGRESS_COMPLETE);
     
     return total;
 }
 
+// ============================================================================
+// SCAN PROGRESS
+// 
+// Counters only grow, and each has a single writer (a slot per worker),
+// so a reader summing the slots without a lock sees a consistent-enough
+// picture: every value it reads was true at some moment of the scan.
+// ============================================================================
+void progress_reset(void) {
+    for (int i = 0; i < PROGRESS_SLOTS; i++) {
+        ProgressSlot* slot = &g_progress.slots[i];
+        InterlockedExchange64(&slot->files_enumerated, 0);
+        InterlockedExchange64(&slot->bytes_enumerated, 0);
+        InterlockedExchange64(&slot->files_hashed, 0);
+        InterlockedExchange64(&slot->bytes_hashed, 0);
+    }
+    InterlockedExchange64(&g_progress.hash_started, 0);
+    InterlockedExchange(&g_progress.phase, PROGRESS_ENUMERATING);
+}
+
+ProgressSlot* progress_slot(int worker) {
+    return &g_progress.slots[worker % PROGRESS_SLOTS];
+}
+
+void progress_phase(ProgressPhase phase) {
+    if (phase == PROGRESS_HASHING) {
+        InterlockedExchange64(&g_progress.hash_started, (LONG64)GetTickCount64());
+    }
+    InterlockedExchange(&g_progress.phase, phase);
+}
+
+void progress_sample(ProgressSample* sample) {
+    memset(sample, 0, sizeof(ProgressSample));
+    sample->phase = (ProgressPhase)g_progress.phase;
+    
+    for (int i = 0; i < PROGRESS_SLOTS; i++) {
+        ProgressSlot* slot = &g_progress.slots[i];
+        sample->files_enumerated += InterlockedCompareExchange64(&slot->files_enumerated, 0, 0);
+        sample->bytes_enumerated += InterlockedCompareExchange64(&slot->bytes_enumerated, 0, 0);
+        sample->files_hashed += InterlockedCompareExchange64(&slot->files_hashed, 0, 0);
+        sample->bytes_hashed += InterlockedCompareExchange64(&slot->bytes_hashed, 0, 0);
+    }
+    sample->bytes_pending = sample->bytes_enumerated - sample->bytes_hashed;
+    if (sample->bytes_pending < 0) sample->bytes_pending = 0;
+    
+    // Rates over the hashing phase only: enumeration reads no file data
+    LONG64 hash_started = InterlockedCompareExchange64(&g_progress.hash_started, 0, 0);
+    if (sample->phase == PROGRESS_ENUMERATING || hash_started == 0) return;
+    
+    double seconds = (double)(GetTickCount64() - (ULONGLONG)hash_started) / 1000.0;
+    if (sample->bytes_enumerated > 0) {
+        sample->percent = (double)sample->bytes_hashed * 100.0 / sample->bytes_enumerated;
+    } else if (sample->files_enumerated > 0) {
+        sample->percent = (double)sample->files_hashed * 100.0 / sample->files_enumerated;
+    }
+    if (seconds > 0) {
+        sample->bytes_per_second = sample->bytes_hashed / seconds;
+        sample->files_per_second = sample->files_hashed / seconds;
+    }
+    if (sample->bytes_per_second > 0) {
+        sample->eta_seconds = sample->bytes_pending / sample->bytes_per_second;
+    } else {
+        sample->eta_seconds = -1;
+    }
+}
+
 // ============================================================================
 // UTILITY: GET SCAN MODE NAME
 // ============================================================================
@@ -290,4 +534,73 @@ void format_file_size(long long bytes, char* output, int output_size) {
         snprintf(output, output_size, "%.2f GB", 
                 bytes / (1024.0 * 1024.0 * 1024.0));
     }
-}
\ No newline at end of file
+}
+
+// ============================================================================
+// UTILITY: WORKER THREAD COUNT
+// 
+// One worker per logical processor, capped at MAX_WORKER_THREADS
+// ============================================================================
+int get_worker_count(void) {
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    
+    int n = (int)si.dwNumberOfProcessors;
+    if (n < 1) n = 1;
+    if (n > MAX_WORKER_THREADS) n = MAX_WORKER_THREADS;
+    return n;
+}
+
+// ============================================================================
+// UTILITY: PARALLEL FOR
+// 
+// Runs task(context, 0..tasks-1) on up to `threads` threads, the calling
+// thread included. Tasks are handed out through an atomic counter, so a
+// thread that fails to start only means fewer workers, never lost tasks.
+// ============================================================================
+typedef struct {
+    volatile LONG next;
+    int tasks;
+    ParallelTask task;
+    void* context;
+} ParallelJob;
+
+static DWORD WINAPI ParallelWorker(LPVOID param) {
+    ParallelJob* job = (ParallelJob*)param;
+    LONG task;
+    
+    while ((task = InterlockedIncrement(&job->next) - 1) < job->tasks) {
+        job->task(job->context, (int)task);
+    }
+    return 0;
+}
+
+void parallel_for(int tasks, int threads, ParallelTask task, void* context) {
+    if (tasks <= 0 || !task) return;
+    
+    ParallelJob job = {0, tasks, task, context};
+    HANDLE handles[MAX_WORKER_THREADS];
+    int started = 0;
+    
+    if (threads > tasks) threads = tasks;
+    if (threads > MAX_WORKER_THREADS) threads = MAX_WORKER_THREADS;
+    
+    for (int t = 1; t < threads; t++) {
+        handles[started] = CreateThread(NULL, 0, ParallelWorker, &job, 0, NULL);
+        if (!handles[started]) break;
+        started++;
+    }
+    
+    ParallelWorker(&job);
+    
+    if (started > 0) {
+        // Out of tasks: whatever the others still run is load imbalance
+        TELEMETRY_START(wait);
+        WaitForMultipleObjects(started, handles, TRUE, INFINITE);
+        TELEMETRY_STOP(TELEMETRY_QUEUE_WAIT, wait);
+        TELEMETRY_COUNT(TELEMETRY_QUEUE_WAITS, 1);
+        for (int t = 0; t < started; t++) {
+            CloseHandle(handles[t]);
+        }
+    }
+}
@@ -15,26 +15,36 @@ bool ensure_directory_exists(const char* path) {
 }
 
 
-int remove_duplicates_keep_first(DuplicateResults* results) {
-    if (!results || results->count == 0) return 0;
+// ============================================================================
+// RUN ON THE EXECUTOR
+// 
+// The three actions below keep member 0 of every group and hand the rest
+// to the action executor (executor.c), which runs them in parallel,
+// batched by directory. Callers that want per-file results or progress
+// build the plan themselves with action_plan_from_results.
+// 
+// RETURNS: Number of files the action succeeded on
+// ============================================================================
+static int run_keep_first(DuplicateResults* results, ActionKind kind, const char* dest_folder) {
+    ActionPlan* plan = action_plan_from_results(results, kind, dest_folder);
+    if (!plan) return 0;
     
-    int removed = 0;
+    action_execute(plan, ACTION_MAX_IN_FLIGHT);
+    int done = plan->succeeded;
     
-    for (int i = 0; i < results->count; i++) {
-        DuplicateGroup* group = &results->groups[i];
-        
-        // Delete all except first (index 0)
-        for (int j = 1; j < group->count; j++) {
-            if (DeleteFileA(group->files[j].path)) {
-                removed++;
-            }
-            // If delete fails, continue with next file
-        }
-    }
+    action_plan_free(plan);
+    return done;
+}
+
+int remove_duplicates_keep_first(DuplicateResults* results) {
+    if (!results || results->count == 0) return 0;
     
-    return removed;
+    return run_keep_first(results, ACTION_DELETE, NULL);
 }
 
+// Name conflicts in dest_folder get base_1.ext, base_2.ext, ... (flat;
+// set mirror_tree on a plan to keep the source folders instead). Files
+// on another volume than dest_folder are copied, flushed, then deleted.
 int move_duplicates(DuplicateResults* results, const char* dest_folder) {
     if (!results || !dest_folder) return 0;
     if (results->count == 0) return 0;
@@ -44,80 +54,7 @@ int move_duplicates(DuplicateResults* results, const char* dest_folder) {
         return 0;
     }
     
-    int moved = 0;
-    
-    for (int i = 0; i < results->count; i++) {
-        DuplicateGroup* group = &results->groups[i];
-        
-        // Move all except first
-        for (int j = 1; j < group->count; j++) {
-            // Extract filename from path
-            const char* filename = strrchr(group->files[j].path, '\\');
-            if (!filename) {
-                filename = group->files[j].path;
-            } else {
-                filename++;  // Skip backslash
-            }
-            
-            // Build destination path
-            char dest_path[MAX_PATH_LENGTH];
-            int len = snprintf(dest_path, MAX_PATH_LENGTH, 
-                              "%s\\%s", dest_folder, filename);
-            
-            if (len >= MAX_PATH_LENGTH - 1) {
-                continue;  // Path too long
-            }
-            
-            // Handle conflicts
-            if (GetFileAttributesA(dest_path) != INVALID_FILE_ATTRIBUTES) {
-                // File exists - append number
-                char base_name[MAX_PATH_LENGTH];
-                const char* ext = strrchr(filename, '.');
-                
-                if (ext) {
-                    // Split into base and extension
-                    size_t base_len = ext - filename;
-                    if (base_len >= MAX_PATH_LENGTH) {
-                        base_len = MAX_PATH_LENGTH - 1;
-                    }
-                    
-                    strncpy(base_name, filename, base_len);
-                    base_name[base_len] = '\0';
-                    
-                    // Try base_1.ext, base_2.ext, ...
-                    for (int n = 1; n < 10000; n++) {
-                        snprintf(dest_path, MAX_PATH_LENGTH, 
-                                "%s\\%s_%d%s", 
-                                dest_folder, base_name, n, ext);
-                        
-                        if (GetFileAttributesA(dest_path) == 
-                            INVALID_FILE_ATTRIBUTES) {
-                            break;  // Found available name
-                        }
-                    }
-                } else {
-                    // No extension
-                    for (int n = 1; n < 10000; n++) {
-                        snprintf(dest_path, MAX_PATH_LENGTH, 
-                                "%s\\%s_%d", 
-                                dest_folder, filename, n);
-                        
-                        if (GetFileAttributesA(dest_path) == 
-                            INVALID_FILE_ATTRIBUTES) {
-                            break;
-                        }
-                    }
-                }
-            }
-            
-            // Move file
-            if (MoveFileA(group->files[j].path, dest_path)) {
-                moved++;
-            }
-        }
-    }
-    
-    return moved;
+    return run_keep_first(results, ACTION_MOVE, dest_folder);
 }
 
 // ============================================================================
@@ -146,43 +83,57 @@ int move_duplicates(DuplicateResults* results, const char* dest_folder) {
 // - NTFS only (not FAT32)
 // - Files only (not directories in Windows)
 // 
-// ALGORITHM:
-// For each duplicate group:
-//   - Keep files[0] as source
-//   - Delete files[1..n]
-//   - Create hard links from deleted locations to files[0]
+// ALGORITHM (run by the action executor):
+// Step 1: Check. The source's volume must support hard links (once per
+//         group); each target must sit on the source's volume and must
+//         not already be a link of the source. Failing targets are
+//         skipped untouched.
+// Step 2: Operations are batched by target directory, so the renames in
+//         one directory run back to back (metadata updates stay local).
+// Step 3: Per target: create the link under a temporary name in the
+//         target's directory, then rename it over the target with
+//         MoveFileEx(MOVEFILE_REPLACE_EXISTING). The rename is atomic
+//         within a directory, so at any moment the target name holds
+//         either the old file or the link - never nothing. If a step
+//         fails, the temporary name is removed and the target is left
+//         as it was.
 // 
 // RETURNS: Number of hard links created
-// TIME COMPLEXITY: O(n) where n = duplicate files
+// TIME COMPLEXITY: O(n log n) where n = duplicate files
 // ============================================================================
 int create_hard_links(DuplicateResults* results) {
     if (!results || results->count == 0) return 0;
     
-    int link_count = 0;
+    return run_keep_first(results, ACTION_HARD_LINK, NULL);
+}
+
+bool volume_supports_hard_links(const char* path) {
+    char root[MAX_PATH_LENGTH];
+    DWORD flags = 0;
     
-    for (int i = 0; i < results->count; i++) {
-        DuplicateGroup* group = &results->groups[i];
-        
-        // Source is first file
-        const char* source = group->files[0].path;
-        
-        // Create links for all others
-        for (int j = 1; j < group->count; j++) {
-            const char* target = group->files[j].path;
-            
-            // Delete existing file
-            DeleteFileA(target);
-            
-            // Create hard link
-            // CreateHardLinkA(link_name, existing_file, security_attributes)
-            if (CreateHardLinkA(target, source, NULL)) {
-                link_count++;
-            }
-            // Fails if different drives, not NTFS, etc.
-        }
-    }
+    if (!GetVolumePathNameA(path, root, sizeof(root))) return false;
+    if (!GetVolumeInformationA(root, NULL, 0, NULL, NULL, &flags, NULL, 0)) return false;
+    return (flags & FILE_SUPPORTS_HARD_LINKS) != 0;
+}
+
+// Link + atomic rename over the target; the target survives any failure.
+// sequence only has to be unique among links made by this process at once.
+bool replace_with_link(const char* source, const char* target, int sequence) {
+    const char* slash = strrchr(target, PATH_SEP);
+    int dir_len = slash ? (int)(slash - target) : 0;
+    
+    char temp[MAX_PATH_LENGTH];
+    int len = snprintf(temp, sizeof(temp), "%.*s" PATH_SEP_STR ".dedup-link-%lu-%d.tmp",
+                       dir_len, target, (unsigned long)GetCurrentProcessId(), sequence);
+    if (len >= (int)sizeof(temp) - 1) return false;
     
-    return link_count;
+    if (!CreateHardLinkA(temp, source, NULL)) return false;
+    
+    if (!MoveFileExA(temp, target, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        DeleteFileA(temp);
+        return false;
+    }
+    return true;
 }
 
 /*
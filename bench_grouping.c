@@ -0,0 +1,260 @@
+/*
+ * BENCH_GROUPING.C - Hash-Table vs Sort-Based Grouping Benchmark
+ *
+ * Compares find_duplicates (filter.c, open-addressing table) with
+ * find_duplicates_sorted (sort_group.c, parallel radix sort).
+ *
+ * BUILD:
+ *   MSVC:  cl /O2 bench_grouping.c filter.c dup_table.c sort_group.c Traversal.c
+ *   MinGW: gcc -O2 -o bench_grouping bench_grouping.c filter.c dup_table.c sort_group.c Traversal.c
+ *
+ * USAGE:
+ *   bench_grouping [-t threads] [-r repeats] [-m max_fileinfo_gb] [records ...]
+ *   Default records: 1000000 10000000 50000000
+ *
+ * TWO LEVELS:
+ * 1. Core: the grouping step alone on compact (digest, size) records.
+ *    Runs at every size.
+ * 2. Full API: find_duplicates vs find_duplicates_sorted on FileInfo
+ *    tables. A FileInfo carries its path inline (~4 KB), so 50M records
+ *    would need ~200 GB; sizes over the -m budget are reported as skipped.
+ */
+
+#include "common.h"
+
+// The engine's scan code references these (normally owned by the GUI)
+CRITICAL_SECTION g_dataLock;
+ProgressInfo g_progress = {0};
+
+#define BENCH_DEFAULT_REPEATS 3
+#define BENCH_DUPLICATE_PERCENT 25
+
+// ============================================================================
+// SYNTHETIC RECORDS
+//
+// 75% distinct contents, 25% extra copies of them. Sizes are spread over
+// 1 KB .. 512 MB (log-uniform) like a real file population, so both engines
+// see realistic key entropy in the size field.
+// ============================================================================
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static void make_record(int i, int count, uint64_t* digest, long long* size) {
+    int unique = count - count / 100 * BENCH_DUPLICATE_PERCENT;
+    uint64_t content = (uint64_t)(i < unique ? i : mix64((uint64_t)i) % unique);
+
+    *digest = mix64(content + 1);
+    *size = (1LL << (10 + (*digest >> 59) % 20)) + (long long)((*digest >> 20) & 0xFFF);
+}
+
+static double now_seconds(void) {
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER t;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (double)t.QuadPart / (double)freq.QuadPart;
+}
+
+// ============================================================================
+// CORE: HASH GROUPING
+//
+// Mirrors phases 1-2 of find_duplicates: table insert per record, then a
+// counting pass over group ids.
+// ============================================================================
+static int core_hash_groups(const SortKey* keys, int count, int* file_group) {
+    DupTable table;
+    if (!dup_table_init(&table, (size_t)count)) return -1;
+
+    for (int i = 0; i < count; i++) {
+        file_group[i] = dup_table_insert(&table, keys[i].digest, (long long)keys[i].size);
+    }
+
+    int key_count = (int)table.size;
+    dup_table_free(&table);
+
+    int* counts = (int*)calloc(key_count, sizeof(int));
+    if (!counts) return -1;
+
+    for (int i = 0; i < count; i++) counts[file_group[i]]++;
+
+    int groups = 0;
+    for (int g = 0; g < key_count; g++) {
+        if (counts[g] > 1) groups++;
+    }
+
+    free(counts);
+    return groups;
+}
+
+// ============================================================================
+// CORE: SORT GROUPING
+//
+// Radix sort + one linear scan for runs of equal keys
+// ============================================================================
+static int core_sort_groups(SortKey* keys, SortKey* scratch, int count, int threads) {
+    SortKey* sorted = sort_keys_parallel(keys, scratch, count, threads);
+    if (!sorted) return -1;
+
+    int groups = 0;
+    for (int i = 0; i < count; ) {
+        int j = i + 1;
+        while (j < count && sorted[j].digest == sorted[i].digest &&
+               sorted[j].size == sorted[i].size) {
+            j++;
+        }
+        if (j - i > 1) groups++;
+        i = j;
+    }
+    return groups;
+}
+
+static void fill_keys(SortKey* keys, int count) {
+    for (int i = 0; i < count; i++) {
+        long long size;
+        make_record(i, count, &keys[i].digest, &size);
+        keys[i].size = (uint64_t)size;
+        keys[i].index = (uint32_t)i;
+    }
+}
+
+static void report(const char* level, const char* engine, int count,
+                   const double* times, int repeats, int groups) {
+    double best = times[0], sum = 0;
+    for (int r = 0; r < repeats; r++) {
+        if (times[r] < best) best = times[r];
+        sum += times[r];
+    }
+
+    printf("%-5s %-6s %10d %10.3f %10.3f %10.1f %10d\n",
+           level, engine, count, best, sum / repeats, count / best / 1e6, groups);
+}
+
+// ============================================================================
+// RUN ONE SIZE
+// ============================================================================
+static void bench_size(int count, int threads, int repeats, double max_fileinfo_gb) {
+    double times[64];
+    int hash_groups = -1, sort_groups = -1;
+
+    // ------------------------------------------------------------------ core
+    SortKey* keys = (SortKey*)malloc(count * sizeof(SortKey));
+    SortKey* scratch = (SortKey*)malloc(count * sizeof(SortKey));
+    int* file_group = (int*)malloc(count * sizeof(int));
+
+    if (!keys || !scratch || !file_group) {
+        printf("core  -      %10d   skipped (out of memory)\n", count);
+    } else {
+        fill_keys(keys, count);
+        for (int r = 0; r < repeats; r++) {
+            double t0 = now_seconds();
+            hash_groups = core_hash_groups(keys, count, file_group);
+            times[r] = now_seconds() - t0;
+        }
+        report("core", "hash", count, times, repeats, hash_groups);
+
+        for (int r = 0; r < repeats; r++) {
+            fill_keys(keys, count);   // Sorting is in place: restore input
+            double t0 = now_seconds();
+            sort_groups = core_sort_groups(keys, scratch, count, threads);
+            times[r] = now_seconds() - t0;
+        }
+        report("core", "sort", count, times, repeats, sort_groups);
+
+        if (hash_groups != sort_groups) {
+            printf("  MISMATCH: hash found %d groups, sort found %d\n",
+                   hash_groups, sort_groups);
+        }
+    }
+
+    free(keys);
+    free(scratch);
+    free(file_group);
+
+    // ------------------------------------------------------------------ full
+    double need_gb = (double)count * sizeof(FileInfo) / (1024.0 * 1024.0 * 1024.0);
+    if (need_gb > max_fileinfo_gb) {
+        printf("full  -      %10d   skipped (FileInfo table needs %.1f GB, budget %.1f GB)\n",
+               count, need_gb, max_fileinfo_gb);
+        return;
+    }
+
+    FileInfo* files = (FileInfo*)malloc((size_t)count * sizeof(FileInfo));
+    if (!files) {
+        printf("full  -      %10d   skipped (out of memory)\n", count);
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        make_record(i, count, &files[i].digest, &files[i].size);
+        snprintf(files[i].hash, HASH_LENGTH, "%016llx", (unsigned long long)files[i].digest);
+        snprintf(files[i].path, MAX_PATH_LENGTH, "C:\\bench\\%d.bin", i);
+        files[i].modified = 0;
+    }
+
+    for (int r = 0; r < repeats; r++) {
+        double t0 = now_seconds();
+        DuplicateResults results = find_duplicates(files, count);
+        times[r] = now_seconds() - t0;
+        hash_groups = results.count;
+        free_duplicate_results(&results);
+    }
+    report("full", "hash", count, times, repeats, hash_groups);
+
+    for (int r = 0; r < repeats; r++) {
+        double t0 = now_seconds();
+        DuplicateResults results = find_duplicates_sorted(files, count, threads);
+        times[r] = now_seconds() - t0;
+        sort_groups = results.count;
+        free_duplicate_results(&results);
+    }
+    report("full", "sort", count, times, repeats, sort_groups);
+
+    free(files);
+}
+
+int main(int argc, char* argv[]) {
+    int threads = get_worker_count();
+    int repeats = BENCH_DEFAULT_REPEATS;
+    double max_fileinfo_gb = 8.0;
+    int sizes[32];
+    int size_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            repeats = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            max_fileinfo_gb = atof(argv[++i]);
+        } else if (size_count < 32) {
+            sizes[size_count++] = atoi(argv[i]);
+        }
+    }
+
+    if (repeats < 1) repeats = 1;
+    if (repeats > 64) repeats = 64;
+
+    if (size_count == 0) {
+        sizes[size_count++] = 1000000;
+        sizes[size_count++] = 10000000;
+        sizes[size_count++] = 50000000;
+    }
+
+    printf("threads=%d repeats=%d duplicates=%d%%\n", threads, repeats, BENCH_DUPLICATE_PERCENT);
+    printf("%-5s %-6s %10s %10s %10s %10s %10s\n",
+           "level", "engine", "records", "best_s", "mean_s", "Mrec/s", "groups");
+
+    for (int i = 0; i < size_count; i++) {
+        if (sizes[i] > 1) {
+            bench_size(sizes[i], threads, repeats, max_fileinfo_gb);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,726 @@
+/*
+ * BENCH_HASH.C - Hash Kernel Microbenchmark
+ *
+ * Measures the throughput (GB/s) of each hashing kernel over buffer sizes
+ * from 64 B to 16 MB, from memory and through the compute_hash read path
+ * on page-cache-hot files.
+ *
+ * BUILD:
+ *   MSVC:  cl /O2 bench_hash.c Traversal.c filter.c dup_table.c sort_group.c
+ *          stream.c near.c rank.c
+ *   MinGW: gcc -O2 -o bench_hash bench_hash.c Traversal.c filter.c dup_table.c
+ *          sort_group.c stream.c near.c rank.c
+ *
+ * USAGE:
+ *   bench_hash [-t threads] [-r trials] [-w warmup] [-c first_cpu]
+ *              [-m min_trial_ms] [-d temp_dir] [-k kernel] [--mem-only]
+ *              [--file-only] [sizes ...]
+ *   Default sizes: 64 256 1K 4K 16K 64K 256K 1M 4M 16M
+ *
+ * DSA CONCEPTS DEMONSTRATED:
+ * 1. Kernel table: every kernel is an init/update/final triple plus the
+ *    name of the kernel whose digest it must reproduce. Adding a kernel
+ *    is three functions and one row in g_kernels.
+ * 2. Instruction-level parallelism: FNV-1a is one serial multiply chain
+ *    per byte. The lane kernels run 4 or 8 independent chains over
+ *    interleaved bytes, so the multiplier pipeline stays full. They give
+ *    a different digest, so they are a separate family, not a drop-in.
+ * 3. Streaming invariance: compute_hash feeds the kernel one read buffer
+ *    at a time, so every kernel must give the same digest however the
+ *    input is split. The cross-check tests this before any timing.
+ * 4. Order statistics: trial times are sorted and reported at the 50th,
+ *    90th and 99th percentile (the slow tail) rather than as a mean.
+ *
+ * METHOD:
+ * - Each thread is pinned to one CPU (SetThreadAffinityMask), so a trial
+ *   never migrates between caches mid-measurement.
+ * - Warm-up trials are run and discarded; they also calibrate how many
+ *   iterations make one trial last at least -m milliseconds, so 64 B
+ *   buffers are not measured at timer resolution.
+ * - mem:  the same buffer hashed repeatedly. Sizes up to the cache size
+ *         measure the kernel; 16 MB measures memory bandwidth.
+ * - file: open + fread in READ_BUFFER_SIZE chunks + hash + close, like
+ *         compute_hash, on a file read once beforehand so it is in the
+ *         page cache. Small sizes are dominated by the open.
+ * - With -t N, N pinned threads run the same trial together (released
+ *   by one event); the aggregate column is N x the median.
+ */
+
+#include "common.h"
+
+// The engine's scan code references these (normally owned by the GUI)
+CRITICAL_SECTION g_dataLock;
+ProgressInfo g_progress = {0};
+
+#define BENCH_DEFAULT_TRIALS 15
+#define BENCH_DEFAULT_WARMUP 3
+#define BENCH_MIN_TRIAL_MS 20
+#define BENCH_MAX_SIZES 32
+#define BENCH_MAX_TRIALS 1000
+#define BENCH_MAX_LANES 8
+
+// ============================================================================
+// HASH KERNELS
+//
+// State is shared by every kernel: up to BENCH_MAX_LANES running hashes
+// plus the number of bytes consumed so far (the lane kernels need it to
+// know which lane the next byte belongs to after a split).
+// ============================================================================
+typedef struct {
+    uint64_t lane[BENCH_MAX_LANES];
+    uint64_t position;
+} HashState;
+
+typedef struct {
+    const char* name;
+    const char* reference;    // Kernel whose digest this must match (NULL = none)
+    void (*init)(HashState* state);
+    void (*update)(HashState* state, const unsigned char* data, size_t length);
+    uint64_t (*final)(const HashState* state);
+} HashKernel;
+
+static void fnv_init(HashState* state) {
+    for (int k = 0; k < BENCH_MAX_LANES; k++) state->lane[k] = FNV_OFFSET_BASIS;
+    state->position = 0;
+}
+
+static uint64_t fnv_final(const HashState* state) {
+    return state->lane[0];
+}
+
+// ---------------------------------------------------------------- fnv1a
+// The loop in compute_hash_ex, byte for byte
+static void fnv1a_update(HashState* state, const unsigned char* data, size_t length) {
+    uint64_t hash = state->lane[0];
+    for (size_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= FNV_PRIME;
+    }
+    state->lane[0] = hash;
+    state->position += length;
+}
+
+// ---------------------------------------------------------------- fnv1a-u8
+// Same digest; one 8-byte load per 8 steps instead of 8 byte loads.
+// The multiply chain is still serial, so this only removes loop overhead.
+static void fnv1a_u8_update(HashState* state, const unsigned char* data, size_t length) {
+    uint64_t hash = state->lane[0];
+    size_t i = 0;
+
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);   // Little-endian: byte 0 in the low bits
+        hash = (hash ^ (word & 0xFF)) * FNV_PRIME;
+        hash = (hash ^ ((word >> 8) & 0xFF)) * FNV_PRIME;
+        hash = (hash ^ ((word >> 16) & 0xFF)) * FNV_PRIME;
+        hash = (hash ^ ((word >> 24) & 0xFF)) * FNV_PRIME;
+        hash = (hash ^ ((word >> 32) & 0xFF)) * FNV_PRIME;
+        hash = (hash ^ ((word >> 40) & 0xFF)) * FNV_PRIME;
+        hash = (hash ^ ((word >> 48) & 0xFF)) * FNV_PRIME;
+        hash = (hash ^ (word >> 56)) * FNV_PRIME;
+    }
+    for (; i < length; i++) {
+        hash ^= data[i];
+        hash *= FNV_PRIME;
+    }
+
+    state->lane[0] = hash;
+    state->position += length;
+}
+
+// ---------------------------------------------------------------- lanes
+// Byte n goes to lane n % lanes; each lane is plain FNV-1a over its bytes.
+// lanes is a compile-time constant at every call, so the inner loop
+// unrolls into independent multiplies.
+static inline void lanes_update(HashState* state, const unsigned char* data,
+                                size_t length, int lanes) {
+    uint64_t h[BENCH_MAX_LANES];
+    memcpy(h, state->lane, sizeof(h));
+    size_t i = 0;
+
+    // Finish the lane cycle a previous (split) call stopped in
+    int lane = (int)(state->position % (uint64_t)lanes);
+    while (lane != 0 && i < length) {
+        h[lane] = (h[lane] ^ data[i++]) * FNV_PRIME;
+        lane = (lane + 1) % lanes;
+    }
+
+    for (; i + (size_t)lanes <= length; i += lanes) {
+        for (int k = 0; k < lanes; k++) {
+            h[k] = (h[k] ^ data[i + k]) * FNV_PRIME;
+        }
+    }
+    for (int k = 0; i < length; k++, i++) {
+        h[k] = (h[k] ^ data[i]) * FNV_PRIME;
+    }
+
+    memcpy(state->lane, h, sizeof(h));
+    state->position += length;
+}
+
+static void fnv1a_x4_update(HashState* state, const unsigned char* data, size_t length) {
+    lanes_update(state, data, length, 4);
+}
+
+static void fnv1a_x8_update(HashState* state, const unsigned char* data, size_t length) {
+    lanes_update(state, data, length, 8);
+}
+
+// Fold the lanes (in order) into one FNV-1a word, then the length
+static uint64_t lanes_fold(const HashState* state, int lanes) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (int k = 0; k < lanes; k++) {
+        hash = (hash ^ state->lane[k]) * FNV_PRIME;
+    }
+    return (hash ^ state->position) * FNV_PRIME;
+}
+
+static uint64_t fnv1a_x4_final(const HashState* state) { return lanes_fold(state, 4); }
+static uint64_t fnv1a_x8_final(const HashState* state) { return lanes_fold(state, 8); }
+
+// ---------------------------------------------------------------- x4-ref
+// The lane digest computed one byte at a time: the reference the
+// unrolled lane kernels are checked against
+static void fnv1a_x4_ref_update(HashState* state, const unsigned char* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        int lane = (int)(state->position++ % 4);
+        state->lane[lane] = (state->lane[lane] ^ data[i]) * FNV_PRIME;
+    }
+}
+
+static void fnv1a_x8_ref_update(HashState* state, const unsigned char* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        int lane = (int)(state->position++ % 8);
+        state->lane[lane] = (state->lane[lane] ^ data[i]) * FNV_PRIME;
+    }
+}
+
+// To add a kernel: write init/update/final (or reuse fnv_init/fnv_final)
+// and add a row. Give it a reference if it must reproduce another
+// kernel's digest; the first row must stay the compute_hash kernel.
+static const HashKernel g_kernels[] = {
+    { "fnv1a",        NULL,          fnv_init, fnv1a_update,        fnv_final      },
+    { "fnv1a-u8",     "fnv1a",       fnv_init, fnv1a_u8_update,     fnv_final      },
+    { "fnv1a-x4-ref", NULL,          fnv_init, fnv1a_x4_ref_update, fnv1a_x4_final },
+    { "fnv1a-x4",     "fnv1a-x4-ref", fnv_init, fnv1a_x4_update,    fnv1a_x4_final },
+    { "fnv1a-x8-ref", NULL,          fnv_init, fnv1a_x8_ref_update, fnv1a_x8_final },
+    { "fnv1a-x8",     "fnv1a-x8-ref", fnv_init, fnv1a_x8_update,    fnv1a_x8_final },
+};
+
+#define KERNEL_COUNT ((int)(sizeof(g_kernels) / sizeof(g_kernels[0])))
+
+static const HashKernel* find_kernel(const char* name) {
+    for (int k = 0; k < KERNEL_COUNT; k++) {
+        if (strcmp(g_kernels[k].name, name) == 0) return &g_kernels[k];
+    }
+    return NULL;
+}
+
+static uint64_t hash_buffer(const HashKernel* kernel, const unsigned char* data, size_t length) {
+    HashState state;
+    kernel->init(&state);
+    kernel->update(&state, data, length);
+    return kernel->final(&state);
+}
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static void fill_random(unsigned char* data, size_t length, uint64_t seed) {
+    for (size_t i = 0; i < length; i += 8) {
+        uint64_t word = mix64(seed + i);
+        size_t n = length - i < 8 ? length - i : 8;
+        memcpy(data + i, &word, n);
+    }
+}
+
+static double now_seconds(void) {
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER t;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (double)t.QuadPart / (double)freq.QuadPart;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of an ascending array
+static double percentile(const double* sorted, int count, int p) {
+    int rank = (p * count + 99) / 100;
+    if (rank < 1) rank = 1;
+    return sorted[rank - 1];
+}
+
+static bool parse_size(const char* text, size_t* size) {
+    char* end;
+    double value = strtod(text, &end);
+    if (end == text || value <= 0) return false;
+    if (*end == 'K' || *end == 'k') { value *= 1024; end++; }
+    else if (*end == 'M' || *end == 'm') { value *= 1024 * 1024; end++; }
+    if (*end != '\0' || value > (double)(1ULL << 40)) return false;
+    *size = (size_t)value;
+    return true;
+}
+
+static void format_size(size_t size, char* text, size_t capacity) {
+    if (size >= 1024 * 1024 && size % (1024 * 1024) == 0) {
+        snprintf(text, capacity, "%zuM", size / (1024 * 1024));
+    } else if (size >= 1024 && size % 1024 == 0) {
+        snprintf(text, capacity, "%zuK", size / 1024);
+    } else {
+        snprintf(text, capacity, "%zu", size);
+    }
+}
+
+// ============================================================================
+// CORRECTNESS CROSS-CHECK
+//
+// Run before any timing; a kernel that fails is never benchmarked.
+// 1. fnv1a on a file == compute_hash on the same file.
+// 2. Every kernel with a reference gives the reference's digest, for all
+//    lengths 0..300 (every tail/lane alignment) and a few large buffers.
+// 3. Every kernel gives its one-shot digest when fed in random splits.
+// ============================================================================
+static bool check_split(const HashKernel* kernel, const unsigned char* data,
+                        size_t length, uint64_t seed) {
+    HashState state;
+    kernel->init(&state);
+    for (size_t done = 0; done < length; ) {
+        size_t piece = (size_t)(mix64(seed + done) % 97) + 1;
+        if (piece > length - done) piece = length - done;
+        kernel->update(&state, data + done, piece);
+        done += piece;
+    }
+    return kernel->final(&state) == hash_buffer(kernel, data, length);
+}
+
+static bool cross_check(const char* temp_dir) {
+    const size_t large = 3 * READ_BUFFER_SIZE + 13;
+    unsigned char* data = (unsigned char*)malloc(large);
+    if (!data) return false;
+    fill_random(data, large, 0x5EED);
+    bool ok = true;
+
+    // 1. Against compute_hash itself (multi-buffer file, odd length)
+    char path[MAX_PATH_LENGTH];
+    snprintf(path, sizeof(path), "%s\\dedup-bench-hash-%lu-check.bin",
+             temp_dir, (unsigned long)GetCurrentProcessId());
+    FILE* file = fopen(path, "wb");
+    bool written = file && fwrite(data, 1, large, file) == large;
+    if (file && fclose(file) != 0) written = false;
+
+    if (!written) {
+        printf("  cannot write %s\n", path);
+        ok = false;
+    } else {
+        char hex[HASH_LENGTH];
+        uint64_t expected = compute_hash(path, hex, SCAN_THOROUGH);
+        uint64_t got = hash_buffer(&g_kernels[0], data, large);
+        if (got != expected) {
+            printf("  MISMATCH: %s %016llx, compute_hash %016llx\n", g_kernels[0].name,
+                   (unsigned long long)got, (unsigned long long)expected);
+            ok = false;
+        }
+    }
+    DeleteFileA(path);
+
+    for (int k = 0; k < KERNEL_COUNT; k++) {
+        const HashKernel* kernel = &g_kernels[k];
+        const HashKernel* reference = kernel->reference ? find_kernel(kernel->reference) : NULL;
+
+        if (kernel->reference && !reference) {
+            printf("  %s: unknown reference kernel %s\n", kernel->name, kernel->reference);
+            ok = false;
+            continue;
+        }
+
+        // 2. Same digest as the reference (length 301 stands for "large")
+        for (size_t n = 0; reference && n <= 301; n++) {
+            size_t length = n <= 300 ? n : large;
+            uint64_t got = hash_buffer(kernel, data, length);
+            uint64_t expected = hash_buffer(reference, data, length);
+            if (got != expected) {
+                printf("  MISMATCH: %s vs %s at %zu bytes: %016llx != %016llx\n",
+                       kernel->name, reference->name, length,
+                       (unsigned long long)got, (unsigned long long)expected);
+                ok = false;
+                break;
+            }
+        }
+
+        // 3. Split invariance, starting at every offset in a lane cycle
+        for (size_t offset = 0; offset < 2 * BENCH_MAX_LANES; offset++) {
+            if (!check_split(kernel, data + offset, large - offset, offset) ||
+                !check_split(kernel, data + offset, 257, offset * 31)) {
+                printf("  MISMATCH: %s changes digest when the input is split\n",
+                       kernel->name);
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    free(data);
+    return ok;
+}
+
+// ============================================================================
+// ONE MEASUREMENT
+//
+// A Measure is one (kernel, input, size) cell. Every thread runs the same
+// warm-up and trials on its own buffer; samples[] holds seconds per
+// iteration, thread-major.
+// ============================================================================
+typedef enum {
+    INPUT_MEMORY,
+    INPUT_FILE
+} InputKind;
+
+typedef struct {
+    const HashKernel* kernel;
+    InputKind input;
+    size_t size;
+    const char* path;             // INPUT_FILE: the page-cache-hot file
+    int trials;
+    int warmup;
+    double min_trial;             // Seconds
+    int first_cpu;
+    int cpu_count;
+    HANDLE start;                 // Manual-reset: releases every thread at once
+    double* samples;              // threads * trials
+    volatile LONG failed;
+} Measure;
+
+typedef struct {
+    Measure* measure;
+    int index;
+    volatile uint64_t sink;       // Keeps the digests live
+} Worker;
+
+// Hash the file the way compute_hash_ex does: fopen, READ_BUFFER_SIZE
+// freads, fclose
+static uint64_t hash_file(const HashKernel* kernel, const char* path, unsigned char* buffer) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return 0;
+
+    HashState state;
+    size_t got;
+    kernel->init(&state);
+    while ((got = fread(buffer, 1, READ_BUFFER_SIZE, file)) > 0) {
+        kernel->update(&state, buffer, got);
+    }
+    fclose(file);
+    return kernel->final(&state);
+}
+
+static uint64_t run_iterations(Measure* m, unsigned char* buffer, long long iterations) {
+    uint64_t acc = 0;
+    for (long long n = 0; n < iterations; n++) {
+        if (m->input == INPUT_MEMORY) {
+            acc += hash_buffer(m->kernel, buffer, m->size);
+        } else {
+            acc += hash_file(m->kernel, m->path, buffer);
+        }
+    }
+    return acc;
+}
+
+static DWORD WINAPI measure_thread(LPVOID param) {
+    Worker* worker = (Worker*)param;
+    Measure* m = worker->measure;
+
+    int cpu = (m->first_cpu + worker->index) % m->cpu_count;
+    SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu);
+
+    size_t capacity = m->input == INPUT_MEMORY ? m->size : READ_BUFFER_SIZE;
+    unsigned char* buffer = (unsigned char*)malloc(capacity);
+    if (!buffer) {
+        InterlockedIncrement(&m->failed);
+        WaitForSingleObject(m->start, INFINITE);
+        return 0;
+    }
+    if (m->input == INPUT_MEMORY) {
+        fill_random(buffer, m->size, 0xB0B + worker->index);
+    }
+
+    WaitForSingleObject(m->start, INFINITE);
+
+    // Warm-up, doubling the iteration count until one trial is long enough
+    long long iterations = 1;
+    uint64_t acc = 0;
+    for (int w = 0; w < m->warmup || w == 0; w++) {
+        double t0 = now_seconds();
+        acc += run_iterations(m, buffer, iterations);
+        double elapsed = now_seconds() - t0;
+        while (elapsed * 2 < m->min_trial && iterations < (1LL << 40)) {
+            iterations *= 2;
+            elapsed *= 2;
+        }
+    }
+
+    double* samples = m->samples + (size_t)worker->index * m->trials;
+    for (int r = 0; r < m->trials; r++) {
+        double t0 = now_seconds();
+        acc += run_iterations(m, buffer, iterations);
+        samples[r] = (now_seconds() - t0) / (double)iterations;
+    }
+
+    worker->sink = acc;
+    free(buffer);
+    return 0;
+}
+
+// Returns false if a thread could not run; samples are then invalid
+static bool run_measure(Measure* m, int threads) {
+    HANDLE handles[MAX_WORKER_THREADS];
+    Worker workers[MAX_WORKER_THREADS];
+    int started = 0;
+
+    m->failed = 0;
+    m->start = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (!m->start) return false;
+
+    for (int i = 0; i < threads; i++) {
+        workers[i].measure = m;
+        workers[i].index = i;
+        handles[started] = CreateThread(NULL, 0, measure_thread, &workers[i], 0, NULL);
+        if (!handles[started]) {
+            InterlockedIncrement(&m->failed);
+            break;
+        }
+        started++;
+    }
+
+    SetEvent(m->start);
+    if (started > 0) WaitForMultipleObjects(started, handles, TRUE, INFINITE);
+    for (int i = 0; i < started; i++) CloseHandle(handles[i]);
+    CloseHandle(m->start);
+
+    return m->failed == 0;
+}
+
+// ============================================================================
+// REPORT
+//
+// Percentiles are of time per iteration, so p90 and p99 are the slow
+// tail; each is shown as the GB/s it corresponds to.
+// ============================================================================
+static void report(const Measure* m, int threads) {
+    int count = threads * m->trials;
+    double* sorted = (double*)malloc(count * sizeof(double));
+    if (!sorted) return;
+    memcpy(sorted, m->samples, count * sizeof(double));
+    qsort(sorted, count, sizeof(double), compare_double);
+
+    double gb = (double)m->size / 1e9;
+    double p50 = percentile(sorted, count, 50);
+    char size_text[32];
+    format_size(m->size, size_text, sizeof(size_text));
+
+    printf("%-13s %-4s %6s %10.3f %10.3f %10.3f %10.3f %10.3f %12.0f\n",
+           m->kernel->name, m->input == INPUT_MEMORY ? "mem" : "file", size_text,
+           gb / sorted[0], gb / p50,
+           gb / percentile(sorted, count, 90), gb / percentile(sorted, count, 99),
+           gb / p50 * threads, p50 * 1e9);
+
+    free(sorted);
+}
+
+static void bench_cell(Measure* m, int threads) {
+    if (!run_measure(m, threads)) {
+        char size_text[32];
+        format_size(m->size, size_text, sizeof(size_text));
+        printf("%-13s %-4s %6s   skipped (out of memory or thread start failed)\n",
+               m->kernel->name, m->input == INPUT_MEMORY ? "mem" : "file", size_text);
+        return;
+    }
+    report(m, threads);
+}
+
+// Write the file for one size and read it once so it is in the page cache
+static bool prepare_file(const char* path, size_t size) {
+    unsigned char* buffer = (unsigned char*)malloc(READ_BUFFER_SIZE);
+    if (!buffer) return false;
+
+    FILE* file = fopen(path, "wb");
+    bool ok = file != NULL;
+    for (size_t done = 0; ok && done < size; ) {
+        size_t n = size - done < READ_BUFFER_SIZE ? size - done : READ_BUFFER_SIZE;
+        fill_random(buffer, n, 0xF11E + done);
+        ok = fwrite(buffer, 1, n, file) == n;
+        done += n;
+    }
+    if (file && fclose(file) != 0) ok = false;
+
+    if (ok) {
+        file = fopen(path, "rb");
+        ok = file != NULL;
+        while (ok && fread(buffer, 1, READ_BUFFER_SIZE, file) > 0) {}
+        if (file) fclose(file);
+    }
+
+    free(buffer);
+    return ok;
+}
+
+static void print_usage(void) {
+    printf("Usage: bench_hash [-t threads] [-r trials] [-w warmup] [-c first_cpu]\n"
+           "                  [-m min_trial_ms] [-d temp_dir] [-k kernel] [--mem-only]\n"
+           "                  [--file-only] [sizes ...]\n"
+           "Sizes take K/M suffixes (default 64 256 1K 4K 16K 64K 256K 1M 4M 16M).\n"
+           "Kernels:");
+    for (int k = 0; k < KERNEL_COUNT; k++) printf(" %s", g_kernels[k].name);
+    printf("\n");
+}
+
+int main(int argc, char* argv[]) {
+    int threads = 1;
+    int trials = BENCH_DEFAULT_TRIALS;
+    int warmup = BENCH_DEFAULT_WARMUP;
+    int first_cpu = 0;
+    int min_trial_ms = BENCH_MIN_TRIAL_MS;
+    bool run_memory = true, run_file = true;
+    const HashKernel* only = NULL;
+    char temp_dir[MAX_PATH_LENGTH] = "";
+    size_t sizes[BENCH_MAX_SIZES];
+    int size_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            trials = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            first_cpu = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            min_trial_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            snprintf(temp_dir, sizeof(temp_dir), "%s", argv[++i]);
+        } else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+            only = find_kernel(argv[++i]);
+            if (!only) {
+                printf("Unknown kernel: %s\n", argv[i]);
+                print_usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--mem-only") == 0) {
+            run_file = false;
+        } else if (strcmp(argv[i], "--file-only") == 0) {
+            run_memory = false;
+        } else if (argv[i][0] == '-') {
+            print_usage();
+            return 1;
+        } else if (size_count < BENCH_MAX_SIZES) {
+            if (!parse_size(argv[i], &sizes[size_count])) {
+                printf("Bad size: %s\n", argv[i]);
+                return 1;
+            }
+            size_count++;
+        }
+    }
+
+    if (threads < 1) threads = 1;
+    if (threads > MAX_WORKER_THREADS) threads = MAX_WORKER_THREADS;
+    if (trials < 1) trials = 1;
+    if (trials > BENCH_MAX_TRIALS) trials = BENCH_MAX_TRIALS;
+    if (warmup < 0) warmup = 0;
+    if (min_trial_ms < 1) min_trial_ms = 1;
+
+    if (size_count == 0) {
+        for (size_t size = 64; size <= 16 * 1024 * 1024; size *= 4) {
+            sizes[size_count++] = size;
+        }
+    }
+
+    if (!temp_dir[0]) {
+        DWORD n = GetTempPathA(sizeof(temp_dir), temp_dir);
+        if (n == 0 || n >= sizeof(temp_dir)) strcpy(temp_dir, ".");
+    }
+    size_t dir_length = strlen(temp_dir);
+    if (dir_length > 1 && (temp_dir[dir_length - 1] == '\\' || temp_dir[dir_length - 1] == '/')) {
+        temp_dir[dir_length - 1] = '\0';
+    }
+
+    // Affinity masks are one bit per CPU in a DWORD_PTR
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int cpu_count = (int)info.dwNumberOfProcessors;
+    if (cpu_count < 1) cpu_count = 1;
+    if (cpu_count > (int)(sizeof(DWORD_PTR) * 8)) cpu_count = (int)(sizeof(DWORD_PTR) * 8);
+    if (first_cpu < 0) first_cpu = 0;
+    first_cpu %= cpu_count;
+
+    printf("Cross-checking %d kernels...\n", KERNEL_COUNT);
+    if (!cross_check(temp_dir)) {
+        printf("Cross-check failed; not benchmarking.\n");
+        return 1;
+    }
+    printf("  all kernels agree\n\n");
+
+    printf("threads=%d trials=%d warmup=%d min_trial=%dms cpus=%d..%d\n",
+           threads, trials, warmup, min_trial_ms,
+           first_cpu, (first_cpu + threads - 1) % cpu_count);
+    printf("%-13s %-4s %6s %10s %10s %10s %10s %10s %12s\n",
+           "kernel", "in", "size", "best_GB/s", "p50_GB/s", "p90_GB/s", "p99_GB/s",
+           "aggr_GB/s", "p50_ns/call");
+
+    Measure m;
+    memset(&m, 0, sizeof(m));
+    m.trials = trials;
+    m.warmup = warmup;
+    m.min_trial = min_trial_ms / 1000.0;
+    m.first_cpu = first_cpu;
+    m.cpu_count = cpu_count;
+    m.samples = (double*)malloc((size_t)threads * trials * sizeof(double));
+    if (!m.samples) {
+        printf("Out of memory\n");
+        return 1;
+    }
+
+    for (int s = 0; s < size_count; s++) {
+        m.size = sizes[s];
+
+        char path[MAX_PATH_LENGTH];
+        bool have_file = false;
+        if (run_file) {
+            snprintf(path, sizeof(path), "%s\\dedup-bench-hash-%lu-%zu.bin",
+                     temp_dir, (unsigned long)GetCurrentProcessId(), m.size);
+            have_file = prepare_file(path, m.size);
+            if (!have_file) printf("  cannot write %s; file rows skipped\n", path);
+            m.path = path;
+        }
+
+        for (int k = 0; k < KERNEL_COUNT; k++) {
+            m.kernel = &g_kernels[k];
+            if (only && m.kernel != only) continue;
+
+            if (run_memory) {
+                m.input = INPUT_MEMORY;
+                bench_cell(&m, threads);
+            }
+            if (have_file) {
+                m.input = INPUT_FILE;
+                bench_cell(&m, threads);
+            }
+        }
+
+        if (have_file) DeleteFileA(path);
+    }
+
+    free(m.samples);
+    return 0;
+}
@@ -0,0 +1,740 @@
+/*
+ * BENCH_PIPELINE.C - End-to-End Benchmark on Synthetic Trees
+ *
+ * Generates a directory tree of known shape, then times every stage of
+ * the engine on it: enumeration, hashing, the whole scan, both grouping
+ * engines, and each action. Every stage runs -r times; the report gives
+ * mean, standard deviation, min and max, plus throughput.
+ *
+ * BUILD:
+ *   MSVC:  cl /O2 bench_pipeline.c Traversal.c filter.c dup_table.c sort_group.c
+ *          stream.c near.c rank.c action.c executor.c name_registry.c journal.c
+ *          planner.c quarantine.c telemetry.c shell32.lib
+ *   MinGW: gcc -O2 -o bench_pipeline bench_pipeline.c Traversal.c filter.c dup_table.c
+ *          sort_group.c stream.c near.c rank.c action.c executor.c name_registry.c
+ *          journal.c planner.c quarantine.c telemetry.c -lshell32
+ *
+ * USAGE:
+ *   bench_pipeline [-t threads] [-r repeats] [-q|-T] [-f files] [-d depth] [-w fanout]
+ *                  [--sizes min:max] [--dup pct] [--prefix pct] [--same-size pct]
+ *                  [--seed n] [--no-actions] [--keep] [-o results.json] root
+ *   bench_pipeline --compare baseline.json results.json
+ *
+ * root must not exist (or be a tree this program generated): the actions
+ * delete, move and link files under it. The move and quarantine actions
+ * write to root\_moved and root\_store, so everything stays under root,
+ * which is removed at the end unless --keep is given.
+ *
+ * TREE SHAPE (all from --seed, so two runs build identical trees):
+ * - fanout^depth leaf directories, files spread over them at random
+ * - sizes log-uniform between min and max (like a real file population)
+ * - dup%        exact copies of an earlier file
+ * - prefix%     same size and contents as an earlier file except the last
+ *               8 bytes: a quick scan of files over 1 MB groups them
+ *               (it only hashes the first 1 MB), a thorough one does not
+ * - same-size%  an earlier file's size, unrelated contents
+ * - the rest    unique
+ * The generator knows which files are equal, so every grouping run is
+ * checked against the expected number of groups.
+ *
+ * Timings are with a warm cache: the tree was just written (or listed).
+ * Actions regenerate the tree before each run, untimed.
+ *
+ * RESULTS FILE: JSON, one stage per line, so runs of two versions can be
+ * diffed or compared with --compare, which exits with status 1 if a
+ * stage got slower by more than its noise.
+ */
+
+#include "common.h"
+#include <math.h>
+
+// The engine's scan code references these (normally owned by the GUI)
+CRITICAL_SECTION g_dataLock;
+ProgressInfo g_progress = {0};
+
+#define BENCH_DEFAULT_REPEATS 5
+#define BENCH_MAX_REPEATS 64
+#define BENCH_DEFAULT_FILES 2000
+#define BENCH_DEFAULT_DEPTH 3
+#define BENCH_DEFAULT_FANOUT 4
+#define BENCH_MAX_LEAVES 65536
+#define BENCH_MARKER ".dedup-bench"
+#define BENCH_WRITE_BUFFER (1024 * 1024)
+#define BENCH_RESULTS_VERSION 1
+#define BENCH_NOISE_SIGMAS 2.0          // --compare: slower beyond 2 stddev...
+#define BENCH_NOISE_FLOOR 0.05          // ...and by more than 5%
+
+typedef struct {
+    int files;
+    int depth;
+    int fanout;
+    long long min_size;
+    long long max_size;
+    int dup_percent;
+    int prefix_percent;
+    int same_size_percent;
+    uint64_t seed;
+} TreeShape;
+
+// What the generator made file i out of
+typedef struct {
+    uint64_t content;        // Byte stream id
+    uint64_t tail;           // 0, or a value written over the last 8 bytes
+    long long size;
+} FileRecipe;
+
+typedef enum {
+    STAGE_ENUMERATE,
+    STAGE_HASH,
+    STAGE_SCAN,
+    STAGE_GROUP_HASH,
+    STAGE_GROUP_SORT,
+    STAGE_DELETE,
+    STAGE_MOVE,
+    STAGE_LINK,
+    STAGE_QUARANTINE,
+    STAGE_COUNT
+} BenchStage;
+
+static const char* const STAGE_NAMES[STAGE_COUNT] = {
+    "enumerate", "hash", "scan", "group_hash", "group_sort",
+    "delete", "move", "link", "quarantine"
+};
+
+typedef struct {
+    double samples[BENCH_MAX_REPEATS];
+    int count;
+    long long items;         // Files per run
+    long long bytes;         // Bytes read per run (0 = not a data stage)
+    bool skipped;
+} StageResult;
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static double now_seconds(void) {
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER t;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (double)t.QuadPart / (double)freq.QuadPart;
+}
+
+// ============================================================================
+// TREE: RECIPES
+//
+// Decided up front for all files, so the expected groups are known
+// before a single byte is written.
+// ============================================================================
+static long long pick_size(const TreeShape* shape, uint64_t r) {
+    double lo = log((double)shape->min_size);
+    double hi = log((double)shape->max_size);
+    double u = (double)(r >> 11) / (double)(1ULL << 53);
+    return (long long)exp(lo + (hi - lo) * u);
+}
+
+static void plan_tree(const TreeShape* shape, FileRecipe* recipes) {
+    for (int i = 0; i < shape->files; i++) {
+        uint64_t r = mix64(shape->seed * 0x9E3779B97F4A7C15ULL + (uint64_t)i);
+        int kind = (int)(r % 100);
+        int k = i > 0 ? (int)(mix64(r) % (uint64_t)i) : 0;   // The earlier file
+        int prefix_from = shape->dup_percent;
+        int same_size_from = prefix_from + shape->prefix_percent;
+        int unique_from = same_size_from + shape->same_size_percent;
+        FileRecipe* f = &recipes[i];
+
+        if (i > 0 && kind < prefix_from) {
+            *f = recipes[k];
+        } else if (i > 0 && kind < same_size_from) {
+            *f = recipes[k];
+            f->tail = (uint64_t)i + 1;
+        } else if (i > 0 && kind < unique_from) {
+            f->content = (uint64_t)i;
+            f->tail = 0;
+            f->size = recipes[k].size;
+        } else {
+            f->content = (uint64_t)i;
+            f->tail = 0;
+            f->size = pick_size(shape, mix64(r ^ 0x5BD1E995));
+        }
+    }
+}
+
+static int compare_recipe(const void* a, const void* b) {
+    const FileRecipe* x = (const FileRecipe*)a;
+    const FileRecipe* y = (const FileRecipe*)b;
+    if (x->content != y->content) return x->content < y->content ? -1 : 1;
+    if (x->tail != y->tail) return x->tail < y->tail ? -1 : 1;
+    if (x->size != y->size) return x->size < y->size ? -1 : 1;
+    return 0;
+}
+
+// Groups the scan must find: runs of >1 equal recipes. A quick scan
+// does not see the tail of a file longer than what it hashes.
+static int expected_groups(const FileRecipe* recipes, int count, ScanMode mode) {
+    FileRecipe* keys = (FileRecipe*)malloc((size_t)count * sizeof(FileRecipe));
+    if (!keys) return -1;
+
+    for (int i = 0; i < count; i++) {
+        keys[i] = recipes[i];
+        if (mode == SCAN_QUICK && keys[i].size > QUICK_HASH_SIZE) keys[i].tail = 0;
+    }
+    qsort(keys, count, sizeof(FileRecipe), compare_recipe);
+
+    int groups = 0;
+    for (int i = 0; i < count; ) {
+        int j = i + 1;
+        while (j < count && compare_recipe(&keys[i], &keys[j]) == 0) j++;
+        if (j - i > 1) groups++;
+        i = j;
+    }
+
+    free(keys);
+    return groups;
+}
+
+// ============================================================================
+// TREE: ON DISK
+// ============================================================================
+static bool leaf_path(const char* root, const TreeShape* shape, int leaf, char* out) {
+    int len = snprintf(out, MAX_PATH_LENGTH, "%s", root);
+    for (int level = 0; level < shape->depth && len < MAX_PATH_LENGTH; level++) {
+        len += snprintf(out + len, MAX_PATH_LENGTH - len, "\\d%d", leaf % shape->fanout);
+        leaf /= shape->fanout;
+    }
+    return len < MAX_PATH_LENGTH - 16;
+}
+
+static int leaf_count(const TreeShape* shape) {
+    int leaves = 1;
+    for (int level = 0; level < shape->depth && leaves <= BENCH_MAX_LEAVES; level++) {
+        leaves *= shape->fanout;
+    }
+    return leaves;
+}
+
+static bool write_file(const char* path, const FileRecipe* recipe, unsigned char* buffer) {
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+
+    uint64_t state = mix64(recipe->content + 1) | 1;
+    long long left = recipe->size;
+    bool ok = true;
+
+    while (left > 0 && ok) {
+        size_t chunk = left < BENCH_WRITE_BUFFER ? (size_t)left : BENCH_WRITE_BUFFER;
+        for (size_t b = 0; b < chunk; b += 8) {
+            state ^= state << 13;            // xorshift64
+            state ^= state >> 7;
+            state ^= state << 17;
+            memcpy(buffer + b, &state, chunk - b < 8 ? chunk - b : 8);
+        }
+
+        // The last 8 bytes of the file carry the tail
+        if (recipe->tail && left == (long long)chunk) {
+            uint64_t tail = mix64(recipe->tail);
+            for (int b = 0; b < 8 && (size_t)b < chunk; b++) {
+                buffer[chunk - 1 - b] ^= (unsigned char)(tail >> (8 * b)) | 1;
+            }
+        }
+
+        ok = fwrite(buffer, 1, chunk, file) == chunk;
+        left -= (long long)chunk;
+    }
+
+    return fclose(file) == 0 && ok;
+}
+
+// Refuses to touch a directory it did not generate
+static bool is_bench_tree(const char* root) {
+    char marker[MAX_PATH_LENGTH];
+    snprintf(marker, sizeof(marker), "%s\\" BENCH_MARKER, root);
+    return GetFileAttributesA(marker) != INVALID_FILE_ATTRIBUTES;
+}
+
+static void remove_tree(const char* dir) {
+    char pattern[MAX_PATH_LENGTH];
+    if (snprintf(pattern, sizeof(pattern), "%s\\*", dir) >= (int)sizeof(pattern)) return;
+
+    WIN32_FIND_DATAA ffd;
+    HANDLE hFind = FindFirstFileA(pattern, &ffd);
+    if (hFind != INVALID_HANDLE_VALUE) {
+        char path[MAX_PATH_LENGTH];
+        do {
+            if (strcmp(ffd.cFileName, ".") == 0 || strcmp(ffd.cFileName, "..") == 0) continue;
+            snprintf(path, sizeof(path), "%s\\%s", dir, ffd.cFileName);
+            if (ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+                remove_tree(path);
+            } else {
+                DeleteFileA(path);
+            }
+        } while (FindNextFileA(hFind, &ffd));
+        FindClose(hFind);
+    }
+    RemoveDirectoryA(dir);
+}
+
+static bool generate_tree(const char* root, const TreeShape* shape, const FileRecipe* recipes) {
+    if (GetFileAttributesA(root) != INVALID_FILE_ATTRIBUTES) {
+        if (!is_bench_tree(root)) return false;
+        remove_tree(root);
+    }
+
+    char path[MAX_PATH_LENGTH];
+    int leaves = leaf_count(shape);
+    for (int leaf = 0; leaf < leaves; leaf++) {
+        if (!leaf_path(root, shape, leaf, path)) return false;
+        int result = SHCreateDirectoryExA(NULL, path, NULL);
+        if (result != ERROR_SUCCESS && result != ERROR_ALREADY_EXISTS) return false;
+    }
+
+    unsigned char* buffer = (unsigned char*)malloc(BENCH_WRITE_BUFFER);
+    if (!buffer) return false;
+
+    bool ok = true;
+    for (int i = 0; i < shape->files && ok; i++) {
+        int leaf = (int)(mix64(shape->seed ^ ((uint64_t)i << 20)) % (uint64_t)leaves);
+        ok = leaf_path(root, shape, leaf, path);
+        if (ok) {
+            size_t len = strlen(path);
+            snprintf(path + len, sizeof(path) - len, "\\f%06d.bin", i);
+            ok = write_file(path, &recipes[i], buffer);
+        }
+    }
+    free(buffer);
+
+    // Marker last: only a completely written tree counts as ours
+    snprintf(path, sizeof(path), "%s\\" BENCH_MARKER, root);
+    FILE* marker = ok ? fopen(path, "w") : NULL;
+    if (marker) fclose(marker);
+    return marker != NULL;
+}
+
+// ============================================================================
+// STAGES
+// ============================================================================
+typedef struct {
+    FileInfo* files;
+    int count;
+    ScanMode mode;
+    volatile LONG next;
+} HashJob;
+
+// Same work as a scan's hash phase: workers pull files from a counter
+static void hash_task(void* context, int worker) {
+    HashJob* job = (HashJob*)context;
+    LONG i;
+    (void)worker;
+
+    while ((i = InterlockedIncrement(&job->next) - 1) < job->count) {
+        FileInfo* file = &job->files[i];
+        file->digest = compute_hash_ex(file->path, file->hash, job->mode, NULL, NULL, file);
+    }
+}
+
+static long long hashed_bytes(const FileInfo* files, int count, ScanMode mode) {
+    long long bytes = 0;
+    for (int i = 0; i < count; i++) {
+        bytes += (mode == SCAN_QUICK && files[i].size > QUICK_HASH_SIZE)
+                 ? QUICK_HASH_SIZE : files[i].size;
+    }
+    return bytes;
+}
+
+static void record(StageResult* stage, double seconds, long long items, long long bytes) {
+    if (stage->count < BENCH_MAX_REPEATS) stage->samples[stage->count++] = seconds;
+    stage->items = items;
+    stage->bytes = bytes;
+}
+
+static void check_groups(const char* engine, int found, int expected) {
+    if (found != expected) {
+        fprintf(stderr, "  MISMATCH: %s found %d groups, expected %d\n", engine, found, expected);
+    }
+}
+
+// Scan + group + one action on a fresh tree; only the action is timed
+static void bench_action(BenchStage stage, const char* root, const TreeShape* shape,
+                         const FileRecipe* recipes, const ScanConfig* config,
+                         FileInfo* files, StageResult* result) {
+    char other[MAX_PATH_LENGTH];
+    snprintf(other, sizeof(other), "%s\\%s", root, stage == STAGE_MOVE ? "_moved" : "_store");
+
+    // Also drops the previous run's _moved / _store
+    if (!generate_tree(root, shape, recipes)) {
+        fprintf(stderr, "  cannot regenerate %s\n", root);
+        result->skipped = true;
+        return;
+    }
+
+    int count = scan_directories(config, files, shape->files + 1);
+    DuplicateResults results = find_duplicates_parallel(files, count, config->threads);
+
+    int done = 0;
+    double t0 = now_seconds();
+    switch (stage) {
+        case STAGE_DELETE:
+            done = remove_duplicates_keep_first(&results);
+            break;
+        case STAGE_MOVE:
+            done = move_duplicates(&results, other);
+            break;
+        case STAGE_LINK:
+            done = create_hard_links(&results);
+            break;
+        case STAGE_QUARANTINE: {
+            QuarantineReport report;
+            quarantine_duplicates(&results, other, &report);
+            done = report.files;
+            break;
+        }
+        default:
+            break;
+    }
+    record(result, now_seconds() - t0, done, 0);
+
+    free_duplicate_results(&results);
+}
+
+// ============================================================================
+// REPORT
+// ============================================================================
+static void stage_stats(const StageResult* stage, double* mean, double* stddev,
+                        double* min, double* max) {
+    double sum = 0;
+    *min = *max = stage->samples[0];
+    for (int r = 0; r < stage->count; r++) {
+        sum += stage->samples[r];
+        if (stage->samples[r] < *min) *min = stage->samples[r];
+        if (stage->samples[r] > *max) *max = stage->samples[r];
+    }
+    *mean = sum / stage->count;
+
+    double squares = 0;
+    for (int r = 0; r < stage->count; r++) {
+        squares += (stage->samples[r] - *mean) * (stage->samples[r] - *mean);
+    }
+    *stddev = stage->count > 1 ? sqrt(squares / (stage->count - 1)) : 0;
+}
+
+static void print_results(const StageResult* stages) {
+    printf("%-11s %9s %10s %10s %10s %10s %12s %10s\n",
+           "stage", "files", "mean_s", "stddev_s", "min_s", "max_s", "files/s", "MB/s");
+
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        const StageResult* stage = &stages[s];
+        if (stage->skipped || stage->count == 0) {
+            printf("%-11s   skipped\n", STAGE_NAMES[s]);
+            continue;
+        }
+
+        double mean, stddev, min, max;
+        stage_stats(stage, &mean, &stddev, &min, &max);
+        printf("%-11s %9lld %10.4f %10.4f %10.4f %10.4f %12.0f",
+               STAGE_NAMES[s], stage->items, mean, stddev, min, max,
+               mean > 0 ? stage->items / mean : 0);
+        if (stage->bytes > 0 && mean > 0) {
+            printf(" %10.1f\n", stage->bytes / mean / (1024.0 * 1024.0));
+        } else {
+            printf(" %10s\n", "-");
+        }
+    }
+}
+
+static bool write_results(const char* path, const TreeShape* shape, ScanMode mode,
+                          int threads, int repeats, long long total_bytes,
+                          int expected, const StageResult* stages) {
+    FILE* out = fopen(path, "w");
+    if (!out) return false;
+
+    fprintf(out, "{\"version\":%d,\"mode\":\"%s\",\"threads\":%d,\"repeats\":%d,\n",
+            BENCH_RESULTS_VERSION, mode == SCAN_QUICK ? "quick" : "thorough", threads, repeats);
+    fprintf(out, "\"shape\":{\"files\":%d,\"depth\":%d,\"fanout\":%d,\"min_size\":%lld,"
+            "\"max_size\":%lld,\"duplicate_percent\":%d,\"prefix_percent\":%d,"
+            "\"same_size_percent\":%d,\"seed\":%llu,\"total_bytes\":%lld,"
+            "\"expected_groups\":%d},\n",
+            shape->files, shape->depth, shape->fanout, shape->min_size, shape->max_size,
+            shape->dup_percent, shape->prefix_percent, shape->same_size_percent,
+            (unsigned long long)shape->seed, total_bytes, expected);
+    fprintf(out, "\"stages\":[");
+
+    int written = 0;
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        const StageResult* stage = &stages[s];
+        if (stage->skipped || stage->count == 0) continue;
+
+        double mean, stddev, min, max;
+        stage_stats(stage, &mean, &stddev, &min, &max);
+        fprintf(out, "%s\n{\"stage\":\"%s\",\"files\":%lld,\"bytes\":%lld,\"mean_s\":%.6f,"
+                "\"stddev_s\":%.6f,\"min_s\":%.6f,\"max_s\":%.6f,\"samples\":[",
+                written++ ? "," : "", STAGE_NAMES[s], stage->items, stage->bytes,
+                mean, stddev, min, max);
+        for (int r = 0; r < stage->count; r++) {
+            fprintf(out, "%s%.6f", r ? "," : "", stage->samples[r]);
+        }
+        fprintf(out, "]}");
+    }
+    fprintf(out, "\n]}\n");
+
+    bool ok = !ferror(out);
+    return fclose(out) == 0 && ok;
+}
+
+// ============================================================================
+// COMPARE
+//
+// Reads back the stage lines of two results files. A stage regressed if
+// its mean grew by more than BENCH_NOISE_SIGMAS standard deviations (the
+// larger of the two runs') and by more than BENCH_NOISE_FLOOR.
+// ============================================================================
+typedef struct {
+    char name[32];
+    double mean;
+    double stddev;
+} StageLine;
+
+static int read_stage_lines(const char* path, StageLine* lines, int max) {
+    FILE* in = fopen(path, "r");
+    if (!in) return -1;
+
+    char line[8192];
+    int count = 0;
+    while (count < max && fgets(line, sizeof(line), in)) {
+        const char* stage = strstr(line, "\"stage\":\"");
+        const char* mean = strstr(line, "\"mean_s\":");
+        const char* stddev = strstr(line, "\"stddev_s\":");
+        if (!stage || !mean || !stddev) continue;
+
+        if (sscanf(stage + 9, "%31[^\"]", lines[count].name) == 1 &&
+            sscanf(mean + 9, "%lf", &lines[count].mean) == 1 &&
+            sscanf(stddev + 11, "%lf", &lines[count].stddev) == 1) {
+            count++;
+        }
+    }
+
+    fclose(in);
+    return count;
+}
+
+static int compare_results(const char* base_path, const char* new_path) {
+    StageLine base[STAGE_COUNT], current[STAGE_COUNT];
+    int base_count = read_stage_lines(base_path, base, STAGE_COUNT);
+    int new_count = read_stage_lines(new_path, current, STAGE_COUNT);
+
+    if (base_count < 0 || new_count < 0) {
+        fprintf(stderr, "cannot read '%s'\n", base_count < 0 ? base_path : new_path);
+        return 2;
+    }
+
+    int regressions = 0;
+    printf("%-11s %10s %10s %9s\n", "stage", "base_s", "new_s", "change");
+    for (int i = 0; i < new_count; i++) {
+        const StageLine* b = NULL;
+        for (int j = 0; j < base_count; j++) {
+            if (strcmp(base[j].name, current[i].name) == 0) b = &base[j];
+        }
+        if (!b || b->mean <= 0) {
+            printf("%-11s %10s %10.4f\n", current[i].name, "-", current[i].mean);
+            continue;
+        }
+
+        double change = (current[i].mean - b->mean) / b->mean;
+        double noise = BENCH_NOISE_SIGMAS *
+                       (b->stddev > current[i].stddev ? b->stddev : current[i].stddev);
+        bool slower = current[i].mean - b->mean > noise && change > BENCH_NOISE_FLOOR;
+
+        printf("%-11s %10.4f %10.4f %+8.1f%%%s\n", current[i].name, b->mean,
+               current[i].mean, change * 100.0, slower ? "  SLOWER" : "");
+        if (slower) regressions++;
+    }
+
+    return regressions > 0 ? 1 : 0;
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+static void print_usage(void) {
+    fprintf(stderr,
+        "usage:\n"
+        "  bench_pipeline [-t threads] [-r repeats] [-q|-T] [-f files] [-d depth] [-w fanout]\n"
+        "                 [--sizes min:max] [--dup pct] [--prefix pct] [--same-size pct]\n"
+        "                 [--seed n] [--no-actions] [--keep] [-o results.json] root\n"
+        "  bench_pipeline --compare baseline.json results.json\n");
+}
+
+int main(int argc, char* argv[]) {
+    TreeShape shape = {BENCH_DEFAULT_FILES, BENCH_DEFAULT_DEPTH, BENCH_DEFAULT_FANOUT,
+                       1024, 1024 * 1024, 25, 5, 10, 1};
+    int threads = get_worker_count();
+    int repeats = BENCH_DEFAULT_REPEATS;
+    ScanMode mode = SCAN_QUICK;
+    bool actions = true;
+    bool keep = false;
+    const char* out_path = NULL;
+    const char* root = NULL;
+
+    if (argc == 4 && strcmp(argv[1], "--compare") == 0) {
+        return compare_results(argv[2], argv[3]);
+    }
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            repeats = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-q") == 0) {
+            mode = SCAN_QUICK;
+        } else if (strcmp(argv[i], "-T") == 0) {
+            mode = SCAN_THOROUGH;
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            shape.files = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            shape.depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            shape.fanout = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%lld:%lld", &shape.min_size, &shape.max_size) != 2) {
+                fprintf(stderr, "bad sizes '%s', expected min:max\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--dup") == 0 && i + 1 < argc) {
+            shape.dup_percent = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--prefix") == 0 && i + 1 < argc) {
+            shape.prefix_percent = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--same-size") == 0 && i + 1 < argc) {
+            shape.same_size_percent = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            shape.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--no-actions") == 0) {
+            actions = false;
+        } else if (strcmp(argv[i], "--keep") == 0) {
+            keep = true;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (!root) {
+            root = argv[i];
+        } else {
+            print_usage();
+            return 2;
+        }
+    }
+
+    if (repeats < 1) repeats = 1;
+    if (repeats > BENCH_MAX_REPEATS) repeats = BENCH_MAX_REPEATS;
+    if (threads < 1 || threads > MAX_WORKER_THREADS) threads = get_worker_count();
+
+    // Sizes of at least 8 bytes, so every file has room for its tail
+    if (!root || shape.files < 2 || shape.files > MAX_FILES || shape.depth < 0 ||
+        shape.fanout < 1 || shape.fanout > BENCH_MAX_LEAVES || leaf_count(&shape) > BENCH_MAX_LEAVES ||
+        shape.min_size < 8 || shape.max_size < shape.min_size ||
+        shape.dup_percent < 0 || shape.prefix_percent < 0 || shape.same_size_percent < 0 ||
+        shape.dup_percent + shape.prefix_percent + shape.same_size_percent > 100) {
+        print_usage();
+        return 2;
+    }
+
+    InitializeCriticalSection(&g_dataLock);
+
+    FileRecipe* recipes = (FileRecipe*)malloc((size_t)shape.files * sizeof(FileRecipe));
+    FileInfo* files = (FileInfo*)malloc((size_t)(shape.files + 1) * sizeof(FileInfo));
+    if (!recipes || !files) {
+        fprintf(stderr, "out of memory for %d files\n", shape.files);
+        return 1;
+    }
+
+    plan_tree(&shape, recipes);
+    int expected = expected_groups(recipes, shape.files, mode);
+    long long total_bytes = 0;
+    for (int i = 0; i < shape.files; i++) total_bytes += recipes[i].size;
+
+    fprintf(stderr, "generating %d files (%.1f MB) under %s\n",
+            shape.files, total_bytes / (1024.0 * 1024.0), root);
+    if (!generate_tree(root, &shape, recipes)) {
+        fprintf(stderr, "cannot generate tree at '%s' (exists and not generated by "
+                "bench_pipeline, or not writable)\n", root);
+        return 1;
+    }
+
+    ScanConfig config = {0};
+    init_directory_list(&config.directories);
+    init_exclusion_list(&config.exclusions);
+    add_directory(&config.directories, root);
+    config.scan_mode = mode;
+    config.threads = threads;
+
+    StageResult stages[STAGE_COUNT];
+    memset(stages, 0, sizeof(stages));
+
+    // The marker file is listed too: one more than the generated files
+    int max_files = shape.files + 1;
+    int count = 0;
+
+    for (int r = 0; r < repeats; r++) {
+        config.skip_hash = true;
+        double t0 = now_seconds();
+        count = scan_directories(&config, files, max_files);
+        record(&stages[STAGE_ENUMERATE], now_seconds() - t0, count, 0);
+        config.skip_hash = false;
+
+        HashJob job = {files, count, mode, 0};
+        t0 = now_seconds();
+        parallel_for(threads, threads, hash_task, &job);
+        record(&stages[STAGE_HASH], now_seconds() - t0, count,
+               hashed_bytes(files, count, mode));
+
+        t0 = now_seconds();
+        count = scan_directories(&config, files, max_files);
+        record(&stages[STAGE_SCAN], now_seconds() - t0, count,
+               hashed_bytes(files, count, mode));
+
+        t0 = now_seconds();
+        DuplicateResults results = find_duplicates_parallel(files, count, threads);
+        record(&stages[STAGE_GROUP_HASH], now_seconds() - t0, count, 0);
+        check_groups("find_duplicates", results.count, expected);
+        free_duplicate_results(&results);
+
+        t0 = now_seconds();
+        results = find_duplicates_sorted(files, count, threads);
+        record(&stages[STAGE_GROUP_SORT], now_seconds() - t0, count, 0);
+        check_groups("find_duplicates_sorted", results.count, expected);
+        free_duplicate_results(&results);
+    }
+
+    if (actions) {
+        stages[STAGE_LINK].skipped = !volume_supports_hard_links(root);
+        for (int s = STAGE_DELETE; s <= STAGE_QUARANTINE; s++) {
+            for (int r = 0; r < repeats && !stages[s].skipped; r++) {
+                fprintf(stderr, "%s run %d/%d\n", STAGE_NAMES[s], r + 1, repeats);
+                bench_action((BenchStage)s, root, &shape, recipes, &config, files, &stages[s]);
+            }
+        }
+    } else {
+        for (int s = STAGE_DELETE; s <= STAGE_QUARANTINE; s++) stages[s].skipped = true;
+    }
+
+    printf("mode=%s threads=%d repeats=%d files=%d bytes=%lld expected_groups=%d\n",
+           mode == SCAN_QUICK ? "quick" : "thorough", threads, repeats, shape.files,
+           total_bytes, expected);
+    print_results(stages);
+
+    int status = 0;
+    if (out_path && !write_results(out_path, &shape, mode, threads, repeats, total_bytes,
+                                   expected, stages)) {
+        fprintf(stderr, "cannot write '%s'\n", out_path);
+        status = 1;
+    }
+
+    if (!keep) remove_tree(root);
+
+    free(recipes);
+    free(files);
+    DeleteCriticalSection(&g_dataLock);
+    return status;
+}
@@ -0,0 +1,938 @@
+/*
+ * CLI.C - Headless Command-Line Driver
+ *
+ * find runs the whole engine without the GUI: scan, group, rank, write
+ * the groups to stdout or a file, and optionally act on them - for batch
+ * jobs and scheduled tasks, and as the harness for timing the engine.
+ *
+ * The other commands split one scan across several worker processes (or
+ * hosts). Each worker hashes its shard of the files and writes a partial
+ * index; merge groups all indexes into one result without reading any
+ * file again.
+ *
+ * BUILD:
+ *   MSVC:  cl /O2 /Fededup_cli cli.c index_file.c Traversal.c filter.c dup_table.c
+ *          sort_group.c stream.c near.c rank.c telemetry.c action.c executor.c
+ *          name_registry.c journal.c planner.c quarantine.c clone.c shell32.lib
+ *   MinGW: gcc -O2 -o dedup_cli cli.c index_file.c Traversal.c filter.c dup_table.c
+ *          sort_group.c stream.c near.c rank.c telemetry.c action.c executor.c
+ *          name_registry.c journal.c planner.c quarantine.c clone.c -lshell32
+ *   Linux: gcc -O2 -pthread -o dedup_cli cli.c index_file.c Traversal.c filter.c
+ *          dup_table.c sort_group.c stream.c near.c rank.c telemetry.c action.c
+ *          executor.c name_registry.c journal.c planner.c quarantine.c clone.c
+ *          posix_compat.c -lm
+ *   Add /DDEDUP_TELEMETRY (MSVC) or -DDEDUP_TELEMETRY (gcc) for the
+ *   --telemetry and --snapshots options; without it they only warn.
+ *   On Linux, posix_compat.c supplies the Win32 calls the engine makes.
+ *
+ * USAGE:
+ *   dedup_cli find [-q|-t] [-x excluded]... [-n max_files] [--threads n]
+ *                  [--format text|csv|json] [-o out] [-g groups]
+ *                  [--delete | --move folder | --link | --clone] [--dry-run]
+ *                  [--journal file] [--telemetry report.json] root...
+ *   dedup_cli scan [-q|-t] [-n max_files] [--shard i/n] [--by-root]
+ *                  [--telemetry report.json] [--snapshots series.jsonl] -o out.idx root...
+ *   dedup_cli merge [-g groups] index...
+ *   dedup_cli info index...
+ *   dedup_cli run -j workers [-q|-t] [--by-root] [-o prefix] root...
+ *   dedup_cli undo [--journal file]
+ *   dedup_cli resume [--journal file]
+ *
+ * find writes groups largest savings first; -g limits how many are
+ * written (all by default), never which ones are acted on. Progress and
+ * summaries go to stderr, so stdout can be piped. Formats:
+ *   text   one block per group, as merge prints them
+ *   csv    group,size,hash,keep,path - one row per file, member 0 kept
+ *   json   one object per line per group (JSON Lines):
+ *          {"group":1,"size":..,"hash":"..","reclaimable":..,"files":[..]}
+ * The action keeps member 0 of every group, like the GUI buttons. An
+ * action always scans with -t: a quick-mode match covers only the first
+ * 1 MB, and a file that differs after it must not be deleted or linked.
+ * --clone keeps every file but shares their data blocks (ReFS; btrfs or
+ * XFS on Linux). --dry-run prints the planner's estimate instead of
+ * acting. Exit status is 1 if the action left any file untouched (for
+ * --link and --clone that includes files already linked or on another
+ * volume).
+ *
+ * Actions are recorded in the GUI's journal (%LOCALAPPDATA%\FileDedup,
+ * on Linux $XDG_STATE_HOME/FileDedup or ~/.local/state/FileDedup) unless
+ * --journal names another; --clone is not, as it changes no contents. undo reverses the last action; resume
+ * finishes one that was interrupted. No action starts while the journal
+ * is held elsewhere or the last action is still interrupted.
+ *
+ * run is the local test of the whole pipeline: it starts `workers` scan
+ * processes of this executable on the same box, waits for them, then
+ * merges prefix.0.idx .. prefix.<n-1>.idx. On several hosts, run scan
+ * with the same roots and --shard i/n on each, copy the indexes to one
+ * place and run merge.
+ */
+
+#include "common.h"
+
+// The engine's scan code references these (normally owned by the GUI)
+CRITICAL_SECTION g_dataLock;
+ProgressInfo g_progress = {0};
+
+#define CLI_DEFAULT_PREFIX "shard"
+#define CLI_DEFAULT_GROUPS 20
+
+typedef enum {
+    OUTPUT_TEXT,
+    OUTPUT_CSV,
+    OUTPUT_JSON
+} OutputFormat;
+
+static void print_usage(void) {
+    fprintf(stderr,
+        "usage:\n"
+        "  dedup_cli find [-q|-t] [-x excluded]... [-n max_files] [--threads n]\n"
+        "                 [--format text|csv|json] [-o out] [-g groups]\n"
+        "                 [--delete | --move folder | --link | --clone] [--dry-run]\n"
+        "                 [--journal file] [--telemetry report.json] root...\n"
+        "  dedup_cli scan [-q|-t] [-n max_files] [--shard i/n] [--by-root]\n"
+        "                 [--telemetry report.json] [--snapshots series.jsonl] -o out.idx root...\n"
+        "  dedup_cli merge [-g groups] index...\n"
+        "  dedup_cli info index...\n"
+        "  dedup_cli run -j workers [-q|-t] [--by-root] [-o prefix] root...\n"
+        "  dedup_cli undo [--journal file]\n"
+        "  dedup_cli resume [--journal file]\n");
+}
+
+// ============================================================================
+// FIND: OUTPUT
+//
+// Written group by group as the results are walked, so a consumer reading
+// the pipe sees the biggest groups first without waiting for the rest.
+// ============================================================================
+static void write_csv_field(FILE* out, const char* text) {
+    fputc('"', out);
+    for (const char* c = text; *c; c++) {
+        if (*c == '"') fputc('"', out);
+        fputc(*c, out);
+    }
+    fputc('"', out);
+}
+
+static void write_json_string(FILE* out, const char* text) {
+    fputc('"', out);
+    for (const unsigned char* c = (const unsigned char*)text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(out, "\\%c", *c);
+        } else if (*c < 0x20) {
+            fprintf(out, "\\u%04x", *c);
+        } else {
+            fputc(*c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void write_group(FILE* out, OutputFormat format, const DuplicateResults* results,
+                        int g) {
+    const DuplicateGroup* group = &results->groups[g];
+    const FileInfo* first = group_file(results, group, 0);
+    char size_text[64];
+
+    switch (format) {
+        case OUTPUT_TEXT:
+            format_file_size(group_reclaimable_bytes(group), size_text, sizeof(size_text));
+            fprintf(out, "\ngroup %d: %d files, frees %s\n", g + 1, group->count, size_text);
+            for (int j = 0; j < group->count; j++) {
+                fprintf(out, "  %s\n", group_file(results, group, j)->path);
+            }
+            break;
+
+        case OUTPUT_CSV:
+            for (int j = 0; j < group->count; j++) {
+                fprintf(out, "%d,%lld,%s,%d,", g + 1, group->size, first->hash, j == 0);
+                write_csv_field(out, group_file(results, group, j)->path);
+                fputc('\n', out);
+            }
+            break;
+
+        case OUTPUT_JSON:
+            fprintf(out, "{\"group\":%d,\"size\":%lld,\"hash\":\"%s\",\"reclaimable\":%lld,"
+                    "\"files\":[", g + 1, group->size, first->hash,
+                    group_reclaimable_bytes(group));
+            for (int j = 0; j < group->count; j++) {
+                if (j > 0) fputc(',', out);
+                write_json_string(out, group_file(results, group, j)->path);
+            }
+            fprintf(out, "]}\n");
+            break;
+    }
+}
+
+// ============================================================================
+// ACTION JOURNAL (journal.c)
+//
+// The CLI records its actions in the GUI's journal, so either one can
+// undo or finish the last action of both. Only one process at a time can
+// hold the journal.
+// ============================================================================
+static const char* const action_names[] = {"delete", "move", "link", "clone", "quarantine"};
+
+// %LOCALAPPDATA%\FileDedup\actions.journal, like the GUI; elsewhere
+// under $XDG_STATE_HOME (default ~/.local/state). Creates the folder.
+static bool default_journal_path(char* path, size_t size) {
+    char folder[MAX_PATH_LENGTH];
+    int len;
+#ifdef _WIN32
+    char appdata[MAX_PATH];
+    if (FAILED(SHGetFolderPathA(NULL, CSIDL_LOCAL_APPDATA, NULL, 0, appdata))) return false;
+    len = snprintf(folder, sizeof(folder), "%s\\FileDedup", appdata);
+#else
+    const char* state = getenv("XDG_STATE_HOME");
+    const char* home = getenv("HOME");
+    if (state && state[0] == '/') {
+        len = snprintf(folder, sizeof(folder), "%s/FileDedup", state);
+    } else if (home && home[0]) {
+        len = snprintf(folder, sizeof(folder), "%s/.local/state/FileDedup", home);
+    } else {
+        return false;
+    }
+#endif
+    if (len < 0 || (size_t)len >= sizeof(folder)) return false;
+
+    int error = SHCreateDirectoryExA(NULL, folder, NULL);
+    if (error != ERROR_SUCCESS && error != ERROR_ALREADY_EXISTS) return false;
+
+    len = snprintf(path, size, "%s" PATH_SEP_STR JOURNAL_FILE_NAME, folder);
+    return len > 0 && (size_t)len < size;
+}
+
+// path NULL = the default journal
+// RETURNS: the journal, or NULL after saying why not
+static Journal* open_cli_journal(const char* path) {
+    char default_path[MAX_PATH_LENGTH];
+    if (!path) {
+        if (!default_journal_path(default_path, sizeof(default_path))) {
+            fprintf(stderr, "cannot create the action journal folder, use --journal file\n");
+            return NULL;
+        }
+        path = default_path;
+    }
+
+    Journal* journal = journal_open(path);
+    if (!journal) {
+        DWORD error = GetLastError();
+        if (error == ERROR_SHARING_VIOLATION) {
+            fprintf(stderr, "action journal '%s' is held by another process "
+                    "(the GUI or another dedup_cli)\n", path);
+        } else {
+            fprintf(stderr, "cannot open action journal '%s' (error %lu)\n", path,
+                    (unsigned long)error);
+        }
+    }
+    return journal;
+}
+
+static void print_action_totals(const char* name, const ActionPlan* plan) {
+    fprintf(stderr, "%s: %d of %d file(s), %d skipped, %d failed\n", name,
+            plan->succeeded, plan->count, plan->skipped, plan->failed);
+}
+
+// ============================================================================
+// FIND: ACTION
+//
+// Runs on the action executor with the journal, like the GUI buttons
+// (clones go unrecorded, as there). Refused, with nothing touched, if the
+// journal cannot be opened or the last action was interrupted: a new
+// plan would replace the record that resume and undo need.
+// RETURNS: exit status, 1 if any duplicate was left untouched
+// ============================================================================
+static int act_on_results(DuplicateResults* results, ActionKind kind,
+                          const char* move_to, const char* journal_path, bool dry_run) {
+    if (dry_run) {
+        ActionEstimate estimate = estimate_action(results, kind, move_to);
+        char text[1024];
+        format_action_estimate(&estimate, text, sizeof(text));
+        fprintf(stderr, "dry run:\n%s\n", text);
+        return 0;
+    }
+
+    Journal* journal = NULL;
+    if (kind != ACTION_CLONE) {
+        journal = open_cli_journal(journal_path);
+        if (!journal) {
+            fprintf(stderr, "%s: not started, no file was changed\n", action_names[kind]);
+            return 1;
+        }
+    }
+
+    JournalState state;
+    action_plan_free(journal_load_last(journal, &state));
+    if (state == JOURNAL_INCOMPLETE || state == JOURNAL_UNDOING) {
+        fprintf(stderr, state == JOURNAL_UNDOING
+                ? "the last undo was interrupted: finish it with 'dedup_cli undo'\n"
+                : "the last action was interrupted: run 'dedup_cli resume' or "
+                  "'dedup_cli undo' first\n");
+        journal_close(journal);
+        return 1;
+    }
+
+    ActionPlan* plan = action_plan_from_results(results, kind, move_to);
+    if (!plan) {
+        fprintf(stderr, "out of memory planning the %s\n", action_names[kind]);
+        journal_close(journal);
+        return 1;
+    }
+    plan->journal = journal;
+
+    int status = 1;
+    if (!action_execute(plan, ACTION_MAX_IN_FLIGHT)) {
+        fprintf(stderr, "out of memory running the %s\n", action_names[kind]);
+    } else {
+        print_action_totals(action_names[kind], plan);
+        if (plan->succeeded == plan->count) status = 0;
+    }
+
+    action_plan_free(plan);
+    journal_close(journal);
+    return status;
+}
+
+// ============================================================================
+// FIND (scan + group + output [+ action])
+// ============================================================================
+static int cmd_find(int argc, char* argv[]) {
+    ScanConfig config = {0};
+    init_directory_list(&config.directories);
+    init_exclusion_list(&config.exclusions);
+    config.scan_mode = SCAN_QUICK;
+    config.directories.include_subdirs = true;
+
+    OutputFormat format = OUTPUT_TEXT;
+    const char* out_path = NULL;
+    const char* move_to = NULL;
+    const char* telemetry_path = NULL;
+    const char* journal_path = NULL;    // NULL = the GUI's
+    int max_files = MAX_FILES;
+    int max_groups = 0;                 // 0 = all
+    int action = -1;                    // ActionKind, -1 = report only
+    bool dry_run = false;
+    bool mode_given = false;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-q") == 0) {
+            config.scan_mode = SCAN_QUICK;
+            mode_given = true;
+        } else if (strcmp(argv[i], "-t") == 0) {
+            config.scan_mode = SCAN_THOROUGH;
+            mode_given = true;
+        } else if (strcmp(argv[i], "-x") == 0 && i + 1 < argc) {
+            if (!add_exclusion(&config.exclusions, argv[++i])) {
+                fprintf(stderr, "cannot add exclusion '%s'\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            max_files = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            config.threads = atoi(argv[++i]);
+            if (config.threads < 1 || config.threads > MAX_WORKER_THREADS) {
+                fprintf(stderr, "threads must be 1..%d\n", MAX_WORKER_THREADS);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "text") == 0) {
+                format = OUTPUT_TEXT;
+            } else if (strcmp(argv[i], "csv") == 0) {
+                format = OUTPUT_CSV;
+            } else if (strcmp(argv[i], "json") == 0) {
+                format = OUTPUT_JSON;
+            } else {
+                fprintf(stderr, "unknown format '%s'\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+            max_groups = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--delete") == 0) {
+            action = ACTION_DELETE;
+        } else if (strcmp(argv[i], "--move") == 0 && i + 1 < argc) {
+            action = ACTION_MOVE;
+            move_to = argv[++i];
+        } else if (strcmp(argv[i], "--link") == 0) {
+            action = ACTION_HARD_LINK;
+        } else if (strcmp(argv[i], "--clone") == 0) {
+            action = ACTION_CLONE;
+        } else if (strcmp(argv[i], "--dry-run") == 0) {
+            dry_run = true;
+        } else if (strcmp(argv[i], "--journal") == 0 && i + 1 < argc) {
+            journal_path = argv[++i];
+        } else if (strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc) {
+            telemetry_path = argv[++i];
+        } else if (!add_directory(&config.directories, argv[i])) {
+            fprintf(stderr, "cannot add root '%s'\n", argv[i]);
+            return 2;
+        }
+    }
+
+    if (config.directories.count == 0 || max_files <= 0 || max_groups < 0 ||
+        (dry_run && action < 0)) {
+        print_usage();
+        return 2;
+    }
+
+#ifndef DEDUP_TELEMETRY
+    if (telemetry_path) {
+        fprintf(stderr, "warning: built without DEDUP_TELEMETRY, no telemetry written\n");
+        telemetry_path = NULL;
+    }
+#endif
+
+    // Acting on a file needs all of its contents compared
+    if (action >= 0 && config.scan_mode == SCAN_QUICK) {
+        if (mode_given) fprintf(stderr, "warning: -q ignored, actions compare whole files\n");
+        config.scan_mode = SCAN_THOROUGH;
+    }
+
+    FileInfo* files = (FileInfo*)malloc((size_t)max_files * sizeof(FileInfo));
+    if (!files) {
+        fprintf(stderr, "out of memory for %d files\n", max_files);
+        return 1;
+    }
+
+    FILE* out = stdout;
+    if (out_path && !(out = fopen(out_path, "w"))) {
+        fprintf(stderr, "cannot write '%s'\n", out_path);
+        free(files);
+        return 1;
+    }
+
+    telemetry_reset();
+
+    int count = scan_directories(&config, files, max_files);
+    int threads = config.threads > 0 ? config.threads : get_worker_count();
+    DuplicateResults results = find_duplicates_parallel(files, count, threads);
+    if (results.failed) {
+        fprintf(stderr, "out of memory while grouping duplicates\n");
+        if (out != stdout) fclose(out);
+        free(files);
+        return 1;
+    }
+    rank_results_by_savings(&results, results.count, false);
+
+    long long total = 0;
+    for (int g = 0; g < results.count; g++) {
+        total += group_reclaimable_bytes(&results.groups[g]);
+    }
+    char size_text[64];
+    format_file_size(total, size_text, sizeof(size_text));
+    fprintf(stderr, "scanned %d file(s), %d group(s), reclaimable %s\n",
+            count, results.count, size_text);
+    if (count == max_files) {
+        fprintf(stderr, "warning: stopped at %d files (-n), results are partial\n", max_files);
+    }
+
+    if (format == OUTPUT_CSV) fprintf(out, "group,size,hash,keep,path\n");
+    int written = max_groups > 0 && max_groups < results.count ? max_groups : results.count;
+    for (int g = 0; g < written; g++) {
+        write_group(out, format, &results, g);
+    }
+
+    int status = 0;
+    bool written_ok = fflush(out) == 0 && !ferror(out);
+    if (out != stdout && fclose(out) != 0) written_ok = false;
+    if (!written_ok) {
+        fprintf(stderr, "cannot write '%s'\n", out_path ? out_path : "stdout");
+        status = 1;
+    }
+
+    if (status == 0 && action >= 0 && results.count > 0) {
+        status = act_on_results(&results, (ActionKind)action, move_to, journal_path,
+                                dry_run);
+    }
+
+    if (telemetry_path && !telemetry_write_report(telemetry_path)) {
+        fprintf(stderr, "warning: cannot write telemetry report '%s'\n", telemetry_path);
+    }
+
+    free_duplicate_results(&results);
+    free(files);
+    return status;
+}
+
+// ============================================================================
+// SCAN (one worker)
+// ============================================================================
+static int cmd_scan(int argc, char* argv[]) {
+    ScanConfig config = {0};
+    init_directory_list(&config.directories);
+    init_exclusion_list(&config.exclusions);
+    config.scan_mode = SCAN_QUICK;
+    config.directories.include_subdirs = true;
+
+    const char* out_path = NULL;
+    const char* telemetry_path = NULL;
+    const char* snapshot_path = NULL;
+    int max_files = MAX_FILES;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-q") == 0) {
+            config.scan_mode = SCAN_QUICK;
+        } else if (strcmp(argv[i], "-t") == 0) {
+            config.scan_mode = SCAN_THOROUGH;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            max_files = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--shard") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%d/%d", &config.shard_index, &config.shard_count) != 2 ||
+                config.shard_count < 1 || config.shard_index < 0 ||
+                config.shard_index >= config.shard_count) {
+                fprintf(stderr, "bad shard '%s', expected i/n with 0 <= i < n\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--by-root") == 0) {
+            config.shard_by_root = true;
+        } else if (strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc) {
+            telemetry_path = argv[++i];
+        } else if (strcmp(argv[i], "--snapshots") == 0 && i + 1 < argc) {
+            snapshot_path = argv[++i];
+        } else if (!add_directory(&config.directories, argv[i])) {
+            fprintf(stderr, "cannot add root '%s'\n", argv[i]);
+            return 2;
+        }
+    }
+
+    if (!out_path || config.directories.count == 0 || max_files <= 0) {
+        print_usage();
+        return 2;
+    }
+
+#ifndef DEDUP_TELEMETRY
+    if (telemetry_path || snapshot_path) {
+        fprintf(stderr, "warning: built without DEDUP_TELEMETRY, no telemetry written\n");
+        telemetry_path = snapshot_path = NULL;
+    }
+#endif
+
+    FileInfo* files = (FileInfo*)malloc((size_t)max_files * sizeof(FileInfo));
+    if (!files) {
+        fprintf(stderr, "out of memory for %d files\n", max_files);
+        return 1;
+    }
+
+    telemetry_reset();
+    if (snapshot_path && !telemetry_start_snapshots(snapshot_path, TELEMETRY_SNAPSHOT_MS)) {
+        fprintf(stderr, "warning: cannot write snapshots to '%s'\n", snapshot_path);
+    }
+
+    int count = scan_directories(&config, files, max_files);
+    bool ok = write_scan_index(out_path, &config, files, count);
+    free(files);
+
+    telemetry_stop_snapshots();
+    if (telemetry_path && !telemetry_write_report(telemetry_path)) {
+        fprintf(stderr, "warning: cannot write telemetry report '%s'\n", telemetry_path);
+    }
+
+    if (!ok) {
+        fprintf(stderr, "cannot write index '%s'\n", out_path);
+        return 1;
+    }
+
+    printf("shard %d/%d: %d files -> %s\n",
+           config.shard_count > 1 ? config.shard_index : 0,
+           config.shard_count > 1 ? config.shard_count : 1, count, out_path);
+    return 0;
+}
+
+// ============================================================================
+// MERGE
+//
+// merge_scan_indexes hands over one group at a time. Only the max_groups
+// groups that free the most bytes are copied (bounded min-heap, as in
+// rank.c); the rest are just counted, so printing a huge merge needs
+// memory for the shown groups alone.
+// ============================================================================
+typedef struct {
+    long long reclaimable;
+    int sequence;             // Arrival order: ties go to the earlier group
+    int count;
+    char** paths;
+} KeptGroup;
+
+typedef struct {
+    KeptGroup* heap;          // Root = smallest kept
+    int size;
+    int capacity;
+    int group_count;
+    long long total;
+    bool out_of_memory;
+} MergeTop;
+
+static bool kept_less(const KeptGroup* a, const KeptGroup* b) {
+    if (a->reclaimable != b->reclaimable) return a->reclaimable < b->reclaimable;
+    return a->sequence > b->sequence;
+}
+
+static void kept_sift_down(KeptGroup* heap, int size, int i) {
+    for (;;) {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+
+        if (left < size && kept_less(&heap[left], &heap[smallest])) smallest = left;
+        if (right < size && kept_less(&heap[right], &heap[smallest])) smallest = right;
+        if (smallest == i) return;
+
+        KeptGroup tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+static void kept_free(KeptGroup* group) {
+    for (int j = 0; j < group->count; j++) free(group->paths[j]);
+    free(group->paths);
+    group->paths = NULL;
+    group->count = 0;
+}
+
+static bool keep_group(void* context, const IndexRecord* members, int count) {
+    MergeTop* top = (MergeTop*)context;
+    KeptGroup candidate;
+    candidate.reclaimable = (long long)(count - 1) * members[0].size;
+    candidate.sequence = top->group_count++;
+    top->total += candidate.reclaimable;
+
+    if (top->capacity <= 0) return true;
+    if (top->size == top->capacity && !kept_less(&top->heap[0], &candidate)) return true;
+
+    candidate.count = 0;
+    candidate.paths = (char**)malloc(count * sizeof(char*));
+    if (!candidate.paths) {
+        top->out_of_memory = true;
+        return false;
+    }
+    for (int j = 0; j < count; j++) {
+        candidate.paths[j] = _strdup(members[j].path);
+        if (!candidate.paths[j]) {
+            kept_free(&candidate);
+            top->out_of_memory = true;
+            return false;
+        }
+        candidate.count++;
+    }
+
+    if (top->size < top->capacity) {
+        // Sift up
+        int i = top->size++;
+        top->heap[i] = candidate;
+        while (i > 0 && kept_less(&top->heap[i], &top->heap[(i - 1) / 2])) {
+            KeptGroup tmp = top->heap[i];
+            top->heap[i] = top->heap[(i - 1) / 2];
+            top->heap[(i - 1) / 2] = tmp;
+            i = (i - 1) / 2;
+        }
+    } else {
+        kept_free(&top->heap[0]);
+        top->heap[0] = candidate;
+        kept_sift_down(top->heap, top->size, 0);
+    }
+    return true;
+}
+
+static int merge_and_print(const char* const* paths, int count, int max_groups) {
+    MergeTop top = {0};
+    if (max_groups > 0) {
+        top.heap = (KeptGroup*)calloc(max_groups, sizeof(KeptGroup));
+        if (!top.heap) {
+            fprintf(stderr, "merge failed: out of memory\n");
+            return 1;
+        }
+        top.capacity = max_groups;
+    }
+
+    MergeReport report;
+    bool ok = merge_scan_indexes(paths, count, keep_group, &top, &report);
+    int status = 0;
+
+    if (!ok) {
+        fprintf(stderr, "merge failed: %s\n",
+                report.message[0] ? report.message : "out of memory");
+        status = 1;
+    } else {
+        printf("merged %d index(es): %lld files, %lld unreadable, %d group(s)\n",
+               report.index_count, report.record_count, report.error_count, top.group_count);
+        if (report.missing_shards > 0) {
+            printf("warning: %d of %d shards missing, results are partial\n",
+                   report.missing_shards, report.shard_count);
+        }
+        if (report.repeated_paths > 0) {
+            printf("warning: %lld file(s) were in more than one index; counted once\n",
+                   report.repeated_paths);
+        }
+
+        char size_text[64];
+        format_file_size(top.total, size_text, sizeof(size_text));
+        printf("reclaimable: %s\n", size_text);
+
+        // Heap sort: popping the smallest to the back leaves the largest first
+        for (int end = top.size - 1; end > 0; end--) {
+            KeptGroup tmp = top.heap[0];
+            top.heap[0] = top.heap[end];
+            top.heap[end] = tmp;
+            kept_sift_down(top.heap, end, 0);
+        }
+
+        for (int g = 0; g < top.size; g++) {
+            const KeptGroup* group = &top.heap[g];
+            format_file_size(group->reclaimable, size_text, sizeof(size_text));
+            printf("\ngroup %d: %d files, frees %s\n", g + 1, group->count, size_text);
+            for (int j = 0; j < group->count; j++) {
+                printf("  %s\n", group->paths[j]);
+            }
+        }
+    }
+
+    for (int g = 0; g < top.size; g++) kept_free(&top.heap[g]);
+    free(top.heap);
+    return status;
+}
+
+static int cmd_merge(int argc, char* argv[]) {
+    int max_groups = CLI_DEFAULT_GROUPS;
+    int first = 0;
+
+    if (argc >= 2 && strcmp(argv[0], "-g") == 0) {
+        max_groups = atoi(argv[1]);
+        first = 2;
+    }
+    if (first >= argc) {
+        print_usage();
+        return 2;
+    }
+
+    return merge_and_print((const char* const*)(argv + first), argc - first, max_groups);
+}
+
+// ============================================================================
+// INFO
+// ============================================================================
+static int cmd_info(int argc, char* argv[]) {
+    if (argc == 0) {
+        print_usage();
+        return 2;
+    }
+
+    int status = 0;
+    for (int i = 0; i < argc; i++) {
+        IndexHeader header;
+        DirectoryList roots;
+
+        if (!read_index_info(argv[i], &header, &roots)) {
+            fprintf(stderr, "%s: not a readable index\n", argv[i]);
+            status = 1;
+            continue;
+        }
+
+        printf("%s: v%u %s %s, shard %d/%d%s, %lld files, %lld unreadable\n",
+               argv[i], header.version, header.hash_name,
+               get_scan_mode_name(header.scan_mode),
+               header.shard_index, header.shard_count,
+               header.shard_by_root ? " by root" : "",
+               header.record_count, header.error_count);
+        for (int r = 0; r < roots.count; r++) {
+            printf("  root %s\n", roots.paths[r]);
+        }
+    }
+    return status;
+}
+
+// ============================================================================
+// RUN (local workers + merge)
+//
+// Every worker gets the same roots and its own --shard, so together they
+// hash each file exactly once.
+// ============================================================================
+static bool append_arg(char* cmd, size_t size, const char* arg) {
+    size_t len = strlen(cmd);
+    int written = snprintf(cmd + len, size - len, " \"%s\"", arg);
+    return written > 0 && (size_t)written < size - len;
+}
+
+static int cmd_run(int argc, char* argv[]) {
+    int workers = 0;
+    const char* prefix = CLI_DEFAULT_PREFIX;
+    const char* mode_flag = "-q";
+    bool by_root = false;
+    int first_root = argc;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            prefix = argv[++i];
+        } else if (strcmp(argv[i], "-q") == 0 || strcmp(argv[i], "-t") == 0) {
+            mode_flag = argv[i];
+        } else if (strcmp(argv[i], "--by-root") == 0) {
+            by_root = true;
+        } else {
+            first_root = i;
+            break;
+        }
+    }
+
+    // WaitForMultipleObjects takes at most MAXIMUM_WAIT_OBJECTS handles
+    if (workers < 1 || workers > MAX_WORKER_THREADS || first_root >= argc) {
+        print_usage();
+        return 2;
+    }
+
+    char self[MAX_PATH_LENGTH];
+    if (GetModuleFileNameA(NULL, self, sizeof(self)) == 0) {
+        fprintf(stderr, "cannot locate own executable\n");
+        return 1;
+    }
+
+    static char index_paths[MAX_WORKER_THREADS][MAX_PATH_LENGTH];
+    const char* merge_paths[MAX_WORKER_THREADS];
+    HANDLE processes[MAX_WORKER_THREADS];
+    int started = 0;
+    int status = 0;
+
+    for (int w = 0; w < workers; w++) {
+        snprintf(index_paths[w], MAX_PATH_LENGTH, "%s.%d.idx", prefix, w);
+        merge_paths[w] = index_paths[w];
+
+        // Command line: "self" scan <mode> --shard w/n [--by-root] -o "out" "root"...
+        static char cmd[32768];
+        char shard[32];
+        snprintf(shard, sizeof(shard), "%d/%d", w, workers);
+        snprintf(cmd, sizeof(cmd), "\"%s\" scan %s --shard %s%s -o",
+                 self, mode_flag, shard, by_root ? " --by-root" : "");
+
+        bool fits = append_arg(cmd, sizeof(cmd), index_paths[w]);
+        for (int i = first_root; fits && i < argc; i++) {
+            fits = append_arg(cmd, sizeof(cmd), argv[i]);
+        }
+        if (!fits) {
+            fprintf(stderr, "command line too long\n");
+            status = 1;
+            break;
+        }
+
+        STARTUPINFOA si;
+        PROCESS_INFORMATION pi;
+        memset(&si, 0, sizeof(si));
+        si.cb = sizeof(si);
+
+        if (!CreateProcessA(NULL, cmd, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi)) {
+            fprintf(stderr, "cannot start worker %d (error %lu)\n", w,
+                    (unsigned long)GetLastError());
+            status = 1;
+            break;
+        }
+        CloseHandle(pi.hThread);
+        processes[started++] = pi.hProcess;
+    }
+
+    if (started > 0) {
+        WaitForMultipleObjects(started, processes, TRUE, INFINITE);
+    }
+
+    for (int w = 0; w < started; w++) {
+        DWORD code = 1;
+        GetExitCodeProcess(processes[w], &code);
+        CloseHandle(processes[w]);
+        if (code != 0) {
+            fprintf(stderr, "worker %d failed (exit code %lu)\n", w, (unsigned long)code);
+            status = 1;
+        }
+    }
+
+    if (status != 0) return status;
+    return merge_and_print(merge_paths, workers, CLI_DEFAULT_GROUPS);
+}
+
+// ============================================================================
+// UNDO / RESUME (the last journaled action)
+//
+// undo reverses the files the last action got to, whether it finished,
+// was interrupted, or was itself being undone; resume finishes an
+// interrupted action. The same choices the GUI offers at startup.
+// ============================================================================
+static int cmd_last_action(int argc, char* argv[], bool undo) {
+    const char* journal_path = NULL;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--journal") == 0 && i + 1 < argc) {
+            journal_path = argv[++i];
+        } else {
+            print_usage();
+            return 2;
+        }
+    }
+
+    Journal* journal = open_cli_journal(journal_path);
+    if (!journal) return 1;
+
+    JournalState state;
+    ActionPlan* plan = journal_load_last(journal, &state);
+    int status = 1;
+
+    if (!plan || state == JOURNAL_CLEAN || (!undo && state != JOURNAL_INCOMPLETE)) {
+        fprintf(stderr, "there is no %s action to %s\n",
+                undo ? "journaled" : "interrupted", undo ? "undo" : "resume");
+    } else if (undo) {
+        if (journal_rollback(journal, plan, ACTION_MAX_IN_FLIGHT)) {
+            fprintf(stderr, "undo %s: %d file(s) restored, %d failed\n",
+                    action_names[plan->kind], plan->succeeded, plan->failed);
+            if (plan->failed == 0) status = 0;
+        } else {
+            fprintf(stderr, "cannot write the action journal, undo not finished\n");
+        }
+    } else {
+        plan->journal = journal;
+        if (action_execute(plan, ACTION_MAX_IN_FLIGHT)) {
+            print_action_totals(action_names[plan->kind], plan);
+            if (plan->failed == 0) status = 0;
+        } else {
+            fprintf(stderr, "out of memory running the %s\n", action_names[plan->kind]);
+        }
+    }
+
+    action_plan_free(plan);
+    journal_close(journal);
+    return status;
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage();
+        return 2;
+    }
+
+    InitializeCriticalSection(&g_dataLock);
+
+    int status;
+    if (strcmp(argv[1], "find") == 0) {
+        status = cmd_find(argc - 2, argv + 2);
+    } else if (strcmp(argv[1], "scan") == 0) {
+        status = cmd_scan(argc - 2, argv + 2);
+    } else if (strcmp(argv[1], "merge") == 0) {
+        status = cmd_merge(argc - 2, argv + 2);
+    } else if (strcmp(argv[1], "info") == 0) {
+        status = cmd_info(argc - 2, argv + 2);
+    } else if (strcmp(argv[1], "run") == 0) {
+        status = cmd_run(argc - 2, argv + 2);
+    } else if (strcmp(argv[1], "undo") == 0) {
+        status = cmd_last_action(argc - 2, argv + 2, true);
+    } else if (strcmp(argv[1], "resume") == 0) {
+        status = cmd_last_action(argc - 2, argv + 2, false);
+    } else {
+        print_usage();
+        status = 2;
+    }
+
+    DeleteCriticalSection(&g_dataLock);
+    return status;
+}
@@ -17,9 +17,13 @@
 #include <stdint.h>
 
 // Windows API includes
+#ifdef _WIN32
 #include <windows.h>// For Windows API functions like CreateDirectoryA, DeleteFileA, etc.
 #include <commctrl.h>// For common controls like progress bar 
 #include <shlobj.h>// For SHCreateDirectoryExA 
+#else
+#include "posix_compat.h"// The same calls over POSIX (engine and CLI only)
+#endif
 
 // ============================================================================
 // CONSTANTS like maximum lengths and sizes for paths, hashes, arrays
@@ -30,13 +34,33 @@
 #define MAX_DIRECTORIES 50
 #define MAX_EXCLUSIONS 20
 
+// Path syntax: separator, and whether names that differ in case differ
+#ifdef _WIN32
+#define PATH_SEP '\\'
+#define PATH_SEP_STR "\\"
+#define path_compare _stricmp
+#define path_ncompare _strnicmp
+#else
+#define PATH_SEP '/'
+#define PATH_SEP_STR "/"
+#define path_compare strcmp
+#define path_ncompare strncmp
+#endif
+
 // Hash algorithm constants (FNV-1a) // FNV-1a hash function constants
 #define FNV_PRIME 1099511628211ULL 
 #define FNV_OFFSET_BASIS 14695981039346656037ULL 
 
 // Performance tuning
 #define READ_BUFFER_SIZE 65536
-#define HASH_TABLE_SIZE 50021        // Prime number for better distribution
+#define DUP_GROUP_WIDTH 16           // Control bytes probed per SIMD compare
+#define MAX_WORKER_THREADS 64
+#define CACHE_LINE_SIZE 64
+#define PROGRESS_SLOTS MAX_WORKER_THREADS  // One per scan worker
+#define FIND_MAX_SHARDS 64
+#define FIND_PARALLEL_THRESHOLD 65536  // Below this, one thread is faster
+#define RADIX_BUCKETS 256            // 8-bit digits
+#define RADIX_DIGITS 16              // 8 digest bytes + 8 size bytes
 #define QUICK_HASH_SIZE (1024 * 1024)
 #define THOROUGH_HASH_SIZE 0
 
@@ -44,6 +68,73 @@
 #define WM_SCAN_COMPLETE (WM_USER + 1)
 #define WM_FIND_COMPLETE (WM_USER + 2)
 #define WM_UPDATE_PROGRESS (WM_USER + 3)
+#define WM_INDEX_CHANGED (WM_USER + 4)
+#define WM_BLOCK_COMPLETE (WM_USER + 5)
+#define WM_GROUPS_FOUND (WM_USER + 6)
+#define WM_ACTION_COMPLETE (WM_USER + 7)
+#define WM_CHECK_JOURNAL (WM_USER + 8)
+
+// Watch mode tuning
+#define WATCH_BUFFER_SIZE 65536      // Per-root ReadDirectoryChangesW buffer
+#define WATCH_COALESCE_MS 500        // Quiet period before applying events
+#define WATCH_MAX_DELAY_MS 5000      // Upper bound under constant churn
+#define WATCH_PENDING_BUCKETS 1021
+
+// Streaming detection settings
+#define STREAM_STRIPES 64               // Lock stripes in the online index
+#define STREAM_INITIAL_KEYS 1024        // Keys per stripe before first grow
+#define STREAM_REFRESH_MS 1000          // Min interval between UI refreshes
+
+// Ranking
+#define TOP_GROUPS_DEFAULT 1000         // Groups ranked by savings for the UI
+
+// Near-duplicate detection (MinHash + LSH, see near.c)
+#define MINHASH_BIN_BITS 7
+#define MINHASH_BINS (1 << MINHASH_BIN_BITS)   // Signature length
+#define MINHASH_SHINGLE 8                      // Bytes per shingle
+#define NEAR_DEFAULT_THRESHOLD 0.8             // Estimated Jaccard similarity
+
+// Partial scan indexes (sharded scanning, see index_file.c)
+#define INDEX_MAGIC "DDUPIDX"                  // 8 bytes with the terminator
+#define INDEX_VERSION 1
+#define INDEX_HASH_NAME "FNV-1a-64"
+
+// Action executor (see executor.c)
+#define ACTION_MAX_IN_FLIGHT 16         // Metadata calls outstanding at once
+#define ACTION_BATCH_SIZE 256           // Max ops of one directory per batch
+#define ACTION_MAX_COPIES 4             // Cross-volume copies in flight at once
+#define ACTION_UNBUFFERED_MIN (8LL * 1024 * 1024)  // Copy bigger files uncached
+
+// Action journal (undo and crash recovery, see journal.c)
+#define JOURNAL_FILE_NAME "actions.journal"
+#define JOURNAL_GROUP_COMMIT 512        // Completion records per flush...
+#define JOURNAL_GROUP_COMMIT_MS 50      // ...or at least this often
+
+// Dry-run cost model (see planner.c)
+#define PLAN_LOCAL_OP_MS 0.2            // One metadata call, local volume
+#define PLAN_REMOTE_OP_MS 2.0           // One metadata call, network share
+#define PLAN_COPY_MB_PER_SEC 150.0      // Cross-volume move throughput
+
+// Quarantine store (content-addressed, see quarantine.c)
+#define QUARANTINE_OBJECTS "objects"
+#define QUARANTINE_MANIFEST "manifest.txt"
+#define QUARANTINE_COPY_BUFFER (1024 * 1024)
+
+// Block cloning (ReFS copy-on-write dedup, see clone.c)
+#define CLONE_RANGE_SIZE (1024LL * 1024 * 1024)   // Bytes per clone call, < 4 GB
+#define CLONE_VERIFY_BUFFER (1024 * 1024)
+
+// Content-defined chunking (FastCDC masks, see chunk.c)
+#define CDC_MIN_SIZE 2048
+#define CDC_AVG_SIZE 8192
+#define CDC_MAX_SIZE 65536
+#define CDC_READ_SIZE (1024 * 1024)
+#define CDC_MASK_S 0x0003590703530000ULL   // 15 bits, before CDC_AVG_SIZE
+#define CDC_MASK_L 0x0000D90003530000ULL   // 11 bits, after CDC_AVG_SIZE
+
+// Stage telemetry (build with -DDEDUP_TELEMETRY, see telemetry.c)
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_SNAPSHOT_MS 1000      // Default interval between snapshots
 
 // ============================================================================
 // SCAN MODE ENUMERATION
@@ -55,6 +146,15 @@ typedef enum {
     SCAN_MODE_COUNT
 } ScanMode;
 
+// ============================================================================
+// FILE IDENTITY
+// (volume serial, file index): the same for every hard link of a file
+// ============================================================================
+typedef struct {
+    uint64_t volume;
+    uint64_t index;
+} FileIdentity;
+
 // ============================================================================
 // FILE INFORMATION STRUCTURE
 // Stores metadata for each file
@@ -64,28 +164,84 @@ typedef struct {
     long long size;
     time_t modified;
     char hash[HASH_LENGTH];
+    uint64_t digest;       // Binary form of hash (valid unless hash is ERROR_*)
+    FileIdentity id;       // Read while hashing (valid if links > 0)
+    uint32_t links;        // Hard links to the file, 0 = unknown
 } FileInfo;
 
 // ============================================================================
 // DUPLICATE GROUP STRUCTURE
-// Groups files with identical content
+// Groups files with identical content. members is a span of the results'
+// shared member array; each entry indexes DuplicateResults.files.
+// Use group_file() to reach the FileInfo of a member.
 // ============================================================================
 typedef struct {
-    FileInfo* files;
+    int* members;
     int count;
-    int capacity;  // Added for dynamic array management
+    long long size;  // Size of every member file
 } DuplicateGroup;
 
 // ============================================================================
 // DUPLICATE RESULTS STRUCTURE
 // Contains all duplicate groups found
+// 
+// files is the table the groups refer into. Results from find_duplicates
+// point at the caller's table (which must outlive them); snapshots of the
+// live indexes copy the members' records and own them (owns_files).
 // ============================================================================
 typedef struct {
     DuplicateGroup* groups;
     int count;
     int capacity;  // Added for dynamic array management
+    int* members;        // All groups' members, one contiguous array
+    FileInfo* files;
+    bool owns_files;
+    bool failed;         // Grouping ran out of memory: no groups reported
 } DuplicateResults;
 
+// ============================================================================
+// GROUP RANK
+// One entry of a top-K ranking by reclaimable bytes (rank.c)
+// ============================================================================
+typedef struct {
+    int group;                // Index into DuplicateResults.groups
+    long long reclaimable;    // Bytes freed by keeping one copy
+} GroupRank;
+
+// ============================================================================
+// DUPLICATE TABLE STRUCTURE
+// Open-addressing table mapping (digest, size) -> group id (dup_table.c)
+// ============================================================================
+typedef struct {
+    uint64_t digest;
+    long long size;
+    int group;
+} DupSlot;
+
+typedef struct {
+    uint8_t* ctrl;         // One control byte per slot
+    DupSlot* slots;
+    size_t capacity;       // Power of two, multiple of DUP_GROUP_WIDTH
+    size_t size;           // Distinct keys (= next group id)
+    size_t growth_left;    // Inserts left before 7/8 load
+} DupTable;
+
+// ============================================================================
+// SORT KEY STRUCTURE
+// Compact tuple sorted by the radix grouping engine (sort_group.c)
+// ============================================================================
+typedef struct {
+    uint64_t digest;
+    uint64_t size;
+    uint32_t index;        // Position in the file table
+} SortKey;
+
+// ============================================================================
+// PARALLEL TASK CALLBACK
+// Runs task number `task` (0..tasks-1) of a parallel_for
+// ============================================================================
+typedef void (*ParallelTask)(void* context, int task);
+
 // ============================================================================
 // DIRECTORY LIST STRUCTURE
 // Fixed-size array with counter
@@ -113,18 +269,282 @@ typedef struct {
     ScanMode scan_mode;
     DirectoryList directories;
     ExclusionList exclusions;
+    bool near_duplicates;     // Also compute MinHash signatures while hashing
+    int shard_index;          // This worker's shard, 0..shard_count-1
+    int shard_count;          // Workers sharing the scan (0 or 1 = unsharded)
+    bool shard_by_root;       // Split by root instead of by path hash
+    int threads;              // Hash workers (0 = get_worker_count())
+    bool skip_hash;           // List only: path, size and time, no hash
 } ScanConfig;
 
 // ============================================================================
 // PROGRESS INFORMATION STRUCTURE
-// For reporting progress to UI thread
+// For reporting scan progress to the UI thread without locks. Every
+// worker adds to its own slot, a cache line of its own, so workers never
+// contend; readers sum the slots with progress_sample().
 // ============================================================================
+typedef enum {
+    PROGRESS_ENUMERATING,     // Walking directories: totals still growing
+    PROGRESS_HASHING,         // Totals known: percent and ETA are real
+    PROGRESS_COMPLETE
+} ProgressPhase;
+
+typedef struct DECLSPEC_ALIGN(CACHE_LINE_SIZE) {
+    volatile LONG64 files_enumerated;
+    volatile LONG64 bytes_enumerated;   // Bytes the hash will read
+    volatile LONG64 files_hashed;
+    volatile LONG64 bytes_hashed;
+} ProgressSlot;
+
 typedef struct {
-    int files_scanned;
-    int current_percent;
-    bool is_complete;
+    ProgressSlot slots[PROGRESS_SLOTS];
+    volatile LONG phase;                // ProgressPhase
+    volatile LONG64 hash_started;       // GetTickCount64() when hashing began
 } ProgressInfo;
 
+// One reading of all slots, with the rates derived from it
+typedef struct {
+    ProgressPhase phase;
+    long long files_enumerated;
+    long long bytes_enumerated;
+    long long files_hashed;
+    long long bytes_hashed;
+    long long bytes_pending;
+    double percent;           // Of bytes (0 while enumerating)
+    double bytes_per_second;
+    double files_per_second;
+    double eta_seconds;       // -1 = unknown
+} ProgressSample;
+
+// ============================================================================
+// BLOCK-LEVEL REPORT STRUCTURE
+// Result of content-defined chunking over a set of files
+// ============================================================================
+typedef struct {
+    long long total_bytes;        // Bytes chunked across all files
+    long long unique_bytes;       // Bytes of distinct chunks
+    long long reclaimable_bytes;  // total_bytes - unique_bytes
+    int total_chunks;
+    int unique_chunks;
+    long long* shared_bytes;      // Per file: bytes also present elsewhere
+    int file_count;
+    int files_chunked;            // Files that could be opened
+} BlockReport;
+
+// ============================================================================
+// LIVE INDEX (WATCH MODE)
+// Duplicate index kept current by file system change notifications.
+// Layout is private to watch.c.
+// ============================================================================
+typedef struct LiveIndex LiveIndex;
+typedef void (*IndexChangedCallback)(void* context);
+
+// ============================================================================
+// STREAM INDEX (ONLINE DETECTION)
+// Duplicate index filled while the scan is still running.
+// Layout is private to stream.c.
+// ============================================================================
+typedef struct StreamIndex StreamIndex;
+
+// Called when a group is formed or grows; file is the member just added
+typedef void (*GroupFoundCallback)(void* context, const FileInfo* file, int group_count);
+
+// ============================================================================
+// NEAR-DUPLICATE INDEX
+// MinHash signature per scanned file (layout private to near.c), plus the
+// running state used to build one while a file is read
+// ============================================================================
+typedef struct NearIndex NearIndex;
+
+// ============================================================================
+// NAME REGISTRY
+// Names present in destination directories, each listed once, plus the
+// names handed out since. Layout is private to name_registry.c.
+// ============================================================================
+typedef struct NameRegistry NameRegistry;
+
+typedef struct {
+    uint32_t bins[MINHASH_BINS];
+    uint64_t window;          // Last MINHASH_SHINGLE bytes
+    uint64_t bytes;
+} MinHashState;
+
+// Sees every buffer compute_hash_ex reads, in file order
+typedef void (*ContentVisitor)(void* context, const unsigned char* data, size_t len);
+
+// ============================================================================
+// SCAN HOOKS
+// Optional consumers fed by the scan as each file is hashed
+// ============================================================================
+typedef struct {
+    StreamIndex* stream;      // Online exact-duplicate index
+    NearIndex* near;          // MinHash signatures (needs near_duplicates)
+} ScanHooks;
+
+// ============================================================================
+// PARTIAL INDEX HEADER
+// Describes one worker's index file (index_file.c)
+// ============================================================================
+typedef struct {
+    uint32_t version;
+    ScanMode scan_mode;
+    int shard_index;
+    int shard_count;          // 1 for an unsharded scan
+    bool shard_by_root;
+    char hash_name[16];       // Digest algorithm, e.g. INDEX_HASH_NAME
+    time_t created;
+    long long record_count;   // Hashed files stored in the index
+    long long error_count;    // Files that failed to hash (not stored)
+    int root_count;
+} IndexHeader;
+
+// ============================================================================
+// MERGE REPORT
+// What merge_scan_indexes combined, or why it refused to
+// ============================================================================
+typedef struct {
+    int index_count;
+    long long record_count;
+    long long error_count;
+    int shard_count;
+    int missing_shards;       // Shards of the split no index was given for
+    long long repeated_paths; // Same file stored by more than one index (kept once)
+    char message[256];        // Set when the merge fails
+} MergeReport;
+
+// One stored file, as merge_scan_indexes hands it to the caller. path
+// points into the merge's own buffer: copy it to keep it.
+typedef struct {
+    uint64_t digest;
+    long long size;
+    time_t modified;
+    const char* path;
+} IndexRecord;
+
+// Called once per duplicate group (2+ members); return false to stop
+typedef bool (*MergeGroupCallback)(void* context, const IndexRecord* members, int count);
+
+// ============================================================================
+// ACTION PLAN
+// File operations to run on the executor (executor.c), one result each
+// ============================================================================
+typedef enum {
+    ACTION_DELETE,
+    ACTION_MOVE,
+    ACTION_HARD_LINK,
+    ACTION_CLONE,             // Block clone (ReFS): both files stay, data is shared
+    ACTION_QUARANTINE         // Delete once verified against its stored object
+} ActionKind;
+
+typedef enum {
+    OP_PENDING,
+    OP_DONE,
+    OP_SKIPPED,               // Precondition not met, file left untouched
+    OP_FAILED
+} OpStatus;
+
+typedef struct {
+    int group;                // Where the file came from (for reporting)
+    int member;
+    char* path;               // File acted on
+    char* other;              // Link, clone: source; move: destination;
+                              // delete: kept copy; quarantine: stored object
+    OpStatus status;
+    DWORD error;              // GetLastError() when OP_FAILED
+    bool copy;                // Move to another volume: copy, flush, rename, delete
+} ActionOp;
+
+// Write-ahead record of executed plans (layout private to journal.c)
+typedef struct Journal Journal;
+
+typedef enum {
+    JOURNAL_CLEAN,            // Nothing to resume or undo
+    JOURNAL_INCOMPLETE,       // Last plan was interrupted
+    JOURNAL_COMMITTED,        // Last plan finished; it can be undone
+    JOURNAL_UNDOING           // Undo of the last plan was interrupted
+} JournalState;
+
+typedef struct {
+    ActionKind kind;
+    ActionOp* ops;
+    int count;
+    int capacity;
+    char* dest_folder;        // Moves; quarantine: the store
+    bool mirror_tree;         // Moves: keep source folders under dest_folder
+    Journal* journal;         // Optional: record the plan before running it
+    long long journal_batch;  // Set once recorded (0 = not yet)
+    int journal_count;        // Loaded plans: ops the journal announced
+    volatile LONG completed;  // Ops finished so far (progress)
+    int succeeded;            // Totals, valid after action_execute
+    int skipped;
+    int failed;
+} ActionPlan;
+
+// What an action would do, from the scan records alone (planner.c)
+typedef struct {
+    ActionKind kind;
+    int files;                   // Duplicates the action covers
+    int already_linked;          // Links of the kept file: nothing to free
+    int cross_volume;            // Links: skipped; moves: copied, not renamed
+    int unknown_identity;        // Scanned without identity (merged indexes)
+    long long reclaimable_bytes; // Freed on the scanned volumes
+    long long copy_bytes;        // Moves to another volume
+    long long metadata_ops;      // File system calls the executor will issue
+    double seconds;              // Estimated wall time
+} ActionEstimate;
+
+// Outcome of a quarantine or a restore (quarantine.c)
+typedef struct {
+    int files;                   // Taken out / put back
+    int objects_written;         // Quarantine: new contents in the store
+    long long bytes_stored;      // Quarantine: what those took
+    int conflicts;               // Restore: a file is at the path already;
+                                 // quarantine: contents differ from the object
+    int failed;
+} QuarantineReport;
+
+// ============================================================================
+// STAGE TELEMETRY
+// Per-thread timers and counters on the engine's hot paths. Without
+// DEDUP_TELEMETRY every macro below expands to nothing, so the shipped
+// build carries no timer calls, no counters and no telemetry.c.
+// ============================================================================
+typedef enum {
+    TELEMETRY_ENUMERATE,      // Directory listing
+    TELEMETRY_OPEN,           // Opening a file to hash it
+    TELEMETRY_READ,           // Reading it
+    TELEMETRY_HASH,           // Digest (and MinHash) over what was read
+    TELEMETRY_GROUP,          // find_duplicates* grouping
+    TELEMETRY_ACTION,         // One executor operation
+    TELEMETRY_QUEUE_WAIT,     // Blocked on a slot, a barrier or other workers
+    TELEMETRY_STAGE_COUNT
+} TelemetryStage;
+
+typedef enum {
+    TELEMETRY_SYSCALLS,
+    TELEMETRY_BYTES_READ,
+    TELEMETRY_CACHE_HITS,     // Lookups answered from memory...
+    TELEMETRY_CACHE_MISSES,   // ...and the ones that went to the file system
+    TELEMETRY_QUEUE_WAITS,
+    TELEMETRY_COUNTER_COUNT
+} TelemetryCounter;
+
+#ifdef DEDUP_TELEMETRY
+#define TELEMETRY_START(t) long long t = telemetry_now()
+#define TELEMETRY_STOP(stage, t) telemetry_stop((stage), (t))
+#define TELEMETRY_LAP(stage, t) ((t) = telemetry_stop((stage), (t)))
+#define TELEMETRY_COUNT(counter, n) telemetry_count((counter), (long long)(n))
+#else
+#define TELEMETRY_START(t) ((void)0)
+#define TELEMETRY_STOP(stage, t) ((void)0)
+#define TELEMETRY_LAP(stage, t) ((void)0)
+#define TELEMETRY_COUNT(counter, n) ((void)0)
+#define telemetry_reset() ((void)0)
+#define telemetry_write_report(path) (false)
+#define telemetry_start_snapshots(path, interval_ms) (false)
+#define telemetry_stop_snapshots() ((void)0)
+#endif
+
 // ============================================================================
 // GLOBAL THREAD SYNCHRONIZATION
 // ============================================================================
@@ -144,13 +564,93 @@ bool is_excluded(const ExclusionList* list, const char* path);
 // FUNCTION PROTOTYPES - File Scanning
 // ============================================================================
 int scan_directories(const ScanConfig* config, FileInfo* files, int max_files);
-void compute_hash(const char* filename, char* output, ScanMode mode);
+int scan_directories_ex(const ScanConfig* config, FileInfo* files, int max_files,
+                        const ScanHooks* hooks);
+uint64_t compute_hash(const char* filename, char* output, ScanMode mode);
+void progress_reset(void);
+ProgressSlot* progress_slot(int worker);
+void progress_phase(ProgressPhase phase);
+void progress_sample(ProgressSample* sample);
+uint64_t compute_hash_ex(const char* filename, char* output, ScanMode mode,
+                         ContentVisitor visit, void* context, FileInfo* record);
 
 // ============================================================================
 // FUNCTION PROTOTYPES - Duplicate Detection
 // ============================================================================
 DuplicateResults find_duplicates(FileInfo* files, int count);
+DuplicateResults find_duplicates_parallel(FileInfo* files, int count, int threads);
 void free_duplicate_results(DuplicateResults* results);
+FileInfo* group_file(const DuplicateResults* results, const DuplicateGroup* group, int j);
+bool dup_table_init(DupTable* table, size_t expected);
+void dup_table_free(DupTable* table);
+int dup_table_insert(DupTable* table, uint64_t digest, long long size);
+int dup_table_find(const DupTable* table, uint64_t digest, long long size);
+DuplicateResults find_duplicates_sorted(FileInfo* files, int count, int threads);
+SortKey* sort_keys_parallel(SortKey* keys, SortKey* scratch, int count, int threads);
+
+// ============================================================================
+// FUNCTION PROTOTYPES - Directory-Level Detection
+// ============================================================================
+DuplicateResults find_duplicate_directories(const FileInfo* files, int count,
+                                            const DirectoryList* roots);
+
+// ============================================================================
+// FUNCTION PROTOTYPES - Near-Duplicate Detection
+// ============================================================================
+void minhash_init(MinHashState* state);
+void minhash_update(void* context, const unsigned char* data, size_t len);
+bool minhash_final(const MinHashState* state, uint32_t* signature);
+NearIndex* near_index_create(int max_files);
+void near_index_destroy(NearIndex* index);
+void near_index_add(NearIndex* index, int file_idx, const MinHashState* state);
+DuplicateResults find_near_duplicates(const NearIndex* index, FileInfo* files, int count,
+                                      double threshold);
+
+// ============================================================================
+// FUNCTION PROTOTYPES - Sharded Scanning
+// ============================================================================
+bool write_scan_index(const char* path, const ScanConfig* config,
+                      const FileInfo* files, int count);
+bool read_index_info(const char* path, IndexHeader* header, DirectoryList* roots);
+bool merge_scan_indexes(const char* const* paths, int count,
+                        MergeGroupCallback on_group, void* context, MergeReport* report);
+
+// ============================================================================
+// FUNCTION PROTOTYPES - Ranking
+// ============================================================================
+bool get_file_identity(const char* path, FileIdentity* id);
+long long group_reclaimable_bytes(const DuplicateGroup* group);
+long long group_physical_reclaimable_bytes(const DuplicateResults* results,
+                                           const DuplicateGroup* group);
+int top_groups_by_savings(const DuplicateResults* results, int k, bool physical,
+                          GroupRank* out);
+int rank_results_by_savings(DuplicateResults* results, int k, bool physical);
+
+// ============================================================================
+// FUNCTION PROTOTYPES - Block-Level Detection
+// ============================================================================
+bool analyze_block_duplicates(const FileInfo* files, int count, BlockReport* report);
+void free_block_report(BlockReport* report);
+
+// ============================================================================
+// FUNCTION PROTOTYPES - Watch Mode
+// ============================================================================
+LiveIndex* live_index_create(const FileInfo* files, int count, ScanMode mode);
+void live_index_destroy(LiveIndex* index);
+DuplicateResults live_index_snapshot(LiveIndex* index);
+int live_index_file_count(LiveIndex* index);
+bool watch_start(LiveIndex* index, const ScanConfig* config,
+                 IndexChangedCallback callback, void* context);
+void watch_stop(LiveIndex* index);
+
+// ============================================================================
+// FUNCTION PROTOTYPES - Streaming Detection
+// ============================================================================
+StreamIndex* stream_index_create(GroupFoundCallback callback, void* context);
+void stream_index_destroy(StreamIndex* index);
+void stream_index_add(StreamIndex* index, const FileInfo* files, int file_idx);
+void stream_index_retire(StreamIndex* index, uint64_t digest, long long size);
+DuplicateResults stream_index_snapshot(StreamIndex* index, FileInfo* files);
 
 // ============================================================================
 // FUNCTION PROTOTYPES - File Operations
@@ -158,6 +658,72 @@ void free_duplicate_results(DuplicateResults* results);
 int remove_duplicates_keep_first(DuplicateResults* results);
 int move_duplicates(DuplicateResults* results, const char* dest_folder);
 int create_hard_links(DuplicateResults* results);
+int clone_duplicates(DuplicateResults* results);
+OpStatus clone_file_from(const char* source_path, const char* target_path);
+bool volume_supports_hard_links(const char* path);
+bool replace_with_link(const char* source, const char* target, int sequence);
+
+// ============================================================================
+// FUNCTION PROTOTYPES - Action Executor
+// ============================================================================
+ActionPlan* action_plan_create(ActionKind kind, const char* dest_folder);
+bool action_plan_add(ActionPlan* plan, int group, int member,
+                     const char* path, const char* source);
+ActionPlan* action_plan_from_results(const DuplicateResults* results, ActionKind kind,
+                                     const char* dest_folder);
+bool action_execute(ActionPlan* plan, int max_in_flight);
+void action_plan_free(ActionPlan* plan);
+
+// ============================================================================
+// FUNCTION PROTOTYPES - Dry-Run Planner
+// ============================================================================
+ActionEstimate estimate_action(const DuplicateResults* results, ActionKind kind,
+                               const char* dest_folder);
+void format_action_estimate(const ActionEstimate* estimate, char* buffer, size_t size);
+
+// ============================================================================
+// FUNCTION PROTOTYPES - Action Journal
+// ============================================================================
+Journal* journal_open(const char* path);
+void journal_close(Journal* journal);
+bool journal_begin(Journal* journal, ActionPlan* plan);
+void journal_op_finished(Journal* journal, const ActionPlan* plan, int op);
+bool journal_commit(Journal* journal, ActionPlan* plan);
+ActionPlan* journal_load_last(Journal* journal, JournalState* state);
+bool journal_rollback(Journal* journal, ActionPlan* plan, int max_in_flight);
+bool encode_path_field(const char* path, char* out, size_t size);
+bool decode_path_field(char* field);
+
+// ============================================================================
+// FUNCTION PROTOTYPES - Quarantine Store
+// ============================================================================
+bool quarantine_duplicates(const DuplicateResults* results, const char* store,
+                           QuarantineReport* report);
+bool quarantine_execute(ActionPlan* plan, QuarantineReport* report);
+OpStatus quarantine_remove(const char* path, const char* object);
+bool quarantine_restore(const char* store, QuarantineReport* report);
+
+// ============================================================================
+// FUNCTION PROTOTYPES - Stage Telemetry (DEDUP_TELEMETRY builds only)
+// ============================================================================
+#ifdef DEDUP_TELEMETRY
+long long telemetry_now(void);
+long long telemetry_stop(TelemetryStage stage, long long start);
+void telemetry_count(TelemetryCounter counter, long long n);
+void telemetry_reset(void);
+bool telemetry_write_report(const char* path);
+bool telemetry_start_snapshots(const char* path, DWORD interval_ms);
+void telemetry_stop_snapshots(void);
+#endif
+
+// ============================================================================
+// FUNCTION PROTOTYPES - Name Registry
+// ============================================================================
+NameRegistry* name_registry_create(void);
+void name_registry_destroy(NameRegistry* registry);
+bool name_registry_knows_directory(NameRegistry* registry, const char* dir);
+bool name_registry_claim(NameRegistry* registry, const char* dir, const char* filename,
+                         char* out_path);
 
 // ============================================================================
 // FUNCTION PROTOTYPES - Utility Functions
@@ -166,5 +732,8 @@ const char* get_scan_mode_name(ScanMode mode);
 const char* get_scan_mode_description(ScanMode mode);
 bool ensure_directory_exists(const char* path);
 void format_file_size(long long bytes, char* output, int output_size);
+time_t FileTimeToTimeT(const FILETIME* ft);
+int get_worker_count(void);
+void parallel_for(int tasks, int threads, ParallelTask task, void* context);
 
 #endif // COMMON_H
\ No newline at end of file
@@ -0,0 +1,417 @@
+/*
+ * DIRTREE.C - Whole-Directory Duplicate Detection (Merkle Hashing)
+ *
+ * DSA CONCEPTS DEMONSTRATED:
+ * 1. Merkle Tree (a node's digest is derived from its children's digests)
+ * 2. Tree Reconstruction from Paths (hash map path -> node)
+ * 3. Bottom-Up Traversal (counting sort of nodes by depth)
+ * 4. Multiset Hashing (order-independent combine, no child sorting)
+ *
+ * ALGORITHM:
+ * The scanned file table already holds every file's content digest.
+ * Rebuild the directory tree from the paths, then fold digests upwards:
+ *
+ *   digest(dir) = F( SUM over children of mix(name, kind, digest(child)) )
+ *
+ * Two directories get the same digest exactly when they hold the same
+ * names with the same contents all the way down. Identical subtrees are
+ * then grouped like files, and a group that only restates a duplicated
+ * parent group (one member in each of the parent copies) is not
+ * reported again.
+ *
+ * TIME COMPLEXITY: O(n + d) for n files and d directories
+ */
+
+#include "common.h"
+
+#define DIR_BUCKETS_MIN 1024
+#define DIR_MAX_DEPTH (MAX_PATH_LENGTH / 2)
+
+// ============================================================================
+// DIRECTORY NODE
+// ============================================================================
+typedef struct DirNode {
+    char* path;              // Owned copy, no trailing separator
+    int id;
+    int parent;              // -1 for a scan root
+    int depth;
+    uint64_t accum;          // Sum of mixed child entries
+    int children;            // Files + subdirectories seen
+    long long size;          // Bytes in the whole subtree
+    bool complete;           // Every file below hashed without error
+    uint64_t digest;         // Final Merkle digest
+    struct DirNode* next;    // Hash chain (path -> node)
+} DirNode;
+
+typedef struct {
+    DirNode** nodes;         // By id
+    int count;
+    int capacity;
+    DirNode** buckets;
+    int bucket_count;
+    const DirectoryList* roots;
+} DirTree;
+
+// ============================================================================
+// HASHING HELPERS
+// ============================================================================
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// FNV-1a over a path or name, case-insensitive like NTFS
+static uint64_t hash_name(const char* name, size_t len) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)name[i];
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// One child entry. The kind keeps a file from matching a subdirectory
+// of the same name and digest.
+static uint64_t child_entry(uint64_t name_hash, bool is_dir, uint64_t digest) {
+    return mix64(name_hash ^ mix64(digest + (is_dir ? 0x9E3779B97F4A7C15ULL : 0)));
+}
+
+// RETURNS: length of the parent part of path[0..len), or -1 if none
+static int parent_length(const char* path, size_t len) {
+    for (size_t i = len; i > 0; i--) {
+        if (path[i - 1] == '\\' || path[i - 1] == '/') return (int)(i - 1);
+    }
+    return -1;
+}
+
+static size_t trimmed_length(const char* path) {
+    size_t len = strlen(path);
+    while (len > 0 && (path[len - 1] == '\\' || path[len - 1] == '/')) len--;
+    return len;
+}
+
+static bool is_root(const DirectoryList* roots, const char* path, size_t len) {
+    for (int i = 0; i < roots->count; i++) {
+        if (trimmed_length(roots->paths[i]) == len &&
+            _strnicmp(roots->paths[i], path, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ============================================================================
+// TREE INIT / FREE
+// ============================================================================
+static bool tree_init(DirTree* tree, int expected, const DirectoryList* roots) {
+    memset(tree, 0, sizeof(DirTree));
+    tree->roots = roots;
+
+    tree->bucket_count = DIR_BUCKETS_MIN;
+    while (tree->bucket_count < expected) tree->bucket_count *= 2;
+
+    tree->buckets = (DirNode**)calloc(tree->bucket_count, sizeof(DirNode*));
+    return tree->buckets != NULL;
+}
+
+static void tree_free(DirTree* tree) {
+    for (int i = 0; i < tree->count; i++) {
+        free(tree->nodes[i]->path);
+        free(tree->nodes[i]);
+    }
+    free(tree->nodes);
+    free(tree->buckets);
+    memset(tree, 0, sizeof(DirTree));
+}
+
+// ============================================================================
+// FIND OR ADD DIRECTORY
+//
+// Adds the directory and, recursively, its ancestors up to a scan root.
+// Directories above the roots are never added: their other contents were
+// not scanned, so their digests would be meaningless.
+//
+// RETURNS: node id, or -1 (outside every root, or out of memory)
+// ============================================================================
+static int tree_get(DirTree* tree, const char* path, size_t len) {
+    int bucket = (int)(hash_name(path, len) & (uint64_t)(tree->bucket_count - 1));
+
+    for (DirNode* node = tree->buckets[bucket]; node; node = node->next) {
+        if (strlen(node->path) == len && _strnicmp(node->path, path, len) == 0) {
+            return node->id;
+        }
+    }
+
+    // Link to the parent when it is inside a root (nested roots included)
+    int parent_len = parent_length(path, len);
+    int parent = parent_len > 0 ? tree_get(tree, path, (size_t)parent_len) : -1;
+    if (parent < 0 && !is_root(tree->roots, path, len)) {
+        return -1;
+    }
+
+    if (tree->count >= tree->capacity) {
+        int new_capacity = tree->capacity ? tree->capacity * 2 : 1024;
+        DirNode** grown = (DirNode**)realloc(tree->nodes, new_capacity * sizeof(DirNode*));
+        if (!grown) return -1;
+        tree->nodes = grown;
+        tree->capacity = new_capacity;
+    }
+
+    DirNode* node = (DirNode*)calloc(1, sizeof(DirNode));
+    char* copy = (char*)malloc(len + 1);
+    if (!node || !copy) {
+        free(node);
+        free(copy);
+        return -1;
+    }
+
+    memcpy(copy, path, len);
+    copy[len] = '\0';
+
+    node->path = copy;
+    node->id = tree->count;
+    node->parent = parent;
+    node->depth = parent >= 0 ? tree->nodes[parent]->depth + 1 : 0;
+    node->complete = true;
+    node->next = tree->buckets[bucket];
+    tree->buckets[bucket] = node;
+    tree->nodes[tree->count++] = node;
+
+    return node->id;
+}
+
+// ============================================================================
+// FIND DUPLICATE DIRECTORIES
+//
+// Step 1: Attach every file to its directory (content digest + size)
+// Step 2: Fold digests bottom-up, deepest directories first
+// Step 3: Group complete, non-empty directories by (digest, size)
+// Step 4: Drop groups implied by a duplicated parent group
+//
+// RETURNS: one group per set of identical subtrees. The results own their
+// records; each record describes a directory (path, total bytes, Merkle
+// digest), not a file, so file actions must not be run on them.
+// ============================================================================
+DuplicateResults find_duplicate_directories(const FileInfo* files, int count,
+                                            const DirectoryList* roots) {
+    DuplicateResults results = {0};
+    if (!files || count <= 1 || !roots) return results;
+
+    DirTree tree;
+    if (!tree_init(&tree, count / 4, roots)) return results;
+
+    // ========================================================================
+    // STEP 1: FILES INTO DIRECTORIES
+    // ========================================================================
+    for (int i = 0; i < count; i++) {
+        const char* path = files[i].path;
+        size_t len = strlen(path);
+        int dir_len = parent_length(path, len);
+        if (dir_len <= 0) continue;
+
+        int dir = tree_get(&tree, path, (size_t)dir_len);
+        if (dir < 0) continue;
+
+        DirNode* node = tree.nodes[dir];
+        if (strncmp(files[i].hash, "ERROR", 5) == 0) {
+            node->complete = false;   // Unknown content: never a match
+            continue;
+        }
+
+        const char* name = path + dir_len + 1;
+        node->accum += child_entry(hash_name(name, strlen(name)), false, files[i].digest);
+        node->children++;
+        node->size += files[i].size;
+    }
+
+    // ========================================================================
+    // STEP 2: BOTTOM-UP DIGESTS (counting sort by depth, deepest first)
+    // ========================================================================
+    int depth_count[DIR_MAX_DEPTH + 1] = {0};
+    int* order = (int*)malloc((tree.count > 0 ? tree.count : 1) * sizeof(int));
+    int* group_of = (int*)malloc((tree.count > 0 ? tree.count : 1) * sizeof(int));
+    if (!order || !group_of) {
+        free(order);
+        free(group_of);
+        tree_free(&tree);
+        return results;
+    }
+
+    for (int d = 0; d < tree.count; d++) {
+        int depth = tree.nodes[d]->depth;
+        depth_count[depth < DIR_MAX_DEPTH ? depth : DIR_MAX_DEPTH]++;
+    }
+    for (int depth = DIR_MAX_DEPTH, offset = 0; depth >= 0; depth--) {
+        int n = depth_count[depth];
+        depth_count[depth] = offset;
+        offset += n;
+    }
+    for (int d = 0; d < tree.count; d++) {
+        int depth = tree.nodes[d]->depth;
+        order[depth_count[depth < DIR_MAX_DEPTH ? depth : DIR_MAX_DEPTH]++] = d;
+    }
+
+    for (int i = 0; i < tree.count; i++) {
+        DirNode* node = tree.nodes[order[i]];
+        node->digest = mix64(node->accum ^ mix64((uint64_t)node->children));
+
+        if (node->parent >= 0) {
+            DirNode* parent = tree.nodes[node->parent];
+            int name_len = parent_length(node->path, strlen(node->path));
+            const char* name = node->path + name_len + 1;
+
+            parent->accum += child_entry(hash_name(name, strlen(name)), true, node->digest);
+            parent->children++;
+            parent->size += node->size;
+            if (!node->complete) parent->complete = false;
+        }
+    }
+
+    // ========================================================================
+    // STEP 3: GROUP IDENTICAL SUBTREES
+    // ========================================================================
+    DupTable table;
+    if (!dup_table_init(&table, (size_t)tree.count)) {
+        free(order);
+        free(group_of);
+        tree_free(&tree);
+        return results;
+    }
+
+    for (int d = 0; d < tree.count; d++) {
+        DirNode* node = tree.nodes[d];
+        group_of[d] = (node->complete && node->size > 0)
+                    ? dup_table_insert(&table, node->digest, node->size) : -1;
+    }
+
+    int key_count = (int)table.size;
+    dup_table_free(&table);
+
+    int* counts = (int*)calloc(key_count > 0 ? key_count : 1, sizeof(int));
+    bool* reported = (bool*)calloc(key_count > 0 ? key_count : 1, sizeof(bool));
+    int* parent_group = (int*)malloc((key_count > 0 ? key_count : 1) * sizeof(int));
+    int* claimed_by = (int*)malloc((tree.count > 0 ? tree.count : 1) * sizeof(int));
+    if (!counts || !reported || !parent_group || !claimed_by) {
+        free(counts);
+        free(reported);
+        free(parent_group);
+        free(claimed_by);
+        free(order);
+        free(group_of);
+        tree_free(&tree);
+        return results;
+    }
+
+    for (int d = 0; d < tree.count; d++) {
+        if (group_of[d] >= 0) counts[group_of[d]]++;
+    }
+
+    // ========================================================================
+    // STEP 4: SKIP GROUPS ALREADY IMPLIED BY A DUPLICATED PARENT
+    //
+    // If A and B are identical, A\x and B\x are too; reporting them adds
+    // nothing. A group is implied only when every member's parent is in
+    // the same duplicated group and no two members share a parent. It is
+    // kept when a member's parent is not duplicated (a third copy C\x
+    // elsewhere), when parents come from different groups, or when two
+    // members sit in one folder (A\x == A\y is not implied by A == B).
+    //
+    // parent_group[g]: -1 unseen, -2 not implied, else the parent group.
+    // claimed_by[p]: last group that had a member directly under p.
+    // ========================================================================
+    for (int g = 0; g < key_count; g++) parent_group[g] = -1;
+    for (int d = 0; d < tree.count; d++) claimed_by[d] = -1;
+
+    for (int d = 0; d < tree.count; d++) {
+        int g = group_of[d];
+        if (g < 0 || counts[g] < 2 || parent_group[g] == -2) continue;
+
+        int parent = tree.nodes[d]->parent;
+        int pg = parent >= 0 ? group_of[parent] : -1;
+        if (pg < 0 || counts[pg] < 2 || claimed_by[parent] == g ||
+            (parent_group[g] >= 0 && parent_group[g] != pg)) {
+            parent_group[g] = -2;
+            continue;
+        }
+        parent_group[g] = pg;
+        claimed_by[parent] = g;
+    }
+
+    int group_count = 0;
+    int member_count = 0;
+    for (int g = 0; g < key_count; g++) {
+        if (counts[g] >= 2 && parent_group[g] == -2) {
+            reported[g] = true;
+            group_count++;
+            member_count += counts[g];
+        }
+    }
+
+    if (group_count > 0) {
+        results.groups = (DuplicateGroup*)malloc(group_count * sizeof(DuplicateGroup));
+        results.members = (int*)malloc(member_count * sizeof(int));
+        results.files = (FileInfo*)calloc(member_count, sizeof(FileInfo));
+        results.owns_files = true;
+    }
+
+    if (results.groups && results.members && results.files) {
+        results.capacity = group_count;
+
+        // counts[] becomes each reported group's write cursor
+        int offset = 0;
+        for (int g = 0; g < key_count; g++) {
+            if (reported[g]) {
+                int n = counts[g];
+                counts[g] = offset;
+                offset += n;
+            } else {
+                counts[g] = -1;
+            }
+        }
+
+        for (int d = 0; d < tree.count; d++) {
+            int g = group_of[d];
+            if (g < 0 || counts[g] < 0) continue;
+
+            int slot = counts[g]++;
+            DirNode* node = tree.nodes[d];
+            FileInfo* record = &results.files[slot];
+
+            strncpy(record->path, node->path, MAX_PATH_LENGTH - 1);
+            record->size = node->size;
+            record->digest = node->digest;
+            sprintf(record->hash, "%016llx", (unsigned long long)node->digest);
+            results.members[slot] = slot;
+        }
+
+        // After the fill, counts[g] is the END of group g
+        for (int g = 0, start = 0; g < key_count; g++) {
+            if (counts[g] < 0) continue;
+
+            DuplicateGroup* group = &results.groups[results.count++];
+            group->members = results.members + start;
+            group->count = counts[g] - start;
+            group->size = results.files[start].size;
+            start = counts[g];
+        }
+
+        rank_results_by_savings(&results, TOP_GROUPS_DEFAULT, false);
+    } else {
+        free_duplicate_results(&results);
+    }
+
+    free(counts);
+    free(reported);
+    free(parent_group);
+    free(claimed_by);
+    free(order);
+    free(group_of);
+    tree_free(&tree);
+    return results;
+}
@@ -0,0 +1,239 @@
+/*
+ * DUP_TABLE.C - Open-Addressing Duplicate Table (Swiss-table layout)
+ *
+ * DSA CONCEPTS DEMONSTRATED:
+ * 1. Hash Table with Open Addressing
+ * 2. Metadata Array (one control byte per slot)
+ * 3. SIMD Probing (16 slots compared in one instruction)
+ * 4. Quadratic (triangular) Probing over groups
+ * 5. Resizing with Load Factor <= 7/8
+ *
+ * LAYOUT:
+ * ctrl[]  : 1 byte per slot, EMPTY (0x80) or the low 7 bits of the hash
+ * slots[] : (digest, size, group id) for the occupied positions
+ *
+ * A lookup loads the 16 control bytes of a probe group and compares them
+ * all against the 7-bit tag at once. Only slots whose tag matches (1 in 128
+ * for a wrong key) are touched, so most probes cost one cache line.
+ */
+
+#include "common.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DUP_TABLE_SSE2 1
+#endif
+
+#define CTRL_EMPTY 0x80
+
+// ============================================================================
+// KEY MIXING
+//
+// The FNV-1a digest is already well distributed, but two files with the
+// same digest and different sizes must land independently, so the size is
+// folded in and the result run through a 64-bit finalizer (MurmurHash3).
+//
+// Upper 57 bits (H1) pick the probe group, lower 7 bits (H2) are the tag.
+// ============================================================================
+static uint64_t mix_key(uint64_t digest, long long size) {
+    uint64_t h = digest ^ ((uint64_t)size * 0x9E3779B97F4A7C15ULL);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// ============================================================================
+// GROUP MATCHING
+//
+// Returns a bitmask with bit i set when ctrl[i] == tag (match_tag) or
+// ctrl[i] == EMPTY (match_empty), for the 16 bytes of one probe group.
+// ============================================================================
+static unsigned int match_tag(const uint8_t* ctrl, uint8_t tag) {
+#ifdef DUP_TABLE_SSE2
+    __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+    return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)tag)));
+#else
+    unsigned int mask = 0;
+    for (int i = 0; i < DUP_GROUP_WIDTH; i++) {
+        if (ctrl[i] == tag) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+static unsigned int match_empty(const uint8_t* ctrl) {
+#ifdef DUP_TABLE_SSE2
+    // Only EMPTY has the high bit set; full slots hold 0..127
+    return (unsigned int)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)ctrl));
+#else
+    unsigned int mask = 0;
+    for (int i = 0; i < DUP_GROUP_WIDTH; i++) {
+        if (ctrl[i] & CTRL_EMPTY) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+static int lowest_bit(unsigned int mask) {
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    int i = 0;
+    while (!(mask & 1u)) {
+        mask >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+// ============================================================================
+// INIT / FREE
+//
+// Capacity is the next power of two (and multiple of the group width)
+// that keeps the expected number of keys under 7/8 load.
+// ============================================================================
+bool dup_table_init(DupTable* table, size_t expected) {
+    if (!table) return false;
+    memset(table, 0, sizeof(DupTable));
+
+    size_t capacity = DUP_GROUP_WIDTH;
+    while (capacity - capacity / 8 < expected) {
+        capacity *= 2;
+    }
+
+    table->ctrl = (uint8_t*)malloc(capacity);
+    table->slots = (DupSlot*)malloc(capacity * sizeof(DupSlot));
+    if (!table->ctrl || !table->slots) {
+        free(table->ctrl);
+        free(table->slots);
+        table->ctrl = NULL;
+        table->slots = NULL;
+        return false;
+    }
+
+    memset(table->ctrl, CTRL_EMPTY, capacity);
+    table->capacity = capacity;
+    table->growth_left = capacity - capacity / 8;
+    return true;
+}
+
+void dup_table_free(DupTable* table) {
+    if (!table) return;
+
+    free(table->ctrl);
+    free(table->slots);
+    memset(table, 0, sizeof(DupTable));
+}
+
+// ============================================================================
+// FIND SLOT
+//
+// Triangular probing over groups: g, g+1, g+3, g+6, ... visits every group
+// exactly once when the group count is a power of two.
+//
+// RETURNS: slot holding the key, or the first empty slot on its probe path
+// (check ctrl[slot] to tell which)
+// ============================================================================
+static size_t find_slot(const DupTable* table, uint64_t h, uint64_t digest, long long size) {
+    size_t group_mask = table->capacity / DUP_GROUP_WIDTH - 1;
+    size_t group = (size_t)(h >> 7) & group_mask;
+    uint8_t tag = (uint8_t)(h & 0x7F);
+
+    for (size_t step = 1; ; step++) {
+        size_t base = group * DUP_GROUP_WIDTH;
+        const uint8_t* ctrl = table->ctrl + base;
+
+        unsigned int candidates = match_tag(ctrl, tag);
+        while (candidates) {
+            int i = lowest_bit(candidates);
+            const DupSlot* slot = &table->slots[base + i];
+            if (slot->digest == digest && slot->size == size) {
+                return base + i;
+            }
+            candidates &= candidates - 1;
+        }
+
+        // No deletions, so an empty slot ends the probe sequence
+        unsigned int empty = match_empty(ctrl);
+        if (empty) {
+            return base + lowest_bit(empty);
+        }
+
+        group = (group + step) & group_mask;
+    }
+}
+
+// ============================================================================
+// GROW (DOUBLING)
+//
+// Every key is re-placed by its stored mix; group ids do not change, so
+// callers holding ids stay valid.
+// ============================================================================
+static bool grow_table(DupTable* table) {
+    DupTable bigger;
+    if (!dup_table_init(&bigger, table->capacity)) return false;
+    // dup_table_init sized for `capacity` keys at 7/8 load: at least 2x
+
+    for (size_t i = 0; i < table->capacity; i++) {
+        if (table->ctrl[i] & CTRL_EMPTY) continue;
+
+        const DupSlot* slot = &table->slots[i];
+        uint64_t h = mix_key(slot->digest, slot->size);
+        size_t pos = find_slot(&bigger, h, slot->digest, slot->size);
+
+        bigger.ctrl[pos] = (uint8_t)(h & 0x7F);
+        bigger.slots[pos] = *slot;
+        bigger.growth_left--;
+    }
+    bigger.size = table->size;
+
+    dup_table_free(table);
+    *table = bigger;
+    return true;
+}
+
+// ============================================================================
+// INSERT
+//
+// RETURNS: group id of the key. Existing keys return their id; new keys
+// get the next id (0, 1, 2, ... in first-seen order). -1 if out of memory.
+// ============================================================================
+int dup_table_insert(DupTable* table, uint64_t digest, long long size) {
+    uint64_t h = mix_key(digest, size);
+    size_t pos = find_slot(table, h, digest, size);
+
+    if (!(table->ctrl[pos] & CTRL_EMPTY)) {
+        return table->slots[pos].group;
+    }
+
+    if (table->growth_left == 0) {
+        if (!grow_table(table)) return -1;
+        pos = find_slot(table, h, digest, size);
+    }
+
+    table->ctrl[pos] = (uint8_t)(h & 0x7F);
+    table->slots[pos].digest = digest;
+    table->slots[pos].size = size;
+    table->slots[pos].group = (int)table->size;
+    table->growth_left--;
+
+    return (int)table->size++;
+}
+
+// ============================================================================
+// FIND
+//
+// RETURNS: group id of the key, or -1 if it was never inserted
+// ============================================================================
+int dup_table_find(const DupTable* table, uint64_t digest, long long size) {
+    if (!table || !table->ctrl) return -1;
+
+    size_t pos = find_slot(table, mix_key(digest, size), digest, size);
+    if (table->ctrl[pos] & CTRL_EMPTY) return -1;
+
+    return table->slots[pos].group;
+}
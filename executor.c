@@ -0,0 +1,569 @@
+/*
+ * EXECUTOR.C - Parallel, Batched Execution of File Actions
+ *
+ * DSA CONCEPTS DEMONSTRATED:
+ * 1. Work Queue with a Bounded Worker Pool (parallel_for over batches)
+ * 2. Sorting for Locality (operations grouped by directory)
+ * 3. Per-Item Result Records (every file reports its own outcome)
+ *
+ * WHY: Delete, move and link are one synchronous metadata call per file
+ * (a clone reads both files, then is one call per gigabyte).
+ * On a local disk that is fast; on a network share each call is a round
+ * trip, so 500k files take hours when issued one at a time. Issuing up to
+ * `max_in_flight` calls at once hides the latency, and keeping each
+ * directory's calls together lets the server (and the local cache) work
+ * on one directory at a time.
+ *
+ * A plan owns copies of every path it needs, so it is built once under
+ * the caller's lock and then executed without it; the GUI keeps running
+ * and can show plan->completed while the workers run.
+ */
+
+#include "common.h"
+
+// ============================================================================
+// PLAN BUILDING
+// ============================================================================
+ActionPlan* action_plan_create(ActionKind kind, const char* dest_folder) {
+    ActionPlan* plan = (ActionPlan*)calloc(1, sizeof(ActionPlan));
+    if (!plan) return NULL;
+
+    plan->kind = kind;
+    if (dest_folder) {
+        plan->dest_folder = _strdup(dest_folder);
+        if (!plan->dest_folder) {
+            free(plan);
+            return NULL;
+        }
+    }
+    return plan;
+}
+
+void action_plan_free(ActionPlan* plan) {
+    if (!plan) return;
+
+    for (int i = 0; i < plan->count; i++) {
+        free(plan->ops[i].path);
+        free(plan->ops[i].other);
+    }
+    free(plan->ops);
+    free(plan->dest_folder);
+    free(plan);
+}
+
+// ============================================================================
+// ADD OPERATION
+//
+// path:   the file acted on (deleted, moved, replaced by a link, or cloned)
+// source: for links and clones, the file to share data with; for
+//         deletes, a kept copy of the same data (what the journal
+//         restores from), or NULL; for quarantine, the stored object
+//         (quarantine_execute sets it); for moves, NULL
+// group, member: where the file came from, for reporting
+// ============================================================================
+bool action_plan_add(ActionPlan* plan, int group, int member,
+                     const char* path, const char* source) {
+    if (!plan || !path) return false;
+    if (plan->kind != ACTION_DELETE && plan->kind != ACTION_MOVE && !source) return false;
+
+    if (plan->count >= plan->capacity) {
+        int new_capacity = plan->capacity ? plan->capacity * 2 : 256;
+        ActionOp* grown = (ActionOp*)realloc(plan->ops, new_capacity * sizeof(ActionOp));
+        if (!grown) return false;
+        plan->ops = grown;
+        plan->capacity = new_capacity;
+    }
+
+    ActionOp* op = &plan->ops[plan->count];
+    memset(op, 0, sizeof(ActionOp));
+    op->group = group;
+    op->member = member;
+    op->path = _strdup(path);
+    op->other = source ? _strdup(source) : NULL;
+    op->status = OP_PENDING;
+
+    if (!op->path || (source && !op->other)) {
+        free(op->path);
+        free(op->other);
+        return false;
+    }
+
+    plan->count++;
+    return true;
+}
+
+// ============================================================================
+// PLAN FROM RESULTS
+//
+// The usual "keep the first file of every group" plan: members 1..n of
+// each group are deleted, moved, or linked to (cloned from) member 0.
+// Deletes name member 0 as the kept copy; so does quarantine until
+// quarantine_execute replaces it with the stored object, and its
+// dest_folder is the store.
+// ============================================================================
+ActionPlan* action_plan_from_results(const DuplicateResults* results, ActionKind kind,
+                                     const char* dest_folder) {
+    if (!results) return NULL;
+    if ((kind == ACTION_MOVE || kind == ACTION_QUARANTINE) && !dest_folder) return NULL;
+
+    ActionPlan* plan = action_plan_create(kind, dest_folder);
+    if (!plan) return NULL;
+
+    for (int i = 0; i < results->count; i++) {
+        const DuplicateGroup* group = &results->groups[i];
+        const char* keep = group_file(results, group, 0)->path;
+
+        for (int j = 1; j < group->count; j++) {
+            if (!action_plan_add(plan, i, j, group_file(results, group, j)->path,
+                                 kind == ACTION_MOVE ? NULL : keep)) {
+                action_plan_free(plan);
+                return NULL;
+            }
+        }
+    }
+    return plan;
+}
+
+// ============================================================================
+// DIRECTORY ORDER
+// ============================================================================
+typedef struct {
+    const ActionPlan* plan;
+    int* order;              // Op indices sorted by directory
+    int* batch_start;        // batch_count + 1 entries into order[]
+    int batch_count;
+    HANDLE copy_slots;       // Semaphore: ACTION_MAX_COPIES whole-file reads or copies
+} ExecJob;
+
+static int directory_length(const char* path) {
+    const char* slash = strrchr(path, PATH_SEP);
+    return slash ? (int)(slash - path) : 0;
+}
+
+typedef struct {
+    const char* path;
+    int dir_len;
+    int index;
+} DirEntry;
+
+static int compare_by_directory(const void* a, const void* b) {
+    const DirEntry* x = (const DirEntry*)a;
+    const DirEntry* y = (const DirEntry*)b;
+
+    if (x->dir_len != y->dir_len) return x->dir_len - y->dir_len;
+
+    int c = path_ncompare(x->path, y->path, x->dir_len);
+    if (c != 0) return c;
+    return x->index - y->index;    // Plan order within a directory
+}
+
+static bool same_directory(const char* a, const char* b) {
+    int la = directory_length(a);
+    return la == directory_length(b) && path_ncompare(a, b, la) == 0;
+}
+
+// ============================================================================
+// MOVE DESTINATIONS
+//
+// Names are chosen before any file moves, in plan order, so two moved
+// files named alike get base.ext and base_1.ext deterministically. The
+// name registry (name_registry.c) lists each destination directory once
+// and remembers every name it hands out, so a name costs O(1) file system
+// calls however many files share it.
+//
+// mirror_tree keeps the source folders: C:\photos\a.jpg moves to
+// <dest>\C\photos\a.jpg. Each destination directory is created once,
+// when the registry first sees it.
+// ============================================================================
+static bool destination_directory(const ActionPlan* plan, const char* path, char* dir) {
+    if (!plan->mirror_tree) {
+        return snprintf(dir, MAX_PATH_LENGTH, "%s", plan->dest_folder) < MAX_PATH_LENGTH;
+    }
+
+    const char* slash = strrchr(path, PATH_SEP);
+    int dir_len = slash ? (int)(slash - path) : 0;
+
+    int len = snprintf(dir, MAX_PATH_LENGTH, "%s", plan->dest_folder);
+    if (len >= MAX_PATH_LENGTH - 1) return false;
+    if (len > 0 && dir[len - 1] != PATH_SEP) dir[len++] = PATH_SEP;
+
+    // Drop the ':' of "C:" and repeated separators (the "\\" of UNC paths);
+    // outside Windows ':' is an ordinary character
+    for (int i = 0; i < dir_len; i++) {
+        char c = path[i];
+        if ((c == ':' && PATH_SEP == '\\') || (c == PATH_SEP && dir[len - 1] == PATH_SEP)) continue;
+        if (len >= MAX_PATH_LENGTH - 1) return false;
+        dir[len++] = c;
+    }
+    if (dir_len > 0 && dir[len - 1] == PATH_SEP) len--;
+    dir[len] = '\0';
+    return true;
+}
+
+static DWORD allocate_destination(ActionPlan* plan, NameRegistry* registry,
+                                  ActionOp* op) {
+    char dir[MAX_PATH_LENGTH];
+    char dest_path[MAX_PATH_LENGTH];
+
+    if (!destination_directory(plan, op->path, dir)) return ERROR_FILENAME_EXCED_RANGE;
+
+    if (plan->mirror_tree && !name_registry_knows_directory(registry, dir)) {
+        int result = SHCreateDirectoryExA(NULL, dir, NULL);
+        if (result != ERROR_SUCCESS && result != ERROR_ALREADY_EXISTS) return (DWORD)result;
+    }
+
+    const char* filename = strrchr(op->path, PATH_SEP);
+    filename = filename ? filename + 1 : op->path;
+
+    if (!name_registry_claim(registry, dir, filename, dest_path)) {
+        return ERROR_FILENAME_EXCED_RANGE;
+    }
+    if (!(op->other = _strdup(dest_path))) return ERROR_NOT_ENOUGH_MEMORY;
+    return ERROR_SUCCESS;
+}
+
+static void plan_destinations(ActionPlan* plan) {
+    NameRegistry* registry = NULL;
+    DWORD error = ERROR_SUCCESS;
+
+    if (!ensure_directory_exists(plan->dest_folder)) {
+        error = GetLastError();
+    } else if (!(registry = name_registry_create())) {
+        error = ERROR_NOT_ENOUGH_MEMORY;
+    }
+
+    for (int i = 0; i < plan->count; i++) {
+        ActionOp* op = &plan->ops[i];
+        if (op->other) continue;    // Resumed plan: named before the crash
+
+        DWORD op_error = registry ? allocate_destination(plan, registry, op) : error;
+        if (op_error != ERROR_SUCCESS) {
+            op->status = OP_FAILED;
+            op->error = op_error;
+        }
+    }
+
+    name_registry_destroy(registry);
+}
+
+// ============================================================================
+// CROSS-VOLUME MOVES
+//
+// Decided before anything runs: a move whose source is not on the
+// destination's volume becomes copy + flush + rename + delete (run_copy_move)
+// instead of a rename. Every destination of a plan lies under
+// dest_folder, so one volume lookup covers them; sources are looked up
+// once per directory (ops of one group usually share directories).
+// ============================================================================
+static void mark_cross_volume(ActionPlan* plan) {
+    char dest_root[MAX_PATH_LENGTH];
+    if (!GetVolumePathNameA(plan->dest_folder, dest_root, sizeof(dest_root))) return;
+
+    char source_root[MAX_PATH_LENGTH];
+    const char* last_dir = NULL;
+    int last_dir_len = -1;
+    bool last_cross = false;
+
+    for (int i = 0; i < plan->count; i++) {
+        ActionOp* op = &plan->ops[i];
+        if (op->status != OP_PENDING) continue;
+
+        const char* slash = strrchr(op->path, PATH_SEP);
+        int dir_len = slash ? (int)(slash - op->path) : 0;
+
+        if (!last_dir || dir_len != last_dir_len || path_ncompare(last_dir, op->path, dir_len) != 0) {
+            last_dir = op->path;
+            last_dir_len = dir_len;
+            last_cross = GetVolumePathNameA(op->path, source_root, sizeof(source_root)) &&
+                         path_compare(source_root, dest_root) != 0;
+            TELEMETRY_COUNT(TELEMETRY_CACHE_MISSES, 1);
+        } else {
+            TELEMETRY_COUNT(TELEMETRY_CACHE_HITS, 1);
+        }
+        op->copy = last_cross;
+    }
+}
+
+// Copy without the cache for big files (no pollution, device-speed
+// streaming) to a temporary name beside the destination, make the copy
+// durable, rename it into place, and only then delete the source. A
+// crash never leaves a partial file under the destination name, only a
+// temporary copy or a complete one next to the untouched source (both
+// removed when the journal is loaded). If the source cannot be deleted
+// the copy is removed again, so a failed move never leaves the file in
+// two places.
+static bool run_copy_move(ActionOp* op, int sequence, HANDLE copy_slots) {
+    char temp[MAX_PATH_LENGTH];
+    const char* slash = strrchr(op->other, PATH_SEP);
+    int len = snprintf(temp, sizeof(temp), "%.*s" PATH_SEP_STR ".dedup-move-%lu-%d.tmp",
+                       slash ? (int)(slash - op->other) : 0, op->other,
+                       (unsigned long)GetCurrentProcessId(), sequence);
+    if (len >= (int)sizeof(temp)) {
+        SetLastError(ERROR_FILENAME_EXCED_RANGE);
+        return false;
+    }
+
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    DWORD flags = 0;
+    if (GetFileAttributesExA(op->path, GetFileExInfoStandard, &data) &&
+        (((long long)data.nFileSizeHigh << 32) | data.nFileSizeLow) >= ACTION_UNBUFFERED_MIN) {
+        flags |= COPY_FILE_NO_BUFFERING;
+    }
+
+    // At most ACTION_MAX_COPIES transfers share the devices at once
+    TELEMETRY_START(wait);
+    WaitForSingleObject(copy_slots, INFINITE);
+    TELEMETRY_STOP(TELEMETRY_QUEUE_WAIT, wait);
+    TELEMETRY_COUNT(TELEMETRY_QUEUE_WAITS, 1);
+    BOOL copied = CopyFileExA(op->path, temp, NULL, NULL, NULL, flags);
+    ReleaseSemaphore(copy_slots, 1, NULL);
+    TELEMETRY_COUNT(TELEMETRY_SYSCALLS, 2);   // Attributes, copy
+
+    HANDLE h = copied ? CreateFileA(temp, GENERIC_WRITE, 0, NULL, OPEN_EXISTING,
+                                    FILE_ATTRIBUTE_NORMAL, NULL)
+                      : INVALID_HANDLE_VALUE;
+    bool flushed = h != INVALID_HANDLE_VALUE && FlushFileBuffers(h);
+    if (h != INVALID_HANDLE_VALUE) CloseHandle(h);
+    TELEMETRY_COUNT(TELEMETRY_SYSCALLS, 5);   // Open, flush, close, rename, delete
+
+    // No MOVEFILE_REPLACE_EXISTING: the destination name was claimed free
+    if (!flushed || !MoveFileExA(temp, op->other, MOVEFILE_WRITE_THROUGH)) {
+        DWORD error = GetLastError();
+        DeleteFileA(temp);
+        SetLastError(error);
+        return false;
+    }
+
+    if (DeleteFileA(op->path)) return true;
+
+    DWORD error = GetLastError();
+    DeleteFileA(op->other);
+    SetLastError(error);
+    return false;
+}
+
+// ============================================================================
+// RUN ONE OPERATION
+// ============================================================================
+static void run_op(ActionOp* op, ActionKind kind, int sequence, HANDLE copy_slots) {
+    bool ok = false;
+
+    switch (kind) {
+        case ACTION_DELETE: {
+            // The kept copy must still exist and be another file: a path
+            // that reaches the kept file itself (a hard link, or a folder
+            // seen twice) would delete the only copy
+            FileIdentity kept_id, target_id;
+            if (op->other) {
+                TELEMETRY_COUNT(TELEMETRY_SYSCALLS, 6);   // Two opens, queries, closes
+                if (!get_file_identity(op->other, &kept_id) ||
+                    !get_file_identity(op->path, &target_id)) {
+                    break;
+                }
+                if (kept_id.volume == target_id.volume && kept_id.index == target_id.index) {
+                    op->status = OP_SKIPPED;
+                    return;
+                }
+            }
+            ok = DeleteFileA(op->path) != 0;
+            TELEMETRY_COUNT(TELEMETRY_SYSCALLS, 1);
+            break;
+        }
+
+        case ACTION_MOVE:
+            if (op->copy) {
+                ok = run_copy_move(op, sequence, copy_slots);
+            } else {
+                // COPY_ALLOWED still covers a volume change we did not foresee
+                ok = MoveFileExA(op->path, op->other, MOVEFILE_COPY_ALLOWED) != 0;
+                TELEMETRY_COUNT(TELEMETRY_SYSCALLS, 1);
+            }
+            break;
+
+        case ACTION_CLONE:
+        case ACTION_QUARANTINE: {
+            // Both read whole files before acting: a copy's worth of I/O
+            TELEMETRY_START(wait);
+            WaitForSingleObject(copy_slots, INFINITE);
+            TELEMETRY_STOP(TELEMETRY_QUEUE_WAIT, wait);
+            TELEMETRY_COUNT(TELEMETRY_QUEUE_WAITS, 1);
+            OpStatus status = kind == ACTION_CLONE ? clone_file_from(op->other, op->path)
+                                                   : quarantine_remove(op->path, op->other);
+            DWORD error = GetLastError();
+            ReleaseSemaphore(copy_slots, 1, NULL);
+            TELEMETRY_COUNT(TELEMETRY_SYSCALLS, kind == ACTION_CLONE ? 8 : 4);
+            if (status == OP_SKIPPED) {
+                op->status = OP_SKIPPED;
+                return;
+            }
+            ok = status == OP_DONE;
+            SetLastError(error);
+            break;
+        }
+
+        case ACTION_HARD_LINK: {
+            FileIdentity source_id, target_id;
+            TELEMETRY_COUNT(TELEMETRY_SYSCALLS, 6);   // Two opens, queries, closes
+            if (!get_file_identity(op->other, &source_id) ||
+                !get_file_identity(op->path, &target_id)) {
+                break;
+            }
+            if (source_id.volume != target_id.volume ||    // Cross-volume
+                source_id.index == target_id.index) {      // Already linked
+                op->status = OP_SKIPPED;
+                return;
+            }
+            ok = replace_with_link(op->other, op->path, sequence);
+            TELEMETRY_COUNT(TELEMETRY_SYSCALLS, 2);   // Link, rename
+            break;
+        }
+    }
+
+    op->status = ok ? OP_DONE : OP_FAILED;
+    if (!ok) op->error = GetLastError();
+}
+
+static void run_batch(void* context, int batch) {
+    ExecJob* job = (ExecJob*)context;
+    ActionPlan* plan = (ActionPlan*)job->plan;
+
+    for (int k = job->batch_start[batch]; k < job->batch_start[batch + 1]; k++) {
+        int i = job->order[k];
+        ActionOp* op = &plan->ops[i];
+
+        if (op->status == OP_PENDING) {
+            TELEMETRY_START(t);
+            run_op(op, plan->kind, i, job->copy_slots);
+            TELEMETRY_STOP(TELEMETRY_ACTION, t);
+            if (plan->journal) journal_op_finished(plan->journal, plan, i);
+        }
+        InterlockedIncrement(&plan->completed);
+    }
+}
+
+// ============================================================================
+// EXECUTE PLAN
+//
+// Step 1: Moves only - pick every destination name (serial, no file
+//         moves) and mark the moves that leave their volume
+// Step 2: Links only - check each source's volume once per group. With a
+//         journal attached, the plan is then recorded (journal.c) and
+//         each op's outcome is appended as it finishes
+// Step 3: Sort operations by directory, cut into batches of at most
+//         ACTION_BATCH_SIZE (a huge directory still spreads over workers)
+// Step 4: max_in_flight workers take batches from a shared counter; each
+//         runs its batch in order, one synchronous call at a time, so at
+//         most max_in_flight calls are outstanding. Of those, at most
+//         ACTION_MAX_COPIES are cross-volume copies, clones or quarantine
+//         checks (which read whole files): enough to keep the devices
+//         streaming, few enough not to make them seek
+//
+// Each op ends OP_DONE, OP_SKIPPED (nothing to do, nothing touched) or
+// OP_FAILED (error holds GetLastError()). Ops that are not OP_PENDING on
+// entry (a plan resumed from the journal) are left as they are.
+//
+// RETURNS: false only if the executor itself ran out of memory
+// ============================================================================
+bool action_execute(ActionPlan* plan, int max_in_flight) {
+    if (!plan) return false;
+    if (max_in_flight <= 0) max_in_flight = ACTION_MAX_IN_FLIGHT;
+
+    plan->completed = 0;
+    plan->succeeded = plan->skipped = plan->failed = 0;
+    if (plan->count == 0) return true;
+
+    ExecJob job = {0};
+    job.plan = plan;
+    job.order = (int*)malloc(plan->count * sizeof(int));
+    job.batch_start = (int*)malloc((plan->count + 1) * sizeof(int));
+    if (!job.order || !job.batch_start) {
+        free(job.order);
+        free(job.batch_start);
+        return false;
+    }
+
+    // ========================================================================
+    // STEPS 1-2: PER-PLAN AND PER-GROUP CHECKS
+    // ========================================================================
+    if (plan->kind == ACTION_MOVE) {
+        plan_destinations(plan);
+        mark_cross_volume(plan);
+    } else if (plan->kind == ACTION_HARD_LINK) {
+        const char* checked = NULL;
+        bool supported = false;
+
+        // Ops of one group are adjacent and share their source string
+        for (int i = 0; i < plan->count; i++) {
+            ActionOp* op = &plan->ops[i];
+            if (!checked || strcmp(checked, op->other) != 0) {
+                checked = op->other;
+                supported = volume_supports_hard_links(checked);
+            }
+            if (!supported && op->status == OP_PENDING) op->status = OP_SKIPPED;
+        }
+    }
+
+    // Write-ahead: nothing runs unless the journal holds the whole plan.
+    // A resumed plan (journal_load_last) is recorded already.
+    if (plan->journal && plan->journal_batch == 0 && !journal_begin(plan->journal, plan)) {
+        DWORD error = GetLastError();
+        for (int i = 0; i < plan->count; i++) {
+            if (plan->ops[i].status != OP_PENDING) continue;
+            plan->ops[i].status = OP_FAILED;
+            plan->ops[i].error = error ? error : ERROR_WRITE_FAULT;
+        }
+    }
+
+    // ========================================================================
+    // STEP 3: DIRECTORY BATCHES
+    // ========================================================================
+    DirEntry* entries = (DirEntry*)malloc(plan->count * sizeof(DirEntry));
+    if (!entries) {
+        free(job.order);
+        free(job.batch_start);
+        return false;
+    }
+    for (int i = 0; i < plan->count; i++) {
+        entries[i].path = plan->ops[i].path;
+        entries[i].dir_len = directory_length(plan->ops[i].path);
+        entries[i].index = i;
+    }
+    qsort(entries, plan->count, sizeof(DirEntry), compare_by_directory);
+    for (int k = 0; k < plan->count; k++) job.order[k] = entries[k].index;
+    free(entries);
+
+    for (int k = 0; k < plan->count; k++) {
+        bool new_directory = k == 0 ||
+            !same_directory(plan->ops[job.order[k - 1]].path, plan->ops[job.order[k]].path);
+        bool batch_full = k > 0 &&
+            k - job.batch_start[job.batch_count - 1] >= ACTION_BATCH_SIZE;
+
+        if (new_directory || batch_full) {
+            job.batch_start[job.batch_count++] = k;
+        }
+    }
+    job.batch_start[job.batch_count] = plan->count;
+
+    // ========================================================================
+    // STEP 4: WORKER POOL
+    // ========================================================================
+    // Without the semaphore copies just run unthrottled
+    job.copy_slots = CreateSemaphoreA(NULL, ACTION_MAX_COPIES, ACTION_MAX_COPIES, NULL);
+    parallel_for(job.batch_count, max_in_flight, run_batch, &job);
+    if (job.copy_slots) CloseHandle(job.copy_slots);
+    if (plan->journal && plan->journal_batch != 0) journal_commit(plan->journal, plan);
+
+    for (int i = 0; i < plan->count; i++) {
+        switch (plan->ops[i].status) {
+            case OP_DONE:    plan->succeeded++; break;
+            case OP_SKIPPED: plan->skipped++;   break;
+            default:         plan->failed++;    break;
+        }
+    }
+    // A resumed plan whose journal lost ops: those were not run
+    if (plan->journal_count > plan->count) plan->failed += plan->journal_count - plan->count;
+
+    free(job.order);
+    free(job.batch_start);
+    return true;
+}
@@ -2,163 +2,258 @@
  * FILTER.C - Duplicate Detection using Hash Table
  * 
  * DSA CONCEPTS DEMONSTRATED:
- * 1. Hash Table with Separate Chaining
- * 2. Dynamic Arrays with Growth Strategy
- * 3. Collision Resolution
- * 4. String Hashing (DJB2 Algorithm)
+ * 1. Hash Table with Open Addressing (dup_table.c)
+ * 2. Counting Sort style bucketing (counting pass + prefix sums)
+ * 3. Flat Arrays instead of per-node allocations
+ * 4. Partitioning for Parallelism (hash sharding)
  * 5. Load Factor Analysis
  * 
- * ALGORITHM: Find duplicates in O(n) average time
+ * ALGORITHM: Find duplicates in O(n) average time, O(n / threads) wall time
  */
 
 #include "common.h"
 
 // ============================================================================
-// HASH TABLE NODE STRUCTURE
+// SHARD STRUCTURE
 // 
-// Each node in the linked list represents files with the same hash value
+// All files whose digest falls in one high-bit range. Two duplicates always
+// have the same digest, so they always land in the same shard: shards can
+// be grouped independently, with no locks and no merge step.
 // ============================================================================
-typedef struct HashNode {
-    char hash[HASH_LENGTH];
-    int* file_indices;
+typedef struct {
+    int begin;              // Range of this shard in order[] / members[]
+    int end;
+    int* group_end;         // End offset (in members[]) of each group
+    int group_count;
+    int group_base;         // Index of the shard's first group in results
+    bool failed;            // Out of memory: the shard's groups are missing
+} Shard;
+
+typedef struct {
+    FileInfo* files;
     int count;
-    int capacity;
-    struct HashNode* next;
-} HashNode;
+    int threads;
+    int shard_count;
+    int (*slice_hist)[FIND_MAX_SHARDS];   // [slice][shard] file counts
+    int* order;             // File indices, grouped by shard
+    int* members;           // Group members, same layout as order[]
+    Shard* shards;
+    DuplicateResults* results;
+} FindJob;
+
+static bool is_error_hash(const FileInfo* file) {
+    return strncmp(file->hash, "ERROR", 5) == 0;
+}
+
+// Multiply-shift: maps the top 32 digest bits onto [0, shard_count)
+static int shard_of(const FileInfo* file, int shard_count) {
+    return (int)(((file->digest >> 32) * (uint64_t)shard_count) >> 32);
+}
+
+static void slice_bounds(const FindJob* job, int slice, int* lo, int* hi) {
+    *lo = (int)((long long)job->count * slice / job->threads);
+    *hi = (int)((long long)job->count * (slice + 1) / job->threads);
+}
 
 // ============================================================================
-// DJB2 STRING HASH FUNCTION
-// 
-// PURPOSE: Convert hash string to table index
-// 
-// ALGORITHM:
-// 1. Initialize hash = 5381 (magic number)
-// 2. For each character: hash = hash * 33 + character
-// 3. Take modulo HASH_TABLE_SIZE
+// PARTITION TASKS (parallel counting sort by shard)
 // 
-// WHY THIS WORKS:
-// - Multiplication by 33 (prime-like) gives good distribution
-// - Left shift by 5 (hash << 5) = hash * 32, add hash = hash * 33
-// - Fast bit operations instead of multiplication
-// 
-// TIME COMPLEXITY: O(k) where k = string length
-// SPACE COMPLEXITY: O(1)
+// Count: each slice counts its files per shard
+// Scatter: each slice writes its file indices at
+//          shard start + counts of earlier slices for that shard
 // ============================================================================
-static unsigned int hash_string_to_index(const char* str) {
-    if (!str) return 0;
+static void count_slice(void* context, int slice) {
+    FindJob* job = (FindJob*)context;
+    int lo, hi;
+    slice_bounds(job, slice, &lo, &hi);
     
-    unsigned int hash = 5381;
-    int c;
+    int* hist = job->slice_hist[slice];
+    for (int i = lo; i < hi; i++) {
+        if (!is_error_hash(&job->files[i])) {
+            hist[shard_of(&job->files[i], job->shard_count)]++;
+        }
+    }
+}
+
+static void scatter_slice(void* context, int slice) {
+    FindJob* job = (FindJob*)context;
+    int lo, hi;
+    slice_bounds(job, slice, &lo, &hi);
     
-    while ((c = *str++)) {
-        hash = ((hash << 5) + hash) + c;  // hash * 33 + c
+    int cursor[FIND_MAX_SHARDS];
+    for (int s = 0; s < job->shard_count; s++) {
+        cursor[s] = job->shards[s].begin;
+        for (int t = 0; t < slice; t++) {
+            cursor[s] += job->slice_hist[t][s];
+        }
     }
     
-    return hash % HASH_TABLE_SIZE;
+    for (int i = lo; i < hi; i++) {
+        if (!is_error_hash(&job->files[i])) {
+            job->order[cursor[shard_of(&job->files[i], job->shard_count)]++] = i;
+        }
+    }
 }
 
 // ============================================================================
-// GROW DYNAMIC ARRAY (DOUBLING STRATEGY)
+// GROUP ONE SHARD
 // 
-// DSA CONCEPT: Dynamic array growth
+// Phase 1: Build hash table
+//    - Key = (binary digest, size), so equal hashes of different sizes
+//      never group together
+//    - Each file gets the group id of its key (first-seen order)
+// 
+// Phase 2: Counting pass
+//    - counts[group]++ for every file
+//    - Prefix sums over groups with 2+ files give each group its offset
+//      in the shard's part of the flat member array
 // 
-// STRATEGY: Double capacity when full
-// - Amortized time complexity: O(1) per insertion
-// - Total copies over n insertions: n/2 + n/4 + n/8 + ... < n
-// - Trade-off: Space vs Time
+// Phase 3: Fill members
+//    - Second pass drops each file index at its group's cursor
+//
+// Any allocation failure marks the shard failed (parallel_for tasks
+// return nothing), so the caller can fail instead of dropping groups.
 // ============================================================================
-static bool grow_array_if_needed(HashNode* node) {
-    if (!node) return false;
+static void group_shard(void* context, int s) {
+    FindJob* job = (FindJob*)context;
+    Shard* shard = &job->shards[s];
+    int n = shard->end - shard->begin;
+    const int* order = job->order + shard->begin;
+    
+    if (n <= 1) return;
     
-    if (node->count >= node->capacity) {
-        int new_capacity = node->capacity * 2;
-        int* new_array = (int*)realloc(
-            node->file_indices,
-            new_capacity * sizeof(int)
-        );
-        
-        if (!new_array) return false;
-        
-        node->file_indices = new_array;
-        node->capacity = new_capacity;
+    DupTable table;
+    int* file_group = (int*)malloc(n * sizeof(int));
+    if (!file_group || !dup_table_init(&table, (size_t)n)) {
+        free(file_group);
+        shard->failed = true;
+        return;
     }
     
-    return true;
-}
-
-// ============================================================================
-// CREATE NEW HASH NODE
-// 
-// Initializes a new node with given file index
-// ============================================================================
-static HashNode* create_hash_node(const char* hash, int file_idx) {
-    HashNode* node = (HashNode*)malloc(sizeof(HashNode));
-    if (!node) return NULL;
+    // ========================================================================
+    // PHASE 1: BUILD HASH TABLE
+    // ========================================================================
+    for (int i = 0; i < n; i++) {
+        const FileInfo* f = &job->files[order[i]];
+        file_group[i] = dup_table_insert(&table, f->digest, f->size);
+        if (file_group[i] < 0) {
+            dup_table_free(&table);
+            free(file_group);
+            shard->failed = true;
+            return;
+        }
+    }
     
-    strncpy(node->hash, hash, HASH_LENGTH - 1);
-    node->hash[HASH_LENGTH - 1] = '\0';
+    int key_count = (int)table.size;
+    dup_table_free(&table);  // Group ids are all we need from here on
     
-    node->capacity = 4;  // Initial capacity
-    node->file_indices = (int*)malloc(node->capacity * sizeof(int));
+    // ========================================================================
+    // PHASE 2: COUNTING PASS
+    // ========================================================================
+    int* counts = (int*)calloc(key_count > 0 ? key_count : 1, sizeof(int));
+    if (!counts) {
+        free(file_group);
+        shard->failed = true;
+        return;
+    }
     
-    if (!node->file_indices) {
-        free(node);
-        return NULL;
+    for (int i = 0; i < n; i++) {
+        counts[file_group[i]]++;
+    }
+    
+    // counts[] becomes the write cursor into members[];
+    // singletons get -1 and are skipped in the fill pass
+    int group_count = 0;
+    int member_total = shard->begin;
+    for (int g = 0; g < key_count; g++) {
+        if (counts[g] > 1) {
+            int size = counts[g];
+            counts[g] = member_total;
+            member_total += size;
+            group_count++;
+        } else {
+            counts[g] = -1;
+        }
+    }
+    
+    shard->group_end = (int*)malloc((group_count > 0 ? group_count : 1) * sizeof(int));
+    if (!shard->group_end) {
+        free(counts);
+        free(file_group);
+        shard->failed = true;
+        return;
+    }
+    
+    // ========================================================================
+    // PHASE 3: FILL MEMBERS
+    // ========================================================================
+    for (int i = 0; i < n; i++) {
+        int g = file_group[i];
+        if (counts[g] >= 0) {
+            job->members[counts[g]++] = order[i];
+        }
     }
     
-    node->file_indices[0] = file_idx;
-    node->count = 1;
-    node->next = NULL;
+    // After the fill, counts[g] is the END of group g
+    for (int g = 0; g < key_count; g++) {
+        if (counts[g] >= 0) {
+            shard->group_end[shard->group_count++] = counts[g];
+        }
+    }
     
-    return node;
+    free(counts);
+    free(file_group);
 }
 
 // ============================================================================
-// FREE HASH TABLE
+// EXTRACT ONE SHARD'S GROUPS
 // 
-// Deallocates all nodes in the hash table
+// Shards write disjoint ranges of results->groups (from group_base on),
+// so this also runs in parallel. Groups are spans of members[]: no file
+// record is copied.
 // ============================================================================
-static void free_hash_table(HashNode** table) {
-    if (!table) return;
+static void extract_shard(void* context, int s) {
+    FindJob* job = (FindJob*)context;
+    Shard* shard = &job->shards[s];
+    DuplicateGroup* out = job->results->groups + shard->group_base;
     
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        HashNode* node = table[i];
-        while (node) {
-            HashNode* next = node->next;
-            free(node->file_indices);
-            free(node);
-            node = next;
-        }
+    int start = shard->begin;
+    for (int g = 0; g < shard->group_count; g++) {
+        DuplicateGroup* group = &out[g];
+        group->members = job->members + start;
+        group->count = shard->group_end[g] - start;
+        group->size = job->files[job->members[start]].size;
+        start = shard->group_end[g];
     }
-    free(table);
 }
 
 // ============================================================================
 // FIND DUPLICATES USING HASH TABLE
 // 
 // ALGORITHM OVERVIEW:
-// Phase 1: Build hash table
-//    - For each file, compute bucket index
-//    - Search chain for matching hash
-//    - Add to existing node or create new node
+// Step 1: Partition (parallel)
+//    - Shard = high digest bits; one shard per worker
+//    - Counting sort of file indices by shard into order[]
 // 
-// Phase 2: Count duplicate groups
-//    - Traverse table, count nodes with 2+ files
+// Step 2: Group each shard (parallel, lock-free)
+//    - Own DupTable, own slice of order[] and members[]
 // 
-// Phase 3: Extract results
-//    - Copy file information to results structure
+// Step 3: Concatenate
+//    - Prefix sum of per-shard group counts gives each shard its output
+//      range; extraction then runs in parallel
+//    - Groups are spans of one member array indexing `files`, so the
+//      results cost O(groups) and copy no FileInfo
 // 
 // TIME COMPLEXITY:
-// - Average: O(n) where n = number of files
-// - Worst: O(n²) if all hashes collide (extremely unlikely)
+// - Average: O(n) work, O(n / threads) wall time
+// - Each table is sized from its shard up front, so no rehash happens
 // 
 // SPACE COMPLEXITY: O(n)
-// 
-// COLLISION HANDLING:
-// - Primary: Separate chaining (linked lists)
-// - Secondary: Size verification (prevents false positives)
+// - No per-group malloc/realloc while grouping
+// - Results: one int per member + one DuplicateGroup per group
+//   (copying FileInfo would cost 4 KB+ per member)
 // ============================================================================
-DuplicateResults find_duplicates(FileInfo* files, int count) {
+DuplicateResults find_duplicates_parallel(FileInfo* files, int count, int threads) {
     DuplicateResults results = {0};
     
     // Validation
@@ -166,119 +261,103 @@ DuplicateResults find_duplicates(FileInfo* files, int count) {
         return results;
     }
     
-    // Allocate hash table
-    HashNode** table = (HashNode**)calloc(HASH_TABLE_SIZE, sizeof(HashNode*));
-    if (!table) {
-        return results;
+    if (threads < 1) threads = 1;
+    if (threads > FIND_MAX_SHARDS) threads = FIND_MAX_SHARDS;
+    if (count < FIND_PARALLEL_THRESHOLD) threads = 1;
+    
+    TELEMETRY_START(t);
+    FindJob job = {0};
+    job.files = files;
+    job.count = count;
+    job.threads = threads;
+    job.shard_count = threads;
+    job.results = &results;
+    job.slice_hist = calloc(threads, sizeof(*job.slice_hist));
+    job.order = (int*)malloc(count * sizeof(int));
+    job.members = (int*)malloc(count * sizeof(int));
+    job.shards = (Shard*)calloc(job.shard_count, sizeof(Shard));
+    
+    if (!job.slice_hist || !job.order || !job.members || !job.shards) {
+        results.failed = true;
+        goto cleanup;
     }
     
     // ========================================================================
-    // PHASE 1: BUILD HASH TABLE
+    // STEP 1: PARTITION BY HIGH DIGEST BITS
     // ========================================================================
-    for (int i = 0; i < count; i++) {
-        // Skip error hashes
-        if (strncmp(files[i].hash, "ERROR", 5) == 0) {
-            continue;
-        }
-        
-        // Get bucket index
-        unsigned int bucket = hash_string_to_index(files[i].hash);
-        
-        // Search chain for matching hash
-        HashNode* current = table[bucket];
-        HashNode* prev = NULL;
-        bool found = false;
-        
-        while (current) {
-            if (strcmp(current->hash, files[i].hash) == 0) {
-                // Verify file size to prevent hash collisions
-                if (files[i].size == files[current->file_indices[0]].size) {
-                    // Add to existing node
-                    if (grow_array_if_needed(current)) {
-                        current->file_indices[current->count++] = i;
-                        found = true;
-                    }
-                }
-                break;
-            }
-            prev = current;
-            current = current->next;
+    parallel_for(threads, threads, count_slice, &job);
+    
+    int offset = 0;
+    for (int s = 0; s < job.shard_count; s++) {
+        job.shards[s].begin = offset;
+        for (int t = 0; t < threads; t++) {
+            offset += job.slice_hist[t][s];
         }
-        
-        // Create new node if not found
-        if (!found) {
-            HashNode* new_node = create_hash_node(files[i].hash, i);
-            if (new_node) {
-                // Insert at end of chain
-                if (prev) {
-                    prev->next = new_node;
-                } else {
-                    table[bucket] = new_node;
-                }
-            }
+        job.shards[s].end = offset;
+    }
+    
+    parallel_for(threads, threads, scatter_slice, &job);
+    
+    // ========================================================================
+    // STEP 2: GROUP SHARDS CONCURRENTLY
+    // ========================================================================
+    parallel_for(job.shard_count, threads, group_shard, &job);
+    
+    // A failed shard would silently drop its groups: report nothing
+    for (int s = 0; s < job.shard_count; s++) {
+        if (job.shards[s].failed) {
+            results.failed = true;
+            goto cleanup;
         }
     }
     
     // ========================================================================
-    // PHASE 2: COUNT DUPLICATE GROUPS
+    // STEP 3: CONCATENATE
     // ========================================================================
     int group_count = 0;
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        for (HashNode* node = table[i]; node; node = node->next) {
-            if (node->count > 1) {
-                group_count++;
-            }
-        }
+    for (int s = 0; s < job.shard_count; s++) {
+        job.shards[s].group_base = group_count;
+        group_count += job.shards[s].group_count;
     }
     
     // No duplicates found
     if (group_count == 0) {
-        free_hash_table(table);
-        return results;
+        goto cleanup;
     }
     
-    // ========================================================================
-    // PHASE 3: EXTRACT DUPLICATE GROUPS
-    // ========================================================================
     results.groups = (DuplicateGroup*)malloc(group_count * sizeof(DuplicateGroup));
     if (!results.groups) {
-        free_hash_table(table);
-        return results;
+        results.failed = true;
+        goto cleanup;
     }
     
-    results.count = 0;
+    parallel_for(job.shard_count, threads, extract_shard, &job);
+    
+    // The member array now belongs to the results
+    results.count = group_count;
     results.capacity = group_count;
+    results.members = job.members;
+    results.files = files;
+    job.members = NULL;
     
-    // Copy file information
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        HashNode* node = table[i];
-        while (node) {
-            if (node->count > 1) {
-                DuplicateGroup* group = &results.groups[results.count];
-                
-                group->files = (FileInfo*)malloc(node->count * sizeof(FileInfo));
-                
-                if (group->files) {
-                    group->count = node->count;
-                    group->capacity = node->count;
-                    
-                    // Copy file data
-                    for (int j = 0; j < node->count; j++) {
-                        int file_idx = node->file_indices[j];
-                        group->files[j] = files[file_idx];
-                    }
-                    
-                    results.count++;
-                }
-            }
-            node = node->next;
+cleanup:
+    if (job.shards) {
+        for (int s = 0; s < job.shard_count; s++) {
+            free(job.shards[s].group_end);
         }
     }
-    
-    free_hash_table(table);
+    free(job.shards);
+    free(job.members);
+    free(job.order);
+    free(job.slice_hist);
+    TELEMETRY_STOP(TELEMETRY_GROUP, t);
     return results;
 }
 
+DuplicateResults find_duplicates(FileInfo* files, int count) {
+    return find_duplicates_parallel(files, count, get_worker_count());
+}
+
 // ============================================================================
 // FREE DUPLICATE RESULTS
 // 
@@ -287,14 +366,21 @@ DuplicateResults find_duplicates(FileInfo* files, int count) {
 void free_duplicate_results(DuplicateResults* results) {
     if (!results) return;
     
-    for (int i = 0; i < results->count; i++) {
-        free(results->groups[i].files);
-    }
-    
     free(results->groups);
-    results->groups = NULL;
-    results->count = 0;
-    results->capacity = 0;
+    free(results->members);
+    if (results->owns_files) {
+        free(results->files);
+    }
+    memset(results, 0, sizeof(DuplicateResults));
+}
+
+// ============================================================================
+// GROUP FILE
+// 
+// RETURNS: FileInfo of member j of a group in these results
+// ============================================================================
+FileInfo* group_file(const DuplicateResults* results, const DuplicateGroup* group, int j) {
+    return &results->files[group->members[j]];
 }
 
 /*
@@ -304,52 +390,44 @@ void free_duplicate_results(DuplicateResults* results) {
  * 
  * HASH TABLE METRICS:
  * -------------------
- * Load Factor (α) = n / m
- *   where n = number of files, m = HASH_TABLE_SIZE (50021)
+ * Load Factor (α) = n / m, kept <= 7/8
+ *   where n = distinct (digest, size) keys, m = table capacity
+ * 
+ * Capacity is chosen from the file count before the first insert:
+ *   10M files → m = 16M slots (α ≈ 0.6 if every file is unique)
  * 
- * Example: 10,000 files → α ≈ 0.2 (excellent distribution)
+ * Sharding divides n by the worker count; each shard's table is sized
+ * from the shard alone, so tables stay small enough for the caches.
  * 
- * COLLISION PROBABILITY:
- * ----------------------
- * With good hash function and α < 1:
- * - Average chain length ≈ α
- * - Most buckets have 0-1 items
- * - Few long chains
+ * PROBING COST:
+ * -------------
+ * One probe = 16 control bytes compared in one SSE2 instruction.
+ * A wrong key matches the 7-bit tag with probability 1/128, so almost
+ * every lookup touches one control line and at most one slot.
  * 
  * COMPLEXITY ANALYSIS:
  * --------------------
- * Insert into hash table:
- *   - Average: O(1)
- *   - Worst: O(n) - all collide in one bucket
- * 
- * Search in hash table:
+ * Insert / search:
  *   - Average: O(1)
- *   - Worst: O(n)
+ *   - Worst: O(n) - all keys collide (needs 57-bit H1 collisions)
  * 
  * Overall algorithm:
  *   - Average: O(n) for n files
- *   - Worst: O(n²)
- * 
- * DYNAMIC ARRAY AMORTIZATION:
- * ---------------------------
- * Doubling strategy:
- *   - Single insertion: O(1) amortized
- *   - Total cost over n insertions: O(n)
- *   - Proof: 1 + 2 + 4 + 8 + ... + n < 2n
  * 
  * MEMORY USAGE:
  * -------------
- * - Hash table: 50,021 * 8 bytes ≈ 400 KB
- * - Nodes: ~n * sizeof(HashNode) ≈ n * 56 bytes
- * - Index arrays: ~n * 4 bytes
- * - Total: O(n) space
+ * - Control bytes: m * 1 byte
+ * - Slots: m * 24 bytes (digest, size, group id)
+ * - file_group + counts + members: <= 3 * n * 4 bytes
+ * - Results keep only members (n * 4 bytes) + one group header per group
+ * - Allocations: a handful, independent of n
+ *   (the old chained table did 2 mallocs per key plus reallocs)
  * 
  * COLLISION PREVENTION:
  * ---------------------
- * 1. Prime table size (50021) reduces patterns
- * 2. Good hash function (DJB2) distributes uniformly
- * 3. Size check eliminates false positives
- * 4. 64-bit hash → collision probability ≈ 1 in 10^19
+ * 1. Size is part of the key (prevents false positives)
+ * 2. Finalizer mix spreads digest + size over all 64 bits
+ * 3. 64-bit hash → collision probability ≈ 1 in 10^19
  * 
  * ============================================================================
- */
\ No newline at end of file
+ */
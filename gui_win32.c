@@ -39,14 +39,24 @@
 #define IDC_BTN_MOVE             1008
 #define IDC_BTN_HARD_LINK        1009
 #define IDC_BTN_DELETE_BY_INDEX  1010
+#define IDC_BTN_WATCH            1011
+#define IDC_BTN_BLOCKS           1012
+#define IDC_BTN_DIRS             1013
+#define IDC_BTN_NEAR             1014
+#define IDC_BTN_CLONE            1015
+#define IDC_BTN_UNDO             1016
+#define IDC_BTN_QUARANTINE       1017
+#define IDC_BTN_RESTORE          1018
 
 #define IDC_LISTBOX_DIRS         2001
 #define IDC_LISTBOX_EXCLUSIONS   2002
 #define IDC_LISTVIEW_RESULTS     2003
 #define IDC_EDIT_STATUS          2004
 #define IDC_PROGRESS             2005
+#define IDC_PROGRESS_TEXT        2006
 #define IDC_CHECK_SUBDIRS        3001
 #define IDC_COMBO_HASH           3002
+#define IDC_CHECK_NEAR           3003
 
 // Input dialog IDs
 #define ID_INPUT_DIALOG          4000
@@ -63,6 +73,10 @@ static ScanConfig g_config = {0};
 static FileInfo* g_files = NULL;
 static int g_file_count = 0;
 static DuplicateResults g_results = {0};
+static LiveIndex* g_liveIndex = NULL;
+static StreamIndex* g_streamIndex = NULL;    // Set only while a scan runs
+static NearIndex* g_nearIndex = NULL;        // Signatures of the last scan
+static volatile LONG g_lastGroupsPost = 0;   // Tick of the last WM_GROUPS_FOUND
 
 // Window handles
 static HWND g_hwndMain;
@@ -71,15 +85,24 @@ static HWND g_listExclusions;
 static HWND g_listResults;
 static HWND g_editStatus;
 static HWND g_hwndProgress;  // Renamed from g_progress to avoid conflict
+static HWND g_labelProgress; // Scan rate and ETA under the progress bar
 static HWND g_checkSubdirs;
+static HWND g_checkNear;
 static HWND g_comboHash;
 static HWND g_btnScan;
 static HWND g_btnFind;
 static HWND g_btnDeleteByIndex;
+static HWND g_btnWatch;
+static HWND g_btnBlocks;
+static HWND g_btnDirs;
 
 // Thread handles
 static HANDLE g_hScanThread = NULL;
 static HANDLE g_hFindThread = NULL;
+static HANDLE g_hBlockThread = NULL;        // Block or folder analysis
+static HANDLE g_hActionThread = NULL;
+static ActionPlan* g_actionPlan = NULL;      // Plan the action thread is running
+static Journal* g_journal = NULL;            // Every action is recorded here
 
 // Input dialog variables
 static int g_inputValue = -1;
@@ -97,57 +120,130 @@ void AppendStatus(const char* text) {
     SendMessage(g_editStatus, EM_REPLACESEL, FALSE, (LPARAM)text);
 }
 
+// ============================================================================
+// RESULTS VIEW (virtual list: LVS_OWNERDATA)
+//
+// The list view holds no rows, only their number. Windows asks for the
+// text of the cells it is about to paint (LVN_GETDISPINFO), so a million
+// results cost as much to show as a hundred.
+//
+// g_rowStart[g] is the first row of group g; a row finds its group by
+// binary search, or at once when it is in the group asked for last
+// (painting goes row by row). Guarded by g_dataLock, like g_results.
+//
+// The map belongs to the results it was built from: every change of
+// g_results goes through ReplaceResults, which drops it, so rows still
+// being painted afterwards stay empty.
+// ============================================================================
+static int* g_rowStart = NULL;
+static int g_rowGroupCount = 0;
+static int g_lastRowGroup = 0;
+
+// Caller holds g_dataLock. Takes ownership of *results (NULL: no results)
+static void ReplaceResults(const DuplicateResults* results) {
+    free_duplicate_results(&g_results);
+    if (results) g_results = *results;
+    
+    free(g_rowStart);
+    g_rowStart = NULL;
+    g_rowGroupCount = 0;
+    g_lastRowGroup = 0;
+}
+
 void UpdateListView() {
-    ListView_DeleteAllItems(g_listResults);
+    EnterCriticalSection(&g_dataLock);
+    
+    free(g_rowStart);
+    g_rowStart = (int*)malloc((g_results.count + 1) * sizeof(int));
+    g_rowGroupCount = 0;
+    g_lastRowGroup = 0;
+    
+    int rows = 0;
+    if (g_rowStart && g_results.groups) {
+        for (int i = 0; i < g_results.count; i++) {
+            g_rowStart[i] = rows;
+            rows += g_results.groups[i].count;
+        }
+        g_rowStart[g_results.count] = rows;
+        g_rowGroupCount = g_results.count;
+    }
+    int group_count = g_rowGroupCount;
+    
+    LeaveCriticalSection(&g_dataLock);
+    
+    // Outside the lock: the list view repaints (and asks for text) at once
+    ListView_SetItemCountEx(g_listResults, rows, 0);
+    
+    char status[256];
+    snprintf(status, sizeof(status), 
+            "Found %d duplicate groups with %d total files\r\n", 
+            group_count, rows);
+    AppendStatus(status);
+}
+
+// Caller holds g_dataLock and has checked 0 <= row < total rows
+static int RowGroup(int row) {
+    int g = g_lastRowGroup;
+    if (g < g_rowGroupCount && g_rowStart[g] <= row && row < g_rowStart[g + 1]) return g;
+    
+    // Last group starting at or before row
+    int lo = 0, hi = g_rowGroupCount - 1;
+    while (lo < hi) {
+        int mid = lo + (hi - lo + 1) / 2;
+        if (g_rowStart[mid] <= row) lo = mid;
+        else hi = mid - 1;
+    }
+    g_lastRowGroup = lo;
+    return lo;
+}
+
+void OnResultsDispInfo(NMLVDISPINFOA* info) {
+    LVITEMA* item = &info->item;
+    if (!(item->mask & LVIF_TEXT) || !item->pszText || item->cchTextMax <= 0) return;
+    item->pszText[0] = '\0';
     
     EnterCriticalSection(&g_dataLock);
     
-    for (int i = 0; i < g_results.count; i++) {
-        if (i >= g_results.count || !g_results.groups) break;
-        
+    // No map: the results were replaced or freed since the rows were set
+    int i = -1, j = -1;
+    if (g_rowStart && g_rowGroupCount == g_results.count &&
+        item->iItem >= 0 && item->iItem < g_rowStart[g_rowGroupCount]) {
+        i = RowGroup(item->iItem);
+        j = item->iItem - g_rowStart[i];
+    }
+    
+    if (i >= 0 && i < g_results.count && j >= 0 && j < g_results.groups[i].count) {
         DuplicateGroup* g = &g_results.groups[i];
-        if (!g || !g->files) continue;
+        FileInfo* file = group_file(&g_results, g, j);
         
-        for (int j = 0; j < g->count; j++) {
-            if (j >= g->count) break;
-            
-            char group_text[64];
-            snprintf(group_text, sizeof(group_text), "Group %d (%d/%d)", 
-                    i + 1, j + 1, g->count);
-            
-            LVITEMA lvi = {0};
-            lvi.mask = LVIF_TEXT;
-            lvi.iItem = ListView_GetItemCount(g_listResults);
-            lvi.pszText = group_text;
-            int idx = ListView_InsertItem(g_listResults, &lvi);
-            
-            if (idx == -1) continue;
-            
-            char size_text[32];
-            format_file_size(g->files[j].size, size_text, sizeof(size_text));
-            ListView_SetItemText(g_listResults, idx, 1, size_text);
+        switch (item->iSubItem) {
+            case 0:
+                snprintf(item->pszText, item->cchTextMax, "Group %d (%d/%d)", 
+                        i + 1, j + 1, g->count);
+                break;
             
-            const char* filename = strrchr(g->files[j].path, '\\');
-            filename = filename ? filename + 1 : g->files[j].path;
+            case 1: {
+                char size_text[32];
+                format_file_size(file->size, size_text, sizeof(size_text));
+                snprintf(item->pszText, item->cchTextMax, "%s", size_text);
+                break;
+            }
             
-            char short_name[64];
-            strncpy(short_name, filename, 60);
-            short_name[60] = '\0';
-            if (strlen(filename) > 60) strcat(short_name, "...");
-            ListView_SetItemText(g_listResults, idx, 2, short_name);
+            case 2: {
+                const char* filename = strrchr(file->path, '\\');
+                filename = filename ? filename + 1 : file->path;
+                snprintf(item->pszText, item->cchTextMax, "%.60s%s", 
+                        filename, strlen(filename) > 60 ? "..." : "");
+                break;
+            }
             
-            ListView_SetItemText(g_listResults, idx, 3, g->files[j].path);
+            case 3:
+                snprintf(item->pszText, item->cchTextMax, "%s", file->path);
+                break;
         }
     }
     
-    char status[256];
-    snprintf(status, sizeof(status), 
-            "Found %d duplicate groups with %d total files\r\n", 
-            g_results.count, ListView_GetItemCount(g_listResults));
-    
     LeaveCriticalSection(&g_dataLock);
-    
-    AppendStatus(status);
 }
 
 // Input dialog procedure
@@ -280,12 +376,42 @@ bool ShowIndexInputDialog(int* result) {
     return g_inputDialogResult;
 }
 
+// Called on the scan thread whenever a group forms or grows. Refreshing
+// copies every group, so the UI is told at most once per STREAM_REFRESH_MS.
+void OnGroupFound(void* context, const FileInfo* file, int group_count) {
+    LONG now = (LONG)GetTickCount();
+    LONG last = g_lastGroupsPost;
+    
+    if ((DWORD)(now - last) < STREAM_REFRESH_MS) return;
+    if (InterlockedCompareExchange(&g_lastGroupsPost, now, last) != last) return;
+    
+    PostMessage(g_hwndMain, WM_GROUPS_FOUND, 0, 0);
+}
+
+// Groups acted on mid-scan must not come back with the next refresh.
+// Caller holds g_dataLock.
+void RetireStreamGroups() {
+    if (!g_streamIndex) return;
+    
+    for (int i = 0; i < g_results.count; i++) {
+        DuplicateGroup* g = &g_results.groups[i];
+        if (g->members && g->count > 0) {
+            stream_index_retire(g_streamIndex, group_file(&g_results, g, 0)->digest, g->size);
+        }
+    }
+}
+
 DWORD WINAPI ScanThread(LPVOID param) {
     AppendStatus("Scanning directories...\r\n");
     
+    // Results refer into the file table, so they go with it
     EnterCriticalSection(&g_dataLock);
+    ReplaceResults(NULL);
     if (g_files) free(g_files);
     g_files = (FileInfo*)malloc(MAX_FILES * sizeof(FileInfo));
+    g_file_count = 0;
+    near_index_destroy(g_nearIndex);
+    g_nearIndex = NULL;
     LeaveCriticalSection(&g_dataLock);
     
     if (!g_files) {
@@ -294,18 +420,53 @@ DWORD WINAPI ScanThread(LPVOID param) {
         return 1;
     }
     
+    // Without the online index the scan still works; groups then
+    // appear only after Find
+    StreamIndex* stream = stream_index_create(OnGroupFound, NULL);
+    
     EnterCriticalSection(&g_dataLock);
     ScanConfig config_copy = g_config;
+    g_streamIndex = stream;
     LeaveCriticalSection(&g_dataLock);
     
-    int count = scan_directories(&config_copy, g_files, MAX_FILES);
+    ScanHooks hooks = {0};
+    hooks.stream = stream;
+    if (config_copy.near_duplicates) {
+        hooks.near = near_index_create(MAX_FILES);
+        if (!hooks.near) {
+            AppendStatus("WARNING: Not enough memory for near-duplicate signatures\r\n");
+        }
+    }
+    
+    int count = scan_directories_ex(&config_copy, g_files, MAX_FILES, &hooks);
+    
+    // Final result: every group, biggest physical savings first
+    DuplicateResults results = {0};
+    if (stream) {
+        results = stream_index_snapshot(stream, g_files);
+        rank_results_by_savings(&results, TOP_GROUPS_DEFAULT, true);
+    }
     
     EnterCriticalSection(&g_dataLock);
     g_file_count = count;
+    g_streamIndex = NULL;
+    g_nearIndex = hooks.near;
+    if (stream) {
+        ReplaceResults(&results);
+    }
+    int group_count = g_results.count;
     LeaveCriticalSection(&g_dataLock);
     
+    stream_index_destroy(stream);
+    
     char status[128];
-    snprintf(status, sizeof(status), "Scan complete! Found %d files\r\n", count);
+    if (stream) {
+        UpdateListView();
+        snprintf(status, sizeof(status), "Scan complete! Found %d files in %d duplicate groups\r\n",
+                 count, group_count);
+    } else {
+        snprintf(status, sizeof(status), "Scan complete! Found %d files\r\n", count);
+    }
     AppendStatus(status);
     
     PostMessage(g_hwndMain, WM_SCAN_COMPLETE, 0, 0);
@@ -315,9 +476,32 @@ DWORD WINAPI ScanThread(LPVOID param) {
 DWORD WINAPI FindThread(LPVOID param) {
     AppendStatus("Finding duplicates...\r\n");
     
+    // Scan is disabled while finding, so the file table cannot change
+    // underneath us; the lock is only needed to publish the result
     EnterCriticalSection(&g_dataLock);
-    free_duplicate_results(&g_results);
-    g_results = find_duplicates(g_files, g_file_count);
+    FileInfo* files = g_files;
+    int count = g_file_count;
+    LeaveCriticalSection(&g_dataLock);
+    
+    DuplicateResults results = find_duplicates(files, count);
+    if (results.failed) {
+        AppendStatus("ERROR: Out of memory while grouping duplicates!\r\n");
+    }
+    
+    // Biggest wins first; hard-linked copies do not count as savings
+    int ranked = rank_results_by_savings(&results, TOP_GROUPS_DEFAULT, true);
+    if (ranked > 0) {
+        char size_text[32];
+        char status[128];
+        format_file_size(group_physical_reclaimable_bytes(&results, &results.groups[0]),
+                         size_text, sizeof(size_text));
+        snprintf(status, sizeof(status), "%d duplicate groups; largest frees %s\r\n",
+                 results.count, size_text);
+        AppendStatus(status);
+    }
+    
+    EnterCriticalSection(&g_dataLock);
+    ReplaceResults(&results);
     LeaveCriticalSection(&g_dataLock);
     
     UpdateListView();
@@ -326,25 +510,284 @@ DWORD WINAPI FindThread(LPVOID param) {
     return 0;
 }
 
-void UpdateProgressBar() {
+// Called on the watch thread; hand the refresh over to the UI thread
+void OnIndexChanged(void* context) {
+    PostMessage(g_hwndMain, WM_INDEX_CHANGED, 0, 0);
+}
+
+void StopWatching() {
+    if (!g_liveIndex) return;
+    
+    live_index_destroy(g_liveIndex);
+    g_liveIndex = NULL;
+    SetWindowTextA(g_btnWatch, "Watch Changes");
+    AppendStatus("Stopped watching for changes\r\n");
+}
+
+void OnWatch() {
+    if (g_liveIndex) {
+        StopWatching();
+        return;
+    }
+    
+    EnterCriticalSection(&g_dataLock);
+    int file_count = g_file_count;
+    ScanConfig config_copy = g_config;
+    LiveIndex* index = NULL;
+    if (file_count > 0) {
+        index = live_index_create(g_files, g_file_count, g_config.scan_mode);
+    }
+    LeaveCriticalSection(&g_dataLock);
+    
+    if (file_count == 0) {
+        MessageBoxA(g_hwndMain, "Please scan directories first!", 
+                   "Error", MB_ICONERROR);
+        return;
+    }
+    
+    if (!index || !watch_start(index, &config_copy, OnIndexChanged, NULL)) {
+        live_index_destroy(index);
+        MessageBoxA(g_hwndMain, "Failed to start watching directories!", 
+                   "Error", MB_ICONERROR);
+        return;
+    }
+    
+    g_liveIndex = index;
+    SetWindowTextA(g_btnWatch, "Stop Watching");
+    AppendStatus("Watching for changes; results update automatically\r\n");
+    PostMessage(g_hwndMain, WM_INDEX_CHANGED, 0, 0);
+}
+
+DWORD WINAPI BlockThread(LPVOID param) {
+    AppendStatus("Chunking files for block-level analysis...\r\n");
+    
+    // Scan/Find are disabled while this runs, so g_files stays put
+    EnterCriticalSection(&g_dataLock);
+    FileInfo* files = g_files;
+    int count = g_file_count;
+    LeaveCriticalSection(&g_dataLock);
+    
+    BlockReport report;
+    if (!analyze_block_duplicates(files, count, &report)) {
+        AppendStatus("ERROR: Block-level analysis failed!\r\n");
+        PostMessage(g_hwndMain, WM_BLOCK_COMPLETE, 0, 0);
+        return 1;
+    }
+    
+    char total_text[32], unique_text[32], reclaim_text[32];
+    format_file_size(report.total_bytes, total_text, sizeof(total_text));
+    format_file_size(report.unique_bytes, unique_text, sizeof(unique_text));
+    format_file_size(report.reclaimable_bytes, reclaim_text, sizeof(reclaim_text));
+    
+    char status[512];
+    snprintf(status, sizeof(status),
+            "Block analysis: %d files, %d chunks (%d unique)\r\n"
+            "  Total %s, unique %s, block-level reclaimable %s\r\n",
+            report.files_chunked, report.total_chunks, report.unique_chunks,
+            total_text, unique_text, reclaim_text);
+    AppendStatus(status);
+    
+    // List the files sharing the most bytes (selection, top 10)
+    for (int n = 0; n < 10; n++) {
+        int best = -1;
+        for (int i = 0; i < count; i++) {
+            if (report.shared_bytes[i] > 0 &&
+                (best < 0 || report.shared_bytes[i] > report.shared_bytes[best])) {
+                best = i;
+            }
+        }
+        if (best < 0) break;
+        
+        char shared_text[32];
+        format_file_size(report.shared_bytes[best], shared_text, sizeof(shared_text));
+        int percent = files[best].size > 0 ?
+            (int)(report.shared_bytes[best] * 100 / files[best].size) : 0;
+        
+        snprintf(status, sizeof(status), "  %s shared (%d%%): %s\r\n",
+                shared_text, percent, files[best].path);
+        AppendStatus(status);
+        
+        report.shared_bytes[best] = 0;
+    }
+    
+    free_block_report(&report);
+    PostMessage(g_hwndMain, WM_BLOCK_COMPLETE, 0, 0);
+    return 0;
+}
+
+// Identical folders are reported in the status box only: their records
+// are directories, which the file actions cannot handle
+DWORD WINAPI FolderThread(LPVOID param) {
+    AppendStatus("Comparing folders...\r\n");
+    
+    // Scan/Find are disabled while this runs, so g_files stays put
+    EnterCriticalSection(&g_dataLock);
+    FileInfo* files = g_files;
+    int count = g_file_count;
+    DirectoryList roots = g_config.directories;
+    LeaveCriticalSection(&g_dataLock);
+    
+    DuplicateResults dirs = find_duplicate_directories(files, count, &roots);
+    
+    char status[MAX_PATH_LENGTH + 64];
+    snprintf(status, sizeof(status), "Folder duplicates: %d groups of identical folders\r\n",
+             dirs.count);
+    AppendStatus(status);
+    
+    // Groups come ranked by savings; show the biggest
+    for (int i = 0; i < dirs.count && i < 20; i++) {
+        DuplicateGroup* group = &dirs.groups[i];
+        char size_text[32];
+        format_file_size(group->size, size_text, sizeof(size_text));
+        
+        snprintf(status, sizeof(status), "  %d copies of %s:\r\n", group->count, size_text);
+        AppendStatus(status);
+        for (int j = 0; j < group->count; j++) {
+            snprintf(status, sizeof(status), "    %s\r\n", group_file(&dirs, group, j)->path);
+            AppendStatus(status);
+        }
+    }
+    
+    free_duplicate_results(&dirs);
+    PostMessage(g_hwndMain, WM_BLOCK_COMPLETE, 0, 0);
+    return 0;
+}
+
+// Block and folder analysis read g_files without holding the lock for
+// the whole run, so Scan/Find stay disabled until WM_BLOCK_COMPLETE
+void StartAnalysisThread(LPTHREAD_START_ROUTINE thread) {
     EnterCriticalSection(&g_dataLock);
-    int files_scanned = g_progress.files_scanned;
-    bool is_complete = g_progress.is_complete;
+    int file_count = g_file_count;
     LeaveCriticalSection(&g_dataLock);
     
+    if (file_count == 0) {
+        MessageBoxA(g_hwndMain, "Please scan directories first!", 
+                   "Error", MB_ICONERROR);
+        return;
+    }
+    
+    EnableWindow(g_btnScan, FALSE);
+    EnableWindow(g_btnFind, FALSE);
+    EnableWindow(g_btnBlocks, FALSE);
+    EnableWindow(g_btnDirs, FALSE);
+    
+    if (g_hBlockThread) {
+        WaitForSingleObject(g_hBlockThread, INFINITE);
+        CloseHandle(g_hBlockThread);
+        g_hBlockThread = NULL;
+    }
+    
+    g_hBlockThread = CreateThread(NULL, 0, thread, NULL, 0, NULL);
+    if (!g_hBlockThread) {
+        MessageBoxA(g_hwndMain, "Failed to create analysis thread!", 
+                   "Error", MB_ICONERROR);
+        EnableWindow(g_btnScan, TRUE);
+        EnableWindow(g_btnFind, TRUE);
+        EnableWindow(g_btnBlocks, TRUE);
+        EnableWindow(g_btnDirs, TRUE);
+    }
+}
+
+void OnBlockAnalysis() {
+    StartAnalysisThread(BlockThread);
+}
+
+void OnFolderDuplicates() {
+    StartAnalysisThread(FolderThread);
+}
+
+// Near duplicates differ in content, so like folder groups they are only
+// listed, never handed to the delete/link actions
+void OnNearDuplicates() {
+    EnterCriticalSection(&g_dataLock);
+    bool has_signatures = (g_nearIndex != NULL);
+    DuplicateResults similar = {0};
+    if (has_signatures) {
+        similar = find_near_duplicates(g_nearIndex, g_files, g_file_count,
+                                       NEAR_DEFAULT_THRESHOLD);
+    }
+    LeaveCriticalSection(&g_dataLock);
+    
+    if (!has_signatures) {
+        MessageBoxA(g_hwndMain, 
+                   "Please scan with 'Near-duplicate signatures' checked first!", 
+                   "Error", MB_ICONERROR);
+        return;
+    }
+    
+    char status[MAX_PATH_LENGTH + 64];
+    snprintf(status, sizeof(status), "Near duplicates (>= %d%% similar): %d groups\r\n",
+             (int)(NEAR_DEFAULT_THRESHOLD * 100), similar.count);
+    AppendStatus(status);
+    
+    for (int i = 0; i < similar.count && i < 20; i++) {
+        DuplicateGroup* group = &similar.groups[i];
+        snprintf(status, sizeof(status), "  %d similar files:\r\n", group->count);
+        AppendStatus(status);
+        for (int j = 0; j < group->count; j++) {
+            char size_text[32];
+            FileInfo* file = group_file(&similar, group, j);
+            format_file_size(file->size, size_text, sizeof(size_text));
+            snprintf(status, sizeof(status), "    %s  %s\r\n", size_text, file->path);
+            AppendStatus(status);
+        }
+    }
+    
+    free_duplicate_results(&similar);
+}
+
+// Sampled on the scan timer; reads the workers' counters without a lock
+void UpdateProgressBar() {
+    ProgressSample sample;
+    progress_sample(&sample);
+    
     HWND hProgress = GetDlgItem(g_hwndMain, IDC_PROGRESS);
+    char text[256];
+    char bytes[32];
     
-    if (is_complete) {
+    if (sample.phase == PROGRESS_COMPLETE) {
         SendMessage(hProgress, PBM_SETPOS, 100, 0);
         SendMessage(hProgress, PBM_SETMARQUEE, FALSE, 0);
         
         LONG style = GetWindowLong(hProgress, GWL_STYLE);
         style &= ~PBS_MARQUEE;
         SetWindowLong(hProgress, GWL_STYLE, style);
-    } else if (files_scanned > 0) {
-        int percent = (files_scanned % 100);
-        SendMessage(hProgress, PBM_SETPOS, percent, 0);
+        SetWindowTextA(g_labelProgress, "");
+        return;
+    }
+    
+    if (sample.phase == PROGRESS_ENUMERATING) {
+        // No total yet: keep the marquee, show what was found so far
+        format_file_size(sample.bytes_enumerated, bytes, sizeof(bytes));
+        snprintf(text, sizeof(text), "Listing files: %lld found (%s to hash)",
+                 sample.files_enumerated, bytes);
+        SetWindowTextA(g_labelProgress, text);
+        return;
+    }
+    
+    LONG style = GetWindowLong(hProgress, GWL_STYLE);
+    if (style & PBS_MARQUEE) {
+        SendMessage(hProgress, PBM_SETMARQUEE, FALSE, 0);
+        SetWindowLong(hProgress, GWL_STYLE, style & ~PBS_MARQUEE);
+    }
+    SendMessage(hProgress, PBM_SETPOS, (WPARAM)sample.percent, 0);
+    
+    char eta[32] = "--";
+    if (sample.eta_seconds >= 0) {
+        long long secs = (long long)(sample.eta_seconds + 0.5);
+        if (secs >= 3600) {
+            snprintf(eta, sizeof(eta), "%lld:%02lld:%02lld", secs / 3600, secs / 60 % 60, secs % 60);
+        } else {
+            snprintf(eta, sizeof(eta), "%lld:%02lld", secs / 60, secs % 60);
+        }
     }
+    format_file_size(sample.bytes_pending, bytes, sizeof(bytes));
+    snprintf(text, sizeof(text),
+             "Hashing: %.1f%%  %lld/%lld files  %.1f MB/s  %.0f files/s  %s left  ETA %s",
+             sample.percent, sample.files_hashed, sample.files_enumerated,
+             sample.bytes_per_second / (1024.0 * 1024.0), sample.files_per_second,
+             bytes, eta);
+    SetWindowTextA(g_labelProgress, text);
 }
 
 void OnAddDirectory() {
@@ -436,11 +879,15 @@ void OnRemoveExclusion() {
 }
 
 void OnScan() {
+    StopWatching();
+    
     EnterCriticalSection(&g_dataLock);
     int dir_count = g_config.directories.count;
     g_config.directories.include_subdirs = 
         (SendMessage(g_checkSubdirs, BM_GETCHECK, 0, 0) == BST_CHECKED);
     g_config.scan_mode = (ScanMode)SendMessage(g_comboHash, CB_GETCURSEL, 0, 0);
+    g_config.near_duplicates =
+        (SendMessage(g_checkNear, BM_GETCHECK, 0, 0) == BST_CHECKED);
     LeaveCriticalSection(&g_dataLock);
     
     if (dir_count == 0) {
@@ -461,6 +908,8 @@ void OnScan() {
     EnableWindow(g_btnScan, FALSE);
     EnableWindow(g_btnFind, FALSE);
     
+    // The timer must not see the last scan's "complete"
+    progress_reset();
     SetTimer(g_hwndMain, 1, 500, NULL);
     
     if (g_hScanThread) {
@@ -517,33 +966,204 @@ void OnFind() {
     }
 }
 
-void OnDeleteFirst() {
-    if (MessageBoxA(g_hwndMain, 
-        "PERMANENTLY DELETE all duplicates except first file?\n\n"
-        "This CANNOT be undone!\n\nContinue?",
-        "Confirm Delete", MB_YESNO | MB_ICONWARNING) != IDYES) {
-        return;
+// ============================================================================
+// ACTIONS ON THE EXECUTOR
+// 
+// The plan copies every path it needs, so the results are released right
+// away and the action runs on its own thread; the window stays responsive
+// and the progress bar follows plan->completed (timer 2).
+// ============================================================================
+DWORD WINAPI ActionThread(LPVOID param) {
+    ActionPlan* plan = (ActionPlan*)param;
+    
+    if (!action_execute(plan, ACTION_MAX_IN_FLIGHT)) {
+        AppendStatus("ERROR: Out of memory running the action!\r\n");
     }
     
-    EnterCriticalSection(&g_dataLock);
-    int removed = remove_duplicates_keep_first(&g_results);
-    free_duplicate_results(&g_results);
-    memset(&g_results, 0, sizeof(g_results));
-    LeaveCriticalSection(&g_dataLock);
+    PostMessage(g_hwndMain, WM_ACTION_COMPLETE, 0, (LPARAM)plan);
+    return 0;
+}
+
+// Stores the plan's contents in its quarantine store, then runs it
+DWORD WINAPI QuarantineThread(LPVOID param) {
+    ActionPlan* plan = (ActionPlan*)param;
     
-    char msg[128];
-    snprintf(msg, sizeof(msg), "Deleted %d duplicate files\r\n", removed);
-    AppendStatus(msg);
+    QuarantineReport report;
+    if (quarantine_execute(plan, &report)) {
+        char stored[64];
+        char msg[256];
+        format_file_size(report.bytes_stored, stored, sizeof(stored));
+        snprintf(msg, sizeof(msg), "Quarantine stored %d new objects (%s)\r\n",
+                 report.objects_written, stored);
+        AppendStatus(msg);
+    } else {
+        AppendStatus("ERROR: Could not write the quarantine store, no file was removed!\r\n");
+    }
     
-    ListView_DeleteAllItems(g_listResults);
+    PostMessage(g_hwndMain, WM_ACTION_COMPLETE, 0, (LPARAM)plan);
+    return 0;
+}
+
+// Reverses the plan's done ops; wParam 1 tells OnActionComplete it was an undo
+DWORD WINAPI UndoThread(LPVOID param) {
+    ActionPlan* plan = (ActionPlan*)param;
     
+    if (!journal_rollback(g_journal, plan, ACTION_MAX_IN_FLIGHT)) {
+        AppendStatus("ERROR: Could not write the action journal!\r\n");
+    }
+    
+    PostMessage(g_hwndMain, WM_ACTION_COMPLETE, 1, (LPARAM)plan);
+    return 0;
+}
+
+void DisableActionButtons() {
     EnableWindow(GetDlgItem(g_hwndMain, IDC_BTN_DELETE_FIRST), FALSE);
     EnableWindow(GetDlgItem(g_hwndMain, IDC_BTN_MOVE), FALSE);
     EnableWindow(GetDlgItem(g_hwndMain, IDC_BTN_HARD_LINK), FALSE);
     EnableWindow(GetDlgItem(g_hwndMain, IDC_BTN_DELETE_BY_INDEX), FALSE);
+    EnableWindow(GetDlgItem(g_hwndMain, IDC_BTN_CLONE), FALSE);
+    EnableWindow(GetDlgItem(g_hwndMain, IDC_BTN_QUARANTINE), FALSE);
+}
+
+// Takes ownership of plan (may be NULL if building it failed)
+void StartActionThread(ActionPlan* plan, LPTHREAD_START_ROUTINE thread) {
+    ListView_DeleteAllItems(g_listResults);
+    DisableActionButtons();
+    
+    if (!plan) {
+        AppendStatus("ERROR: Out of memory planning the action!\r\n");
+        return;
+    }
+    
+    HWND hProgress = GetDlgItem(g_hwndMain, IDC_PROGRESS);
+    SendMessage(hProgress, PBM_SETMARQUEE, FALSE, 0);
+    SetWindowLong(hProgress, GWL_STYLE, GetWindowLong(hProgress, GWL_STYLE) & ~PBS_MARQUEE);
+    SendMessage(hProgress, PBM_SETPOS, 0, 0);
+    
+    g_actionPlan = plan;
+    g_hActionThread = CreateThread(NULL, 0, thread, plan, 0, NULL);
+    if (!g_hActionThread) {
+        g_actionPlan = NULL;
+        action_plan_free(plan);
+        MessageBoxA(g_hwndMain, "Failed to create action thread!", 
+                   "Error", MB_ICONERROR);
+        return;
+    }
+    
+    SetTimer(g_hwndMain, 2, 200, NULL);
+}
+
+void StartAction(ActionPlan* plan) {
+    if (plan) plan->journal = g_journal;
+    StartActionThread(plan, ActionThread);
+}
+
+// Only one action at a time: the next one must see the last one's result
+bool ActionRunning() {
+    if (!g_hActionThread) return false;
+    
+    MessageBoxA(g_hwndMain, "Please wait for the running action to finish.", 
+               "Busy", MB_ICONINFORMATION);
+    return true;
+}
+
+void UpdateActionProgress() {
+    if (!g_actionPlan || g_actionPlan->count == 0) return;
+    
+    LONG done = g_actionPlan->completed;
+    SendMessage(GetDlgItem(g_hwndMain, IDC_PROGRESS), PBM_SETPOS, 
+               (WPARAM)((long long)done * 100 / g_actionPlan->count), 0);
+}
+
+void OnActionComplete(ActionPlan* plan, bool undo) {
+    KillTimer(g_hwndMain, 2);
+    if (g_hActionThread) {
+        WaitForSingleObject(g_hActionThread, INFINITE);
+        CloseHandle(g_hActionThread);
+        g_hActionThread = NULL;
+    }
+    g_actionPlan = NULL;
+    
+    SendMessage(GetDlgItem(g_hwndMain, IDC_PROGRESS), PBM_SETPOS, 100, 0);
+    
+    const char* verb = "Deleted";
+    if (plan->kind == ACTION_MOVE) verb = "Moved";
+    if (plan->kind == ACTION_HARD_LINK) verb = "Hard-linked";
+    if (plan->kind == ACTION_CLONE) verb = "Block-cloned";
+    if (plan->kind == ACTION_QUARANTINE) verb = "Quarantined";
+    if (undo) verb = "Undo: restored";
+    
+    char msg[MAX_PATH_LENGTH + 64];
+    snprintf(msg, sizeof(msg), "%s %d files (%d skipped, %d failed)\r\n",
+             verb, plan->succeeded, plan->skipped, plan->failed);
+    AppendStatus(msg);
+    
+    // Per-file results: list the first failures
+    int shown = 0;
+    for (int i = 0; i < plan->count && shown < 10; i++) {
+        const ActionOp* op = &plan->ops[i];
+        if (op->status != OP_FAILED) continue;
+        
+        snprintf(msg, sizeof(msg), "  failed (error %lu): %s\r\n", 
+                 (unsigned long)op->error, op->path);
+        AppendStatus(msg);
+        shown++;
+    }
+    if (plan->failed > shown) {
+        snprintf(msg, sizeof(msg), "  ... and %d more\r\n", plan->failed - shown);
+        AppendStatus(msg);
+    }
+    
+    if (!undo && plan->kind == ACTION_HARD_LINK && plan->succeeded == 0) {
+        MessageBoxA(g_hwndMain, 
+            "No hard links created.\nFiles may be on different drives.", 
+            "Info", MB_ICONINFORMATION);
+    }
+    if (!undo && plan->kind == ACTION_CLONE && plan->succeeded == 0) {
+        MessageBoxA(g_hwndMain, 
+            "No files cloned.\nThe volume may not support block cloning (ReFS only).", 
+            "Info", MB_ICONINFORMATION);
+    }
+    
+    action_plan_free(plan);
+}
+
+// Dry run of the keep-first action on the current results (no disk access)
+void GetEstimateText(ActionKind kind, const char* dest_folder, char* text, size_t size) {
+    EnterCriticalSection(&g_dataLock);
+    ActionEstimate estimate = estimate_action(&g_results, kind, dest_folder);
+    LeaveCriticalSection(&g_dataLock);
+    
+    format_action_estimate(&estimate, text, size);
+}
+
+void OnDeleteFirst() {
+    if (ActionRunning()) return;
+    
+    char estimate[512];
+    char msg[1024];
+    GetEstimateText(ACTION_DELETE, NULL, estimate, sizeof(estimate));
+    snprintf(msg, sizeof(msg), 
+             "Delete all duplicates except first file?\n\n%s\n\n"
+             "Undo Last Action can copy them back from the kept file.\n\nContinue?",
+             estimate);
+    
+    if (MessageBoxA(g_hwndMain, msg, "Confirm Delete", MB_YESNO | MB_ICONWARNING) != IDYES) {
+        return;
+    }
+    
+    EnterCriticalSection(&g_dataLock);
+    ActionPlan* plan = action_plan_from_results(&g_results, ACTION_DELETE, NULL);
+    RetireStreamGroups();
+    ReplaceResults(NULL);
+    LeaveCriticalSection(&g_dataLock);
+    
+    StartAction(plan);
 }
 
 void OnDeleteByIndex() {
+    if (ActionRunning()) return;
+    
     int index;
     if (!ShowIndexInputDialog(&index)) {
         return;
@@ -596,9 +1216,10 @@ void OnDeleteByIndex() {
     char confirm_msg[512];
     snprintf(confirm_msg, sizeof(confirm_msg), 
              "Keep file at index %d and delete all other duplicates?\n\n"
-             "File to keep: %s\n\n"
-             "This CANNOT be undone!\n\nContinue?",
-             index, g_results.groups[group_idx].files[file_idx].path);
+             "File to keep: %s\n"
+             "Other groups keep their first file.\n\n"
+             "Undo Last Action can copy them back from the kept file.\n\nContinue?",
+             index, group_file(&g_results, &g_results.groups[group_idx], file_idx)->path);
     
     if (MessageBoxA(g_hwndMain, confirm_msg, 
                    "Confirm Delete", MB_YESNO | MB_ICONWARNING) != IDYES) {
@@ -606,38 +1227,35 @@ void OnDeleteByIndex() {
         return;
     }
     
-    // Delete all files except the one at the specified index
-    int removed = 0;
-    for (int i = 0; i < g_results.count; i++) {
-        for (int j = 0; j < g_results.groups[i].count; j++) {
-            if (i == group_idx && j == file_idx) {
-                // Skip the file to keep
-                continue;
-            }
+    // Delete every file but one per group: the chosen one in its group,
+    // the first elsewhere. The kept file is what undo copies back from.
+    ActionPlan* plan = action_plan_create(ACTION_DELETE, NULL);
+    for (int i = 0; plan && i < g_results.count; i++) {
+        const DuplicateGroup* group = &g_results.groups[i];
+        int keep = i == group_idx ? file_idx : 0;
+        const char* kept = group_file(&g_results, group, keep)->path;
+        
+        for (int j = 0; j < group->count; j++) {
+            if (j == keep) continue;
             
-            if (DeleteFileA(g_results.groups[i].files[j].path)) {
-                removed++;
+            if (!action_plan_add(plan, i, j, group_file(&g_results, group, j)->path, kept)) {
+                action_plan_free(plan);
+                plan = NULL;
+                break;
             }
         }
     }
     
-    free_duplicate_results(&g_results);
-    memset(&g_results, 0, sizeof(g_results));
+    RetireStreamGroups();
+    ReplaceResults(NULL);
     LeaveCriticalSection(&g_dataLock);
     
-    char msg[128];
-    snprintf(msg, sizeof(msg), "Deleted %d duplicate files\r\n", removed);
-    AppendStatus(msg);
-    
-    ListView_DeleteAllItems(g_listResults);
-    
-    EnableWindow(GetDlgItem(g_hwndMain, IDC_BTN_DELETE_FIRST), FALSE);
-    EnableWindow(GetDlgItem(g_hwndMain, IDC_BTN_MOVE), FALSE);
-    EnableWindow(GetDlgItem(g_hwndMain, IDC_BTN_HARD_LINK), FALSE);
-    EnableWindow(GetDlgItem(g_hwndMain, IDC_BTN_DELETE_BY_INDEX), FALSE);
+    StartAction(plan);
 }
 
 void OnMove() {
+    if (ActionRunning()) return;
+    
     BROWSEINFOA bi = {0};
     bi.hwndOwner = g_hwndMain;
     bi.lpszTitle = "Select Destination Folder";
@@ -647,60 +1265,232 @@ void OnMove() {
     if (pidl) {
         char path[MAX_PATH];
         if (SHGetPathFromIDListA(pidl, path)) {
-            EnterCriticalSection(&g_dataLock);
-            int moved = move_duplicates(&g_results, path);
-            free_duplicate_results(&g_results);
-            memset(&g_results, 0, sizeof(g_results));
-            LeaveCriticalSection(&g_dataLock);
+            char estimate[512];
+            char msg[1024];
+            GetEstimateText(ACTION_MOVE, path, estimate, sizeof(estimate));
+            snprintf(msg, sizeof(msg), 
+                     "%s\n\nKeep the original folder structure under the destination?\n\n"
+                     "Yes: C:\\photos\\a.jpg goes to <destination>\\C\\photos\\a.jpg\n"
+                     "No: all files go directly into the destination",
+                     estimate);
             
-            char msg[256];
-            int len = snprintf(msg, sizeof(msg), "Moved %d files to %s\r\n", moved, path);
-            if (len > 0 && len < sizeof(msg)) {
-                AppendStatus(msg);
+            int choice = MessageBoxA(g_hwndMain, msg, "Move Duplicates", 
+                                    MB_YESNOCANCEL | MB_ICONQUESTION);
+            if (choice == IDCANCEL) {
+                CoTaskMemFree(pidl);
+                return;
             }
+            bool mirror = choice == IDYES;
+            
+            EnterCriticalSection(&g_dataLock);
+            ActionPlan* plan = action_plan_from_results(&g_results, ACTION_MOVE, path);
+            if (plan) plan->mirror_tree = mirror;
+            RetireStreamGroups();
+            ReplaceResults(NULL);
+            LeaveCriticalSection(&g_dataLock);
             
-            ListView_DeleteAllItems(g_listResults);
+            snprintf(msg, sizeof(msg), "Moving duplicates to %s\r\n", path);
+            AppendStatus(msg);
             
-            EnableWindow(GetDlgItem(g_hwndMain, IDC_BTN_DELETE_FIRST), FALSE);
-            EnableWindow(GetDlgItem(g_hwndMain, IDC_BTN_MOVE), FALSE);
-            EnableWindow(GetDlgItem(g_hwndMain, IDC_BTN_HARD_LINK), FALSE);
-            EnableWindow(GetDlgItem(g_hwndMain, IDC_BTN_DELETE_BY_INDEX), FALSE);
+            StartAction(plan);
         }
         CoTaskMemFree(pidl);
     }
 }
 
 void OnHardLink() {
-    if (MessageBoxA(g_hwndMain, 
-        "Create hard links to save disk space?\n\n"
-        "Keeps first file, replaces duplicates with links.\n"
-        "Only works on same drive (NTFS).\n\nContinue?",
-        "Create Hard Links", MB_YESNO | MB_ICONQUESTION) != IDYES) {
+    if (ActionRunning()) return;
+    
+    char estimate[512];
+    char msg[1024];
+    GetEstimateText(ACTION_HARD_LINK, NULL, estimate, sizeof(estimate));
+    snprintf(msg, sizeof(msg), 
+             "Create hard links to save disk space?\n\n%s\n\n"
+             "Keeps first file, replaces duplicates with links.\n"
+             "Only works on same drive (NTFS).\n\nContinue?",
+             estimate);
+    
+    if (MessageBoxA(g_hwndMain, msg, "Create Hard Links", MB_YESNO | MB_ICONQUESTION) != IDYES) {
         return;
     }
     
     EnterCriticalSection(&g_dataLock);
-    int linked = create_hard_links(&g_results);
-    free_duplicate_results(&g_results);
-    memset(&g_results, 0, sizeof(g_results));
+    ActionPlan* plan = action_plan_from_results(&g_results, ACTION_HARD_LINK, NULL);
+    RetireStreamGroups();
+    ReplaceResults(NULL);
     LeaveCriticalSection(&g_dataLock);
     
+    StartAction(plan);
+}
+
+// ============================================================================
+// UNDO AND CRASH RECOVERY (journal.c)
+// ============================================================================
+void OnUndo() {
+    if (ActionRunning()) return;
+    
+    JournalState state;
+    ActionPlan* plan = journal_load_last(g_journal, &state);
+    if (!plan || state == JOURNAL_INCOMPLETE) {
+        action_plan_free(plan);
+        MessageBoxA(g_hwndMain, "There is no finished action to undo.", 
+                   "Undo", MB_ICONINFORMATION);
+        return;
+    }
+    
+    int done = 0;
+    for (int i = 0; i < plan->count; i++) {
+        if (plan->ops[i].status == OP_DONE) done++;
+    }
+    
     char msg[256];
-    snprintf(msg, sizeof(msg), "Created %d hard links\r\n", linked);
-    AppendStatus(msg);
+    snprintf(msg, sizeof(msg), 
+             "Undo the last action (%d files)?\n\n"
+             "Moved files go back, deleted files are copied back from the "
+             "kept duplicate, hard links become separate files again.",
+             done);
+    if (MessageBoxA(g_hwndMain, msg, "Undo", MB_YESNO | MB_ICONQUESTION) != IDYES) {
+        action_plan_free(plan);
+        return;
+    }
     
-    if (linked == 0) {
-        MessageBoxA(g_hwndMain, 
-            "No hard links created.\nFiles may be on different drives.", 
-            "Info", MB_ICONINFORMATION);
+    StartActionThread(plan, UndoThread);
+}
+
+// Posted once at startup: offers to finish or roll back an interrupted action
+void CheckJournal() {
+    JournalState state;
+    ActionPlan* plan = journal_load_last(g_journal, &state);
+    if (!plan) return;
+    
+    if (state == JOURNAL_INCOMPLETE) {
+        int done = 0;
+        for (int i = 0; i < plan->count; i++) {
+            if (plan->ops[i].status == OP_DONE) done++;
+        }
+        
+        char msg[256];
+        snprintf(msg, sizeof(msg), 
+                 "The last action was interrupted after %d of %d files.\n\n"
+                 "Yes: finish it\nNo: undo the files already done\nCancel: decide later",
+                 done, plan->count);
+        int choice = MessageBoxA(g_hwndMain, msg, "Interrupted Action", 
+                                MB_YESNOCANCEL | MB_ICONWARNING);
+        if (choice == IDYES) {
+            StartAction(plan);
+            return;
+        }
+        if (choice == IDNO) {
+            StartActionThread(plan, UndoThread);
+            return;
+        }
+    } else if (state == JOURNAL_UNDOING) {
+        if (MessageBoxA(g_hwndMain, 
+            "Undoing the last action was interrupted.\n\nFinish the undo now?",
+            "Interrupted Undo", MB_YESNO | MB_ICONWARNING) == IDYES) {
+            StartActionThread(plan, UndoThread);
+            return;
+        }
     }
     
-    ListView_DeleteAllItems(g_listResults);
+    action_plan_free(plan);
+}
+
+void OnBlockClone() {
+    if (ActionRunning()) return;
     
-    EnableWindow(GetDlgItem(g_hwndMain, IDC_BTN_DELETE_FIRST), FALSE);
-    EnableWindow(GetDlgItem(g_hwndMain, IDC_BTN_MOVE), FALSE);
-    EnableWindow(GetDlgItem(g_hwndMain, IDC_BTN_HARD_LINK), FALSE);
-    EnableWindow(GetDlgItem(g_hwndMain, IDC_BTN_DELETE_BY_INDEX), FALSE);
+    if (MessageBoxA(g_hwndMain, 
+        "Share duplicate data with block cloning?\n\n"
+        "Keeps every file, but duplicates reuse the first file's disk blocks.\n"
+        "Files stay independent: editing one never changes the others.\n"
+        "Each file is compared byte by byte first.\n"
+        "Only works on ReFS volumes.\n\nContinue?",
+        "Block Clone", MB_YESNO | MB_ICONQUESTION) != IDYES) {
+        return;
+    }
+    
+    EnterCriticalSection(&g_dataLock);
+    ActionPlan* plan = action_plan_from_results(&g_results, ACTION_CLONE, NULL);
+    RetireStreamGroups();
+    ReplaceResults(NULL);
+    LeaveCriticalSection(&g_dataLock);
+    
+    // Not journaled: a clone changes no contents, so there is nothing to
+    // undo, and Undo Last Action keeps reversing the last real change
+    StartActionThread(plan, ActionThread);
+}
+
+// Asks for a quarantine store folder; false if the user cancelled
+static bool BrowseQuarantineStore(const char* title, char* path) {
+    BROWSEINFOA bi = {0};
+    bi.hwndOwner = g_hwndMain;
+    bi.lpszTitle = title;
+    bi.ulFlags = BIF_RETURNONLYFSDIRS | BIF_NEWDIALOGSTYLE;
+
+    LPITEMIDLIST pidl = SHBrowseForFolderA(&bi);
+    if (!pidl) return false;
+
+    bool ok = SHGetPathFromIDListA(pidl, path) != 0;
+    CoTaskMemFree(pidl);
+    return ok;
+}
+
+void OnQuarantine() {
+    if (ActionRunning()) return;
+
+    char store[MAX_PATH];
+    if (!BrowseQuarantineStore("Select Quarantine Store Folder", store)) return;
+
+    char estimate[512];
+    char msg[1024];
+    GetEstimateText(ACTION_DELETE, NULL, estimate, sizeof(estimate));
+    snprintf(msg, sizeof(msg),
+             "Quarantine duplicates in %s?\n\n%s\n\n"
+             "Keeps first file. The others are taken out, but the store keeps\n"
+             "only one copy of each content. Files whose full contents differ\n"
+             "from the stored copy stay. Restore Quarantine puts them back.\n\n"
+             "Continue?",
+             store, estimate);
+
+    if (MessageBoxA(g_hwndMain, msg, "Quarantine", MB_YESNO | MB_ICONQUESTION) != IDYES) {
+        return;
+    }
+
+    EnterCriticalSection(&g_dataLock);
+    ActionPlan* plan = action_plan_from_results(&g_results, ACTION_QUARANTINE, store);
+    RetireStreamGroups();
+    ReplaceResults(NULL);
+    LeaveCriticalSection(&g_dataLock);
+
+    if (plan) plan->journal = g_journal;
+    StartActionThread(plan, QuarantineThread);
+}
+
+void OnRestoreQuarantine() {
+    if (ActionRunning()) return;
+
+    char store[MAX_PATH];
+    if (!BrowseQuarantineStore("Select Quarantine Store to Restore", store)) return;
+
+    QuarantineReport report;
+    bool ok = quarantine_restore(store, &report);
+
+    char msg[512];
+    snprintf(msg, sizeof(msg),
+             "Restored %d files, %d already present, %d failed\r\n",
+             report.files, report.conflicts, report.failed);
+    AppendStatus(msg);
+
+    if (!ok) {
+        MessageBoxA(g_hwndMain,
+            "Could not read or update the quarantine manifest.",
+            "Restore Quarantine", MB_ICONERROR);
+    } else if (report.conflicts > 0 || report.failed > 0) {
+        MessageBoxA(g_hwndMain,
+            "Some files were not restored and stay in quarantine.\n"
+            "Files already present at their path were left untouched.",
+            "Restore Quarantine", MB_ICONWARNING);
+    }
 }
 
 // Handle window resizing
@@ -719,6 +1509,7 @@ void OnSize(HWND hwnd, UINT state, int cx, int cy) {
     
     // Update progress bar
     SetWindowPos(g_hwndProgress, NULL, margin, 245, progress_width, 20, SWP_NOZORDER);
+    SetWindowPos(g_labelProgress, NULL, 170, 275, progress_width - 160, 20, SWP_NOZORDER);
     
     // Update ListView
     SetWindowPos(g_listResults, NULL, margin, 335, progress_width, listview_height, SWP_NOZORDER);
@@ -731,6 +1522,10 @@ void OnSize(HWND hwnd, UINT state, int cx, int cy) {
     SetWindowPos(GetDlgItem(hwnd, IDC_BTN_DELETE_BY_INDEX), NULL, margin + buttonWidth + spacing, y_actions, buttonWidth, buttonHeight, SWP_NOZORDER);
     SetWindowPos(GetDlgItem(hwnd, IDC_BTN_MOVE), NULL, margin + (buttonWidth + spacing) * 2, y_actions, buttonWidth, buttonHeight, SWP_NOZORDER);
     SetWindowPos(GetDlgItem(hwnd, IDC_BTN_HARD_LINK), NULL, margin + (buttonWidth + spacing) * 3, y_actions, buttonWidth, buttonHeight, SWP_NOZORDER);
+    SetWindowPos(GetDlgItem(hwnd, IDC_BTN_CLONE), NULL, margin + (buttonWidth + spacing) * 4, y_actions, buttonWidth, buttonHeight, SWP_NOZORDER);
+    SetWindowPos(GetDlgItem(hwnd, IDC_BTN_UNDO), NULL, margin + (buttonWidth + spacing) * 5, y_actions, buttonWidth, buttonHeight, SWP_NOZORDER);
+    SetWindowPos(GetDlgItem(hwnd, IDC_BTN_QUARANTINE), NULL, margin, y_actions + buttonHeight + 6, buttonWidth, buttonHeight, SWP_NOZORDER);
+    SetWindowPos(GetDlgItem(hwnd, IDC_BTN_RESTORE), NULL, margin + buttonWidth + spacing, y_actions + buttonHeight + 6, buttonWidth, buttonHeight, SWP_NOZORDER);
     
     // Update ListView columns to resize
     LVCOLUMNA lvc = {0};
@@ -817,6 +1612,14 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                 (LPARAM)"FNV-1a (Full)(slower)");
             SendMessage(g_comboHash, CB_SETCURSEL, 0, 0);
             
+            g_checkNear = CreateWindowA("BUTTON", "Near-duplicate signatures", 
+                WS_VISIBLE | WS_CHILD | BS_AUTOCHECKBOX,
+                460, 175, 190, 20, hwnd, (HMENU)IDC_CHECK_NEAR, NULL, NULL);
+            
+            CreateWindowA("BUTTON", "Near Duplicates", 
+                WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
+                660, 172, 160, 26, hwnd, (HMENU)IDC_BTN_NEAR, NULL, NULL);
+            
             g_btnScan = CreateWindowA("BUTTON", "Scan Directories", 
                 WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
                 10, 205, 140, 30, hwnd, (HMENU)IDC_BTN_SCAN, NULL, NULL);
@@ -825,6 +1628,18 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                 WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
                 160, 205, 140, 30, hwnd, (HMENU)IDC_BTN_FIND, NULL, NULL);
             
+            g_btnWatch = CreateWindowA("BUTTON", "Watch Changes", 
+                WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
+                310, 205, 140, 30, hwnd, (HMENU)IDC_BTN_WATCH, NULL, NULL);
+            
+            g_btnBlocks = CreateWindowA("BUTTON", "Block Analysis", 
+                WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
+                460, 205, 140, 30, hwnd, (HMENU)IDC_BTN_BLOCKS, NULL, NULL);
+            
+            g_btnDirs = CreateWindowA("BUTTON", "Folder Duplicates", 
+                WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
+                610, 205, 140, 30, hwnd, (HMENU)IDC_BTN_DIRS, NULL, NULL);
+            
             g_hwndProgress = CreateWindowA(PROGRESS_CLASSA, NULL,
                 WS_VISIBLE | WS_CHILD,
                 10, 245, 810, 20, hwnd, (HMENU)IDC_PROGRESS, NULL, NULL);
@@ -834,6 +1649,10 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                 WS_VISIBLE | WS_CHILD,
                 10, 275, 150, 20, hwnd, NULL, NULL, NULL);
             
+            g_labelProgress = CreateWindowA("STATIC", "", 
+                WS_VISIBLE | WS_CHILD | SS_RIGHT,
+                170, 275, 650, 20, hwnd, (HMENU)IDC_PROGRESS_TEXT, NULL, NULL);
+            
             CreateWindowA("BUTTON", "Delete (Keep First)", 
                 WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
                 10, 295, 130, 28, hwnd, (HMENU)IDC_BTN_DELETE_FIRST, NULL, NULL);
@@ -854,8 +1673,26 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                 430, 295, 130, 28, hwnd, (HMENU)IDC_BTN_HARD_LINK, NULL, NULL);
             EnableWindow(GetDlgItem(hwnd, IDC_BTN_HARD_LINK), FALSE);
             
+            CreateWindowA("BUTTON", "Block Clone (ReFS)", 
+                WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
+                570, 295, 130, 28, hwnd, (HMENU)IDC_BTN_CLONE, NULL, NULL);
+            EnableWindow(GetDlgItem(hwnd, IDC_BTN_CLONE), FALSE);
+            
+            CreateWindowA("BUTTON", "Undo Last Action", 
+                WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
+                710, 295, 130, 28, hwnd, (HMENU)IDC_BTN_UNDO, NULL, NULL);
+            
+            CreateWindowA("BUTTON", "Quarantine", 
+                WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
+                10, 329, 130, 28, hwnd, (HMENU)IDC_BTN_QUARANTINE, NULL, NULL);
+            EnableWindow(GetDlgItem(hwnd, IDC_BTN_QUARANTINE), FALSE);
+            
+            CreateWindowA("BUTTON", "Restore Quarantine", 
+                WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
+                150, 329, 130, 28, hwnd, (HMENU)IDC_BTN_RESTORE, NULL, NULL);
+            
             g_listResults = CreateWindowA(WC_LISTVIEWA, NULL,
-                WS_VISIBLE | WS_CHILD | WS_BORDER | LVS_REPORT | LVS_SINGLESEL,
+                WS_VISIBLE | WS_CHILD | WS_BORDER | LVS_REPORT | LVS_SINGLESEL | LVS_OWNERDATA,
                 10, 335, 810, 180, hwnd, (HMENU)IDC_LISTVIEW_RESULTS, NULL, NULL);
             
             // Use SendMessage instead of ListView_SetExtendedListViewStyle
@@ -886,6 +1723,24 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                 ES_MULTILINE | ES_READONLY | ES_AUTOVSCROLL,
                 10, 525, 810, 100, hwnd, (HMENU)IDC_EDIT_STATUS, NULL, NULL);
             
+            // Action journal in %LOCALAPPDATA%\FileDedup
+            char journal_path[MAX_PATH_LENGTH];
+            if (SUCCEEDED(SHGetFolderPathA(NULL, CSIDL_LOCAL_APPDATA, NULL, 0, journal_path)) &&
+                strlen(journal_path) + 32 < sizeof(journal_path)) {
+                strcat(journal_path, "\\FileDedup");
+                ensure_directory_exists(journal_path);
+                strcat(journal_path, "\\" JOURNAL_FILE_NAME);
+                g_journal = journal_open(journal_path);
+            }
+            if (g_journal) {
+                PostMessage(hwnd, WM_CHECK_JOURNAL, 0, 0);
+            } else {
+                EnableWindow(GetDlgItem(hwnd, IDC_BTN_UNDO), FALSE);
+                AppendStatus(GetLastError() == ERROR_SHARING_VIOLATION
+                    ? "WARNING: Another window holds the action journal, actions cannot be undone here.\r\n"
+                    : "WARNING: Action journal unavailable, actions cannot be undone.\r\n");
+            }
+            
             break;
         }
         
@@ -895,16 +1750,29 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
         
         case WM_TIMER:
             if (wParam == 1) UpdateProgressBar();
+            if (wParam == 2) UpdateActionProgress();
             break;
         
         case WM_SCAN_COMPLETE:
             KillTimer(hwnd, 1);
             EnableWindow(g_btnScan, TRUE);
             EnableWindow(g_btnFind, TRUE);
+            SetWindowTextA(g_labelProgress, "");
             {
                 HWND hProgress = GetDlgItem(hwnd, IDC_PROGRESS);
                 SendMessage(hProgress, PBM_SETMARQUEE, FALSE, 0);
                 SendMessage(hProgress, PBM_SETPOS, 100, 0);
+                
+                EnterCriticalSection(&g_dataLock);
+                bool has_groups = (g_results.count > 0);
+                LeaveCriticalSection(&g_dataLock);
+                
+                EnableWindow(GetDlgItem(hwnd, IDC_BTN_DELETE_FIRST), has_groups);
+                EnableWindow(GetDlgItem(hwnd, IDC_BTN_MOVE), has_groups);
+                EnableWindow(GetDlgItem(hwnd, IDC_BTN_HARD_LINK), has_groups);
+                EnableWindow(GetDlgItem(hwnd, IDC_BTN_DELETE_BY_INDEX), has_groups);
+                EnableWindow(GetDlgItem(hwnd, IDC_BTN_CLONE), has_groups);
+                EnableWindow(GetDlgItem(hwnd, IDC_BTN_QUARANTINE), has_groups);
             }
             break;
             
@@ -926,6 +1794,67 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             EnableWindow(GetDlgItem(hwnd, IDC_BTN_MOVE), has_results);
             EnableWindow(GetDlgItem(hwnd, IDC_BTN_HARD_LINK), has_results);
             EnableWindow(GetDlgItem(hwnd, IDC_BTN_DELETE_BY_INDEX), has_results);
+            EnableWindow(GetDlgItem(hwnd, IDC_BTN_CLONE), has_results);
+            EnableWindow(GetDlgItem(hwnd, IDC_BTN_QUARANTINE), has_results);
+            break;
+        
+        case WM_CHECK_JOURNAL:
+            CheckJournal();
+            break;
+        
+        case WM_ACTION_COMPLETE:
+            OnActionComplete((ActionPlan*)lParam, wParam == 1);
+            break;
+        
+        case WM_BLOCK_COMPLETE:
+            EnableWindow(g_btnScan, TRUE);
+            EnableWindow(g_btnFind, TRUE);
+            EnableWindow(g_btnBlocks, TRUE);
+            EnableWindow(g_btnDirs, TRUE);
+            break;
+        
+        case WM_INDEX_CHANGED:
+            if (g_liveIndex) {
+                EnterCriticalSection(&g_dataLock);
+                DuplicateResults snapshot = live_index_snapshot(g_liveIndex);
+                ReplaceResults(&snapshot);
+                bool has_groups = (g_results.count > 0);
+                LeaveCriticalSection(&g_dataLock);
+                
+                UpdateListView();
+                
+                EnableWindow(GetDlgItem(hwnd, IDC_BTN_DELETE_FIRST), has_groups);
+                EnableWindow(GetDlgItem(hwnd, IDC_BTN_MOVE), has_groups);
+                EnableWindow(GetDlgItem(hwnd, IDC_BTN_HARD_LINK), has_groups);
+                EnableWindow(GetDlgItem(hwnd, IDC_BTN_DELETE_BY_INDEX), has_groups);
+                EnableWindow(GetDlgItem(hwnd, IDC_BTN_CLONE), has_groups);
+                EnableWindow(GetDlgItem(hwnd, IDC_BTN_QUARANTINE), has_groups);
+            }
+            break;
+        
+        case WM_GROUPS_FOUND:
+            // Groups found so far by a running scan, largest first
+            {
+                EnterCriticalSection(&g_dataLock);
+                bool streaming = (g_streamIndex != NULL);
+                if (streaming) {
+                    DuplicateResults snapshot = stream_index_snapshot(g_streamIndex, g_files);
+                    ReplaceResults(&snapshot);
+                }
+                bool has_groups = (g_results.count > 0);
+                LeaveCriticalSection(&g_dataLock);
+                
+                if (streaming) {
+                    UpdateListView();
+                    
+                    EnableWindow(GetDlgItem(hwnd, IDC_BTN_DELETE_FIRST), has_groups);
+                    EnableWindow(GetDlgItem(hwnd, IDC_BTN_MOVE), has_groups);
+                    EnableWindow(GetDlgItem(hwnd, IDC_BTN_HARD_LINK), has_groups);
+                    EnableWindow(GetDlgItem(hwnd, IDC_BTN_DELETE_BY_INDEX), has_groups);
+                    EnableWindow(GetDlgItem(hwnd, IDC_BTN_CLONE), has_groups);
+                    EnableWindow(GetDlgItem(hwnd, IDC_BTN_QUARANTINE), has_groups);
+                }
+            }
             break;
         
         case WM_COMMAND:
@@ -936,6 +1865,14 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                 case IDC_BTN_REMOVE_EXCLUSION: OnRemoveExclusion(); break;
                 case IDC_BTN_SCAN: OnScan(); break;
                 case IDC_BTN_FIND: OnFind(); break;
+                case IDC_BTN_WATCH: OnWatch(); break;
+                case IDC_BTN_BLOCKS: OnBlockAnalysis(); break;
+                case IDC_BTN_DIRS: OnFolderDuplicates(); break;
+                case IDC_BTN_NEAR: OnNearDuplicates(); break;
+                case IDC_BTN_CLONE: OnBlockClone(); break;
+                case IDC_BTN_UNDO: OnUndo(); break;
+                case IDC_BTN_QUARANTINE: OnQuarantine(); break;
+                case IDC_BTN_RESTORE: OnRestoreQuarantine(); break;
                 case IDC_BTN_DELETE_FIRST: OnDeleteFirst(); break;
                 case IDC_BTN_DELETE_BY_INDEX: OnDeleteByIndex(); break;
                 case IDC_BTN_MOVE: OnMove(); break;
@@ -943,6 +1880,14 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             }
             break;
         
+        case WM_NOTIFY:
+            if (((NMHDR*)lParam)->hwndFrom == g_listResults &&
+                ((NMHDR*)lParam)->code == LVN_GETDISPINFOA) {
+                OnResultsDispInfo((NMLVDISPINFOA*)lParam);
+                return 0;
+            }
+            break;
+        
         case WM_CLOSE:
             DestroyWindow(hwnd);
             return 0;
@@ -956,12 +1901,32 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                 WaitForSingleObject(g_hFindThread, 5000);
                 CloseHandle(g_hFindThread);
             }
+            if (g_hBlockThread) {
+                WaitForSingleObject(g_hBlockThread, 5000);
+                CloseHandle(g_hBlockThread);
+            }
+            {
+                // A still-running action keeps its journal; exit ends both
+                bool action_done = true;
+                if (g_hActionThread) {
+                    action_done = WaitForSingleObject(g_hActionThread, 5000) == WAIT_OBJECT_0;
+                    CloseHandle(g_hActionThread);
+                }
+                if (action_done) journal_close(g_journal);
+                g_journal = NULL;
+            }
             
             KillTimer(hwnd, 1);
+            KillTimer(hwnd, 2);
+            
+            live_index_destroy(g_liveIndex);
+            g_liveIndex = NULL;
             
             EnterCriticalSection(&g_dataLock);
+            near_index_destroy(g_nearIndex);
+            g_nearIndex = NULL;
             if (g_files) free(g_files);
-            free_duplicate_results(&g_results);
+            ReplaceResults(NULL);
             LeaveCriticalSection(&g_dataLock);
             
             DeleteCriticalSection(&g_dataLock);
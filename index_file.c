@@ -0,0 +1,585 @@
+/*
+ * INDEX_FILE.C - Partial Scan Indexes for Sharded Scanning
+ *
+ * DSA CONCEPTS DEMONSTRATED:
+ * 1. Self-Describing Binary Format (magic, version, header, records)
+ * 2. External Two-Pass Merge (keys first, full records only for winners)
+ * 3. Sort-Based Grouping over Many Inputs (sort_group.c)
+ *
+ * WORKFLOW:
+ * Several workers (processes or hosts) scan the same roots, each with its
+ * own ScanConfig shard (by path hash or by root), and write what they
+ * hashed with write_scan_index. merge_scan_indexes then groups all the
+ * stored (digest, size) pairs at once. No file is read again: the digest
+ * in the index is the one the worker computed.
+ *
+ * FILE LAYOUT (little-endian, fixed-width fields):
+ *
+ *   char[8]  magic "DDUPIDX\0"
+ *   u32      version
+ *   u32      scan mode            (digests only compare within one mode)
+ *   u32      shard index
+ *   u32      shard count          (0 or 1 = unsharded)
+ *   u32      flags                (bit 0: sharded by root)
+ *   char[16] hash algorithm name
+ *   i64      created (time_t)
+ *   u64      record count
+ *   u64      error count          (files that failed to hash, not stored)
+ *   u32      root count, then per root: u16 length + bytes
+ *   records: u64 digest, i64 size, i64 modified, u16 length + path bytes
+ */
+
+#include "common.h"
+
+#define INDEX_FLAG_BY_ROOT 1u
+
+// ============================================================================
+// LITTLE-ENDIAN FIELD I/O
+//
+// Fields are written byte by byte, so an index written on one host reads
+// the same on any other.
+// ============================================================================
+static bool put_u64(FILE* f, uint64_t v, int bytes) {
+    unsigned char buf[8];
+    for (int i = 0; i < bytes; i++) {
+        buf[i] = (unsigned char)(v >> (8 * i));
+    }
+    return fwrite(buf, 1, bytes, f) == (size_t)bytes;
+}
+
+static bool get_u64(FILE* f, uint64_t* v, int bytes) {
+    unsigned char buf[8];
+    if (fread(buf, 1, bytes, f) != (size_t)bytes) return false;
+
+    *v = 0;
+    for (int i = 0; i < bytes; i++) {
+        *v |= (uint64_t)buf[i] << (8 * i);
+    }
+    return true;
+}
+
+static bool put_string(FILE* f, const char* s) {
+    size_t len = strlen(s);
+    if (len >= MAX_PATH_LENGTH) return false;
+    return put_u64(f, len, 2) && fwrite(s, 1, len, f) == len;
+}
+
+// out may be NULL to skip the string
+static bool get_string(FILE* f, char* out) {
+    uint64_t len;
+    if (!get_u64(f, &len, 2) || len >= MAX_PATH_LENGTH) return false;
+
+    if (!out) return fseek(f, (long)len, SEEK_CUR) == 0;
+
+    if (fread(out, 1, (size_t)len, f) != (size_t)len) return false;
+    out[len] = '\0';
+    return true;
+}
+
+// ============================================================================
+// HEADER
+// ============================================================================
+static bool write_header(FILE* f, const IndexHeader* h) {
+    char magic[8] = INDEX_MAGIC;
+    char hash_name[16] = {0};
+    size_t name_length = strnlen(h->hash_name, sizeof(h->hash_name));
+    if (name_length >= sizeof(hash_name)) return false;    // No room for the NUL
+    memcpy(hash_name, h->hash_name, name_length);
+
+    return fwrite(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+           put_u64(f, h->version, 4) &&
+           put_u64(f, (uint64_t)h->scan_mode, 4) &&
+           put_u64(f, (uint64_t)h->shard_index, 4) &&
+           put_u64(f, (uint64_t)h->shard_count, 4) &&
+           put_u64(f, h->shard_by_root ? INDEX_FLAG_BY_ROOT : 0, 4) &&
+           fwrite(hash_name, 1, sizeof(hash_name), f) == sizeof(hash_name) &&
+           put_u64(f, (uint64_t)(long long)h->created, 8) &&
+           put_u64(f, (uint64_t)h->record_count, 8) &&
+           put_u64(f, (uint64_t)h->error_count, 8) &&
+           put_u64(f, (uint64_t)h->root_count, 4);
+}
+
+// Reads the header and the root list; roots may be NULL to skip them
+static bool read_header(FILE* f, IndexHeader* h, DirectoryList* roots) {
+    char magic[8];
+    uint64_t v[9];
+
+    if (fread(magic, 1, sizeof(magic), f) != sizeof(magic) ||
+        memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0) {
+        return false;
+    }
+    if (!get_u64(f, &v[0], 4) || v[0] != INDEX_VERSION) return false;
+
+    for (int i = 1; i <= 4; i++) {
+        if (!get_u64(f, &v[i], 4)) return false;
+    }
+    if (fread(h->hash_name, 1, sizeof(h->hash_name), f) != sizeof(h->hash_name)) {
+        return false;
+    }
+    for (int i = 5; i <= 7; i++) {
+        if (!get_u64(f, &v[i], 8)) return false;
+    }
+    if (!get_u64(f, &v[8], 4)) return false;
+
+    h->hash_name[sizeof(h->hash_name) - 1] = '\0';
+    h->version = (uint32_t)v[0];
+    h->scan_mode = (ScanMode)v[1];
+    h->shard_index = (int)v[2];
+    h->shard_count = (int)v[3];
+    h->shard_by_root = (v[4] & INDEX_FLAG_BY_ROOT) != 0;
+    h->created = (time_t)(long long)v[5];
+    h->record_count = (long long)v[6];
+    h->error_count = (long long)v[7];
+    h->root_count = (int)v[8];
+
+    if (h->scan_mode < 0 || h->scan_mode >= SCAN_MODE_COUNT) return false;
+    if (h->root_count < 0 || h->root_count > MAX_DIRECTORIES) return false;
+    if (h->record_count < 0) return false;
+
+    if (roots) init_directory_list(roots);
+    for (int i = 0; i < h->root_count; i++) {
+        if (!get_string(f, roots ? roots->paths[i] : NULL)) return false;
+    }
+    if (roots) roots->count = h->root_count;
+
+    return true;
+}
+
+// ============================================================================
+// WRITE SCAN INDEX
+//
+// Stores every successfully hashed file of this worker's scan. Files that
+// failed to hash are only counted: they carry no digest to merge.
+// The file is written under a temporary name and renamed at the end, so a
+// worker that dies never leaves a truncated index behind.
+//
+// RETURNS: true if the index was written completely
+// ============================================================================
+bool write_scan_index(const char* path, const ScanConfig* config,
+                      const FileInfo* files, int count) {
+    if (!path || !config || (!files && count > 0)) return false;
+
+    char temp_path[MAX_PATH_LENGTH];
+    if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", path) >= (int)sizeof(temp_path)) {
+        return false;
+    }
+
+    IndexHeader header = {0};
+    header.version = INDEX_VERSION;
+    header.scan_mode = config->scan_mode;
+    header.shard_index = config->shard_count > 1 ? config->shard_index : 0;
+    header.shard_count = config->shard_count > 1 ? config->shard_count : 1;
+    header.shard_by_root = config->shard_by_root;
+    strncpy(header.hash_name, INDEX_HASH_NAME, sizeof(header.hash_name) - 1);
+    header.created = time(NULL);
+    header.root_count = config->directories.count;
+
+    for (int i = 0; i < count; i++) {
+        if (strncmp(files[i].hash, "ERROR", 5) == 0) {
+            header.error_count++;
+        } else {
+            header.record_count++;
+        }
+    }
+
+    FILE* f = fopen(temp_path, "wb");
+    if (!f) return false;
+
+    bool ok = write_header(f, &header);
+    for (int i = 0; ok && i < header.root_count; i++) {
+        ok = put_string(f, config->directories.paths[i]);
+    }
+
+    for (int i = 0; ok && i < count; i++) {
+        const FileInfo* file = &files[i];
+        if (strncmp(file->hash, "ERROR", 5) == 0) continue;
+
+        ok = put_u64(f, file->digest, 8) &&
+             put_u64(f, (uint64_t)file->size, 8) &&
+             put_u64(f, (uint64_t)(long long)file->modified, 8) &&
+             put_string(f, file->path);
+    }
+
+    if (fclose(f) != 0) ok = false;
+
+    if (!ok || !MoveFileExA(temp_path, path, MOVEFILE_REPLACE_EXISTING)) {
+        DeleteFileA(temp_path);
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// READ INDEX INFO
+//
+// Header and roots only, e.g. to check which shards are present before
+// merging.
+// ============================================================================
+bool read_index_info(const char* path, IndexHeader* header, DirectoryList* roots) {
+    if (!path || !header) return false;
+
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+
+    bool ok = read_header(f, header, roots);
+    fclose(f);
+    return ok;
+}
+
+// ============================================================================
+// MERGE HELPERS
+// ============================================================================
+static void merge_fail(MergeReport* report, const char* format, const char* path) {
+    snprintf(report->message, sizeof(report->message), format, path);
+}
+
+// Opens an index and positions it at its first record
+static FILE* open_records(const char* path, IndexHeader* header) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    if (!read_header(f, header, NULL)) {
+        fclose(f);
+        return NULL;
+    }
+    return f;
+}
+
+// ============================================================================
+// MEMBER RECORDS
+//
+// Pass 3 keeps one compact record per duplicate member: the fixed fields
+// plus the path's offset in a shared string arena. A path costs its own
+// length, not a whole MAX_PATH_LENGTH FileInfo.
+// ============================================================================
+typedef struct {
+    uint64_t digest;
+    long long size;
+    long long modified;
+    size_t path;              // Offset into the arena
+} MemberRecord;
+
+typedef struct {
+    char* data;
+    size_t used;
+    size_t capacity;
+} PathArena;
+
+static bool arena_add(PathArena* arena, const char* path, size_t* offset) {
+    size_t len = strlen(path) + 1;
+    if (arena->used + len > arena->capacity) {
+        size_t new_capacity = arena->capacity ? arena->capacity * 2 : 65536;
+        while (new_capacity < arena->used + len) new_capacity *= 2;
+        char* grown = (char*)realloc(arena->data, new_capacity);
+        if (!grown) return false;
+        arena->data = grown;
+        arena->capacity = new_capacity;
+    }
+    memcpy(arena->data + arena->used, path, len);
+    *offset = arena->used;
+    arena->used += len;
+    return true;
+}
+
+// Path order for spotting one file stored twice; ties keep input order
+static int compare_record_path(const void* a, const void* b) {
+    const IndexRecord* x = (const IndexRecord*)a;
+    const IndexRecord* y = (const IndexRecord*)b;
+    int c = path_compare(x->path, y->path);
+    if (c != 0) return c;
+    return x < y ? -1 : (x > y);
+}
+
+// Sorts a group's records by path and drops repeats of the same path.
+// Two overlapping indexes (nested roots, or roots scanned twice) would
+// otherwise make a file its own duplicate, and acting on that
+// "duplicate" would destroy the only copy.
+// RETURNS: the number of records left
+static int drop_repeated_paths(IndexRecord* records, int count, long long* repeated) {
+    qsort(records, count, sizeof(IndexRecord), compare_record_path);
+
+    int kept = 0;
+    for (int k = 0; k < count; k++) {
+        if (kept > 0 && path_compare(records[kept - 1].path, records[k].path) == 0) {
+            (*repeated)++;
+            continue;
+        }
+        records[kept++] = records[k];
+    }
+    return kept;
+}
+
+// ============================================================================
+// MERGE SCAN INDEXES
+//
+// Pass 0: Read every header; all indexes must use the same scan mode,
+//         hash algorithm and shard count, and no shard may appear twice
+// Pass 1: Load only (digest, size, record number) of every record
+// Pass 2: Radix sort the keys (sort_keys_parallel); runs of 2+ equal keys
+//         are the duplicate groups. Each member gets a slot.
+// Pass 3: Re-read the indexes and keep just the members' records, in
+//         compact form
+// Pass 4: Hand each group to on_group, in (digest, size) order, with
+//         repeated paths dropped
+//
+// Each index's record count is checked against its header from pass 0
+// in passes 1 and 3, so an index rewritten mid-merge is refused instead
+// of being read past the tables sized for it.
+//
+// MEMORY: 2 * n * sizeof(SortKey) + 4n for n records, plus one
+// MemberRecord and the path bytes per duplicate member. Unique files are
+// never kept, and no group is built as FileInfo records: the caller
+// decides what to keep (cli.c keeps only the top groups).
+//
+// RETURNS: true if every group was delivered; false with report->message
+// set on failure (or with it empty if on_group stopped the merge)
+// ============================================================================
+bool merge_scan_indexes(const char* const* paths, int count,
+                        MergeGroupCallback on_group, void* context, MergeReport* report) {
+    MergeReport local = {0};
+    if (!report) report = &local;
+    memset(report, 0, sizeof(MergeReport));
+
+    if (!paths || count <= 0 || !on_group) {
+        merge_fail(report, "%s", "No index files given");
+        return false;
+    }
+
+    IndexHeader* headers = (IndexHeader*)calloc(count, sizeof(IndexHeader));
+    bool* shard_seen = NULL;
+    SortKey* keys = NULL;
+    SortKey* scratch = NULL;
+    int* slot_of = NULL;
+    MemberRecord* members = NULL;
+    IndexRecord* group = NULL;
+    PathArena arena = {0};
+    FILE* f = NULL;
+    bool ok = false;
+
+    if (!headers) {
+        merge_fail(report, "%s", "Out of memory");
+        return false;
+    }
+
+    // ========================================================================
+    // PASS 0: HEADERS
+    // ========================================================================
+    long long total = 0;
+    for (int i = 0; i < count; i++) {
+        if (!read_index_info(paths[i], &headers[i], NULL)) {
+            merge_fail(report, "Not a readable index: %s", paths[i]);
+            goto cleanup;
+        }
+        if (headers[i].scan_mode != headers[0].scan_mode ||
+            strcmp(headers[i].hash_name, headers[0].hash_name) != 0) {
+            merge_fail(report, "Index uses a different scan mode or hash: %s", paths[i]);
+            goto cleanup;
+        }
+        if (headers[i].shard_count != headers[0].shard_count ||
+            headers[i].shard_by_root != headers[0].shard_by_root) {
+            merge_fail(report, "Index belongs to a different shard layout: %s", paths[i]);
+            goto cleanup;
+        }
+        total += headers[i].record_count;
+        report->error_count += headers[i].error_count;
+    }
+
+    // Group members are int indexes
+    if (total > 0x7FFFFFFF) {
+        merge_fail(report, "%s", "Too many records to merge in one pass");
+        goto cleanup;
+    }
+
+    report->index_count = count;
+    report->record_count = total;
+    report->shard_count = headers[0].shard_count;
+
+    // Unsharded indexes (separate scans of separate roots) merge freely;
+    // shards of one split must each appear once
+    if (report->shard_count > 1) {
+        shard_seen = (bool*)calloc(report->shard_count, sizeof(bool));
+        if (!shard_seen) {
+            merge_fail(report, "%s", "Out of memory");
+            goto cleanup;
+        }
+        for (int i = 0; i < count; i++) {
+            int shard = headers[i].shard_index;
+            if (shard < 0 || shard >= report->shard_count || shard_seen[shard]) {
+                merge_fail(report, "Shard given twice or out of range: %s", paths[i]);
+                goto cleanup;
+            }
+            shard_seen[shard] = true;
+        }
+        for (int s = 0; s < report->shard_count; s++) {
+            if (!shard_seen[s]) report->missing_shards++;
+        }
+    }
+
+    if (total < 2) {
+        ok = true;
+        goto cleanup;
+    }
+
+    // ========================================================================
+    // PASS 1: KEYS
+    // ========================================================================
+    keys = (SortKey*)malloc((size_t)total * sizeof(SortKey));
+    scratch = (SortKey*)malloc((size_t)total * sizeof(SortKey));
+    slot_of = (int*)malloc((size_t)total * sizeof(int));
+    if (!keys || !scratch || !slot_of) {
+        merge_fail(report, "%s", "Out of memory");
+        goto cleanup;
+    }
+
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        IndexHeader header;
+        f = open_records(paths[i], &header);
+        if (!f) {
+            merge_fail(report, "Cannot reopen index: %s", paths[i]);
+            goto cleanup;
+        }
+        if (header.record_count != headers[i].record_count) {
+            merge_fail(report, "Index changed during merge: %s", paths[i]);
+            goto cleanup;
+        }
+
+        for (long long r = 0; r < header.record_count; r++) {
+            uint64_t digest, size, modified;
+            if (!get_u64(f, &digest, 8) || !get_u64(f, &size, 8) ||
+                !get_u64(f, &modified, 8) || !get_string(f, NULL)) {
+                merge_fail(report, "Truncated index: %s", paths[i]);
+                goto cleanup;
+            }
+            keys[n].digest = digest;
+            keys[n].size = size;
+            keys[n].index = (uint32_t)n;
+            n++;
+        }
+
+        fclose(f);
+        f = NULL;
+    }
+
+    // ========================================================================
+    // PASS 2: SORT AND ASSIGN SLOTS
+    // ========================================================================
+    SortKey* sorted = sort_keys_parallel(keys, scratch, n, get_worker_count());
+    if (!sorted) {
+        merge_fail(report, "%s", "Out of memory");
+        goto cleanup;
+    }
+
+    int member_count = 0;
+    int largest = 0;
+    for (int i = 0; i < n; i++) slot_of[i] = -1;
+
+    for (int i = 0; i < n; ) {
+        int j = i + 1;
+        while (j < n && sorted[j].digest == sorted[i].digest &&
+               sorted[j].size == sorted[i].size) {
+            j++;
+        }
+        if (j - i > 1) {
+            for (int k = i; k < j; k++) {
+                slot_of[sorted[k].index] = member_count++;
+            }
+            if (j - i > largest) largest = j - i;
+        }
+        i = j;
+    }
+
+    if (member_count == 0) {
+        ok = true;
+        goto cleanup;
+    }
+
+    members = (MemberRecord*)malloc(member_count * sizeof(MemberRecord));
+    group = (IndexRecord*)malloc(largest * sizeof(IndexRecord));
+    if (!members || !group) {
+        merge_fail(report, "%s", "Out of memory");
+        goto cleanup;
+    }
+
+    // ========================================================================
+    // PASS 3: MEMBER RECORDS
+    // ========================================================================
+    n = 0;
+    for (int i = 0; i < count; i++) {
+        IndexHeader header;
+        f = open_records(paths[i], &header);
+        if (!f) {
+            merge_fail(report, "Cannot reopen index: %s", paths[i]);
+            goto cleanup;
+        }
+        if (header.record_count != headers[i].record_count) {
+            merge_fail(report, "Index changed during merge: %s", paths[i]);
+            goto cleanup;
+        }
+
+        for (long long r = 0; r < header.record_count; r++, n++) {
+            uint64_t digest, size, modified;
+            char path[MAX_PATH_LENGTH];
+            int slot = slot_of[n];
+
+            if (!get_u64(f, &digest, 8) || !get_u64(f, &size, 8) ||
+                !get_u64(f, &modified, 8) || !get_string(f, slot >= 0 ? path : NULL)) {
+                merge_fail(report, "Index changed during merge: %s", paths[i]);
+                goto cleanup;
+            }
+            if (slot < 0) continue;
+
+            MemberRecord* member = &members[slot];
+            member->digest = digest;
+            member->size = (long long)size;
+            member->modified = (long long)modified;
+            if (!arena_add(&arena, path, &member->path)) {
+                merge_fail(report, "%s", "Out of memory");
+                goto cleanup;
+            }
+        }
+
+        fclose(f);
+        f = NULL;
+    }
+
+    // ========================================================================
+    // PASS 4: DELIVER GROUPS
+    //
+    // Slots were handed out run by run, so every group is a contiguous
+    // span of members[]
+    // ========================================================================
+    for (int start = 0; start < member_count; ) {
+        int end = start + 1;
+        while (end < member_count && members[end].digest == members[start].digest &&
+               members[end].size == members[start].size) {
+            end++;
+        }
+
+        for (int k = start; k < end; k++) {
+            IndexRecord* record = &group[k - start];
+            record->digest = members[k].digest;
+            record->size = members[k].size;
+            record->modified = (time_t)members[k].modified;
+            record->path = arena.data + members[k].path;
+        }
+
+        int kept = drop_repeated_paths(group, end - start, &report->repeated_paths);
+        if (kept > 1 && !on_group(context, group, kept)) goto cleanup;
+        start = end;
+    }
+
+    ok = true;
+
+cleanup:
+    if (f) fclose(f);
+    free(headers);
+    free(shard_seen);
+    free(keys);
+    free(scratch);
+    free(slot_of);
+    free(members);
+    free(group);
+    free(arena.data);
+    return ok;
+}
@@ -0,0 +1,675 @@
+/*
+ * JOURNAL.C - Write-Ahead Action Journal (Undo and Crash Recovery)
+ *
+ * DSA CONCEPTS DEMONSTRATED:
+ * 1. Write-Ahead Logging (intent is durable before the first file changes)
+ * 2. Group Commit (many completion records share one flush)
+ * 3. Idempotent Redo/Undo (every step checks the disk before acting)
+ *
+ * FILE FORMAT: append-only text, one record per line, tab-separated.
+ * Paths are percent-encoded ("%", tabs, newlines and other control
+ * characters become %XX; POSIX names may contain them). The last field
+ * is "#" + FNV-1a-64 of everything before it, so a line torn by a crash
+ * is recognized and ignored.
+ *
+ *   B  batch pid kind mirror count dest   plan header
+ *   P  op group member path other         one per planned operation
+ *   D  op                                 operation done
+ *   X  op status error                    operation skipped or failed
+ *   C  batch                              executor finished
+ *   U  op                                 operation reversed
+ *   R  batch                              batch fully rolled back
+ *
+ * Records after a B belong to that batch; count in B is how many P
+ * records follow. A batch that lost one of them is undone as far as its
+ * P records go, but never reported fully undone. Only the last batch is ever
+ * resumed or undone, so once a batch commits everything before its B is
+ * dropped (compaction: the file is rewritten beside the journal and
+ * renamed over it, so a crash leaves the old or the new file).
+ *
+ * ONE OWNER: the journal is opened without sharing. A second instance
+ * cannot open it, so it can never offer to resume or roll back a batch
+ * that the first one is still running.
+ *
+ * WHAT "REVERSE" MEANS (op->other holds what each undo needs):
+ *   Move:   move it back from other to path
+ *   Delete: copy the kept duplicate (other) back to path
+ *   Quarantine: copy the stored object (other) back to path
+ *   Link:   give path its own copy of other's data again
+ *
+ * GROUP COMMIT: B and P records are flushed (FlushFileBuffers) before the
+ * executor touches anything. D/X/U records are buffered and flushed every
+ * JOURNAL_GROUP_COMMIT records or JOURNAL_GROUP_COMMIT_MS, by whichever
+ * worker crosses the line; the others keep appending into a second buffer
+ * meanwhile. A crash can lose the last few completion records, so
+ * recovery re-checks every operation with no record on disk - which is
+ * cheap, because only the unrecorded tail needs it.
+ */
+
+#include "common.h"
+#include <stdarg.h>
+
+#define JOURNAL_FIELD_MAX (MAX_PATH_LENGTH * 3)    // Every byte as %XX
+#define JOURNAL_LINE_MAX (JOURNAL_FIELD_MAX * 2 + 128)
+
+struct Journal {
+    HANDLE file;
+    char path[MAX_PATH_LENGTH];
+    long long batch_offset;      // Where the last B record starts
+    CRITICAL_SECTION lock;       // Guards the active buffer
+    CRITICAL_SECTION flush_lock; // One writer at a time, in order
+    char* buffer;                // Active: records being appended
+    size_t used;
+    size_t capacity;
+    char* spare;                 // Being written by the flusher
+    size_t spare_capacity;
+    int pending;                 // Records in the active buffer
+    DWORD last_flush;            // GetTickCount() of the last flush
+    bool holding;                // Writing a plan: one flush at the end
+    bool failed;                 // A write failed; the journal is unusable
+};
+
+// ============================================================================
+// OPEN / CLOSE
+//
+// A line cut short by a crash would swallow the next record, so a
+// missing final newline is restored first. Writes always append
+// (FILE_APPEND_DATA without FILE_WRITE_DATA), whatever the file pointer.
+//
+// RETURNS: NULL if the journal cannot be opened; GetLastError() is
+// ERROR_SHARING_VIOLATION if another process has it open
+// ============================================================================
+static HANDLE open_exclusive(const char* path) {
+    return CreateFileA(path, GENERIC_READ | FILE_APPEND_DATA, 0, NULL,
+                       OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+}
+
+Journal* journal_open(const char* path) {
+    if (!path || strlen(path) >= MAX_PATH_LENGTH) return NULL;
+
+    Journal* journal = (Journal*)calloc(1, sizeof(Journal));
+    if (!journal) return NULL;
+
+    journal->file = open_exclusive(path);
+    if (journal->file == INVALID_HANDLE_VALUE) {
+        DWORD error = GetLastError();
+        free(journal);
+        SetLastError(error);
+        return NULL;
+    }
+    strcpy(journal->path, path);
+
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(journal->file, &size) && size.QuadPart > 0) {
+        LARGE_INTEGER last;
+        char c = '\n';
+        DWORD bytes = 0;
+        last.QuadPart = size.QuadPart - 1;
+        SetFilePointerEx(journal->file, last, NULL, FILE_BEGIN);
+        if (ReadFile(journal->file, &c, 1, &bytes, NULL) && bytes == 1 && c != '\n') {
+            WriteFile(journal->file, "\n", 1, &bytes, NULL);
+        }
+    }
+
+    InitializeCriticalSection(&journal->lock);
+    InitializeCriticalSection(&journal->flush_lock);
+    journal->last_flush = GetTickCount();
+    return journal;
+}
+
+static void journal_flush(Journal* journal);
+
+void journal_close(Journal* journal) {
+    if (!journal) return;
+
+    journal_flush(journal);
+    CloseHandle(journal->file);
+    DeleteCriticalSection(&journal->lock);
+    DeleteCriticalSection(&journal->flush_lock);
+    free(journal->buffer);
+    free(journal->spare);
+    free(journal);
+}
+
+// ============================================================================
+// GROUP COMMIT
+//
+// The flusher swaps buffers under the append lock (cheap) and writes the
+// full one outside it, so workers never wait for the disk unless the
+// buffer they just filled is the one being flushed.
+// ============================================================================
+static void journal_flush(Journal* journal) {
+    EnterCriticalSection(&journal->flush_lock);
+
+    EnterCriticalSection(&journal->lock);
+    char* full = journal->buffer;
+    size_t full_size = journal->used;
+    size_t full_capacity = journal->capacity;
+    journal->buffer = journal->spare;
+    journal->capacity = journal->spare_capacity;
+    journal->used = 0;
+    journal->pending = 0;
+    journal->last_flush = GetTickCount();
+    LeaveCriticalSection(&journal->lock);
+
+    if (full_size > 0 && !journal->failed) {
+        DWORD written = 0;
+        if (!WriteFile(journal->file, full, (DWORD)full_size, &written, NULL) ||
+            written != full_size || !FlushFileBuffers(journal->file)) {
+            journal->failed = true;
+        }
+    }
+
+    journal->spare = full;
+    journal->spare_capacity = full_capacity;
+    LeaveCriticalSection(&journal->flush_lock);
+}
+
+// Appends one checksummed line; flushes when the group is full or old
+static bool journal_append(Journal* journal, const char* format, ...) {
+    char line[JOURNAL_LINE_MAX];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(line, sizeof(line) - 20, format, args);
+    va_end(args);
+    if (len < 0 || len >= (int)sizeof(line) - 20) return false;
+
+    uint64_t h = FNV_OFFSET_BASIS;
+    for (int i = 0; i < len; i++) {
+        h ^= (unsigned char)line[i];
+        h *= FNV_PRIME;
+    }
+    len += snprintf(line + len, sizeof(line) - len, "\t#%016llx\n", (unsigned long long)h);
+
+    EnterCriticalSection(&journal->lock);
+    if (journal->used + len > journal->capacity) {
+        size_t new_capacity = journal->capacity ? journal->capacity * 2 : 64 * 1024;
+        while (new_capacity < journal->used + len) new_capacity *= 2;
+        char* grown = (char*)realloc(journal->buffer, new_capacity);
+        if (!grown) {
+            LeaveCriticalSection(&journal->lock);
+            return false;
+        }
+        journal->buffer = grown;
+        journal->capacity = new_capacity;
+    }
+    memcpy(journal->buffer + journal->used, line, len);
+    journal->used += len;
+    journal->pending++;
+
+    bool flush_now = !journal->holding &&
+                     (journal->pending >= JOURNAL_GROUP_COMMIT ||
+                      GetTickCount() - journal->last_flush >= JOURNAL_GROUP_COMMIT_MS);
+    LeaveCriticalSection(&journal->lock);
+
+    if (flush_now) journal_flush(journal);
+    return true;
+}
+
+// ============================================================================
+// COMPACTION
+//
+// Copies the last batch (from its B record on) into "<journal>.tmp",
+// makes the copy durable, renames it over the journal and reopens it.
+// Until the rename the old journal is untouched; if the reopen fails the
+// journal is marked failed, so no later action runs unrecorded.
+// ============================================================================
+static char* read_from(HANDLE file, long long offset, size_t* size) {
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart < offset) return NULL;
+
+    char* data = (char*)malloc((size_t)(file_size.QuadPart - offset) + 1);
+    if (!data) return NULL;
+
+    LARGE_INTEGER start;
+    start.QuadPart = offset;
+    SetFilePointerEx(file, start, NULL, FILE_BEGIN);
+
+    size_t total = 0;
+    while (total < (size_t)(file_size.QuadPart - offset)) {
+        size_t left = (size_t)(file_size.QuadPart - offset) - total;
+        DWORD want = left > ((size_t)1 << 30) ? (DWORD)1 << 30 : (DWORD)left;
+        DWORD got = 0;
+        if (!ReadFile(file, data + total, want, &got, NULL) || got == 0) break;
+        total += got;
+    }
+    data[total] = '\0';
+    *size = total;
+    return data;
+}
+
+static void journal_compact(Journal* journal) {
+    char temp[MAX_PATH_LENGTH];
+    if (journal->batch_offset <= 0 ||
+        snprintf(temp, sizeof(temp), "%s.tmp", journal->path) >= (int)sizeof(temp)) {
+        return;
+    }
+
+    EnterCriticalSection(&journal->flush_lock);
+
+    size_t size = 0;
+    char* data = read_from(journal->file, journal->batch_offset, &size);
+    bool ok = data != NULL;
+    if (ok) {
+        HANDLE out = CreateFileA(temp, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                                 FILE_ATTRIBUTE_NORMAL, NULL);
+        DWORD written = 0;
+        ok = out != INVALID_HANDLE_VALUE &&
+             WriteFile(out, data, (DWORD)size, &written, NULL) && written == size &&
+             FlushFileBuffers(out);
+        if (out != INVALID_HANDLE_VALUE) CloseHandle(out);
+    }
+    free(data);
+
+    if (ok) {
+        CloseHandle(journal->file);
+        ok = MoveFileExA(temp, journal->path,
+                         MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+        journal->file = open_exclusive(journal->path);
+        if (journal->file == INVALID_HANDLE_VALUE) {
+            journal->failed = true;
+        } else if (ok) {
+            journal->batch_offset = 0;
+        }
+    }
+    if (!ok) DeleteFileA(temp);
+
+    LeaveCriticalSection(&journal->flush_lock);
+}
+
+// ============================================================================
+// PATH FIELDS
+//
+// Percent-encoding keeps a path inside its field whatever it contains;
+// the quarantine manifest writes its paths the same way.
+// ============================================================================
+
+// RETURNS: false if the encoded path does not fit in size
+bool encode_path_field(const char* path, char* out, size_t size) {
+    static const char hex[] = "0123456789ABCDEF";
+    size_t used = 0;
+
+    for (const unsigned char* c = (const unsigned char*)path; *c; c++) {
+        bool escaped = *c == '%' || *c < 0x20 || *c == 0x7F;
+        if (used + (escaped ? 3 : 1) >= size) return false;
+        if (escaped) {
+            out[used++] = '%';
+            out[used++] = hex[*c >> 4];
+            out[used++] = hex[*c & 0xF];
+        } else {
+            out[used++] = (char)*c;
+        }
+    }
+    if (used >= size) return false;
+    out[used] = '\0';
+    return true;
+}
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Decodes in place
+// RETURNS: false if the field is not a valid encoding
+bool decode_path_field(char* field) {
+    char* out = field;
+    for (const char* c = field; *c; c++) {
+        if (*c != '%') {
+            *out++ = *c;
+            continue;
+        }
+        int high = hex_digit(c[1]);
+        int low = high < 0 ? -1 : hex_digit(c[2]);
+        if (low < 0 || (high == 0 && low == 0)) return false;
+        *out++ = (char)(high << 4 | low);
+        c += 2;
+    }
+    *out = '\0';
+    return true;
+}
+
+// ============================================================================
+// RECORDING A PLAN (called by action_execute)
+// ============================================================================
+
+// B + every P, durable before the first operation runs
+bool journal_begin(Journal* journal, ActionPlan* plan) {
+    if (!journal || !plan || journal->failed) return false;
+
+    // A path that cannot be recorded refuses the whole plan, before any
+    // record is written: a batch with P records missing is never replayed
+    char dest_field[JOURNAL_FIELD_MAX];
+    char path_field[JOURNAL_FIELD_MAX], other_field[JOURNAL_FIELD_MAX];
+    bool encoded = encode_path_field(plan->dest_folder ? plan->dest_folder : "",
+                                     dest_field, sizeof(dest_field));
+    for (int i = 0; encoded && i < plan->count; i++) {
+        const ActionOp* op = &plan->ops[i];
+        encoded = encode_path_field(op->path, path_field, sizeof(path_field)) &&
+                  encode_path_field(op->other ? op->other : "", other_field,
+                                    sizeof(other_field));
+    }
+    if (!encoded) {
+        SetLastError(ERROR_FILENAME_EXCED_RANGE);
+        return false;
+    }
+
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    plan->journal_batch = ((long long)now.dwHighDateTime << 32) | now.dwLowDateTime;
+
+    // Everything before this offset is dropped once the batch commits
+    LARGE_INTEGER end;
+    journal_flush(journal);
+    journal->batch_offset = GetFileSizeEx(journal->file, &end) ? end.QuadPart : 0;
+
+    journal->holding = true;
+    bool ok = journal_append(journal, "B\t%lld\t%lu\t%d\t%d\t%d\t%s",
+                             plan->journal_batch, (unsigned long)GetCurrentProcessId(),
+                             (int)plan->kind, plan->mirror_tree ? 1 : 0, plan->count,
+                             dest_field);
+    for (int i = 0; ok && i < plan->count; i++) {
+        const ActionOp* op = &plan->ops[i];
+        encode_path_field(op->path, path_field, sizeof(path_field));
+        encode_path_field(op->other ? op->other : "", other_field, sizeof(other_field));
+        ok = journal_append(journal, "P\t%d\t%d\t%d\t%s\t%s", i, op->group, op->member,
+                            path_field, other_field);
+    }
+
+    journal->holding = false;
+
+    journal_flush(journal);
+    return ok && !journal->failed;
+}
+
+void journal_op_finished(Journal* journal, const ActionPlan* plan, int op) {
+    const ActionOp* o = &plan->ops[op];
+    if (o->status == OP_DONE) {
+        journal_append(journal, "D\t%d", op);
+    } else {
+        journal_append(journal, "X\t%d\t%d\t%lu", op, (int)o->status, (unsigned long)o->error);
+    }
+}
+
+bool journal_commit(Journal* journal, ActionPlan* plan) {
+    journal_append(journal, "C\t%lld", plan->journal_batch);
+    journal_flush(journal);
+    if (!journal->failed) journal_compact(journal);
+    return !journal->failed;
+}
+
+// ============================================================================
+// CHECKING THE DISK
+//
+// Whether an operation without a completion record happened anyway.
+// ============================================================================
+static bool path_exists(const char* path) {
+    return GetFileAttributesA(path) != INVALID_FILE_ATTRIBUTES;
+}
+
+static bool same_file(const char* a, const char* b) {
+    FileIdentity ia, ib;
+    return get_file_identity(a, &ia) && get_file_identity(b, &ib) &&
+           ia.volume == ib.volume && ia.index == ib.index;
+}
+
+static bool op_happened(ActionKind kind, const ActionOp* op) {
+    switch (kind) {
+        case ACTION_DELETE:
+        case ACTION_QUARANTINE:
+            return !path_exists(op->path);
+        case ACTION_MOVE:
+            return op->other && !path_exists(op->path) && path_exists(op->other);
+        case ACTION_HARD_LINK:
+            return op->other && same_file(op->path, op->other);
+        case ACTION_CLONE:
+            return false;     // Invisible on disk; redoing it re-verifies first
+    }
+    return false;
+}
+
+// ============================================================================
+// LOAD LAST BATCH
+//
+// Rebuilds the last batch as a plan: ops marked OP_DONE happened (by
+// record or, for an interrupted batch, by checking the disk), OP_PENDING
+// did not. Ops that were skipped, failed or already reversed keep the
+// status they ended with and are left alone by resume and rollback.
+//
+// An interrupted batch also gets its leftover temporary names removed
+// (replace_with_link and run_copy_move, sequence = op index), and so does
+// a cross-volume copy that was renamed into place while its source still
+// exists: finish and undo then both start from the untouched source.
+//
+// RETURNS: the plan (caller frees), or NULL when state is JOURNAL_CLEAN
+// ============================================================================
+static int split_fields(char* line, char** fields, int max_fields) {
+    int n = 0;
+    fields[n++] = line;
+    for (char* p = line; *p && n < max_fields; p++) {
+        if (*p == '\t') {
+            *p = '\0';
+            fields[n++] = p + 1;
+        }
+    }
+    return n;
+}
+
+// Strips and checks the trailing "\t#<hash>"
+static bool line_valid(char* line) {
+    char* mark = strrchr(line, '\t');
+    if (!mark || mark[1] != '#') return false;
+
+    uint64_t h = FNV_OFFSET_BASIS;
+    for (const char* p = line; p < mark; p++) {
+        h ^= (unsigned char)*p;
+        h *= FNV_PRIME;
+    }
+    unsigned long long stored = strtoull(mark + 2, NULL, 16);
+    *mark = '\0';
+    return stored == h;
+}
+
+ActionPlan* journal_load_last(Journal* journal, JournalState* state) {
+    *state = JOURNAL_CLEAN;
+    if (!journal) return NULL;
+
+    // Through the journal's own handle: nobody else can open the file
+    size_t size = 0;
+    journal_flush(journal);
+    EnterCriticalSection(&journal->flush_lock);
+    char* data = read_from(journal->file, 0, &size);
+    LeaveCriticalSection(&journal->flush_lock);
+    if (!data) return NULL;
+
+    ActionPlan* plan = NULL;
+    unsigned long pid = 0;
+    bool committed = false, undoing = false, rolled_back = false;
+
+    char* line = data;
+    while (line < data + size) {
+        char* end = strchr(line, '\n');
+        if (!end) break;                      // Torn last line
+        *end = '\0';
+
+        char* f[8];
+        int n = line_valid(line) ? split_fields(line, f, 8) : 0;
+        char type = n > 0 ? f[0][0] : 0;
+        int op = n > 1 ? atoi(f[1]) : -1;
+        bool op_ok = plan && op >= 0 && op < plan->count;
+
+        if (type == 'B' && n >= 7 && decode_path_field(f[6])) {
+            action_plan_free(plan);
+            plan = action_plan_create((ActionKind)atoi(f[3]), f[6][0] ? f[6] : NULL);
+            if (plan) {
+                plan->journal_batch = strtoll(f[1], NULL, 10);
+                plan->mirror_tree = atoi(f[4]) != 0;
+                plan->journal_count = atoi(f[5]);
+            }
+            pid = strtoul(f[2], NULL, 10);
+            journal->batch_offset = line - data;
+            committed = undoing = rolled_back = false;
+        } else if (type == 'P' && n >= 6 && plan && op == plan->count &&
+                   decode_path_field(f[4]) && decode_path_field(f[5])) {
+            action_plan_add(plan, atoi(f[2]), atoi(f[3]), f[4], f[5][0] ? f[5] : NULL);
+        } else if (type == 'D' && op_ok) {
+            plan->ops[op].status = OP_DONE;
+        } else if (type == 'X' && n >= 4 && op_ok) {
+            plan->ops[op].status = (OpStatus)atoi(f[2]);
+            plan->ops[op].error = strtoul(f[3], NULL, 10);
+        } else if (type == 'U' && op_ok) {
+            plan->ops[op].status = OP_SKIPPED;
+            undoing = true;
+        } else if (type == 'C' && plan) {
+            committed = true;
+        } else if (type == 'R' && plan) {
+            rolled_back = true;
+        }
+
+        line = end + 1;
+    }
+    free(data);
+
+    if (!plan || rolled_back) {
+        action_plan_free(plan);
+        return NULL;
+    }
+
+    if (undoing) {
+        *state = JOURNAL_UNDOING;
+    } else if (committed) {
+        *state = JOURNAL_COMMITTED;
+    } else {
+        *state = JOURNAL_INCOMPLETE;
+
+        // The completion records that did not make it to disk
+        for (int i = 0; i < plan->count; i++) {
+            ActionOp* op = &plan->ops[i];
+            if (op->status != OP_PENDING) continue;
+
+            if (op_happened(plan->kind, op)) {
+                op->status = OP_DONE;
+            } else if (plan->kind == ACTION_HARD_LINK) {
+                const char* slash = strrchr(op->path, PATH_SEP);
+                char temp[MAX_PATH_LENGTH];
+                snprintf(temp, sizeof(temp), "%.*s" PATH_SEP_STR ".dedup-link-%lu-%d.tmp",
+                         slash ? (int)(slash - op->path) : 0, op->path, pid, i);
+                DeleteFileA(temp);
+            } else if (plan->kind == ACTION_MOVE && op->other) {
+                // Copies are renamed into place only once complete and
+                // durable, so both names existing means a finished copy
+                if (path_exists(op->path)) DeleteFileA(op->other);
+
+                const char* slash = strrchr(op->other, PATH_SEP);
+                char temp[MAX_PATH_LENGTH];
+                snprintf(temp, sizeof(temp), "%.*s" PATH_SEP_STR ".dedup-move-%lu-%d.tmp",
+                         slash ? (int)(slash - op->other) : 0, op->other, pid, i);
+                DeleteFileA(temp);
+            }
+        }
+    }
+    return plan;
+}
+
+// ============================================================================
+// ROLLBACK
+//
+// Reverses every OP_DONE op of the last batch, max_in_flight at a time,
+// and records each with U (group-committed), then R. Safe to repeat after
+// a crash: an op that is already reversed on disk counts as reversed.
+//
+// Afterwards an op is OP_DONE if it was reversed, OP_FAILED if it could
+// not be (error says why), and OP_SKIPPED if there was nothing to undo.
+// plan->succeeded / skipped / failed count the same.
+// ============================================================================
+typedef struct {
+    Journal* journal;
+    ActionPlan* plan;
+} RollbackJob;
+
+static bool undo_op(ActionKind kind, const ActionOp* op, int sequence) {
+    if (!op->other) {
+        SetLastError(ERROR_FILE_NOT_FOUND);    // Nothing to restore from
+        return false;
+    }
+
+    switch (kind) {
+        case ACTION_MOVE:
+            if (path_exists(op->path) && !path_exists(op->other)) return true;
+            return MoveFileExA(op->other, op->path, MOVEFILE_COPY_ALLOWED) != 0;
+
+        case ACTION_DELETE:
+        case ACTION_QUARANTINE:
+            if (path_exists(op->path)) return true;
+            return CopyFileA(op->other, op->path, TRUE) != 0;
+
+        case ACTION_HARD_LINK: {
+            if (!same_file(op->path, op->other)) return true;
+
+            // Private copy under a temporary name, then renamed over the link
+            const char* slash = strrchr(op->path, PATH_SEP);
+            char temp[MAX_PATH_LENGTH];
+            int len = snprintf(temp, sizeof(temp), "%.*s" PATH_SEP_STR ".dedup-undo-%lu-%d.tmp",
+                               slash ? (int)(slash - op->path) : 0, op->path,
+                               (unsigned long)GetCurrentProcessId(), sequence);
+            if (len >= (int)sizeof(temp) - 1) return false;
+
+            if (!CopyFileA(op->other, temp, FALSE)) return false;
+            if (!MoveFileExA(temp, op->path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+                DeleteFileA(temp);
+                return false;
+            }
+            return true;
+        }
+
+        case ACTION_CLONE:
+            return true;      // Contents never changed: nothing to reverse
+    }
+    return false;
+}
+
+static void rollback_one(void* context, int i) {
+    RollbackJob* job = (RollbackJob*)context;
+    ActionOp* op = &job->plan->ops[i];
+
+    if (op->status == OP_DONE) {
+        if (undo_op(job->plan->kind, op, i)) {
+            journal_append(job->journal, "U\t%d", i);
+        } else {
+            op->status = OP_FAILED;
+            op->error = GetLastError();
+        }
+    } else {
+        op->status = OP_SKIPPED;
+    }
+    InterlockedIncrement(&job->plan->completed);
+}
+
+bool journal_rollback(Journal* journal, ActionPlan* plan, int max_in_flight) {
+    if (!journal || !plan || journal->failed) return false;
+    if (max_in_flight <= 0) max_in_flight = ACTION_MAX_IN_FLIGHT;
+
+    plan->completed = 0;
+    plan->succeeded = plan->skipped = plan->failed = 0;
+
+    RollbackJob job = { journal, plan };
+    parallel_for(plan->count, max_in_flight, rollback_one, &job);
+
+    for (int i = 0; i < plan->count; i++) {
+        switch (plan->ops[i].status) {
+            case OP_DONE:    plan->succeeded++; break;
+            case OP_SKIPPED: plan->skipped++;   break;
+            default:         plan->failed++;    break;
+        }
+    }
+
+    // Ops whose P record was lost cannot be reversed
+    if (plan->journal_count > plan->count) plan->failed += plan->journal_count - plan->count;
+
+    // Only a complete rollback closes the batch; otherwise it can be retried
+    if (plan->failed == 0) journal_append(journal, "R\t%lld", plan->journal_batch);
+    journal_flush(journal);
+    return !journal->failed;
+}
@@ -0,0 +1,233 @@
+/*
+ * NAME_REGISTRY.C - Destination Name Allocation in O(1) per File
+ *
+ * DSA CONCEPTS DEMONSTRATED:
+ * 1. Hash Set with Chaining (case-insensitive full paths)
+ * 2. Per-Key Counters (next free suffix remembered per base name)
+ * 3. Amortized Analysis (each suffix is tried at most once per base name)
+ *
+ * PROBLEM: Moving thousands of files called IMG_0001.jpg into one folder
+ * used to probe IMG_0001_1.jpg, IMG_0001_2.jpg, ... on disk for every
+ * file: quadratic in file system calls.
+ *
+ * SOLUTION: Each destination directory is listed once, the first time a
+ * name is claimed in it. From then on the registry knows every name in
+ * the directory, including the ones it handed out itself, and answers
+ * from memory. The entry of a base name remembers the next suffix to try,
+ * so the k-th IMG_0001.jpg costs O(1), not O(k).
+ */
+
+#include "common.h"
+
+#define REGISTRY_INITIAL_BUCKETS 1024
+
+typedef struct NameEntry {
+    char* path;              // Lowercased full path
+    uint64_t hash;
+    int next_suffix;         // Next n to try for base_n.ext (when taken)
+    bool is_listed_dir;      // Directory entry: its contents are loaded
+    struct NameEntry* next;
+} NameEntry;
+
+struct NameRegistry {
+    NameEntry** buckets;
+    int bucket_count;
+    int count;
+};
+
+// ============================================================================
+// HASHING (FNV-1a over the lowercased path)
+// ============================================================================
+static uint64_t hash_lower(const char* s, char* lowered) {
+    uint64_t h = FNV_OFFSET_BASIS;
+    int i = 0;
+    for (; s[i]; i++) {
+        char c = s[i];
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        lowered[i] = c;
+        h ^= (unsigned char)c;
+        h *= FNV_PRIME;
+    }
+    lowered[i] = '\0';
+    return h;
+}
+
+// ============================================================================
+// CREATE / DESTROY
+// ============================================================================
+NameRegistry* name_registry_create(void) {
+    NameRegistry* registry = (NameRegistry*)calloc(1, sizeof(NameRegistry));
+    if (!registry) return NULL;
+
+    registry->buckets = (NameEntry**)calloc(REGISTRY_INITIAL_BUCKETS, sizeof(NameEntry*));
+    if (!registry->buckets) {
+        free(registry);
+        return NULL;
+    }
+    registry->bucket_count = REGISTRY_INITIAL_BUCKETS;
+    return registry;
+}
+
+void name_registry_destroy(NameRegistry* registry) {
+    if (!registry) return;
+
+    for (int b = 0; b < registry->bucket_count; b++) {
+        NameEntry* entry = registry->buckets[b];
+        while (entry) {
+            NameEntry* next = entry->next;
+            free(entry->path);
+            free(entry);
+            entry = next;
+        }
+    }
+    free(registry->buckets);
+    free(registry);
+}
+
+// ============================================================================
+// LOOKUP / INSERT
+// ============================================================================
+static NameEntry* lookup(NameRegistry* registry, const char* path) {
+    char lowered[MAX_PATH_LENGTH];
+    uint64_t h = hash_lower(path, lowered);
+
+    NameEntry* entry = registry->buckets[h & (registry->bucket_count - 1)];
+    for (; entry; entry = entry->next) {
+        if (entry->hash == h && strcmp(entry->path, lowered) == 0) return entry;
+    }
+    return NULL;
+}
+
+// Doubles the bucket array at load factor 1 (bucket_count is a power of two)
+static void grow(NameRegistry* registry) {
+    int new_count = registry->bucket_count * 2;
+    NameEntry** buckets = (NameEntry**)calloc(new_count, sizeof(NameEntry*));
+    if (!buckets) return;    // Keep working with longer chains
+
+    for (int b = 0; b < registry->bucket_count; b++) {
+        NameEntry* entry = registry->buckets[b];
+        while (entry) {
+            NameEntry* next = entry->next;
+            NameEntry** slot = &buckets[entry->hash & (new_count - 1)];
+            entry->next = *slot;
+            *slot = entry;
+            entry = next;
+        }
+    }
+
+    free(registry->buckets);
+    registry->buckets = buckets;
+    registry->bucket_count = new_count;
+}
+
+static NameEntry* insert(NameRegistry* registry, const char* path) {
+    NameEntry* existing = lookup(registry, path);
+    if (existing) return existing;
+
+    char lowered[MAX_PATH_LENGTH];
+    uint64_t h = hash_lower(path, lowered);
+
+    NameEntry* entry = (NameEntry*)calloc(1, sizeof(NameEntry));
+    if (!entry) return NULL;
+    entry->path = _strdup(lowered);
+    if (!entry->path) {
+        free(entry);
+        return NULL;
+    }
+    entry->hash = h;
+    entry->next_suffix = 1;
+
+    if (registry->count >= registry->bucket_count) grow(registry);
+
+    NameEntry** slot = &registry->buckets[h & (registry->bucket_count - 1)];
+    entry->next = *slot;
+    *slot = entry;
+    registry->count++;
+    return entry;
+}
+
+// ============================================================================
+// LOAD DIRECTORY (once per directory)
+//
+// A directory that does not exist yet simply has no names.
+// ============================================================================
+static bool load_directory(NameRegistry* registry, const char* dir) {
+    NameEntry* dir_entry = insert(registry, dir);
+    if (!dir_entry) return false;
+    if (dir_entry->is_listed_dir) {
+        TELEMETRY_COUNT(TELEMETRY_CACHE_HITS, 1);
+        return true;
+    }
+    TELEMETRY_COUNT(TELEMETRY_CACHE_MISSES, 1);
+
+    char pattern[MAX_PATH_LENGTH];
+    if (snprintf(pattern, sizeof(pattern), "%s" PATH_SEP_STR "*", dir) >= (int)sizeof(pattern)) {
+        return false;
+    }
+
+    WIN32_FIND_DATAA ffd;
+    HANDLE hFind = FindFirstFileA(pattern, &ffd);
+    if (hFind != INVALID_HANDLE_VALUE) {
+        char path[MAX_PATH_LENGTH];
+        do {
+            TELEMETRY_COUNT(TELEMETRY_SYSCALLS, 1);   // The Find call that returned it
+            if (strcmp(ffd.cFileName, ".") == 0 || strcmp(ffd.cFileName, "..") == 0) continue;
+            if (snprintf(path, sizeof(path), "%s" PATH_SEP_STR "%s", dir,
+                         ffd.cFileName) >= (int)sizeof(path)) {
+                continue;
+            }
+            insert(registry, path);
+        } while (FindNextFileA(hFind, &ffd));
+        FindClose(hFind);
+    }
+    TELEMETRY_COUNT(TELEMETRY_SYSCALLS, hFind != INVALID_HANDLE_VALUE ? 2 : 1);
+
+    dir_entry->is_listed_dir = true;
+    return true;
+}
+
+// True once a name has been claimed in dir (so the caller has already
+// made sure the directory exists)
+bool name_registry_knows_directory(NameRegistry* registry, const char* dir) {
+    NameEntry* entry = registry ? lookup(registry, dir) : NULL;
+    return entry && entry->is_listed_dir;
+}
+
+// ============================================================================
+// CLAIM NAME
+//
+// Picks dir\filename, or dir\base_n.ext for the smallest n not yet seen
+// for this base name, and records it as taken. No file is created: the
+// caller moves a file there next (MoveFileEx without REPLACE_EXISTING,
+// so a name that appeared in the meantime fails rather than overwrites).
+//
+// RETURNS: false if the name does not fit or memory runs out
+// ============================================================================
+bool name_registry_claim(NameRegistry* registry, const char* dir, const char* filename,
+                         char* out_path) {
+    if (!registry || !dir || !filename || !out_path) return false;
+    if (!load_directory(registry, dir)) return false;
+
+    int len = snprintf(out_path, MAX_PATH_LENGTH, "%s" PATH_SEP_STR "%s", dir, filename);
+    if (len >= MAX_PATH_LENGTH - 1) return false;
+
+    NameEntry* base = lookup(registry, out_path);
+    if (!base) return insert(registry, out_path) != NULL;
+
+    // Taken: continue from where the last conflict on this name stopped
+    const char* ext = strrchr(filename, '.');
+    int base_len = ext ? (int)(ext - filename) : (int)strlen(filename);
+    if (!ext) ext = "";
+
+    // Ends: the registry holds finitely many names
+    for (int n = base->next_suffix; ; n++) {
+        len = snprintf(out_path, MAX_PATH_LENGTH, "%s" PATH_SEP_STR "%.*s_%d%s",
+                       dir, base_len, filename, n, ext);
+        if (len >= MAX_PATH_LENGTH - 1) return false;
+
+        if (!lookup(registry, out_path)) {
+            base->next_suffix = n + 1;
+            return insert(registry, out_path) != NULL;
+        }
+    }
+}
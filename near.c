@@ -0,0 +1,339 @@
+/*
+ * NEAR.C - Near-Duplicate Detection with MinHash and LSH
+ *
+ * DSA CONCEPTS DEMONSTRATED:
+ * 1. MinHash (Jaccard similarity estimate from small signatures)
+ * 2. One-Permutation Hashing with Densification (1 hash per shingle)
+ * 3. Locality-Sensitive Hashing with Banding (candidates without O(n^2))
+ * 4. Union-Find (merging verified pairs into clusters)
+ *
+ * SHINGLES:
+ * Every 8-byte window of the file is one shingle. Rotated logs, config
+ * variants and re-exported CSVs share most of their windows, so their
+ * shingle sets have a high Jaccard similarity J = |A & B| / |A | B|.
+ *
+ * SIGNATURE (computed while the file is read for its content hash):
+ * Each shingle hash picks one of MINHASH_BINS bins (top bits) and only
+ * lowers that bin's minimum (low bits). Per byte this is one multiply
+ * and one compare, so a scan with signatures stays close to plain
+ * hashing. For two files, P(bin i equal) ~ J.
+ *
+ * LSH: the signature is cut into b bands of r bins. Files that agree on
+ * a whole band are candidates; P(candidate) = 1 - (1 - J^r)^b, a steep
+ * S-curve around (1/b)^(1/r), picked from the requested threshold.
+ */
+
+#include "common.h"
+#include <math.h>
+
+#define MINHASH_EMPTY 0xFFFFFFFFu
+
+struct NearIndex {
+    uint32_t* signatures;    // capacity * MINHASH_BINS
+    bool* has_signature;
+    int capacity;
+};
+
+// ============================================================================
+// SIGNATURE BUILDING
+// ============================================================================
+void minhash_init(MinHashState* state) {
+    for (int i = 0; i < MINHASH_BINS; i++) {
+        state->bins[i] = MINHASH_EMPTY;
+    }
+    state->window = 0;
+    state->bytes = 0;
+}
+
+// ContentVisitor: feeds the bytes compute_hash_ex reads
+void minhash_update(void* context, const unsigned char* data, size_t len) {
+    MinHashState* state = (MinHashState*)context;
+    uint64_t window = state->window;
+    size_t i = 0;
+
+    // Fill the first window without emitting shingles
+    while (i < len && state->bytes + i < MINHASH_SHINGLE) {
+        window = (window << 8) | data[i++];
+    }
+
+    for (; i < len; i++) {
+        window = (window << 8) | data[i];
+
+        // High product bits depend on the whole window: top bits pick
+        // the bin, the 32 bits below them are the value
+        uint64_t h = window * 0x9E3779B97F4A7C15ULL;
+
+        uint32_t bin = (uint32_t)(h >> (64 - MINHASH_BIN_BITS));
+        uint32_t value = (uint32_t)(h >> (32 - MINHASH_BIN_BITS));
+        if (value < state->bins[bin]) state->bins[bin] = value;
+    }
+
+    state->window = window;
+    state->bytes += len;
+}
+
+// ============================================================================
+// DENSIFICATION
+//
+// Small files leave some bins empty. An empty bin borrows the value of
+// the next non-empty bin to its right (circularly), salted with the
+// distance, so two similar files still fill their empty bins alike.
+//
+// RETURNS: false if the file had no shingle at all
+// ============================================================================
+bool minhash_final(const MinHashState* state, uint32_t* signature) {
+    int first = -1;
+    for (int i = 0; i < MINHASH_BINS; i++) {
+        if (state->bins[i] != MINHASH_EMPTY) {
+            first = i;
+            break;
+        }
+    }
+    if (first < 0) return false;
+
+    for (int i = 0; i < MINHASH_BINS; i++) {
+        uint32_t value = state->bins[i];
+        int distance = 0;
+
+        while (value == MINHASH_EMPTY) {
+            distance++;
+            value = state->bins[(i + distance) % MINHASH_BINS];
+        }
+        signature[i] = distance ? value + (uint32_t)distance * 0x9E3779B9u : value;
+    }
+    return true;
+}
+
+// ============================================================================
+// INDEX
+// ============================================================================
+NearIndex* near_index_create(int max_files) {
+    if (max_files <= 0) return NULL;
+
+    NearIndex* index = (NearIndex*)calloc(1, sizeof(NearIndex));
+    if (!index) return NULL;
+
+    index->signatures = (uint32_t*)malloc((size_t)max_files * MINHASH_BINS * sizeof(uint32_t));
+    index->has_signature = (bool*)calloc(max_files, sizeof(bool));
+    if (!index->signatures || !index->has_signature) {
+        near_index_destroy(index);
+        return NULL;
+    }
+
+    index->capacity = max_files;
+    return index;
+}
+
+void near_index_destroy(NearIndex* index) {
+    if (!index) return;
+
+    free(index->signatures);
+    free(index->has_signature);
+    free(index);
+}
+
+// Each file writes only its own slot, so scanning threads need no lock
+void near_index_add(NearIndex* index, int file_idx, const MinHashState* state) {
+    if (!index || file_idx < 0 || file_idx >= index->capacity) return;
+
+    uint32_t* signature = index->signatures + (size_t)file_idx * MINHASH_BINS;
+    index->has_signature[file_idx] = minhash_final(state, signature);
+}
+
+static double estimate_similarity(const uint32_t* a, const uint32_t* b) {
+    int equal = 0;
+    for (int i = 0; i < MINHASH_BINS; i++) {
+        if (a[i] == b[i]) equal++;
+    }
+    return (double)equal / MINHASH_BINS;
+}
+
+// ============================================================================
+// BAND LAYOUT
+//
+// r (rows per band) is the largest divisor of MINHASH_BINS whose S-curve
+// midpoint (1/b)^(1/r) stays at or below the threshold, so files at the
+// threshold are found with high probability; verification then removes
+// the extra candidates.
+// ============================================================================
+static int rows_per_band(double threshold) {
+    int best = 1;
+    for (int r = 1; r <= MINHASH_BINS; r *= 2) {
+        int bands = MINHASH_BINS / r;
+        if (pow(1.0 / bands, 1.0 / r) <= threshold) best = r;
+    }
+    return best;
+}
+
+// ============================================================================
+// UNION-FIND (path halving + union by size)
+// ============================================================================
+static int uf_find(int* parent, int x) {
+    while (parent[x] != x) {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+static void uf_union(int* parent, int* rank_size, int a, int b) {
+    a = uf_find(parent, a);
+    b = uf_find(parent, b);
+    if (a == b) return;
+
+    if (rank_size[a] < rank_size[b]) {
+        int t = a;
+        a = b;
+        b = t;
+    }
+    parent[b] = a;
+    rank_size[a] += rank_size[b];
+}
+
+static uint64_t hash_band(const uint32_t* rows, int r, int band) {
+    uint64_t h = 14695981039346656037ULL ^ (uint64_t)band;
+    for (int i = 0; i < r; i++) {
+        h ^= rows[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// ============================================================================
+// FIND NEAR DUPLICATES
+//
+// Step 1: For every band, bucket files by the hash of their band rows
+//         (DupTable keyed on (band hash, band number))
+// Step 2: Verify each bucket member against the bucket's first member;
+//         pairs with estimated similarity >= threshold are unioned
+// Step 3: Clusters of 2+ files that are not all byte-identical become
+//         groups (exact copies are already reported by find_duplicates)
+//
+// Checking against the first member keeps a bucket at O(k) comparisons;
+// a pair missed that way is usually linked through another band.
+//
+// RETURNS: groups referencing `files`. A group's size is its smallest
+// member's size (the members differ, so savings are an estimate).
+// ============================================================================
+DuplicateResults find_near_duplicates(const NearIndex* index, FileInfo* files, int count,
+                                      double threshold) {
+    DuplicateResults results = {0};
+    if (!index || !files || count <= 1) return results;
+    if (count > index->capacity) count = index->capacity;
+    if (threshold <= 0.0 || threshold > 1.0) threshold = NEAR_DEFAULT_THRESHOLD;
+
+    int r = rows_per_band(threshold);
+    int bands = MINHASH_BINS / r;
+
+    int* parent = (int*)malloc(count * sizeof(int));
+    int* rank_size = (int*)malloc(count * sizeof(int));
+    int* first_in_bucket = (int*)malloc(count * sizeof(int));
+    int* cursor = NULL;
+    bool* mixed = NULL;      // Per root: cluster holds 2+ distinct digests
+    DupTable table = {0};
+
+    if (!parent || !rank_size || !first_in_bucket) goto cleanup;
+
+    for (int i = 0; i < count; i++) {
+        parent[i] = i;
+        rank_size[i] = 1;
+    }
+
+    // ========================================================================
+    // STEPS 1-2: BAND BUCKETS + VERIFICATION
+    // ========================================================================
+    for (int band = 0; band < bands; band++) {
+        if (!dup_table_init(&table, (size_t)count)) goto cleanup;
+
+        for (int i = 0; i < count; i++) {
+            if (!index->has_signature[i]) continue;
+
+            const uint32_t* sig = index->signatures + (size_t)i * MINHASH_BINS;
+            int buckets_before = (int)table.size;
+            int bucket = dup_table_insert(&table, hash_band(sig + band * r, r, band), band);
+            if (bucket < 0) continue;
+
+            // Bucket ids are handed out in order: a new id means i opened it
+            if (bucket == buckets_before) {
+                first_in_bucket[bucket] = i;
+                continue;
+            }
+
+            int other = first_in_bucket[bucket];
+            if (uf_find(parent, i) == uf_find(parent, other)) continue;
+
+            const uint32_t* other_sig = index->signatures + (size_t)other * MINHASH_BINS;
+            if (estimate_similarity(sig, other_sig) >= threshold) {
+                uf_union(parent, rank_size, i, other);
+            }
+        }
+
+        dup_table_free(&table);
+    }
+
+    // ========================================================================
+    // STEP 3: CLUSTERS -> GROUPS (rank_size[root] is the cluster size)
+    // ========================================================================
+    mixed = (bool*)calloc(count, sizeof(bool));
+    if (!mixed) goto cleanup;
+
+    int group_count = 0;
+    int member_count = 0;
+
+    for (int i = 0; i < count; i++) {
+        int root = uf_find(parent, i);
+        if (files[i].digest != files[root].digest) mixed[root] = true;
+    }
+    for (int i = 0; i < count; i++) {
+        if (parent[i] == i && rank_size[i] > 1 && mixed[i]) {
+            group_count++;
+            member_count += rank_size[i];
+        }
+    }
+
+    if (group_count == 0) goto cleanup;
+
+    results.groups = (DuplicateGroup*)malloc(group_count * sizeof(DuplicateGroup));
+    results.members = (int*)malloc(member_count * sizeof(int));
+    cursor = (int*)malloc(count * sizeof(int));
+    if (!results.groups || !results.members || !cursor) {
+        free_duplicate_results(&results);
+        goto cleanup;
+    }
+    results.files = files;
+    results.capacity = group_count;
+
+    // Lay groups out in root order, then drop members at their cursor
+    int offset = 0;
+    for (int i = 0; i < count; i++) {
+        cursor[i] = -1;
+        if (parent[i] == i && rank_size[i] > 1 && mixed[i]) {
+            DuplicateGroup* group = &results.groups[results.count++];
+            group->members = results.members + offset;
+            group->count = 0;
+            group->size = files[i].size;
+            cursor[i] = results.count - 1;
+            offset += rank_size[i];
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        int g = cursor[uf_find(parent, i)];
+        if (g < 0) continue;
+
+        DuplicateGroup* group = &results.groups[g];
+        group->members[group->count++] = i;
+        if (files[i].size < group->size) group->size = files[i].size;
+    }
+
+    rank_results_by_savings(&results, TOP_GROUPS_DEFAULT, false);
+
+cleanup:
+    dup_table_free(&table);
+    free(mixed);
+    free(cursor);
+    free(first_in_bucket);
+    free(parent);
+    free(rank_size);
+    return results;
+}
@@ -0,0 +1,326 @@
+/*
+ * PLANNER.C - Dry Run: What an Action Will Free, Issue and Cost
+ *
+ * DSA CONCEPTS DEMONSTRATED:
+ * 1. Single Linear Pass (O(n) over all group members)
+ * 2. Fast Path + Rare Slow Path (sorting only files with several links)
+ * 3. Cost Model (latency per call, bandwidth per byte, parallelism)
+ *
+ * Works from the scan records alone - the only file system call asks
+ * which volume a move destination is on. The scan
+ * stores each file's identity and hard link count while it has the file
+ * open for hashing (compute_hash_ex); records without them (merged shard
+ * indexes) are treated as separate single-link files, which makes the
+ * byte count an upper bound for them.
+ *
+ * WHEN DOES REMOVING A NAME FREE DATA?
+ * Only when it removes the last name of the file. For a duplicate (keep
+ * member 0, act on the rest) that means:
+ * - it is not a link of the kept file, and
+ * - every link of its file is acted on in the same group
+ * A file with one link (the normal case) passes the second test by
+ * itself, so only files with links > 1 are collected and sorted.
+ */
+
+#include "common.h"
+
+// ============================================================================
+// VOLUME OF A PATH (string only)
+//
+// "C:\..." -> "C:", "\\server\share\..." -> "\\server\share".
+// RETURNS: length of the root, 0 if the path has none (POSIX paths: one
+// tree, whatever volumes are mounted in it)
+// ============================================================================
+static int volume_root_length(const char* path) {
+    if (path[0] && path[1] == ':') return 2;
+
+    if (path[0] == '\\' && path[1] == '\\') {
+        const char* server_end = strchr(path + 2, '\\');
+        if (!server_end) return (int)strlen(path);
+        const char* share_end = strchr(server_end + 1, '\\');
+        return share_end ? (int)(share_end - path) : (int)strlen(path);
+    }
+    return 0;
+}
+
+// Paths without a root may be on any volume: not the same one
+static bool same_root(const char* a, const char* b) {
+    int la = volume_root_length(a);
+    return la > 0 && la == volume_root_length(b) && path_ncompare(a, b, la) == 0;
+}
+
+static bool is_remote(const char* path) {
+    return path[0] == '\\' && path[1] == '\\';
+}
+
+static bool same_volume(const FileInfo* a, const FileInfo* b) {
+    if (a->links > 0 && b->links > 0) return a->id.volume == b->id.volume;
+    return same_root(a->path, b->path);
+}
+
+static bool same_file(const FileInfo* a, const FileInfo* b) {
+    return a->links > 0 && b->links > 0 &&
+           a->id.volume == b->id.volume && a->id.index == b->id.index;
+}
+
+// ============================================================================
+// MOVE DESTINATION VOLUME
+//
+// The volume of the destination folder, or of the nearest folder above
+// it that exists (the executor creates the rest). Compared with the scan
+// records' identities, this is what tells a rename from a copy where
+// paths carry no volume (POSIX mount points).
+// ============================================================================
+static bool destination_volume(const char* dest_folder, uint64_t* volume) {
+    char path[MAX_PATH_LENGTH];
+    FileIdentity id;
+    size_t len = strlen(dest_folder);
+    if (len == 0 || len >= sizeof(path)) return false;
+    memcpy(path, dest_folder, len + 1);
+
+    for (;;) {
+        if (get_file_identity(path, &id)) {
+            *volume = id.volume;
+            return true;
+        }
+        char* sep = strrchr(path, PATH_SEP);
+        if (!sep) {
+            if (strcmp(path, ".") == 0) return false;
+            strcpy(path, ".");          // Relative: the current folder
+        } else if (sep == path) {
+            if (path[1] == '\0') return false;
+            path[1] = '\0';             // Up to the root
+        } else {
+            *sep = '\0';
+        }
+    }
+}
+
+// ============================================================================
+// PATH FACTS BY VOLUME
+//
+// Whether a file is remote comes from its path; whether it is on the move
+// destination's volume from its identity, or else from its path's root.
+// Consecutive members are almost always on the same volume, so the
+// answer for the last volume serial is reused and the path (a separate
+// cache line, usually a separate page) is not read.
+// ============================================================================
+typedef struct {
+    uint64_t volume;
+    bool valid;
+    bool remote;
+    bool dest_root;          // Same volume as the move destination
+    bool dest_known;         // dest_volume is valid
+    uint64_t dest_volume;
+} VolumeMemo;
+
+static const VolumeMemo* volume_facts(VolumeMemo* memo, const FileInfo* file,
+                                      const char* dest_folder) {
+    if (memo->valid && file->links > 0 && memo->volume == file->id.volume) {
+        TELEMETRY_COUNT(TELEMETRY_CACHE_HITS, 1);
+        return memo;
+    }
+    TELEMETRY_COUNT(TELEMETRY_CACHE_MISSES, 1);
+
+    memo->valid = file->links > 0;
+    memo->volume = file->id.volume;
+    memo->remote = is_remote(file->path);
+    if (file->links > 0 && memo->dest_known) {
+        memo->dest_root = file->id.volume == memo->dest_volume;
+    } else {
+        memo->dest_root = dest_folder && same_root(file->path, dest_folder);
+    }
+    return memo;
+}
+
+// ============================================================================
+// MULTI-LINK FILES OF ONE GROUP
+//
+// Bytes freed by removing the collected names: one file size per
+// identity whose names were all collected.
+// ============================================================================
+typedef struct {
+    FileIdentity id;
+    uint32_t links;
+} LinkedName;
+
+static int compare_linked(const void* a, const void* b) {
+    const LinkedName* x = (const LinkedName*)a;
+    const LinkedName* y = (const LinkedName*)b;
+
+    if (x->id.volume != y->id.volume) return x->id.volume < y->id.volume ? -1 : 1;
+    if (x->id.index != y->id.index) return x->id.index < y->id.index ? -1 : 1;
+    return 0;
+}
+
+static long long linked_bytes_freed(LinkedName* names, int count, long long size) {
+    qsort(names, count, sizeof(LinkedName), compare_linked);
+
+    long long freed = 0;
+    for (int i = 0; i < count; ) {
+        int j = i + 1;
+        while (j < count && compare_linked(&names[i], &names[j]) == 0) j++;
+        if ((uint32_t)(j - i) >= names[i].links) freed += size;
+        i = j;
+    }
+    return freed;
+}
+
+// ============================================================================
+// ESTIMATE ACTION
+//
+// The same "keep member 0" plan action_plan_from_results builds, counted
+// instead of run. Metadata calls per file, as the executor issues them:
+//   Delete:           1 (DeleteFile)
+//   Link:             2 identity checks, +2 (link, rename) if not skipped
+//   Move, same volume: 1 rename; other volume: 3 (create, copy, delete)
+//                      and the bytes, plus 1 listing of the destination
+//
+// TIME: calls run ACTION_MAX_IN_FLIGHT at a time, each costing
+// PLAN_LOCAL_OP_MS or PLAN_REMOTE_OP_MS (UNC paths); copied bytes move at
+// PLAN_COPY_MB_PER_SEC in total.
+//
+// TIME COMPLEXITY: O(n) for n members, plus O(m log m) for the m members
+// that have more than one hard link
+// ============================================================================
+ActionEstimate estimate_action(const DuplicateResults* results, ActionKind kind,
+                               const char* dest_folder) {
+    ActionEstimate estimate;
+    memset(&estimate, 0, sizeof(estimate));
+    estimate.kind = kind;
+    if (!results || (kind == ACTION_MOVE && !dest_folder)) return estimate;
+
+    LinkedName* linked = NULL;
+    int linked_capacity = 0;
+    VolumeMemo memo = {0};
+    long long local_ops = 0, remote_ops = 0;
+
+    if (kind == ACTION_MOVE && results->count > 0) {
+        if (is_remote(dest_folder)) remote_ops++; else local_ops++;
+        memo.dest_known = destination_volume(dest_folder, &memo.dest_volume);
+    }
+
+    for (int g = 0; g < results->count; g++) {
+        const DuplicateGroup* group = &results->groups[g];
+        if (group->count < 2) continue;
+
+        const FileInfo* keep = group_file(results, group, 0);
+        int linked_count = 0;
+
+        for (int j = 1; j < group->count; j++) {
+            const FileInfo* file = group_file(results, group, j);
+            const VolumeMemo* facts = volume_facts(&memo, file, dest_folder);
+            int ops = 0;
+            bool frees = false;
+
+            estimate.files++;
+            if (file->links == 0) estimate.unknown_identity++;
+
+            switch (kind) {
+                case ACTION_DELETE:
+                case ACTION_QUARANTINE:
+                    ops = 1;
+                    frees = !same_file(file, keep);
+                    break;
+
+                case ACTION_HARD_LINK:
+                case ACTION_CLONE:
+                    ops = 2;
+                    if (!same_volume(file, keep)) {
+                        estimate.cross_volume++;
+                    } else if (!same_file(file, keep)) {
+                        ops += 2;
+                        frees = true;
+                    }
+                    break;
+
+                case ACTION_MOVE:
+                    if (facts->dest_root) {
+                        ops = 1;
+                    } else {
+                        ops = 3;
+                        estimate.cross_volume++;
+                        estimate.copy_bytes += file->size;
+                        frees = !same_file(file, keep);
+                    }
+                    break;
+            }
+
+            if (kind != ACTION_MOVE && same_file(file, keep)) estimate.already_linked++;
+
+            if (facts->remote) remote_ops += ops; else local_ops += ops;
+
+            if (!frees) continue;
+
+            if (file->links <= 1) {
+                estimate.reclaimable_bytes += group->size;
+            } else {
+                // Rare: collect, settle after the group
+                if (linked_count >= linked_capacity) {
+                    int new_capacity = linked_capacity ? linked_capacity * 2 : 64;
+                    LinkedName* grown = (LinkedName*)realloc(linked,
+                                                             new_capacity * sizeof(LinkedName));
+                    if (!grown) {
+                        // Out of memory: count it, as if it had one link
+                        estimate.reclaimable_bytes += group->size;
+                        continue;
+                    }
+                    linked = grown;
+                    linked_capacity = new_capacity;
+                }
+                linked[linked_count].id = file->id;
+                linked[linked_count].links = file->links;
+                linked_count++;
+            }
+        }
+
+        if (linked_count > 0) {
+            estimate.reclaimable_bytes += linked_bytes_freed(linked, linked_count, group->size);
+        }
+    }
+
+    free(linked);
+
+    estimate.metadata_ops = local_ops + remote_ops;
+    estimate.seconds = (local_ops * PLAN_LOCAL_OP_MS + remote_ops * PLAN_REMOTE_OP_MS) /
+                       ACTION_MAX_IN_FLIGHT / 1000.0 +
+                       (double)estimate.copy_bytes / (PLAN_COPY_MB_PER_SEC * 1024 * 1024);
+    return estimate;
+}
+
+// ============================================================================
+// FORMAT ESTIMATE (for dialogs and the status box)
+// ============================================================================
+void format_action_estimate(const ActionEstimate* estimate, char* buffer, size_t size) {
+    char freed[64], copied[64], eta[32];
+    format_file_size(estimate->reclaimable_bytes, freed, sizeof(freed));
+    format_file_size(estimate->copy_bytes, copied, sizeof(copied));
+
+    if (estimate->seconds < 60) {
+        snprintf(eta, sizeof(eta), "%.1f s", estimate->seconds);
+    } else if (estimate->seconds < 3600) {
+        snprintf(eta, sizeof(eta), "%.0f min", estimate->seconds / 60);
+    } else {
+        snprintf(eta, sizeof(eta), "%.1f h", estimate->seconds / 3600);
+    }
+
+    int len = snprintf(buffer, size,
+                       "%d files, frees %s, %lld file system calls, about %s",
+                       estimate->files, freed, estimate->metadata_ops, eta);
+
+    if (len > 0 && (size_t)len < size && estimate->kind == ACTION_MOVE &&
+        estimate->cross_volume > 0) {
+        len += snprintf(buffer + len, size - len, "\n%d files copied to another drive (%s)",
+                        estimate->cross_volume, copied);
+    }
+    if (len > 0 && (size_t)len < size &&
+        (estimate->kind == ACTION_HARD_LINK || estimate->kind == ACTION_CLONE) &&
+        estimate->cross_volume > 0) {
+        len += snprintf(buffer + len, size - len, "\n%d files on another drive are skipped",
+                        estimate->cross_volume);
+    }
+    if (len > 0 && (size_t)len < size && estimate->already_linked > 0) {
+        len += snprintf(buffer + len, size - len, "\n%d files are already links of the kept file",
+                        estimate->already_linked);
+    }
+}
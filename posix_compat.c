@@ -0,0 +1,1415 @@
+/*
+ * POSIX_COMPAT.C - The Win32 Subset the Engine Uses, on POSIX
+ *
+ * CONCEPTS DEMONSTRATED:
+ * 1. Adapter Layer (one interface, a second platform behind it)
+ * 2. Tagged Handles (one opaque type for files, listings, threads, events,
+ *    semaphores and processes; CloseHandle dispatches on the tag)
+ * 3. Monitor Objects (mutex + condition variable behind every waitable)
+ * 4. Reference Counting (a thread and its handle each hold a reference)
+ *
+ * Declarations and contracts are in posix_compat.h. Errors are mapped
+ * from errno to the Win32 codes the engine tests for, and kept per
+ * thread like GetLastError().
+ */
+
+#ifndef _WIN32
+
+#define _GNU_SOURCE    // renameat2, O_CLOEXEC
+#include "common.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <spawn.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/fs.h>   // FIDEDUPERANGE, FICLONERANGE
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/vfs.h>    // statfs: file system type
+#endif
+
+extern char** environ;
+
+#define COMPAT_COPY_BUFFER (1024 * 1024)
+#define EPOCH_DIFF 116444736000000000LL    // 1601 -> 1970 in 100 ns units
+
+// ============================================================================
+// ERRORS
+// ============================================================================
+static _Thread_local DWORD g_last_error = ERROR_SUCCESS;
+
+DWORD GetLastError(void) {
+    return g_last_error;
+}
+
+void SetLastError(DWORD error) {
+    g_last_error = error;
+}
+
+static DWORD error_from_errno(int error) {
+    switch (error) {
+        case 0:            return ERROR_SUCCESS;
+        case ENOENT:       return ERROR_FILE_NOT_FOUND;
+        case ENOTDIR:      return ERROR_PATH_NOT_FOUND;
+        case EACCES:
+        case EPERM:
+        case EISDIR:
+        case EROFS:        return ERROR_ACCESS_DENIED;
+        case EBADF:        return ERROR_INVALID_HANDLE;
+        case ENOMEM:       return ERROR_NOT_ENOUGH_MEMORY;
+        case EXDEV:        return ERROR_NOT_SAME_DEVICE;
+        case EBUSY:
+        case ETXTBSY:
+        case EWOULDBLOCK:  return ERROR_SHARING_VIOLATION;
+        case ENOTSUP:      return ERROR_NOT_SUPPORTED;
+        case EINVAL:       return ERROR_INVALID_PARAMETER;
+        case ENOSPC:       return ERROR_DISK_FULL;
+        case ENOTEMPTY:    return ERROR_DIR_NOT_EMPTY;
+        case EEXIST:       return ERROR_ALREADY_EXISTS;
+        case ENAMETOOLONG: return ERROR_FILENAME_EXCED_RANGE;
+        case EMLINK:       return ERROR_TOO_MANY_LINKS;
+        default:           return ERROR_GEN_FAILURE;
+    }
+}
+
+// RETURNS: FALSE, so callers can write return fail_errno();
+static BOOL fail_errno(void) {
+    SetLastError(error_from_errno(errno));
+    return FALSE;
+}
+
+static BOOL fail_with(DWORD error) {
+    SetLastError(error);
+    return FALSE;
+}
+
+// ============================================================================
+// HANDLES
+//
+// Every HANDLE points at one of these. Waitable kinds guard their state
+// with mutex and announce changes on cond.
+// ============================================================================
+typedef enum {
+    HANDLE_FILE,
+    HANDLE_FIND,
+    HANDLE_THREAD,
+    HANDLE_EVENT,
+    HANDLE_SEMAPHORE,
+    HANDLE_PROCESS
+} HandleKind;
+
+typedef struct {
+    HandleKind kind;
+
+    // File
+    int fd;
+    bool owned;                  // false: _get_osfhandle's view of a stream
+    char* path;                  // For FILE_DISPOSITION_INFO
+
+    // Find
+    DIR* dir;
+    char* pattern;
+
+    // Waitables
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool signaled;               // Event set, thread or process finished
+    bool manual_reset;
+    LONG count;                  // Semaphore
+    LONG maximum;
+    int references;              // Thread: the handle and the running thread
+    bool suspended;
+    LPTHREAD_START_ROUTINE start;
+    LPVOID param;
+    pid_t pid;
+    DWORD exit_code;
+} CompatHandle;
+
+static CompatHandle* new_handle(HandleKind kind) {
+    CompatHandle* h = (CompatHandle*)calloc(1, sizeof(CompatHandle));
+    if (!h) {
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return NULL;
+    }
+    h->kind = kind;
+    h->fd = -1;
+    if (kind != HANDLE_FILE && kind != HANDLE_FIND) {
+        pthread_mutex_init(&h->mutex, NULL);
+        pthread_cond_init(&h->cond, NULL);
+    }
+    return h;
+}
+
+static void free_waitable(CompatHandle* h) {
+    pthread_mutex_destroy(&h->mutex);
+    pthread_cond_destroy(&h->cond);
+    free(h);
+}
+
+static CompatHandle* as_kind(HANDLE handle, HandleKind kind) {
+    CompatHandle* h = (CompatHandle*)handle;
+    if (!h || handle == INVALID_HANDLE_VALUE || h->kind != kind) {
+        SetLastError(ERROR_INVALID_HANDLE);
+        return NULL;
+    }
+    return h;
+}
+
+// Drops one reference to a thread handle; the last one frees it
+static void release_thread(CompatHandle* h) {
+    pthread_mutex_lock(&h->mutex);
+    bool last = --h->references == 0;
+    pthread_mutex_unlock(&h->mutex);
+    if (last) free_waitable(h);
+}
+
+BOOL CloseHandle(HANDLE handle) {
+    CompatHandle* h = (CompatHandle*)handle;
+    if (!h || handle == INVALID_HANDLE_VALUE) return fail_with(ERROR_INVALID_HANDLE);
+
+    switch (h->kind) {
+        case HANDLE_FILE:
+            if (!h->owned) return TRUE;
+            close(h->fd);
+            free(h->path);
+            free(h);
+            break;
+        case HANDLE_FIND:
+            return FindClose(handle);
+        case HANDLE_THREAD:
+            release_thread(h);
+            break;
+        case HANDLE_PROCESS:
+            // A child nobody waited for is reaped when this process exits
+            free_waitable(h);
+            break;
+        default:
+            free_waitable(h);
+            break;
+    }
+    return TRUE;
+}
+
+// ============================================================================
+// TIMES AND ATTRIBUTES
+// ============================================================================
+static FILETIME filetime_from(time_t seconds, long nanoseconds) {
+    FILETIME ft;
+    long long ticks = (long long)seconds * 10000000LL + nanoseconds / 100 + EPOCH_DIFF;
+    ft.dwLowDateTime = (DWORD)ticks;
+    ft.dwHighDateTime = (DWORD)(ticks >> 32);
+    return ft;
+}
+
+static struct timespec timespec_from(const FILETIME* ft) {
+    long long ticks = (((long long)ft->dwHighDateTime << 32) | ft->dwLowDateTime) - EPOCH_DIFF;
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ticks / 10000000LL);
+    ts.tv_nsec = (long)(ticks % 10000000LL) * 100;
+    return ts;
+}
+
+// Attributes of what lstat saw; a symbolic link also takes its target's
+// directory bit, as a Windows directory link does
+static DWORD attributes_of(const struct stat* st, bool target_is_directory) {
+    DWORD attributes = 0;
+    if (S_ISDIR(st->st_mode) || target_is_directory) attributes |= FILE_ATTRIBUTE_DIRECTORY;
+    if (S_ISLNK(st->st_mode)) attributes |= FILE_ATTRIBUTE_REPARSE_POINT;
+    if (!(st->st_mode & S_IWUSR)) attributes |= FILE_ATTRIBUTE_READONLY;
+    return attributes ? attributes : FILE_ATTRIBUTE_NORMAL;
+}
+
+// lstat at dir_fd (AT_FDCWD for a plain path). A link reports size 0.
+static bool describe(int dir_fd, const char* name, WIN32_FILE_ATTRIBUTE_DATA* data) {
+    struct stat st;
+    if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) return false;
+
+    struct stat target;
+    bool target_is_directory = S_ISLNK(st.st_mode) && fstatat(dir_fd, name, &target, 0) == 0 &&
+                               S_ISDIR(target.st_mode);
+    long long size = S_ISREG(st.st_mode) ? (long long)st.st_size : 0;
+
+    data->dwFileAttributes = attributes_of(&st, target_is_directory);
+    data->ftCreationTime = filetime_from(st.st_ctime, 0);
+    data->ftLastAccessTime = filetime_from(st.st_atime, 0);
+    data->ftLastWriteTime = filetime_from(st.st_mtime, 0);
+    data->nFileSizeHigh = (DWORD)(size >> 32);
+    data->nFileSizeLow = (DWORD)size;
+    return true;
+}
+
+DWORD GetFileAttributesA(LPCSTR path) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!describe(AT_FDCWD, path, &data)) {
+        fail_errno();
+        return INVALID_FILE_ATTRIBUTES;
+    }
+    return data.dwFileAttributes;
+}
+
+BOOL GetFileAttributesExA(LPCSTR path, GET_FILEEX_INFO_LEVELS level, LPVOID info) {
+    if (level != GetFileExInfoStandard || !info) return fail_with(ERROR_INVALID_PARAMETER);
+    return describe(AT_FDCWD, path, (WIN32_FILE_ATTRIBUTE_DATA*)info) ? TRUE : fail_errno();
+}
+
+// ============================================================================
+// FILES
+// ============================================================================
+HANDLE CreateFileA(LPCSTR path, DWORD access, DWORD share, void* security,
+                   DWORD disposition, DWORD flags, HANDLE template_file) {
+    (void)security;
+    (void)template_file;
+
+    bool reads = (access & GENERIC_READ) != 0;
+    bool writes = (access & (GENERIC_WRITE | FILE_WRITE_DATA)) != 0;
+    bool appends = !writes && (access & FILE_APPEND_DATA) != 0;
+
+    int oflags = O_CLOEXEC;
+    if (writes || appends) {
+        oflags |= reads ? O_RDWR : O_WRONLY;
+    } else {
+        oflags |= O_RDONLY;      // Also for access 0 (attributes only)
+    }
+    if (appends) oflags |= O_APPEND;
+
+    switch (disposition) {
+        case CREATE_NEW:        oflags |= O_CREAT | O_EXCL; break;
+        case CREATE_ALWAYS:     oflags |= O_CREAT | O_TRUNC; break;
+        case OPEN_ALWAYS:       oflags |= O_CREAT; break;
+        case TRUNCATE_EXISTING: oflags |= O_TRUNC; break;
+        case OPEN_EXISTING:     break;
+        default:
+            SetLastError(ERROR_INVALID_PARAMETER);
+            return INVALID_HANDLE_VALUE;
+    }
+
+    int fd = open(path, oflags, 0666);
+#ifdef O_PATH
+    // Access 0 asks for no rights at all: enough to fstat an unreadable file
+    if (fd < 0 && errno == EACCES && access == 0) fd = open(path, O_PATH | O_CLOEXEC);
+#endif
+    if (fd < 0) {
+        // Windows reports an existing file for CREATE_NEW differently
+        DWORD error = errno == EEXIST ? ERROR_FILE_EXISTS : error_from_errno(errno);
+        SetLastError(error);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISDIR(st.st_mode) && !(flags & FILE_FLAG_BACKUP_SEMANTICS)) {
+        close(fd);
+        SetLastError(ERROR_ACCESS_DENIED);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    if (share == 0 && flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        DWORD error = errno == EWOULDBLOCK ? ERROR_SHARING_VIOLATION : error_from_errno(errno);
+        close(fd);
+        SetLastError(error);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    CompatHandle* h = new_handle(HANDLE_FILE);
+    char* saved = h ? strdup(path) : NULL;
+    if (!saved) {
+        free(h);
+        close(fd);
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return INVALID_HANDLE_VALUE;
+    }
+    h->fd = fd;
+    h->owned = true;
+    h->path = saved;
+    SetLastError(ERROR_SUCCESS);
+    return h;
+}
+
+intptr_t _get_osfhandle(int fd) {
+    static _Thread_local CompatHandle view;
+    if (fd < 0) return (intptr_t)INVALID_HANDLE_VALUE;
+
+    memset(&view, 0, sizeof(view));
+    view.kind = HANDLE_FILE;
+    view.fd = fd;
+    view.owned = false;
+    return (intptr_t)&view;
+}
+
+// Whole transfers: a short count only at end of file, as ReadFile
+BOOL ReadFile(HANDLE file, LPVOID buffer, DWORD size, LPDWORD read_count,
+              OVERLAPPED* overlapped) {
+    CompatHandle* h = as_kind(file, HANDLE_FILE);
+    if (read_count) *read_count = 0;
+    if (!h) return FALSE;
+    if (overlapped) return fail_with(ERROR_NOT_SUPPORTED);
+
+    DWORD total = 0;
+    while (total < size) {
+        ssize_t got = read(h->fd, (char*)buffer + total, size - total);
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0) return fail_errno();
+        if (got == 0) break;
+        total += (DWORD)got;
+    }
+    if (read_count) *read_count = total;
+    return TRUE;
+}
+
+BOOL WriteFile(HANDLE file, LPCVOID buffer, DWORD size, LPDWORD written,
+               OVERLAPPED* overlapped) {
+    CompatHandle* h = as_kind(file, HANDLE_FILE);
+    if (written) *written = 0;
+    if (!h) return FALSE;
+    if (overlapped) return fail_with(ERROR_NOT_SUPPORTED);
+
+    DWORD total = 0;
+    while (total < size) {
+        ssize_t put = write(h->fd, (const char*)buffer + total, size - total);
+        if (put < 0 && errno == EINTR) continue;
+        if (put < 0) {
+            if (written) *written = total;
+            return fail_errno();
+        }
+        total += (DWORD)put;
+    }
+    if (written) *written = total;
+    return TRUE;
+}
+
+BOOL SetFilePointerEx(HANDLE file, LARGE_INTEGER distance, LARGE_INTEGER* position,
+                      DWORD method) {
+    CompatHandle* h = as_kind(file, HANDLE_FILE);
+    if (!h) return FALSE;
+
+    int whence = method == FILE_BEGIN ? SEEK_SET : method == FILE_CURRENT ? SEEK_CUR : SEEK_END;
+    off_t at = lseek(h->fd, (off_t)distance.QuadPart, whence);
+    if (at < 0) return fail_errno();
+    if (position) position->QuadPart = at;
+    return TRUE;
+}
+
+BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER* size) {
+    CompatHandle* h = as_kind(file, HANDLE_FILE);
+    struct stat st;
+    if (!h) return FALSE;
+    if (fstat(h->fd, &st) != 0) return fail_errno();
+    size->QuadPart = st.st_size;
+    return TRUE;
+}
+
+// Cuts the file at its file pointer
+BOOL SetEndOfFile(HANDLE file) {
+    CompatHandle* h = as_kind(file, HANDLE_FILE);
+    if (!h) return FALSE;
+
+    off_t at = lseek(h->fd, 0, SEEK_CUR);
+    if (at < 0 || ftruncate(h->fd, at) != 0) return fail_errno();
+    return TRUE;
+}
+
+BOOL FlushFileBuffers(HANDLE file) {
+    CompatHandle* h = as_kind(file, HANDLE_FILE);
+    if (!h) return FALSE;
+    return fsync(h->fd) == 0 ? TRUE : fail_errno();
+}
+
+BOOL GetFileInformationByHandle(HANDLE file, BY_HANDLE_FILE_INFORMATION* info) {
+    CompatHandle* h = as_kind(file, HANDLE_FILE);
+    struct stat st;
+    if (!h) return FALSE;
+    if (fstat(h->fd, &st) != 0) return fail_errno();
+
+    uint64_t index = (uint64_t)st.st_ino;
+    long long size = (long long)st.st_size;
+    info->dwFileAttributes = attributes_of(&st, false);
+    info->ftCreationTime = filetime_from(st.st_ctime, 0);
+    info->ftLastAccessTime = filetime_from(st.st_atime, 0);
+    info->ftLastWriteTime = filetime_from(st.st_mtime, 0);
+    info->dwVolumeSerialNumber = (DWORD)st.st_dev;
+    info->nFileSizeHigh = (DWORD)(size >> 32);
+    info->nFileSizeLow = (DWORD)size;
+    info->nNumberOfLinks = (DWORD)st.st_nlink;
+    info->nFileIndexHigh = (DWORD)(index >> 32);
+    info->nFileIndexLow = (DWORD)index;
+    return TRUE;
+}
+
+BOOL SetFileTime(HANDLE file, const FILETIME* created, const FILETIME* accessed,
+                 const FILETIME* written) {
+    CompatHandle* h = as_kind(file, HANDLE_FILE);
+    (void)created;
+    if (!h) return FALSE;
+
+    struct timespec times[2];
+    times[0].tv_nsec = times[1].tv_nsec = UTIME_OMIT;
+    if (accessed) times[0] = timespec_from(accessed);
+    if (written) times[1] = timespec_from(written);
+    return futimens(h->fd, times) == 0 ? TRUE : fail_errno();
+}
+
+BOOL SetFileInformationByHandle(HANDLE file, FILE_INFO_BY_HANDLE_CLASS info_class,
+                                LPVOID info, DWORD size) {
+    CompatHandle* h = as_kind(file, HANDLE_FILE);
+    if (!h) return FALSE;
+    if (info_class != FileDispositionInfo || !info || size < sizeof(FILE_DISPOSITION_INFO) ||
+        !h->path) {
+        return fail_with(ERROR_NOT_SUPPORTED);
+    }
+    if (!((FILE_DISPOSITION_INFO*)info)->DeleteFile) return TRUE;
+    return unlink(h->path) == 0 ? TRUE : fail_errno();
+}
+
+#ifdef __linux__
+static bool no_such_ioctl(int error) {
+    return error == EOPNOTSUPP || error == ENOTTY || error == ENOSYS || error == EINVAL;
+}
+
+// FIDEDUPERANGE may share less than asked per call, so it loops; the
+// range is cut at the source's end (the caller rounds it up to a block)
+static BOOL share_extents(int target, const DUPLICATE_EXTENTS_DATA* extents) {
+    CompatHandle* source = as_kind(extents->FileHandle, HANDLE_FILE);
+    struct stat st;
+    if (!source) return FALSE;
+    if (fstat(source->fd, &st) != 0) return fail_errno();
+
+    long long offset = extents->SourceFileOffset.QuadPart;
+    long long target_offset = extents->TargetFileOffset.QuadPart;
+    long long end = offset + extents->ByteCount.QuadPart;
+    if (end > (long long)st.st_size) end = st.st_size;
+
+    // One range with one destination
+    uint64_t request[(sizeof(struct file_dedupe_range) +
+                      sizeof(struct file_dedupe_range_info)) / sizeof(uint64_t) + 1];
+    struct file_dedupe_range* range = (struct file_dedupe_range*)request;
+    struct file_dedupe_range_info* info = range->info;
+
+    while (offset < end) {
+        memset(request, 0, sizeof(request));
+        range->src_offset = (uint64_t)offset;
+        range->src_length = (uint64_t)(end - offset);
+        range->dest_count = 1;
+        info->dest_fd = target;
+        info->dest_offset = (uint64_t)target_offset;
+
+        if (ioctl(source->fd, FIDEDUPERANGE, range) != 0) {
+            if (!no_such_ioctl(errno)) return fail_errno();
+
+            // No dedupe here (NFS, CIFS): clone what the caller compared
+            struct file_clone_range clone;
+            clone.src_fd = source->fd;
+            clone.src_offset = (uint64_t)offset;
+            clone.src_length = (uint64_t)(end - offset);
+            clone.dest_offset = (uint64_t)target_offset;
+            if (ioctl(target, FICLONERANGE, &clone) == 0) return TRUE;
+            return no_such_ioctl(errno) ? fail_with(ERROR_NOT_SUPPORTED) : fail_errno();
+        }
+        if (info->status == FILE_DEDUPE_RANGE_DIFFERS) return fail_with(ERROR_INVALID_DATA);
+        if (info->status < 0) return fail_with(error_from_errno(-info->status));
+        if (info->bytes_deduped == 0) return fail_with(ERROR_GEN_FAILURE);
+
+        offset += (long long)info->bytes_deduped;
+        target_offset += (long long)info->bytes_deduped;
+    }
+    return TRUE;
+}
+#endif
+
+BOOL DeviceIoControl(HANDLE device, DWORD code, LPVOID in, DWORD in_size, LPVOID out,
+                     DWORD out_size, LPDWORD returned, OVERLAPPED* overlapped) {
+    (void)out; (void)out_size; (void)overlapped;
+    if (returned) *returned = 0;
+
+    CompatHandle* h = as_kind(device, HANDLE_FILE);
+    if (!h) return FALSE;
+    if (code == FSCTL_SET_SPARSE) return TRUE;
+#ifdef __linux__
+    if (code == FSCTL_DUPLICATE_EXTENTS_TO_FILE && in &&
+        in_size >= sizeof(DUPLICATE_EXTENTS_DATA)) {
+        return share_extents(h->fd, (const DUPLICATE_EXTENTS_DATA*)in);
+    }
+#else
+    (void)in; (void)in_size;
+#endif
+    return fail_with(ERROR_NOT_SUPPORTED);
+}
+
+// ============================================================================
+// DIRECTORY LISTING
+// ============================================================================
+static bool find_next_match(CompatHandle* h, WIN32_FIND_DATAA* data) {
+    struct dirent* entry;
+    errno = 0;
+    while ((entry = readdir(h->dir)) != NULL) {
+        if (fnmatch(h->pattern, entry->d_name, 0) != 0) continue;    // "*" takes dot files too
+        if (strlen(entry->d_name) >= sizeof(data->cFileName)) continue;
+
+        WIN32_FILE_ATTRIBUTE_DATA attributes;
+        if (!describe(dirfd(h->dir), entry->d_name, &attributes)) continue;  // Gone since
+
+        memset(data, 0, sizeof(WIN32_FIND_DATAA));
+        data->dwFileAttributes = attributes.dwFileAttributes;
+        data->ftCreationTime = attributes.ftCreationTime;
+        data->ftLastAccessTime = attributes.ftLastAccessTime;
+        data->ftLastWriteTime = attributes.ftLastWriteTime;
+        data->nFileSizeHigh = attributes.nFileSizeHigh;
+        data->nFileSizeLow = attributes.nFileSizeLow;
+        strcpy(data->cFileName, entry->d_name);
+        return true;
+    }
+    SetLastError(errno ? error_from_errno(errno) : ERROR_NO_MORE_FILES);
+    return false;
+}
+
+HANDLE FindFirstFileA(LPCSTR pattern, WIN32_FIND_DATAA* data) {
+    const char* slash = strrchr(pattern, '/');
+    char directory[MAX_PATH_LENGTH];
+    int len = slash ? (int)(slash - pattern) : 1;
+
+    if (len >= (int)sizeof(directory)) {
+        SetLastError(ERROR_FILENAME_EXCED_RANGE);
+        return INVALID_HANDLE_VALUE;
+    }
+    if (!slash) {
+        strcpy(directory, ".");
+    } else if (len == 0) {
+        strcpy(directory, "/");
+    } else {
+        memcpy(directory, pattern, len);
+        directory[len] = '\0';
+    }
+
+    CompatHandle* h = new_handle(HANDLE_FIND);
+    if (!h) return INVALID_HANDLE_VALUE;
+    h->pattern = strdup(slash ? slash + 1 : pattern);
+    h->dir = h->pattern ? opendir(directory) : NULL;
+    if (!h->dir) {
+        DWORD error = !h->pattern ? ERROR_NOT_ENOUGH_MEMORY
+                    : errno == ENOENT ? ERROR_PATH_NOT_FOUND : error_from_errno(errno);
+        free(h->pattern);
+        free(h);
+        SetLastError(error);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    if (!find_next_match(h, data)) {
+        DWORD error = GetLastError() == ERROR_NO_MORE_FILES ? ERROR_FILE_NOT_FOUND : GetLastError();
+        FindClose(h);
+        SetLastError(error);
+        return INVALID_HANDLE_VALUE;
+    }
+    return h;
+}
+
+BOOL FindNextFileA(HANDLE find, WIN32_FIND_DATAA* data) {
+    CompatHandle* h = as_kind(find, HANDLE_FIND);
+    if (!h) return FALSE;
+    return find_next_match(h, data) ? TRUE : FALSE;
+}
+
+BOOL FindClose(HANDLE find) {
+    CompatHandle* h = as_kind(find, HANDLE_FIND);
+    if (!h) return FALSE;
+    closedir(h->dir);
+    free(h->pattern);
+    free(h);
+    return TRUE;
+}
+
+// ============================================================================
+// NAMES AND DIRECTORIES
+// ============================================================================
+BOOL CreateDirectoryA(LPCSTR path, void* security) {
+    (void)security;
+    if (mkdir(path, 0777) == 0) return TRUE;
+    return errno == ENOENT ? fail_with(ERROR_PATH_NOT_FOUND) : fail_errno();
+}
+
+BOOL RemoveDirectoryA(LPCSTR path) {
+    return rmdir(path) == 0 ? TRUE : fail_errno();
+}
+
+BOOL DeleteFileA(LPCSTR path) {
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISDIR(st.st_mode)) return fail_with(ERROR_ACCESS_DENIED);
+    return unlink(path) == 0 ? TRUE : fail_errno();
+}
+
+int SHCreateDirectoryExA(HWND owner, LPCSTR path, const void* security) {
+    (void)owner;
+    (void)security;
+
+    char partial[MAX_PATH_LENGTH];
+    size_t len = strlen(path);
+    struct stat st;
+
+    if (len == 0) return ERROR_INVALID_PARAMETER;
+    if (len >= sizeof(partial)) return ERROR_FILENAME_EXCED_RANGE;
+    if (stat(path, &st) == 0) {
+        return S_ISDIR(st.st_mode) ? ERROR_ALREADY_EXISTS : ERROR_FILE_EXISTS;
+    }
+
+    // Each prefix ending before a separator, then the whole path
+    memcpy(partial, path, len + 1);
+    for (size_t i = 1; i <= len; i++) {
+        if (i < len && partial[i] != '/') continue;
+        char c = partial[i];
+        partial[i] = '\0';
+        if (mkdir(partial, 0777) != 0 && errno != EEXIST) {
+            return (int)error_from_errno(errno);
+        }
+        partial[i] = c;
+    }
+    return ERROR_SUCCESS;
+}
+
+BOOL CreateHardLinkA(LPCSTR link_path, LPCSTR existing, void* security) {
+    (void)security;
+    return link(existing, link_path) == 0 ? TRUE : fail_errno();
+}
+
+// Makes a rename or new name durable: fsync of the containing directory
+static void sync_parent(const char* path) {
+    char directory[MAX_PATH_LENGTH];
+    const char* slash = strrchr(path, '/');
+    int len = slash ? (int)(slash - path) : 1;
+
+    if (len >= (int)sizeof(directory)) return;
+    if (!slash) {
+        strcpy(directory, ".");
+    } else if (len == 0) {
+        strcpy(directory, "/");
+    } else {
+        memcpy(directory, path, len);
+        directory[len] = '\0';
+    }
+
+    int fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+// Copies source to copy from their current offsets to the end.
+// copy_file_range lets the file system share or copy blocks without the
+// data passing through user space; sendfile at least keeps it in the
+// kernel. Each stops where it is not supported (another file system,
+// an old kernel) and the next carries on from the same offsets; the
+// read/write loop finishes whatever is left, including any growth
+// since size was taken.
+// RETURNS: 0, or the errno that stopped the copy
+static int copy_contents(int source, int copy, off_t size) {
+    off_t left = size;
+
+#ifdef __linux__
+    while (left > 0) {
+        ssize_t put = copy_file_range(source, NULL, copy, NULL, (size_t)left, 0);
+        if (put < 0 && errno == EINTR) continue;
+        if (put < 0 && errno != EXDEV && errno != ENOSYS && errno != EINVAL &&
+            errno != EOPNOTSUPP) {
+            return errno;
+        }
+        if (put <= 0) break;
+        left -= put;
+    }
+    while (left > 0) {
+        ssize_t put = sendfile(copy, source, NULL, (size_t)left);
+        if (put < 0 && errno == EINTR) continue;
+        if (put < 0 && errno != ENOSYS && errno != EINVAL) return errno;
+        if (put <= 0) break;
+        left -= put;
+    }
+#else
+    (void)left;
+#endif
+
+    char* buffer = (char*)malloc(COMPAT_COPY_BUFFER);
+    if (!buffer) return ENOMEM;
+
+    int error = 0;
+    for (;;) {
+        ssize_t got = read(source, buffer, COMPAT_COPY_BUFFER);
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0) error = errno;
+        if (got <= 0) break;
+
+        ssize_t done = 0;
+        while (error == 0 && done < got) {
+            ssize_t put = write(copy, buffer + done, got - done);
+            if (put < 0 && errno == EINTR) continue;
+            if (put < 0) {
+                error = errno;
+            } else {
+                done += put;
+            }
+        }
+        if (error != 0) break;
+    }
+    free(buffer);
+    return error;
+}
+
+BOOL CopyFileA(LPCSTR existing, LPCSTR target, BOOL fail_if_exists) {
+    int source = open(existing, O_RDONLY | O_CLOEXEC);
+    if (source < 0) return fail_errno();
+
+    struct stat st;
+    if (fstat(source, &st) != 0) {
+        DWORD error = error_from_errno(errno);
+        close(source);
+        return fail_with(error);
+    }
+    if (S_ISDIR(st.st_mode)) {
+        close(source);
+        return fail_with(ERROR_ACCESS_DENIED);
+    }
+
+    int copy = open(target, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC |
+                    (fail_if_exists ? O_EXCL : 0), st.st_mode & 0777);
+    if (copy < 0) {
+        DWORD error = errno == EEXIST ? ERROR_FILE_EXISTS : error_from_errno(errno);
+        close(source);
+        return fail_with(error);
+    }
+
+    int error = copy_contents(source, copy, st.st_size);
+    bool ok = error == 0;
+
+    // CopyFile keeps the last write time
+    if (ok) {
+        struct timespec times[2];
+        times[0].tv_sec = st.st_atime;
+        times[1].tv_sec = st.st_mtime;
+        times[0].tv_nsec = times[1].tv_nsec = 0;
+        futimens(copy, times);
+    }
+    if (close(copy) != 0 && ok) {
+        error = errno;
+        ok = false;
+    }
+    close(source);
+
+    if (!ok) {
+        unlink(target);
+        return fail_with(error_from_errno(error));
+    }
+    return TRUE;
+}
+
+// Cross-volume moves copy through here; COPY_FILE_NO_BUFFERING is moot,
+// copy_contents keeps the data in the kernel where it can
+BOOL CopyFileExA(LPCSTR existing, LPCSTR target, LPPROGRESS_ROUTINE progress,
+                 LPVOID data, LPBOOL cancel, DWORD flags) {
+    (void)data;
+    if (progress || cancel) return fail_with(ERROR_NOT_SUPPORTED);
+    return CopyFileA(existing, target, (flags & COPY_FILE_FAIL_IF_EXISTS) != 0);
+}
+
+// rename() that fails with EEXIST instead of replacing target
+static int rename_no_replace(const char* existing, const char* target) {
+#if defined(__linux__) && defined(RENAME_NOREPLACE)
+    if (renameat2(AT_FDCWD, existing, AT_FDCWD, target, RENAME_NOREPLACE) == 0) return 0;
+    if (errno != EINVAL && errno != ENOSYS) return -1;
+#endif
+    // No atomic no-replace rename here: a second name, then drop the first
+    if (link(existing, target) != 0) return -1;
+    if (unlink(existing) != 0) {
+        int error = errno;
+        unlink(target);
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+BOOL MoveFileExA(LPCSTR existing, LPCSTR target, DWORD flags) {
+    bool replace = (flags & MOVEFILE_REPLACE_EXISTING) != 0;
+    int result = replace ? rename(existing, target) : rename_no_replace(existing, target);
+
+    if (result != 0 && errno == EXDEV) {
+        if (!(flags & MOVEFILE_COPY_ALLOWED)) return fail_with(ERROR_NOT_SAME_DEVICE);
+
+        // Another volume: copy, then remove the original (or the copy again)
+        if (!CopyFileA(existing, target, !replace)) return FALSE;
+        if (unlink(existing) != 0) {
+            DWORD error = error_from_errno(errno);
+            unlink(target);
+            return fail_with(error);
+        }
+        result = 0;
+    }
+    if (result != 0) return fail_errno();
+
+    if (flags & MOVEFILE_WRITE_THROUGH) sync_parent(target);
+    return TRUE;
+}
+
+// ============================================================================
+// VOLUMES
+// ============================================================================
+// Absolute form of path, resolved through the deepest ancestor that exists
+static bool resolve_existing(const char* path, char* resolved) {
+    char partial[MAX_PATH_LENGTH];
+    if (snprintf(partial, sizeof(partial), "%s", path) >= (int)sizeof(partial)) return false;
+
+    for (;;) {
+        if (realpath(partial[0] ? partial : ".", resolved)) return true;
+        char* slash = strrchr(partial, '/');
+        if (!slash) {
+            partial[0] = '\0';
+        } else if (slash == partial) {
+            partial[1] = '\0';
+        } else {
+            *slash = '\0';
+        }
+    }
+}
+
+BOOL GetVolumePathNameA(LPCSTR path, LPSTR root, DWORD size) {
+    char current[PATH_MAX];
+    struct stat st;
+
+    if (!resolve_existing(path, current) || stat(current, &st) != 0) return fail_errno();
+
+    // Climb while the parent is on the same device: the top is the mount point
+    while (strcmp(current, "/") != 0) {
+        char parent[PATH_MAX];
+        struct stat up;
+        char* slash = strrchr(current, '/');
+        int len = slash == current ? 1 : (int)(slash - current);
+
+        memcpy(parent, current, len);
+        parent[len] = '\0';
+        if (stat(parent, &up) != 0 || up.st_dev != st.st_dev) break;
+        strcpy(current, parent);
+    }
+
+    int written = snprintf(root, size, "%s%s", current, strcmp(current, "/") == 0 ? "" : "/");
+    if (written < 0 || (DWORD)written >= size) return fail_with(ERROR_FILENAME_EXCED_RANGE);
+    return TRUE;
+}
+
+BOOL GetVolumeInformationA(LPCSTR root, LPSTR name, DWORD name_size, LPDWORD serial,
+                           LPDWORD max_component, LPDWORD flags, LPSTR fs_name,
+                           DWORD fs_name_size) {
+    struct statvfs vfs;
+    struct stat st;
+    if (statvfs(root, &vfs) != 0 || stat(root, &st) != 0) return fail_errno();
+
+    DWORD features = FILE_SUPPORTS_HARD_LINKS;
+#ifdef __linux__
+    // FAT and exFAT have no hard links; btrfs, XFS (if made with reflink,
+    // else cloning fails with ERROR_NOT_SUPPORTED) and bcachefs share extents
+    struct statfs fs;
+    if (statfs(root, &fs) == 0) {
+        unsigned long type = (unsigned long)fs.f_type & 0xFFFFFFFFUL;
+        if (type == 0x4d44 || type == 0x2011BAB0) {
+            features = 0;
+        } else if (type == 0x9123683E || type == 0x58465342 || type == 0xCA451A4E) {
+            features |= FILE_SUPPORTS_BLOCK_REFCOUNTING;
+        }
+    }
+#endif
+
+    if (name && name_size > 0) name[0] = '\0';
+    if (fs_name && fs_name_size > 0) fs_name[0] = '\0';
+    if (serial) *serial = (DWORD)st.st_dev;
+    if (max_component) *max_component = (DWORD)vfs.f_namemax;
+    if (flags) *flags = features;
+    return TRUE;
+}
+
+BOOL GetDiskFreeSpaceA(LPCSTR root, LPDWORD sectors_per_cluster, LPDWORD bytes_per_sector,
+                       LPDWORD free_clusters, LPDWORD total_clusters) {
+    struct statvfs vfs;
+    if (statvfs(root, &vfs) != 0) return fail_errno();
+
+    unsigned long cluster = vfs.f_frsize ? vfs.f_frsize : vfs.f_bsize;
+    unsigned long long free_count = vfs.f_bavail;
+    unsigned long long total_count = vfs.f_blocks;
+
+    if (bytes_per_sector) *bytes_per_sector = 512;
+    if (sectors_per_cluster) *sectors_per_cluster = cluster >= 512 ? (DWORD)(cluster / 512) : 1;
+    if (free_clusters) *free_clusters = free_count > 0xFFFFFFFFULL ? 0xFFFFFFFF : (DWORD)free_count;
+    if (total_clusters) *total_clusters = total_count > 0xFFFFFFFFULL ? 0xFFFFFFFF : (DWORD)total_count;
+    return TRUE;
+}
+
+// ============================================================================
+// WAITING
+//
+// Caller holds h->mutex. Consumes the signal where Windows does: an
+// auto-reset event resets, a semaphore count drops.
+// ============================================================================
+static bool try_acquire(CompatHandle* h) {
+    switch (h->kind) {
+        case HANDLE_SEMAPHORE:
+            if (h->count == 0) return false;
+            h->count--;
+            return true;
+        case HANDLE_EVENT:
+            if (!h->signaled) return false;
+            if (!h->manual_reset) h->signaled = false;
+            return true;
+        default:
+            return h->signaled;
+    }
+}
+
+static struct timespec deadline_after(DWORD milliseconds) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += milliseconds / 1000;
+    ts.tv_nsec += (long)(milliseconds % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+// Processes have no condition to wait on: waitpid() instead
+static DWORD wait_process(CompatHandle* h, DWORD milliseconds) {
+    ULONGLONG start = GetTickCount64();
+
+    for (;;) {
+        pthread_mutex_lock(&h->mutex);
+        bool finished = h->signaled;
+        if (!finished) {
+            int status;
+            pid_t result = waitpid(h->pid, &status, milliseconds == INFINITE ? 0 : WNOHANG);
+            if (result == h->pid) {
+                h->exit_code = WIFEXITED(status) ? (DWORD)WEXITSTATUS(status) : 1;
+                h->signaled = finished = true;
+            } else if (result < 0 && errno != EINTR) {
+                pthread_mutex_unlock(&h->mutex);
+                return WAIT_FAILED;
+            }
+        }
+        pthread_mutex_unlock(&h->mutex);
+
+        if (finished) return WAIT_OBJECT_0;
+        if (milliseconds != INFINITE && GetTickCount64() - start >= milliseconds) return WAIT_TIMEOUT;
+        if (milliseconds != INFINITE) {
+            struct timespec pause = {0, 1000000L};
+            nanosleep(&pause, NULL);
+        }
+    }
+}
+
+DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds) {
+    CompatHandle* h = (CompatHandle*)handle;
+    if (!h || handle == INVALID_HANDLE_VALUE || h->kind == HANDLE_FILE || h->kind == HANDLE_FIND) {
+        SetLastError(ERROR_INVALID_HANDLE);
+        return WAIT_FAILED;
+    }
+    if (h->kind == HANDLE_PROCESS) return wait_process(h, milliseconds);
+
+    struct timespec deadline = deadline_after(milliseconds == INFINITE ? 0 : milliseconds);
+    DWORD result = WAIT_OBJECT_0;
+
+    pthread_mutex_lock(&h->mutex);
+    while (!try_acquire(h)) {
+        if (milliseconds == INFINITE) {
+            pthread_cond_wait(&h->cond, &h->mutex);
+        } else if (pthread_cond_timedwait(&h->cond, &h->mutex, &deadline) == ETIMEDOUT) {
+            result = try_acquire(h) ? WAIT_OBJECT_0 : WAIT_TIMEOUT;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&h->mutex);
+    return result;
+}
+
+// wait_all: each in turn, within the one time limit. Otherwise the
+// handles are polled until one is ready.
+DWORD WaitForMultipleObjects(DWORD count, const HANDLE* handles, BOOL wait_all,
+                             DWORD milliseconds) {
+    ULONGLONG start = GetTickCount64();
+
+    if (wait_all) {
+        for (DWORD i = 0; i < count; i++) {
+            DWORD left = INFINITE;
+            if (milliseconds != INFINITE) {
+                ULONGLONG spent = GetTickCount64() - start;
+                left = spent >= milliseconds ? 0 : (DWORD)(milliseconds - spent);
+            }
+            DWORD result = WaitForSingleObject(handles[i], left);
+            if (result != WAIT_OBJECT_0) return result;
+        }
+        return WAIT_OBJECT_0;
+    }
+
+    for (;;) {
+        for (DWORD i = 0; i < count; i++) {
+            DWORD result = WaitForSingleObject(handles[i], 0);
+            if (result != WAIT_TIMEOUT) return result == WAIT_OBJECT_0 ? WAIT_OBJECT_0 + i : result;
+        }
+        if (milliseconds != INFINITE && GetTickCount64() - start >= milliseconds) return WAIT_TIMEOUT;
+        struct timespec pause = {0, 1000000L};
+        nanosleep(&pause, NULL);
+    }
+}
+
+// ============================================================================
+// THREADS, EVENTS, SEMAPHORES
+// ============================================================================
+static void* thread_main(void* param) {
+    CompatHandle* h = (CompatHandle*)param;
+
+    pthread_mutex_lock(&h->mutex);
+    while (h->suspended) pthread_cond_wait(&h->cond, &h->mutex);
+    pthread_mutex_unlock(&h->mutex);
+
+    DWORD code = h->start(h->param);
+
+    pthread_mutex_lock(&h->mutex);
+    h->exit_code = code;
+    h->signaled = true;
+    pthread_cond_broadcast(&h->cond);
+    pthread_mutex_unlock(&h->mutex);
+
+    release_thread(h);
+    return NULL;
+}
+
+HANDLE CreateThread(void* security, size_t stack_size, LPTHREAD_START_ROUTINE start,
+                    LPVOID param, DWORD flags, LPDWORD thread_id) {
+    (void)security;
+
+    CompatHandle* h = new_handle(HANDLE_THREAD);
+    if (!h) return NULL;
+    h->start = start;
+    h->param = param;
+    h->suspended = (flags & CREATE_SUSPENDED) != 0;
+    h->references = 2;
+
+    pthread_attr_t attr;
+    pthread_t thread;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (stack_size > 0) pthread_attr_setstacksize(&attr, stack_size);
+    int error = pthread_create(&thread, &attr, thread_main, h);
+    pthread_attr_destroy(&attr);
+
+    if (error != 0) {
+        free_waitable(h);
+        SetLastError(error_from_errno(error));
+        return NULL;
+    }
+    if (thread_id) *thread_id = 0;
+    return h;
+}
+
+DWORD ResumeThread(HANDLE thread) {
+    CompatHandle* h = as_kind(thread, HANDLE_THREAD);
+    if (!h) return (DWORD)-1;
+
+    pthread_mutex_lock(&h->mutex);
+    DWORD previous = h->suspended ? 1 : 0;
+    h->suspended = false;
+    pthread_cond_broadcast(&h->cond);
+    pthread_mutex_unlock(&h->mutex);
+    return previous;
+}
+
+HANDLE CreateEventA(void* security, BOOL manual_reset, BOOL initial_state, LPCSTR name) {
+    (void)security;
+    if (name) {
+        SetLastError(ERROR_NOT_SUPPORTED);
+        return NULL;
+    }
+    CompatHandle* h = new_handle(HANDLE_EVENT);
+    if (!h) return NULL;
+    h->manual_reset = manual_reset != 0;
+    h->signaled = initial_state != 0;
+    return h;
+}
+
+BOOL SetEvent(HANDLE event) {
+    CompatHandle* h = as_kind(event, HANDLE_EVENT);
+    if (!h) return FALSE;
+
+    pthread_mutex_lock(&h->mutex);
+    h->signaled = true;
+    pthread_cond_broadcast(&h->cond);
+    pthread_mutex_unlock(&h->mutex);
+    return TRUE;
+}
+
+HANDLE CreateSemaphoreA(void* security, LONG initial_count, LONG maximum_count, LPCSTR name) {
+    (void)security;
+    if (name || maximum_count <= 0 || initial_count < 0 || initial_count > maximum_count) {
+        SetLastError(name ? ERROR_NOT_SUPPORTED : ERROR_INVALID_PARAMETER);
+        return NULL;
+    }
+    CompatHandle* h = new_handle(HANDLE_SEMAPHORE);
+    if (!h) return NULL;
+    h->count = initial_count;
+    h->maximum = maximum_count;
+    return h;
+}
+
+BOOL ReleaseSemaphore(HANDLE semaphore, LONG count, LONG* previous_count) {
+    CompatHandle* h = as_kind(semaphore, HANDLE_SEMAPHORE);
+    if (!h) return FALSE;
+    if (count <= 0) return fail_with(ERROR_INVALID_PARAMETER);
+
+    pthread_mutex_lock(&h->mutex);
+    bool ok = count <= h->maximum - h->count;
+    if (previous_count) *previous_count = h->count;
+    if (ok) {
+        h->count += count;
+        pthread_cond_broadcast(&h->cond);
+    }
+    pthread_mutex_unlock(&h->mutex);
+    return ok ? TRUE : fail_with(ERROR_TOO_MANY_POSTS);
+}
+
+void InitializeCriticalSection(CRITICAL_SECTION* section) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&section->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void EnterCriticalSection(CRITICAL_SECTION* section) {
+    pthread_mutex_lock(&section->mutex);
+}
+
+void LeaveCriticalSection(CRITICAL_SECTION* section) {
+    pthread_mutex_unlock(&section->mutex);
+}
+
+void DeleteCriticalSection(CRITICAL_SECTION* section) {
+    pthread_mutex_destroy(&section->mutex);
+}
+
+void InitializeConditionVariable(CONDITION_VARIABLE* condition) {
+    pthread_cond_init(&condition->cond, NULL);
+}
+
+BOOL SleepConditionVariableCS(CONDITION_VARIABLE* condition, CRITICAL_SECTION* section,
+                              DWORD milliseconds) {
+    if (milliseconds == INFINITE) {
+        return pthread_cond_wait(&condition->cond, &section->mutex) == 0;
+    }
+    struct timespec deadline = deadline_after(milliseconds);
+    int error = pthread_cond_timedwait(&condition->cond, &section->mutex, &deadline);
+    if (error == ETIMEDOUT) return fail_with(ERROR_TIMEOUT);
+    return error == 0;
+}
+
+void WakeAllConditionVariable(CONDITION_VARIABLE* condition) {
+    pthread_cond_broadcast(&condition->cond);
+}
+
+// ============================================================================
+// ONE-TIME INITIALIZATION AND THREAD-LOCAL SLOTS
+// ============================================================================
+static pthread_mutex_t g_once_lock = PTHREAD_MUTEX_INITIALIZER;
+
+BOOL InitOnceExecuteOnce(PINIT_ONCE once, PINIT_ONCE_FN fn, PVOID param, LPVOID* context) {
+    if (__atomic_load_n(&once->Ptr, __ATOMIC_ACQUIRE)) return TRUE;
+
+    pthread_mutex_lock(&g_once_lock);
+    BOOL ok = TRUE;
+    if (!once->Ptr) {
+        ok = fn(once, param, context);
+        if (ok) __atomic_store_n(&once->Ptr, (PVOID)1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&g_once_lock);
+    return ok;
+}
+
+DWORD FlsAlloc(PFLS_CALLBACK_FUNCTION callback) {
+    pthread_key_t key;
+    if (pthread_key_create(&key, callback) != 0) return FLS_OUT_OF_INDEXES;
+    return (DWORD)key;
+}
+
+PVOID FlsGetValue(DWORD index) {
+    return pthread_getspecific((pthread_key_t)index);
+}
+
+BOOL FlsSetValue(DWORD index, PVOID value) {
+    return pthread_setspecific((pthread_key_t)index, value) == 0;
+}
+
+// ============================================================================
+// PROCESSES
+// ============================================================================
+// Windows command-line rules: whitespace separates, double quotes group,
+// 2n backslashes + quote = n backslashes and a quote toggles,
+// 2n+1 backslashes + quote = n backslashes and a literal quote.
+// RETURNS: argv (one allocation, strings included) or NULL
+static char** split_command_line(const char* line) {
+    size_t len = strlen(line);
+    size_t max_args = len / 2 + 2;
+    char** argv = (char**)malloc(max_args * sizeof(char*) + len + 1);
+    if (!argv) return NULL;
+
+    char* out = (char*)(argv + max_args);
+    int argc = 0;
+    const char* p = line;
+
+    for (;;) {
+        while (*p == ' ' || *p == '\t') p++;
+        if (!*p) break;
+
+        argv[argc++] = out;
+        bool quoted = false;
+        while (*p && (quoted || (*p != ' ' && *p != '\t'))) {
+            int slashes = 0;
+            while (*p == '\\') {
+                slashes++;
+                p++;
+            }
+            if (*p == '"') {
+                for (int i = 0; i < slashes / 2; i++) *out++ = '\\';
+                if (slashes % 2) {
+                    *out++ = '"';
+                } else {
+                    quoted = !quoted;
+                }
+                p++;
+            } else {
+                for (int i = 0; i < slashes; i++) *out++ = '\\';
+                if (*p && (quoted || (*p != ' ' && *p != '\t'))) *out++ = *p++;
+            }
+        }
+        *out++ = '\0';
+    }
+    argv[argc] = NULL;
+    return argv;
+}
+
+BOOL CreateProcessA(LPCSTR application, LPSTR command_line, void* process_security,
+                    void* thread_security, BOOL inherit_handles, DWORD flags,
+                    LPVOID environment, LPCSTR directory, STARTUPINFOA* startup,
+                    PROCESS_INFORMATION* info) {
+    (void)process_security; (void)thread_security; (void)inherit_handles;
+    (void)flags; (void)startup;
+    if (environment || directory || !command_line) return fail_with(ERROR_NOT_SUPPORTED);
+
+    char** argv = split_command_line(command_line);
+    if (!argv) return fail_with(ERROR_NOT_ENOUGH_MEMORY);
+    if (!argv[0]) {
+        free(argv);
+        return fail_with(ERROR_INVALID_PARAMETER);
+    }
+
+    CompatHandle* h = new_handle(HANDLE_PROCESS);
+    if (!h) {
+        free(argv);
+        return FALSE;
+    }
+
+    pid_t pid;
+    int error = posix_spawnp(&pid, application ? application : argv[0], NULL, NULL,
+                             argv, environ);
+    free(argv);
+    if (error != 0) {
+        free_waitable(h);
+        return fail_with(error == ENOENT ? ERROR_FILE_NOT_FOUND : error_from_errno(error));
+    }
+
+    h->pid = pid;
+    info->hProcess = h;
+    info->hThread = NULL;
+    info->dwProcessId = (DWORD)pid;
+    info->dwThreadId = 0;
+    return TRUE;
+}
+
+BOOL GetExitCodeProcess(HANDLE process, LPDWORD code) {
+    CompatHandle* h = as_kind(process, HANDLE_PROCESS);
+    if (!h) return FALSE;
+
+    if (wait_process(h, 0) == WAIT_FAILED) return fail_errno();
+    pthread_mutex_lock(&h->mutex);
+    *code = h->signaled ? h->exit_code : STILL_ACTIVE;
+    pthread_mutex_unlock(&h->mutex);
+    return TRUE;
+}
+
+DWORD GetModuleFileNameA(HMODULE module, LPSTR path, DWORD size) {
+    if (module || size == 0) return (DWORD)fail_with(ERROR_INVALID_PARAMETER);
+#ifdef __linux__
+    ssize_t len = readlink("/proc/self/exe", path, size);
+    if (len < 0) return (DWORD)fail_errno();
+    if ((DWORD)len >= size) {
+        path[size - 1] = '\0';
+        return (DWORD)fail_with(ERROR_FILENAME_EXCED_RANGE);
+    }
+    path[len] = '\0';
+    return (DWORD)len;
+#else
+    path[0] = '\0';
+    return (DWORD)fail_with(ERROR_NOT_SUPPORTED);
+#endif
+}
+
+DWORD GetCurrentProcessId(void) {
+    return (DWORD)getpid();
+}
+
+// ============================================================================
+// CLOCKS AND SYSTEM
+// ============================================================================
+ULONGLONG GetTickCount64(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ULONGLONG)ts.tv_sec * 1000 + (ULONGLONG)ts.tv_nsec / 1000000;
+}
+
+DWORD GetTickCount(void) {
+    return (DWORD)GetTickCount64();
+}
+
+BOOL QueryPerformanceCounter(LARGE_INTEGER* count) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    count->QuadPart = (LONGLONG)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    return TRUE;
+}
+
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* frequency) {
+    frequency->QuadPart = 1000000000LL;
+    return TRUE;
+}
+
+void GetSystemTimeAsFileTime(FILETIME* time) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    *time = filetime_from(ts.tv_sec, ts.tv_nsec);
+}
+
+void GetSystemInfo(SYSTEM_INFO* info) {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    long page = sysconf(_SC_PAGESIZE);
+    info->dwNumberOfProcessors = processors > 0 ? (DWORD)processors : 1;
+    info->dwPageSize = page > 0 ? (DWORD)page : 4096;
+}
+
+// ============================================================================
+// C RUNTIME
+// ============================================================================
+void* _aligned_malloc(size_t size, size_t alignment) {
+    void* block = NULL;
+    return posix_memalign(&block, alignment, size) == 0 ? block : NULL;
+}
+
+void _aligned_free(void* block) {
+    free(block);
+}
+
+#endif // !_WIN32
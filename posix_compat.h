@@ -0,0 +1,431 @@
+/*
+ * POSIX_COMPAT.H - The Win32 Subset the Engine Uses, on POSIX
+ *
+ * common.h includes this instead of <windows.h> when _WIN32 is not
+ * defined, so the engine and the command-line driver (cli.c) build on
+ * Linux unchanged. Only what those files call is declared here, with the
+ * Win32 contract they rely on: return values, GetLastError() codes and
+ * handle lifetimes. The GUI (gui_win32.c), the change watcher (watch.c)
+ * and the benchmarks stay Windows-only.
+ *
+ * Implemented in posix_compat.c. Where POSIX has no equivalent, the note
+ * on the declaration says what happens instead.
+ */
+
+#ifndef POSIX_COMPAT_H
+#define POSIX_COMPAT_H
+
+#include <pthread.h>
+#include <strings.h>    // strcasecmp, strncasecmp
+
+// ============================================================================
+// TYPES (Win32 sizes: DWORD and LONG are 32 bits on every platform)
+// ============================================================================
+typedef int BOOL;
+typedef uint8_t BYTE;
+typedef uint8_t BOOLEAN;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef unsigned int UINT;
+typedef int64_t LONG64;
+typedef int64_t LONGLONG;
+typedef uint64_t ULONGLONG;
+typedef uintptr_t ULONG_PTR;
+typedef uintptr_t DWORD_PTR;
+typedef void VOID;
+typedef void* PVOID;
+typedef void* LPVOID;
+typedef const void* LPCVOID;
+typedef char* LPSTR;
+typedef const char* LPCSTR;
+typedef DWORD* LPDWORD;
+typedef BOOL* LPBOOL;
+typedef void* HANDLE;
+typedef void* HMODULE;
+typedef void* HWND;
+
+#define WINAPI
+#define CALLBACK
+#define TRUE 1
+#define FALSE 0
+#define MAX_PATH 260
+#define DECLSPEC_ALIGN(x) __attribute__((aligned(x)))
+
+typedef struct {
+    DWORD dwLowDateTime;
+    DWORD dwHighDateTime;
+} FILETIME;
+
+typedef union {
+    struct {
+        DWORD LowPart;
+        LONG HighPart;
+    };
+    LONGLONG QuadPart;
+} LARGE_INTEGER;
+
+typedef union {
+    struct {
+        DWORD LowPart;
+        DWORD HighPart;
+    };
+    ULONGLONG QuadPart;
+} ULARGE_INTEGER;
+
+// Synchronous I/O only: every OVERLAPPED* argument must be NULL
+typedef struct {
+    ULONG_PTR Internal;
+    ULONG_PTR InternalHigh;
+    DWORD Offset;
+    DWORD OffsetHigh;
+    HANDLE hEvent;
+} OVERLAPPED;
+
+// ============================================================================
+// ERROR CODES (GetLastError)
+// ============================================================================
+#define ERROR_SUCCESS 0
+#define ERROR_INVALID_FUNCTION 1
+#define ERROR_FILE_NOT_FOUND 2
+#define ERROR_PATH_NOT_FOUND 3
+#define ERROR_ACCESS_DENIED 5
+#define ERROR_INVALID_HANDLE 6
+#define ERROR_NOT_ENOUGH_MEMORY 8
+#define ERROR_INVALID_DATA 13
+#define ERROR_NOT_SAME_DEVICE 17
+#define ERROR_NO_MORE_FILES 18
+#define ERROR_WRITE_FAULT 29
+#define ERROR_GEN_FAILURE 31
+#define ERROR_SHARING_VIOLATION 32
+#define ERROR_NOT_SUPPORTED 50
+#define ERROR_FILE_EXISTS 80
+#define ERROR_INVALID_PARAMETER 87
+#define ERROR_DISK_FULL 112
+#define ERROR_DIR_NOT_EMPTY 145
+#define ERROR_ALREADY_EXISTS 183
+#define ERROR_FILENAME_EXCED_RANGE 206
+#define ERROR_TOO_MANY_POSTS 298
+#define ERROR_TOO_MANY_LINKS 1142
+#define ERROR_TIMEOUT 1460
+
+DWORD GetLastError(void);
+void SetLastError(DWORD error);
+
+// ============================================================================
+// FILES
+//
+// A file HANDLE owns a file descriptor. Share mode 0 takes an advisory
+// flock(), so two processes opening the same file exclusively (the
+// action journal) fail with ERROR_SHARING_VIOLATION as on Windows; the
+// other share modes are not enforced.
+// ============================================================================
+#define INVALID_HANDLE_VALUE ((HANDLE)(intptr_t)-1)
+#define INVALID_FILE_ATTRIBUTES ((DWORD)-1)
+
+#define GENERIC_READ 0x80000000
+#define GENERIC_WRITE 0x40000000
+#define DELETE 0x00010000
+#define FILE_WRITE_DATA 0x0002
+#define FILE_APPEND_DATA 0x0004
+#define FILE_WRITE_ATTRIBUTES 0x0100
+
+#define FILE_SHARE_READ 0x1
+#define FILE_SHARE_WRITE 0x2
+#define FILE_SHARE_DELETE 0x4
+
+#define CREATE_NEW 1
+#define CREATE_ALWAYS 2
+#define OPEN_EXISTING 3
+#define OPEN_ALWAYS 4
+#define TRUNCATE_EXISTING 5
+
+#define FILE_ATTRIBUTE_READONLY 0x0001
+#define FILE_ATTRIBUTE_DIRECTORY 0x0010
+#define FILE_ATTRIBUTE_NORMAL 0x0080
+#define FILE_ATTRIBUTE_SPARSE_FILE 0x0200
+#define FILE_ATTRIBUTE_REPARSE_POINT 0x0400    // Symbolic link
+
+#define FILE_FLAG_BACKUP_SEMANTICS 0x02000000  // Needed to open a directory
+#define FILE_FLAG_SEQUENTIAL_SCAN 0x08000000   // Hint, ignored
+
+#define FILE_BEGIN 0
+#define FILE_CURRENT 1
+#define FILE_END 2
+
+typedef struct {
+    DWORD dwFileAttributes;
+    FILETIME ftCreationTime;
+    FILETIME ftLastAccessTime;
+    FILETIME ftLastWriteTime;
+    DWORD dwVolumeSerialNumber;   // st_dev
+    DWORD nFileSizeHigh;
+    DWORD nFileSizeLow;
+    DWORD nNumberOfLinks;
+    DWORD nFileIndexHigh;         // st_ino
+    DWORD nFileIndexLow;
+} BY_HANDLE_FILE_INFORMATION;
+
+typedef struct {
+    BOOLEAN DeleteFile;
+} FILE_DISPOSITION_INFO;
+
+typedef enum {
+    FileDispositionInfo = 4       // The only class supported
+} FILE_INFO_BY_HANDLE_CLASS;
+
+HANDLE CreateFileA(LPCSTR path, DWORD access, DWORD share, void* security,
+                   DWORD disposition, DWORD flags, HANDLE template_file);
+BOOL ReadFile(HANDLE file, LPVOID buffer, DWORD size, LPDWORD read, OVERLAPPED* overlapped);
+BOOL WriteFile(HANDLE file, LPCVOID buffer, DWORD size, LPDWORD written,
+               OVERLAPPED* overlapped);
+BOOL SetFilePointerEx(HANDLE file, LARGE_INTEGER distance, LARGE_INTEGER* position,
+                      DWORD method);
+BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER* size);
+BOOL SetEndOfFile(HANDLE file);
+BOOL FlushFileBuffers(HANDLE file);
+BOOL GetFileInformationByHandle(HANDLE file, BY_HANDLE_FILE_INFORMATION* info);
+// Creation time is ignored: POSIX files have none to set
+BOOL SetFileTime(HANDLE file, const FILETIME* created, const FILETIME* accessed,
+                 const FILETIME* written);
+// Unlinks the name at once, not when the handle closes
+BOOL SetFileInformationByHandle(HANDLE file, FILE_INFO_BY_HANDLE_CLASS info_class,
+                                LPVOID info, DWORD size);
+// FSCTL_DUPLICATE_EXTENTS_TO_FILE shares extents through FIDEDUPERANGE
+// (which compares the ranges itself: ERROR_INVALID_DATA if they differ),
+// or FICLONERANGE where the file system has no dedupe; FSCTL_SET_SPARSE
+// does nothing (any file can be sparse). Anything else, or another
+// platform: ERROR_NOT_SUPPORTED
+BOOL DeviceIoControl(HANDLE device, DWORD code, LPVOID in, DWORD in_size, LPVOID out,
+                     DWORD out_size, LPDWORD returned, OVERLAPPED* overlapped);
+BOOL CloseHandle(HANDLE handle);
+
+// The CRT's view of a FILE*: a handle that the stream keeps owning
+intptr_t _get_osfhandle(int fd);
+#define _fileno fileno
+
+// ============================================================================
+// NAMES AND DIRECTORIES
+// ============================================================================
+#define MOVEFILE_REPLACE_EXISTING 0x1
+#define MOVEFILE_COPY_ALLOWED 0x2
+#define MOVEFILE_WRITE_THROUGH 0x8     // fsync() the destination directory
+
+#define COPY_FILE_FAIL_IF_EXISTS 0x1
+#define COPY_FILE_NO_BUFFERING 0x1000  // Hint, ignored
+
+#define FILE_SUPPORTS_HARD_LINKS 0x00400000
+#define FILE_SUPPORTS_BLOCK_REFCOUNTING 0x08000000    // btrfs, XFS, bcachefs
+#define FSCTL_SET_SPARSE 0x000900c4
+#define FSCTL_DUPLICATE_EXTENTS_TO_FILE 0x00098344
+
+typedef struct {
+    HANDLE FileHandle;               // Source, open for reading
+    LARGE_INTEGER SourceFileOffset;
+    LARGE_INTEGER TargetFileOffset;
+    LARGE_INTEGER ByteCount;         // May run past the source's end
+} DUPLICATE_EXTENTS_DATA;
+
+typedef struct {
+    DWORD dwFileAttributes;
+    FILETIME ftCreationTime;
+    FILETIME ftLastAccessTime;
+    FILETIME ftLastWriteTime;
+    DWORD nFileSizeHigh;
+    DWORD nFileSizeLow;
+    DWORD dwReserved0;
+    DWORD dwReserved1;
+    char cFileName[MAX_PATH];
+    char cAlternateFileName[14];
+} WIN32_FIND_DATAA;
+
+typedef struct {
+    DWORD dwFileAttributes;
+    FILETIME ftCreationTime;
+    FILETIME ftLastAccessTime;
+    FILETIME ftLastWriteTime;
+    DWORD nFileSizeHigh;
+    DWORD nFileSizeLow;
+} WIN32_FILE_ATTRIBUTE_DATA;
+
+typedef enum {
+    GetFileExInfoStandard
+} GET_FILEEX_INFO_LEVELS;
+
+typedef DWORD (WINAPI *LPPROGRESS_ROUTINE)(LARGE_INTEGER, LARGE_INTEGER, LARGE_INTEGER,
+                                           LARGE_INTEGER, DWORD, DWORD, HANDLE, HANDLE,
+                                           LPVOID);
+
+// pattern is "<directory>/<glob>"; "." and ".." are listed, as on Windows
+HANDLE FindFirstFileA(LPCSTR pattern, WIN32_FIND_DATAA* data);
+BOOL FindNextFileA(HANDLE find, WIN32_FIND_DATAA* data);
+BOOL FindClose(HANDLE find);
+
+DWORD GetFileAttributesA(LPCSTR path);
+BOOL GetFileAttributesExA(LPCSTR path, GET_FILEEX_INFO_LEVELS level, LPVOID info);
+BOOL CreateDirectoryA(LPCSTR path, void* security);
+BOOL RemoveDirectoryA(LPCSTR path);
+BOOL DeleteFileA(LPCSTR path);
+BOOL MoveFileExA(LPCSTR existing, LPCSTR target, DWORD flags);
+BOOL CopyFileA(LPCSTR existing, LPCSTR target, BOOL fail_if_exists);
+// progress and cancel must be NULL
+BOOL CopyFileExA(LPCSTR existing, LPCSTR target, LPPROGRESS_ROUTINE progress,
+                 LPVOID data, LPBOOL cancel, DWORD flags);
+BOOL CreateHardLinkA(LPCSTR link, LPCSTR existing, void* security);
+// Creates every missing parent; returns an error code, not a BOOL
+int SHCreateDirectoryExA(HWND owner, LPCSTR path, const void* security);
+
+// Volume = mount point: "/" or "/mnt/data/"
+BOOL GetVolumePathNameA(LPCSTR path, LPSTR root, DWORD size);
+BOOL GetVolumeInformationA(LPCSTR root, LPSTR name, DWORD name_size, LPDWORD serial,
+                           LPDWORD max_component, LPDWORD flags, LPSTR fs_name,
+                           DWORD fs_name_size);
+BOOL GetDiskFreeSpaceA(LPCSTR root, LPDWORD sectors_per_cluster, LPDWORD bytes_per_sector,
+                       LPDWORD free_clusters, LPDWORD total_clusters);
+
+// ============================================================================
+// THREADS AND SYNCHRONIZATION
+//
+// Thread, event, semaphore and process handles can all be waited on.
+// Critical sections are recursive mutexes, as on Windows.
+// ============================================================================
+#define INFINITE 0xFFFFFFFF
+#define WAIT_OBJECT_0 0
+#define WAIT_TIMEOUT 258
+#define WAIT_FAILED ((DWORD)0xFFFFFFFF)
+#define CREATE_SUSPENDED 0x4
+#define STILL_ACTIVE 259
+
+typedef DWORD (WINAPI *LPTHREAD_START_ROUTINE)(LPVOID);
+
+typedef struct {
+    pthread_mutex_t mutex;
+} CRITICAL_SECTION;
+
+typedef struct {
+    pthread_cond_t cond;
+} CONDITION_VARIABLE;
+
+typedef struct {
+    DWORD dwNumberOfProcessors;
+    DWORD dwPageSize;
+} SYSTEM_INFO;
+
+HANDLE CreateThread(void* security, size_t stack_size, LPTHREAD_START_ROUTINE start,
+                    LPVOID param, DWORD flags, LPDWORD thread_id);
+DWORD ResumeThread(HANDLE thread);
+HANDLE CreateEventA(void* security, BOOL manual_reset, BOOL initial_state, LPCSTR name);
+BOOL SetEvent(HANDLE event);
+HANDLE CreateSemaphoreA(void* security, LONG initial_count, LONG maximum_count, LPCSTR name);
+BOOL ReleaseSemaphore(HANDLE semaphore, LONG count, LONG* previous_count);
+DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds);
+DWORD WaitForMultipleObjects(DWORD count, const HANDLE* handles, BOOL wait_all,
+                             DWORD milliseconds);
+
+void InitializeCriticalSection(CRITICAL_SECTION* section);
+void EnterCriticalSection(CRITICAL_SECTION* section);
+void LeaveCriticalSection(CRITICAL_SECTION* section);
+void DeleteCriticalSection(CRITICAL_SECTION* section);
+
+void InitializeConditionVariable(CONDITION_VARIABLE* condition);
+BOOL SleepConditionVariableCS(CONDITION_VARIABLE* condition, CRITICAL_SECTION* section,
+                              DWORD milliseconds);
+void WakeAllConditionVariable(CONDITION_VARIABLE* condition);
+
+// One-time initialization
+typedef union {
+    PVOID Ptr;
+} INIT_ONCE, *PINIT_ONCE;
+#define INIT_ONCE_STATIC_INIT {0}
+typedef BOOL (CALLBACK *PINIT_ONCE_FN)(PINIT_ONCE, PVOID, PVOID*);
+BOOL InitOnceExecuteOnce(PINIT_ONCE once, PINIT_ONCE_FN fn, PVOID param, LPVOID* context);
+
+// Fiber-local storage = thread-specific data (pthread keys); the
+// callback runs when a thread with a non-NULL value exits
+#define FLS_OUT_OF_INDEXES ((DWORD)0xFFFFFFFF)
+typedef VOID (WINAPI *PFLS_CALLBACK_FUNCTION)(PVOID);
+DWORD FlsAlloc(PFLS_CALLBACK_FUNCTION callback);
+PVOID FlsGetValue(DWORD index);
+BOOL FlsSetValue(DWORD index, PVOID value);
+
+static inline LONG InterlockedIncrement(volatile LONG* target) {
+    return __atomic_add_fetch(target, 1, __ATOMIC_SEQ_CST);
+}
+static inline LONG InterlockedExchange(volatile LONG* target, LONG value) {
+    return __atomic_exchange_n(target, value, __ATOMIC_SEQ_CST);
+}
+static inline LONG InterlockedCompareExchange(volatile LONG* target, LONG value,
+                                              LONG comparand) {
+    __atomic_compare_exchange_n(target, &comparand, value, false,
+                                __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return comparand;
+}
+static inline LONG64 InterlockedIncrement64(volatile LONG64* target) {
+    return __atomic_add_fetch(target, 1, __ATOMIC_SEQ_CST);
+}
+static inline LONG64 InterlockedExchangeAdd64(volatile LONG64* target, LONG64 value) {
+    return __atomic_fetch_add(target, value, __ATOMIC_SEQ_CST);
+}
+static inline LONG64 InterlockedExchange64(volatile LONG64* target, LONG64 value) {
+    return __atomic_exchange_n(target, value, __ATOMIC_SEQ_CST);
+}
+static inline LONG64 InterlockedCompareExchange64(volatile LONG64* target, LONG64 value,
+                                                  LONG64 comparand) {
+    __atomic_compare_exchange_n(target, &comparand, value, false,
+                                __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return comparand;
+}
+static inline PVOID InterlockedCompareExchangePointer(PVOID volatile* target, PVOID value,
+                                                      PVOID comparand) {
+    __atomic_compare_exchange_n(target, &comparand, value, false,
+                                __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return comparand;
+}
+
+// ============================================================================
+// PROCESSES, CLOCKS, SYSTEM
+// ============================================================================
+typedef struct {
+    DWORD cb;
+} STARTUPINFOA;
+
+typedef struct {
+    HANDLE hProcess;
+    HANDLE hThread;            // Always NULL
+    DWORD dwProcessId;
+    DWORD dwThreadId;
+} PROCESS_INFORMATION;
+
+// command_line is split by the Windows rules (double quotes group, \"
+// is a quote); its first word is the program. Handles are not inherited.
+BOOL CreateProcessA(LPCSTR application, LPSTR command_line, void* process_security,
+                    void* thread_security, BOOL inherit_handles, DWORD flags,
+                    LPVOID environment, LPCSTR directory, STARTUPINFOA* startup,
+                    PROCESS_INFORMATION* info);
+BOOL GetExitCodeProcess(HANDLE process, LPDWORD code);
+// Linux only (/proc/self/exe); returns 0 elsewhere
+DWORD GetModuleFileNameA(HMODULE module, LPSTR path, DWORD size);
+DWORD GetCurrentProcessId(void);
+
+DWORD GetTickCount(void);
+ULONGLONG GetTickCount64(void);
+BOOL QueryPerformanceCounter(LARGE_INTEGER* count);
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* frequency);
+void GetSystemTimeAsFileTime(FILETIME* time);
+void GetSystemInfo(SYSTEM_INFO* info);
+
+// common.h numbers its GUI messages from here
+#define WM_USER 0x0400
+
+// ============================================================================
+// C RUNTIME NAMES
+// ============================================================================
+#define _strdup strdup
+#define _stricmp strcasecmp
+#define _strnicmp strncasecmp
+
+void* _aligned_malloc(size_t size, size_t alignment);
+void _aligned_free(void* block);
+
+#endif // POSIX_COMPAT_H
@@ -0,0 +1,893 @@
+/*
+ * QUARANTINE.C - Content-Addressed Quarantine Store
+ *
+ * DSA CONCEPTS DEMONSTRATED:
+ * 1. Content Addressing (an object's name is its digest: equal contents
+ *    are stored once, however many files had them)
+ * 2. Fan-Out Directories (objects spread over 256 folders by hash prefix,
+ *    so no folder grows huge)
+ * 3. Mark and Sweep (after a restore, objects no manifest entry refers
+ *    to any more are deleted)
+ * 4. Verify-then-Commit under a Lock (a file is hashed through a
+ *    deny-write handle and deleted through that same handle)
+ *
+ * PROBLEM: "Move to Folder" stores the N-1 duplicates of a group as N-1
+ * full files again - quarantining 10 copies of a 1 GB file takes 9 GB.
+ *
+ * SOLUTION: Quarantine keeps member 0 in place and takes the others out,
+ * but writes their content into the store only once per digest. What
+ * grows with the number of files is the manifest: one line per file.
+ *
+ * STORE LAYOUT:
+ *   <store>\objects\ab\abcdef0123456789-1f400   contents, named
+ *                                               "<digest>-<size in hex>"
+ *   <store>\manifest.txt                        what was taken from where
+ *
+ * MANIFEST: text, one record per line, tab-separated, paths
+ * percent-encoded like the action journal's; every quarantine run
+ * appends:
+ *   Q  object  modified  path     path's contents are in object
+ *   K  path                       path could not be removed: forget it
+ * The last field is "#" + FNV-1a-64 of everything before it. A torn last
+ * line (a crash while appending) is cut off before the next append;
+ * any other line that does not check out stops a restore, which then
+ * changes nothing.
+ *
+ * The digest is FNV-1a-64 over the whole file, computed while copying it
+ * into the store (a quick scan only hashed the first 1 MB). The scan's
+ * digest only picks which files to try: every member is hashed in full
+ * again right before it is removed, and stays if it does not match the
+ * stored object. An address that is taken already is compared byte by
+ * byte before the new copy is dropped, so a digest collision cannot
+ * swap one file's contents for another's.
+ *
+ * The removals run on the action executor as ACTION_QUARANTINE ops whose
+ * kept copy is the object, so they are journaled like a delete: Undo Last
+ * Action copies the files back out of the store.
+ */
+
+#include "common.h"
+#ifdef _WIN32
+#include <io.h>
+#endif
+#include <errno.h>
+
+#define QUARANTINE_KEY_LENGTH 40      // "<16 hex>-<size hex>" + terminator
+#define QUARANTINE_FIELD_MAX (MAX_PATH_LENGTH * 3)    // Encoded path
+#define QUARANTINE_LINE_MAX (QUARANTINE_FIELD_MAX + 128)
+
+typedef struct {
+    ActionPlan* plan;
+    const char* store;
+    const int* group_start;               // group_count + 1 entries into plan->ops
+    char (*keys)[QUARANTINE_KEY_LENGTH];  // Per group, "" = not stored
+    volatile LONG objects_written;
+    volatile LONGLONG bytes_stored;
+} QuarantineJob;
+
+// ============================================================================
+// PATHS
+// ============================================================================
+// Start of a format for paths under the store's objects folder
+#define OBJECTS_FORMAT "%s" PATH_SEP_STR QUARANTINE_OBJECTS PATH_SEP_STR
+
+static bool object_path(const char* store, const char* key, char* out) {
+    return snprintf(out, MAX_PATH_LENGTH, OBJECTS_FORMAT "%.2s" PATH_SEP_STR "%s",
+                    store, key, key) < MAX_PATH_LENGTH;
+}
+
+static bool manifest_path(const char* store, const char* name, char* out) {
+    return snprintf(out, MAX_PATH_LENGTH, "%s" PATH_SEP_STR "%s", store, name) < MAX_PATH_LENGTH;
+}
+
+static FILETIME time_t_to_filetime(time_t t) {
+    const long long EPOCH_DIFF = 116444736000000000LL;
+
+    LARGE_INTEGER li;
+    li.QuadPart = (long long)t * 10000000LL + EPOCH_DIFF;
+
+    FILETIME ft;
+    ft.dwLowDateTime = li.LowPart;
+    ft.dwHighDateTime = li.HighPart;
+    return ft;
+}
+
+static time_t filetime_to_time_t(FILETIME ft) {
+    const long long EPOCH_DIFF = 116444736000000000LL;
+
+    LARGE_INTEGER li;
+    li.LowPart = ft.dwLowDateTime;
+    li.HighPart = ft.dwHighDateTime;
+    return (time_t)((li.QuadPart - EPOCH_DIFF) / 10000000LL);
+}
+
+// Manifest writes must be on disk before any original is deleted
+static bool close_durably(FILE* f, bool ok) {
+    if (ok && fflush(f) != 0) ok = false;
+    if (ok && !FlushFileBuffers((HANDLE)_get_osfhandle(_fileno(f)))) ok = false;
+    if (fclose(f) != 0) ok = false;
+    return ok;
+}
+
+// ============================================================================
+// MANIFEST RECORDS
+// ============================================================================
+static uint64_t line_checksum(const char* line, size_t len) {
+    uint64_t h = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)line[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+// Writes one record: type, the key and time if given, the encoded path
+static bool write_record(FILE* f, char type, const char* key, time_t modified,
+                         const char* path) {
+    char field[QUARANTINE_FIELD_MAX];
+    char line[QUARANTINE_LINE_MAX];
+    if (!encode_path_field(path, field, sizeof(field))) return false;
+
+    int len = key ? snprintf(line, sizeof(line), "%c\t%s\t%lld\t%s", type, key,
+                             (long long)modified, field)
+                  : snprintf(line, sizeof(line), "%c\t%s", type, field);
+    if (len < 0 || len >= (int)sizeof(line)) return false;
+
+    return fprintf(f, "%s\t#%016llx\n", line,
+                   (unsigned long long)line_checksum(line, len)) > 0;
+}
+
+// Opens the manifest for appending, first cutting off a line torn by a
+// crash so it cannot run into the next record. Such a line recorded
+// nothing: a run's Q records are durable before its first removal, and
+// a lost K record only makes its file a conflict on restore.
+static FILE* open_manifest_append(const char* path) {
+    FILE* f = fopen(path, "ab+");
+    if (!f) return NULL;
+
+    HANDLE h = (HANDLE)_get_osfhandle(_fileno(f));
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(h, &size) || size.QuadPart == 0) return f;
+
+    char tail[QUARANTINE_LINE_MAX];
+    DWORD got = 0;
+    LARGE_INTEGER at;
+    at.QuadPart = size.QuadPart > (long long)sizeof(tail) ? size.QuadPart - sizeof(tail) : 0;
+    if (!SetFilePointerEx(h, at, NULL, FILE_BEGIN) ||
+        !ReadFile(h, tail, (DWORD)(size.QuadPart - at.QuadPart), &got, NULL) || got == 0 ||
+        tail[got - 1] == '\n') {
+        return f;
+    }
+
+    // Back to the end of the last whole line (a line longer than the
+    // tail is malformed anyway: restore reports it)
+    DWORD keep = got;
+    while (keep > 0 && tail[keep - 1] != '\n') keep--;
+    if (keep == 0 && at.QuadPart > 0) return f;
+
+    at.QuadPart += keep;
+    if (!SetFilePointerEx(h, at, NULL, FILE_BEGIN) || !SetEndOfFile(h)) {
+        fclose(f);
+        return NULL;
+    }
+    return f;
+}
+
+// ============================================================================
+// HASHING
+//
+// Reads source to the end, FNV-1a-64 over every byte, and writes what it
+// reads to copy unless that is INVALID_HANDLE_VALUE. key receives the
+// object name "<digest>-<size in hex>".
+// ============================================================================
+static bool hash_file(HANDLE source, HANDLE copy, unsigned char* buffer, char* key) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    long long total = 0;
+
+    for (;;) {
+        DWORD got = 0, put = 0;
+        if (!ReadFile(source, buffer, QUARANTINE_COPY_BUFFER, &got, NULL)) return false;
+        if (got == 0) break;
+
+        for (DWORD i = 0; i < got; i++) {
+            hash ^= buffer[i];
+            hash *= FNV_PRIME;
+        }
+        if (copy != INVALID_HANDLE_VALUE &&
+            (!WriteFile(copy, buffer, got, &put, NULL) || put != got)) {
+            return false;
+        }
+        total += got;
+    }
+
+    snprintf(key, QUARANTINE_KEY_LENGTH, "%016llx-%llx",
+             (unsigned long long)hash, (unsigned long long)total);
+    return true;
+}
+
+// Byte-for-byte; the buffer is split in two halves, one per file
+static bool same_bytes(const char* path_a, const char* path_b, unsigned char* buffer) {
+    const DWORD half = QUARANTINE_COPY_BUFFER / 2;
+
+    HANDLE a = CreateFileA(path_a, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                           FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (a == INVALID_HANDLE_VALUE) return false;
+    HANDLE b = CreateFileA(path_b, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                           FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (b == INVALID_HANDLE_VALUE) {
+        CloseHandle(a);
+        return false;
+    }
+
+    bool same = false;
+    for (;;) {
+        DWORD got_a = 0, got_b = 0;
+        if (!ReadFile(a, buffer, half, &got_a, NULL) ||
+            !ReadFile(b, buffer + half, half, &got_b, NULL) ||
+            got_a != got_b || memcmp(buffer, buffer + half, got_a) != 0) {
+            break;
+        }
+        if (got_a == 0) {
+            same = true;
+            break;
+        }
+    }
+
+    CloseHandle(b);
+    CloseHandle(a);
+    return same;
+}
+
+// ============================================================================
+// STORE ONE OBJECT
+//
+// Copies path into a temporary file of the store while hashing it, makes
+// the copy durable, then renames it to its content address. If the
+// address is taken, the copy is dropped only when the stored object has
+// the same bytes; otherwise the file is refused (a digest collision).
+//
+// RETURNS: false if the file could not be stored; *created tells whether
+// the object is new
+// ============================================================================
+static bool store_object(const char* store, const char* path, int sequence,
+                         char* key, long long* size, bool* created) {
+    *created = false;
+
+    char temp[MAX_PATH_LENGTH];
+    if (snprintf(temp, sizeof(temp), OBJECTS_FORMAT "incoming-%lu-%d.tmp",
+                 store, (unsigned long)GetCurrentProcessId(), sequence) >= (int)sizeof(temp)) {
+        return false;
+    }
+
+    unsigned char* buffer = (unsigned char*)malloc(QUARANTINE_COPY_BUFFER);
+    if (!buffer) return false;
+
+    HANDLE source = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (source == INVALID_HANDLE_VALUE) {
+        free(buffer);
+        return false;
+    }
+    HANDLE target = CreateFileA(temp, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                                FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (target == INVALID_HANDLE_VALUE) {
+        CloseHandle(source);
+        free(buffer);
+        return false;
+    }
+
+    bool ok = hash_file(source, target, buffer, key);
+    if (ok && !FlushFileBuffers(target)) ok = false;
+    CloseHandle(target);
+    CloseHandle(source);
+
+    char object[MAX_PATH_LENGTH];
+    char fan_out[MAX_PATH_LENGTH];
+    if (!ok || !object_path(store, key, object) ||
+        snprintf(fan_out, sizeof(fan_out), OBJECTS_FORMAT "%.2s",
+                 store, key) >= (int)sizeof(fan_out) ||
+        (!CreateDirectoryA(fan_out, NULL) && GetLastError() != ERROR_ALREADY_EXISTS)) {
+        DeleteFileA(temp);
+        free(buffer);
+        return false;
+    }
+    *size = strtoll(strchr(key, '-') + 1, NULL, 16);
+
+    if (MoveFileExA(temp, object, MOVEFILE_WRITE_THROUGH)) {
+        *created = true;
+        free(buffer);
+        return true;
+    }
+
+    DWORD error = GetLastError();
+    ok = (error == ERROR_ALREADY_EXISTS || error == ERROR_FILE_EXISTS) &&
+         same_bytes(temp, object, buffer);
+    DeleteFileA(temp);
+    free(buffer);
+    return ok;
+}
+
+// ============================================================================
+// REMOVE ONE MEMBER (the executor's ACTION_QUARANTINE op)
+//
+// Hashes path in full through a handle that locks out writers and other
+// deleters, and deletes it through that handle only if it matches the
+// object (named by its key). A file changed since it was stored - or
+// one a quick scan only matched on its first megabyte - stays.
+//
+// RETURNS: OP_DONE if removed, OP_SKIPPED if the contents differ from
+// the object (nothing touched), OP_FAILED otherwise (GetLastError())
+// ============================================================================
+OpStatus quarantine_remove(const char* path, const char* object) {
+    const char* key = strrchr(object, PATH_SEP);
+    key = key ? key + 1 : object;
+
+    unsigned char* buffer = (unsigned char*)malloc(QUARANTINE_COPY_BUFFER);
+    if (!buffer) {
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return OP_FAILED;
+    }
+
+    HANDLE h = CreateFileA(path, GENERIC_READ | DELETE, FILE_SHARE_READ, NULL,
+                           OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (h == INVALID_HANDLE_VALUE) {
+        free(buffer);
+        return OP_FAILED;
+    }
+
+    char actual[QUARANTINE_KEY_LENGTH];
+    OpStatus status = OP_FAILED;
+    if (hash_file(h, INVALID_HANDLE_VALUE, buffer, actual)) {
+        if (strcmp(actual, key) != 0) {
+            status = OP_SKIPPED;
+        } else {
+            FILE_DISPOSITION_INFO disposition = { TRUE };
+            if (SetFileInformationByHandle(h, FileDispositionInfo, &disposition,
+                                           sizeof(disposition))) {
+                status = OP_DONE;
+            }
+        }
+    }
+
+    DWORD error = GetLastError();
+    CloseHandle(h);      // Deletes the file if marked
+    free(buffer);
+    SetLastError(error);
+    return status;
+}
+
+// ============================================================================
+// WORKER TASK (one group each)
+//
+// Stores the group's first op (member 1) and points every op of the
+// group at the object, which the journal then restores from.
+// ============================================================================
+static void store_group(void* context, int g) {
+    QuarantineJob* job = (QuarantineJob*)context;
+    ActionPlan* plan = job->plan;
+    int first = job->group_start[g];
+    int end = job->group_start[g + 1];
+
+    bool created;
+    long long size = 0;
+    char object[MAX_PATH_LENGTH];
+    bool ok = store_object(job->store, plan->ops[first].path, g, job->keys[g], &size,
+                           &created) &&
+              object_path(job->store, job->keys[g], object);
+    DWORD error = ok ? ERROR_SUCCESS : GetLastError();
+
+    for (int i = first; ok && i < end; i++) {
+        char* copy = _strdup(object);
+        if (!copy) {
+            ok = false;
+            error = ERROR_NOT_ENOUGH_MEMORY;
+            break;
+        }
+        free(plan->ops[i].other);
+        plan->ops[i].other = copy;
+    }
+
+    if (!ok) {
+        job->keys[g][0] = '\0';
+        for (int i = first; i < end; i++) {
+            plan->ops[i].status = OP_FAILED;
+            plan->ops[i].error = error ? error : ERROR_WRITE_FAULT;
+        }
+        return;
+    }
+
+    if (created) {
+        InterlockedIncrement(&job->objects_written);
+        InterlockedExchangeAdd64(&job->bytes_stored, size);
+    }
+}
+
+// ============================================================================
+// QUARANTINE A PLAN
+//
+// plan: ACTION_QUARANTINE, built by action_plan_from_results with the
+//       store as dest_folder (ops of a group are adjacent)
+//
+// Step 1: Store one object per group, from its first op (ACTION_MAX_COPIES
+//         groups at a time: the work is copying)
+// Step 2: Append a Q record for every op of the stored groups and flush
+//         the manifest - from here on every file can be restored
+// Step 3: Run the plan on the executor: each file is verified against
+//         its object and removed (journaled when plan->journal is set)
+// Step 4: Append a K record for each file that stayed, so a restore does
+//         not try to recreate a file that is still there
+//
+// Ends with plan->succeeded / skipped / failed set, as action_execute
+// leaves them.
+//
+// RETURNS: false if the store or its manifest could not be written (no
+// file has been removed then)
+// ============================================================================
+static void count_outcomes(ActionPlan* plan) {
+    plan->succeeded = plan->skipped = plan->failed = 0;
+    for (int i = 0; i < plan->count; i++) {
+        switch (plan->ops[i].status) {
+            case OP_DONE:    plan->succeeded++; break;
+            case OP_SKIPPED: plan->skipped++;   break;
+            default:         plan->failed++;    break;
+        }
+    }
+}
+
+static void fail_pending(ActionPlan* plan, DWORD error) {
+    for (int i = 0; i < plan->count; i++) {
+        if (plan->ops[i].status != OP_PENDING) continue;
+        plan->ops[i].status = OP_FAILED;
+        plan->ops[i].error = error;
+    }
+    count_outcomes(plan);
+}
+
+bool quarantine_execute(ActionPlan* plan, QuarantineReport* report) {
+    if (report) memset(report, 0, sizeof(QuarantineReport));
+    if (!plan || plan->kind != ACTION_QUARANTINE || !plan->dest_folder) return false;
+    const char* store = plan->dest_folder;
+
+    char objects[MAX_PATH_LENGTH];
+    char manifest[MAX_PATH_LENGTH];
+    if (snprintf(objects, sizeof(objects), "%s" PATH_SEP_STR QUARANTINE_OBJECTS,
+                 store) >= (int)sizeof(objects) ||
+        !manifest_path(store, QUARANTINE_MANIFEST, manifest)) {
+        fail_pending(plan, ERROR_FILENAME_EXCED_RANGE);
+        return false;
+    }
+    int created = SHCreateDirectoryExA(NULL, objects, NULL);
+    if (created != ERROR_SUCCESS && created != ERROR_ALREADY_EXISTS) {
+        fail_pending(plan, (DWORD)created);
+        return false;
+    }
+
+    int* group_start = (int*)malloc((plan->count + 1) * sizeof(int));
+    int group_count = 0;
+    for (int i = 0; group_start && i < plan->count; i++) {
+        if (i == 0 || plan->ops[i].group != plan->ops[i - 1].group) {
+            group_start[group_count++] = i;
+        }
+    }
+
+    QuarantineJob job;
+    memset(&job, 0, sizeof(job));
+    job.plan = plan;
+    job.store = store;
+    job.group_start = group_start;
+    job.keys = calloc(group_count + 1, QUARANTINE_KEY_LENGTH);
+    if (!group_start || !job.keys) {
+        free(group_start);
+        free(job.keys);
+        fail_pending(plan, ERROR_NOT_ENOUGH_MEMORY);
+        return false;
+    }
+    group_start[group_count] = plan->count;
+
+    // ========================================================================
+    // STEP 1: OBJECTS
+    // ========================================================================
+    parallel_for(group_count, ACTION_MAX_COPIES, store_group, &job);
+
+    // ========================================================================
+    // STEP 2: MANIFEST (durable before anything is deleted)
+    // ========================================================================
+    FILE* f = open_manifest_append(manifest);
+    bool ok = f != NULL;
+
+    for (int g = 0; ok && g < group_count; g++) {
+        if (!job.keys[g][0]) continue;
+
+        for (int i = group_start[g]; ok && i < group_start[g + 1]; i++) {
+            WIN32_FILE_ATTRIBUTE_DATA data;
+            time_t modified = GetFileAttributesExA(plan->ops[i].path, GetFileExInfoStandard, &data)
+                              ? filetime_to_time_t(data.ftLastWriteTime) : 0;
+            ok = write_record(f, 'Q', job.keys[g], modified, plan->ops[i].path);
+        }
+    }
+    if (f) ok = close_durably(f, ok);
+
+    if (!ok) {
+        fail_pending(plan, ERROR_WRITE_FAULT);
+    } else {
+        // ====================================================================
+        // STEPS 3-4: REMOVE ORIGINALS, RECORD THE ONES THAT STAYED
+        // ====================================================================
+        if (!action_execute(plan, ACTION_MAX_IN_FLIGHT)) {
+            fail_pending(plan, ERROR_NOT_ENOUGH_MEMORY);
+        }
+
+        if (plan->succeeded < plan->count) {
+            f = open_manifest_append(manifest);
+            bool kept_ok = f != NULL;
+            for (int g = 0; kept_ok && g < group_count; g++) {
+                if (!job.keys[g][0]) continue;
+
+                for (int i = group_start[g]; kept_ok && i < group_start[g + 1]; i++) {
+                    if (plan->ops[i].status == OP_DONE) continue;
+                    kept_ok = write_record(f, 'K', NULL, 0, plan->ops[i].path);
+                }
+            }
+            if (f) close_durably(f, kept_ok);
+        }
+    }
+
+    if (report) {
+        report->files = plan->succeeded;
+        report->objects_written = job.objects_written;
+        report->bytes_stored = job.bytes_stored;
+        report->conflicts = plan->skipped;
+        report->failed = plan->failed;
+    }
+
+    free(group_start);
+    free(job.keys);
+    return ok;
+}
+
+// ============================================================================
+// QUARANTINE DUPLICATES
+//
+// Keeps member 0 of every group and quarantines the others (no journal;
+// callers that want one, or progress, build the plan themselves).
+// ============================================================================
+bool quarantine_duplicates(const DuplicateResults* results, const char* store,
+                           QuarantineReport* report) {
+    if (report) memset(report, 0, sizeof(QuarantineReport));
+    if (!results || !store || results->count == 0) return false;
+
+    ActionPlan* plan = action_plan_from_results(results, ACTION_QUARANTINE, store);
+    if (!plan) return false;
+
+    bool ok = quarantine_execute(plan, report);
+    action_plan_free(plan);
+    return ok;
+}
+
+// ============================================================================
+// MANIFEST READING
+// ============================================================================
+typedef struct {
+    char key[QUARANTINE_KEY_LENGTH];
+    char* path;               // NULL once cancelled by a K record
+    time_t modified;
+    bool restored;
+} ManifestEntry;
+
+typedef struct {
+    ManifestEntry* entries;
+    int count;
+    int capacity;
+} Manifest;
+
+static void free_manifest(Manifest* manifest) {
+    for (int i = 0; i < manifest->count; i++) free(manifest->entries[i].path);
+    free(manifest->entries);
+}
+
+// A K record cancels the newest Q record of its path (they are rare, so
+// a backwards scan is fine)
+static void cancel_entry(Manifest* manifest, const char* path) {
+    for (int i = manifest->count - 1; i >= 0; i--) {
+        ManifestEntry* entry = &manifest->entries[i];
+        if (entry->path && path_compare(entry->path, path) == 0) {
+            free(entry->path);
+            entry->path = NULL;
+            return;
+        }
+    }
+}
+
+// Strips and checks the trailing "\t#<hash>"
+static bool record_valid(char* line) {
+    char* mark = strrchr(line, '\t');
+    if (!mark || mark[1] != '#') return false;
+
+    char* end;
+    unsigned long long stored = strtoull(mark + 2, &end, 16);
+    if (*end || stored != line_checksum(line, mark - line)) return false;
+    *mark = '\0';
+    return true;
+}
+
+// RETURNS: false if the manifest cannot be read or has a malformed line
+// (all of it is then left alone: a line that does not check out may be
+// a file only the store still holds)
+static bool load_manifest(const char* path, Manifest* manifest) {
+    memset(manifest, 0, sizeof(Manifest));
+
+    FILE* f = fopen(path, "rb");
+    if (!f) return errno == ENOENT;    // Nothing quarantined yet
+
+    char* line = (char*)malloc(QUARANTINE_LINE_MAX);
+    if (!line) {
+        fclose(f);
+        return false;
+    }
+
+    bool ok = true;
+    while (ok && fgets(line, QUARANTINE_LINE_MAX, f)) {
+        char* end = strchr(line, '\n');
+        if (!end) {
+            ok = feof(f) != 0;    // Torn last line, or one too long
+            break;
+        }
+        *end = '\0';
+
+        ok = record_valid(line) && line[1] == '\t';
+        if (!ok) break;
+
+        char* key = line + 2;
+        char* modified = strchr(key, '\t');
+        char* file_path = modified ? strchr(modified + 1, '\t') : NULL;
+
+        if (line[0] == 'K') {
+            ok = !modified && decode_path_field(key);
+            if (ok) cancel_entry(manifest, key);
+            continue;
+        }
+        ok = line[0] == 'Q' && file_path && !strchr(file_path + 1, '\t') &&
+             modified - key < QUARANTINE_KEY_LENGTH;
+        if (!ok) break;
+        *modified++ = '\0';
+        *file_path++ = '\0';
+        if (!decode_path_field(file_path)) {
+            ok = false;
+            break;
+        }
+
+        if (manifest->count >= manifest->capacity) {
+            int new_capacity = manifest->capacity ? manifest->capacity * 2 : 256;
+            ManifestEntry* grown = (ManifestEntry*)realloc(manifest->entries,
+                                                           new_capacity * sizeof(ManifestEntry));
+            if (!grown) {
+                ok = false;
+                break;
+            }
+            manifest->entries = grown;
+            manifest->capacity = new_capacity;
+        }
+
+        ManifestEntry* entry = &manifest->entries[manifest->count];
+        memset(entry, 0, sizeof(ManifestEntry));
+        strcpy(entry->key, key);
+        entry->modified = (time_t)strtoll(modified, NULL, 10);
+        entry->path = _strdup(file_path);
+        if (!entry->path) {
+            ok = false;
+            break;
+        }
+        manifest->count++;
+    }
+
+    free(line);
+    fclose(f);
+    if (!ok) free_manifest(manifest);
+    return ok;
+}
+
+// ============================================================================
+// RESTORE ONE FILE
+//
+// Recreates the file from its object (and its folder, if that is gone)
+// with the modification time it had when it was quarantined. A file that
+// is back at its path already is left alone: a conflict, not a failure.
+// ============================================================================
+typedef struct {
+    const char* store;
+    Manifest* manifest;
+    volatile LONG restored;
+    volatile LONG conflicts;
+    volatile LONG failed;
+} RestoreJob;
+
+static void restore_entry(void* context, int i) {
+    RestoreJob* job = (RestoreJob*)context;
+    ManifestEntry* entry = &job->manifest->entries[i];
+    if (!entry->path) return;
+
+    char object[MAX_PATH_LENGTH];
+    char dir[MAX_PATH_LENGTH];
+    if (!object_path(job->store, entry->key, object)) {
+        InterlockedIncrement(&job->failed);
+        return;
+    }
+
+    const char* slash = strrchr(entry->path, PATH_SEP);
+    if (slash && slash - entry->path < MAX_PATH_LENGTH) {
+        snprintf(dir, sizeof(dir), "%.*s", (int)(slash - entry->path), entry->path);
+        if (GetFileAttributesA(dir) == INVALID_FILE_ATTRIBUTES) {
+            SHCreateDirectoryExA(NULL, dir, NULL);
+        }
+    }
+
+    if (!CopyFileA(object, entry->path, TRUE)) {
+        DWORD error = GetLastError();
+        if (error == ERROR_FILE_EXISTS || error == ERROR_ALREADY_EXISTS) {
+            InterlockedIncrement(&job->conflicts);
+        } else {
+            InterlockedIncrement(&job->failed);
+        }
+        return;
+    }
+
+    HANDLE h = CreateFileA(entry->path, FILE_WRITE_ATTRIBUTES, 0, NULL, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h != INVALID_HANDLE_VALUE) {
+        FILETIME modified = time_t_to_filetime(entry->modified);
+        SetFileTime(h, NULL, NULL, &modified);
+        CloseHandle(h);
+    }
+
+    entry->restored = true;
+    InterlockedIncrement(&job->restored);
+}
+
+// ============================================================================
+// SWEEP UNREFERENCED OBJECTS
+// ============================================================================
+static int compare_keys(const void* a, const void* b) {
+    return strcmp((const char*)a, (const char*)b);
+}
+
+static void sweep_objects(const char* store, const Manifest* manifest) {
+    char (*live)[QUARANTINE_KEY_LENGTH] = calloc(manifest->count + 1, QUARANTINE_KEY_LENGTH);
+    if (!live) return;     // Keep everything: a later restore sweeps
+
+    int live_count = 0;
+    for (int i = 0; i < manifest->count; i++) {
+        const ManifestEntry* entry = &manifest->entries[i];
+        if (entry->path && !entry->restored) strcpy(live[live_count++], entry->key);
+    }
+    qsort(live, live_count, QUARANTINE_KEY_LENGTH, compare_keys);
+
+    // A path that does not fit is skipped, never cut: a shortened
+    // name could be another file's
+    char pattern[MAX_PATH_LENGTH];
+    char path[MAX_PATH_LENGTH];
+    WIN32_FIND_DATAA dir_data;
+    HANDLE dirs = INVALID_HANDLE_VALUE;
+    if (snprintf(pattern, sizeof(pattern), OBJECTS_FORMAT "*", store) < (int)sizeof(pattern)) {
+        dirs = FindFirstFileA(pattern, &dir_data);
+    }
+    if (dirs == INVALID_HANDLE_VALUE) {
+        free(live);
+        return;
+    }
+
+    do {
+        if (strcmp(dir_data.cFileName, ".") == 0 || strcmp(dir_data.cFileName, "..") == 0) {
+            continue;
+        }
+        if (!(dir_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+            // Copy left behind by an interrupted quarantine
+            if (snprintf(path, sizeof(path), OBJECTS_FORMAT "%s",
+                         store, dir_data.cFileName) < (int)sizeof(path)) {
+                DeleteFileA(path);
+            }
+            continue;
+        }
+
+        char fan_out[MAX_PATH_LENGTH];
+        if (snprintf(fan_out, sizeof(fan_out), OBJECTS_FORMAT "%s",
+                     store, dir_data.cFileName) >= (int)sizeof(fan_out) ||
+            snprintf(pattern, sizeof(pattern), "%s" PATH_SEP_STR "*",
+                     fan_out) >= (int)sizeof(pattern)) {
+            continue;
+        }
+
+        WIN32_FIND_DATAA data;
+        HANDLE files = FindFirstFileA(pattern, &data);
+        if (files != INVALID_HANDLE_VALUE) {
+            do {
+                if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+                if (strlen(data.cFileName) < QUARANTINE_KEY_LENGTH &&
+                    bsearch(data.cFileName, live, live_count, QUARANTINE_KEY_LENGTH,
+                            compare_keys)) {
+                    continue;
+                }
+                if (snprintf(path, sizeof(path), "%s" PATH_SEP_STR "%s",
+                             fan_out, data.cFileName) < (int)sizeof(path)) {
+                    DeleteFileA(path);
+                }
+            } while (FindNextFileA(files, &data));
+            FindClose(files);
+        }
+        RemoveDirectoryA(fan_out);    // Only succeeds once it is empty
+    } while (FindNextFileA(dirs, &dir_data));
+
+    FindClose(dirs);
+    free(live);
+}
+
+// ============================================================================
+// RESTORE QUARANTINE
+//
+// Step 1: Read the manifest (K records cancel their Q records)
+// Step 2: Recreate every file, ACTION_MAX_IN_FLIGHT at a time
+// Step 3: Rewrite the manifest with the entries still in quarantine
+//         (temporary file + rename, so a crash leaves the old or the
+//         new manifest, never half of one)
+// Step 4: Delete the objects no remaining entry refers to
+//
+// RETURNS: false if the manifest could not be read or rewritten
+// ============================================================================
+bool quarantine_restore(const char* store, QuarantineReport* report) {
+    if (report) memset(report, 0, sizeof(QuarantineReport));
+    if (!store) return false;
+
+    char manifest_file[MAX_PATH_LENGTH];
+    char temp_file[MAX_PATH_LENGTH];
+    if (!manifest_path(store, QUARANTINE_MANIFEST, manifest_file) ||
+        !manifest_path(store, QUARANTINE_MANIFEST ".tmp", temp_file)) {
+        return false;
+    }
+
+    Manifest manifest;
+    if (!load_manifest(manifest_file, &manifest)) return false;
+
+    RestoreJob job;
+    memset(&job, 0, sizeof(job));
+    job.store = store;
+    job.manifest = &manifest;
+    parallel_for(manifest.count, ACTION_MAX_IN_FLIGHT, restore_entry, &job);
+
+    int remaining = 0;
+    for (int i = 0; i < manifest.count; i++) {
+        if (manifest.entries[i].path && !manifest.entries[i].restored) remaining++;
+    }
+
+    bool ok = true;
+    if (remaining == 0) {
+        if (manifest.count > 0 || GetFileAttributesA(manifest_file) != INVALID_FILE_ATTRIBUTES) {
+            ok = DeleteFileA(manifest_file) != 0;
+        }
+    } else if (job.restored > 0) {
+        FILE* f = fopen(temp_file, "wb");
+        ok = f != NULL;
+        for (int i = 0; ok && i < manifest.count; i++) {
+            const ManifestEntry* entry = &manifest.entries[i];
+            if (!entry->path || entry->restored) continue;
+            ok = write_record(f, 'Q', entry->key, entry->modified, entry->path);
+        }
+        if (f) ok = close_durably(f, ok);
+
+        if (!ok || !MoveFileExA(temp_file, manifest_file,
+                                MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+            DeleteFileA(temp_file);
+            ok = false;
+        }
+    }
+
+    // Objects are only dropped once the manifest no longer needs them
+    if (ok) sweep_objects(store, &manifest);
+
+    if (report) {
+        report->files = job.restored;
+        report->conflicts = job.conflicts;
+        report->failed = job.failed;
+    }
+
+    free_manifest(&manifest);
+    return ok;
+}
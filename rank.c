@@ -0,0 +1,227 @@
+/*
+ * RANK.C - Top-K Duplicate Groups by Reclaimable Bytes
+ *
+ * DSA CONCEPTS DEMONSTRATED:
+ * 1. Bounded Min-Heap (keeps the K best of a stream in O(n log K))
+ * 2. Heap Sort (heap -> descending order in place)
+ * 3. Upper-Bound Pruning (cheap bound before the expensive exact value)
+ *
+ * SAVINGS OF A GROUP:
+ * - Logical:  (count - 1) * size
+ * - Physical: (distinct on-disk files - 1) * size
+ *   Members that are already hard links of each other share their data,
+ *   so linking or deleting them frees nothing. Physical <= logical.
+ */
+
+#include "common.h"
+
+// ============================================================================
+// FILE IDENTITY
+//
+// (volume serial, file index) names the on-disk file behind a path;
+// every hard link to it reports the same pair.
+// ============================================================================
+bool get_file_identity(const char* path, FileIdentity* id) {
+    // No access rights needed just to query the file's identity
+    HANDLE h = CreateFileA(path, 0,
+                           FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                           NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+    if (h == INVALID_HANDLE_VALUE) return false;
+
+    BY_HANDLE_FILE_INFORMATION info;
+    BOOL ok = GetFileInformationByHandle(h, &info);
+    CloseHandle(h);
+    if (!ok) return false;
+
+    id->volume = info.dwVolumeSerialNumber;
+    id->index = ((uint64_t)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+    return true;
+}
+
+static int compare_identity(const void* a, const void* b) {
+    const FileIdentity* x = (const FileIdentity*)a;
+    const FileIdentity* y = (const FileIdentity*)b;
+
+    if (x->volume != y->volume) return x->volume < y->volume ? -1 : 1;
+    if (x->index != y->index) return x->index < y->index ? -1 : 1;
+    return 0;
+}
+
+// ============================================================================
+// RECLAIMABLE BYTES
+// ============================================================================
+long long group_reclaimable_bytes(const DuplicateGroup* group) {
+    if (!group || group->count < 2) return 0;
+    return (long long)(group->count - 1) * group->size;
+}
+
+// ============================================================================
+// PHYSICAL RECLAIMABLE BYTES
+//
+// Opens every member once to read its identity, then counts distinct
+// identities by sorting them. A member that cannot be opened is counted
+// as its own file (it can still be acted on by path).
+// ============================================================================
+long long group_physical_reclaimable_bytes(const DuplicateResults* results,
+                                           const DuplicateGroup* group) {
+    if (!results || !group || group->count < 2 || group->size == 0) return 0;
+
+    FileIdentity* ids = (FileIdentity*)malloc(group->count * sizeof(FileIdentity));
+    if (!ids) return group_reclaimable_bytes(group);
+
+    for (int j = 0; j < group->count; j++) {
+        if (!get_file_identity(group_file(results, group, j)->path, &ids[j])) {
+            // Volume serial 2^32+ never occurs, so this is unique
+            ids[j].volume = 0x100000000ULL;
+            ids[j].index = (uint64_t)j;
+        }
+    }
+
+    qsort(ids, group->count, sizeof(FileIdentity), compare_identity);
+
+    int distinct = 1;
+    for (int j = 1; j < group->count; j++) {
+        if (compare_identity(&ids[j - 1], &ids[j]) != 0) distinct++;
+    }
+
+    free(ids);
+    return (long long)(distinct - 1) * group->size;
+}
+
+// ============================================================================
+// BOUNDED MIN-HEAP
+//
+// Root = smallest of the K kept so far. A new group only gets in if it
+// beats the root, so the heap never holds more than K entries.
+// Ties go to the lower group index, which keeps the output deterministic.
+// ============================================================================
+static bool rank_less(const GroupRank* a, const GroupRank* b) {
+    if (a->reclaimable != b->reclaimable) return a->reclaimable < b->reclaimable;
+    return a->group > b->group;
+}
+
+static void sift_down(GroupRank* heap, int size, int i) {
+    for (;;) {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+
+        if (left < size && rank_less(&heap[left], &heap[smallest])) smallest = left;
+        if (right < size && rank_less(&heap[right], &heap[smallest])) smallest = right;
+        if (smallest == i) return;
+
+        GroupRank tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+static void sift_up(GroupRank* heap, int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!rank_less(&heap[i], &heap[parent])) return;
+
+        GroupRank tmp = heap[i];
+        heap[i] = heap[parent];
+        heap[parent] = tmp;
+        i = parent;
+    }
+}
+
+// ============================================================================
+// TOP GROUPS BY SAVINGS
+//
+// Fills out[0..k-1] with the k groups that free the most bytes, largest
+// first.
+//
+// physical = false: exact, O(G log k), no I/O
+// physical = true : logical bytes are an upper bound on physical bytes,
+//                   so a group whose bound cannot beat the heap root is
+//                   skipped without opening its files. Only groups that
+//                   might enter the top k are looked at on disk.
+//
+// RETURNS: number of entries written (min(k, groups that free anything))
+// ============================================================================
+int top_groups_by_savings(const DuplicateResults* results, int k, bool physical,
+                          GroupRank* out) {
+    if (!results || !out || k <= 0) return 0;
+
+    int size = 0;
+
+    for (int g = 0; g < results->count; g++) {
+        const DuplicateGroup* group = &results->groups[g];
+        GroupRank candidate = {g, group_reclaimable_bytes(group)};
+
+        if (candidate.reclaimable <= 0) continue;
+        if (size == k && !rank_less(&out[0], &candidate)) continue;
+
+        if (physical) {
+            candidate.reclaimable = group_physical_reclaimable_bytes(results, group);
+            if (candidate.reclaimable <= 0) continue;
+            if (size == k && !rank_less(&out[0], &candidate)) continue;
+        }
+
+        if (size < k) {
+            out[size] = candidate;
+            sift_up(out, size++);
+        } else {
+            out[0] = candidate;
+            sift_down(out, size, 0);
+        }
+    }
+
+    // Heap sort: repeatedly move the smallest to the end -> descending
+    for (int end = size - 1; end > 0; end--) {
+        GroupRank tmp = out[0];
+        out[0] = out[end];
+        out[end] = tmp;
+        sift_down(out, end, 0);
+    }
+
+    return size;
+}
+
+// ============================================================================
+// RANK RESULTS
+//
+// Moves the top k groups to the front of results->groups, largest savings
+// first; the remaining groups follow in their previous order. Anything
+// that walks the results in order (list view, exports, actions) then sees
+// the biggest wins first.
+//
+// RETURNS: number of ranked groups at the front
+// ============================================================================
+int rank_results_by_savings(DuplicateResults* results, int k, bool physical) {
+    if (!results || results->count == 0 || k <= 0) return 0;
+    if (k > results->count) k = results->count;
+
+    GroupRank* top = (GroupRank*)malloc(k * sizeof(GroupRank));
+    DuplicateGroup* reordered = (DuplicateGroup*)malloc(results->count * sizeof(DuplicateGroup));
+    bool* taken = (bool*)calloc(results->count, sizeof(bool));
+
+    if (!top || !reordered || !taken) {
+        free(top);
+        free(reordered);
+        free(taken);
+        return 0;
+    }
+
+    int ranked = top_groups_by_savings(results, k, physical, top);
+    int next = 0;
+
+    for (int i = 0; i < ranked; i++) {
+        reordered[next++] = results->groups[top[i].group];
+        taken[top[i].group] = true;
+    }
+    for (int g = 0; g < results->count; g++) {
+        if (!taken[g]) reordered[next++] = results->groups[g];
+    }
+
+    memcpy(results->groups, reordered, results->count * sizeof(DuplicateGroup));
+
+    free(top);
+    free(reordered);
+    free(taken);
+    return ranked;
+}
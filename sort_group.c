@@ -0,0 +1,429 @@
+/*
+ * SORT_GROUP.C - Sort-Based Duplicate Grouping with Parallel Radix Sort
+ *
+ * DSA CONCEPTS DEMONSTRATED:
+ * 1. LSD Radix Sort (stable counting sort per byte)
+ * 2. Parallel Prefix Sums (per-thread histograms -> scatter offsets)
+ * 3. Run-Length Scan (equal keys are adjacent after sorting)
+ * 4. Barrier Synchronization
+ *
+ * ALTERNATIVE TO filter.c:
+ * Instead of hashing into a table, sort compact (size, digest, index)
+ * tuples and emit every run of equal (size, digest) as a group.
+ * - Memory: exactly 2 arrays of n tuples, known before starting
+ * - Access pattern: sequential reads, 256 sequential write streams
+ * - Output order: by (size, digest), members by file index, every run
+ */
+
+#include "common.h"
+
+// ============================================================================
+// BARRIER
+//
+// All workers must finish a pass's histograms before anyone scatters, and
+// finish scattering before the next pass reads the output.
+// ============================================================================
+typedef struct {
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE cv;
+    int threads;
+    int waiting;
+    int phase;
+} Barrier;
+
+static void barrier_wait(Barrier* b) {
+    TELEMETRY_START(t);
+    EnterCriticalSection(&b->lock);
+
+    int phase = b->phase;
+    if (++b->waiting == b->threads) {
+        b->waiting = 0;
+        b->phase++;
+        WakeAllConditionVariable(&b->cv);
+    } else {
+        while (phase == b->phase) {
+            SleepConditionVariableCS(&b->cv, &b->lock, INFINITE);
+        }
+    }
+
+    LeaveCriticalSection(&b->lock);
+    TELEMETRY_STOP(TELEMETRY_QUEUE_WAIT, t);
+    TELEMETRY_COUNT(TELEMETRY_QUEUE_WAITS, 1);
+}
+
+// ============================================================================
+// SHARED SORT STATE
+//
+// Key byte d (0..15): bytes 0-7 are the digest, 8-15 the size, so LSD
+// order sorts by digest first and size last, i.e. final order is
+// (size, digest).
+// ============================================================================
+typedef struct {
+    SortKey* src;
+    SortKey* dst;
+    int count;
+    int threads;
+    size_t (*hist)[RADIX_BUCKETS];     // [thread][bucket], current pass
+    size_t (*digit_totals)[RADIX_BUCKETS];  // [digit][bucket], whole input
+    bool skip[RADIX_DIGITS];           // All keys share this byte
+    FileInfo* files;                   // Only for the initial tuple build
+    Barrier barrier;
+} SortJob;
+
+typedef struct {
+    SortJob* job;
+    int id;
+    size_t (*digit_hist)[RADIX_BUCKETS];   // Per-thread [digit][bucket]
+} SortWorker;
+
+static unsigned int key_byte(const SortKey* k, int d) {
+    return d < 8 ? (unsigned int)(k->digest >> (d * 8)) & 0xFF
+                 : (unsigned int)(k->size >> ((d - 8) * 8)) & 0xFF;
+}
+
+static void slice_bounds(const SortJob* job, int id, int* lo, int* hi) {
+    *lo = (int)((long long)job->count * id / job->threads);
+    *hi = (int)((long long)job->count * (id + 1) / job->threads);
+}
+
+// ============================================================================
+// PHASE A WORKER: BUILD TUPLES + ALL DIGIT HISTOGRAMS
+//
+// One read of the slice produces the 16 histograms used to detect bytes
+// that are equal in every key (those passes are skipped).
+// ============================================================================
+static DWORD WINAPI BuildWorkerThread(LPVOID param) {
+    SortWorker* w = (SortWorker*)param;
+    SortJob* job = w->job;
+    int lo, hi;
+    slice_bounds(job, w->id, &lo, &hi);
+
+    for (int i = lo; i < hi; i++) {
+        SortKey* k = &job->src[i];
+        if (job->files) {
+            k->digest = job->files[i].digest;
+            k->size = (uint64_t)job->files[i].size;
+            k->index = (uint32_t)i;
+        }
+
+        for (int d = 0; d < RADIX_DIGITS; d++) {
+            w->digit_hist[d][key_byte(k, d)]++;
+        }
+    }
+    return 0;
+}
+
+// ============================================================================
+// PHASE B WORKER: RADIX PASSES
+//
+// For each digit that is not skipped:
+//   1. Histogram own slice of src
+//   -- barrier --
+//   2. Offset for (thread t, bucket b) =
+//        sum of all threads' counts for buckets < b
+//      + counts of threads < t for bucket b
+//      Scatter own slice to dst at those offsets (stable)
+//   -- barrier --
+// ============================================================================
+static DWORD WINAPI SortWorkerThread(LPVOID param) {
+    SortWorker* w = (SortWorker*)param;
+    SortJob* job = w->job;
+    int lo, hi;
+    slice_bounds(job, w->id, &lo, &hi);
+
+    SortKey* src = job->src;
+    SortKey* dst = job->dst;
+
+    for (int d = 0; d < RADIX_DIGITS; d++) {
+        if (job->skip[d]) continue;
+
+        size_t* hist = job->hist[w->id];
+        memset(hist, 0, sizeof(job->hist[0]));
+        for (int i = lo; i < hi; i++) {
+            hist[key_byte(&src[i], d)]++;
+        }
+        barrier_wait(&job->barrier);
+
+        size_t offsets[RADIX_BUCKETS];
+        size_t running = 0;
+        for (int b = 0; b < RADIX_BUCKETS; b++) {
+            offsets[b] = running;
+            for (int t = 0; t < w->id; t++) {
+                offsets[b] += job->hist[t][b];
+            }
+            running += job->digit_totals[d][b];
+        }
+
+        for (int i = lo; i < hi; i++) {
+            dst[offsets[key_byte(&src[i], d)]++] = src[i];
+        }
+        barrier_wait(&job->barrier);
+
+        SortKey* tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    return 0;
+}
+
+// ============================================================================
+// RUN WORKERS
+//
+// Worker 0 runs on the calling thread. The others are created suspended,
+// so if thread creation fails part-way the job can still shrink to the
+// workers that exist before any of them has looked at its slice.
+// ============================================================================
+static void run_workers(SortJob* job, SortWorker* workers, LPTHREAD_START_ROUTINE fn) {
+    HANDLE handles[MAX_WORKER_THREADS];
+    int started = 0;
+
+    for (int t = 1; t < job->threads; t++) {
+        handles[t] = CreateThread(NULL, 0, fn, &workers[t], CREATE_SUSPENDED, NULL);
+        if (!handles[t]) break;
+        started++;
+    }
+
+    job->threads = started + 1;
+    job->barrier.threads = started + 1;
+
+    for (int t = 1; t <= started; t++) {
+        ResumeThread(handles[t]);
+    }
+
+    fn(&workers[0]);
+
+    for (int t = 1; t <= started; t++) {
+        WaitForSingleObject(handles[t], INFINITE);
+        CloseHandle(handles[t]);
+    }
+}
+
+// ============================================================================
+// PARALLEL RADIX SORT OF TUPLES
+//
+// files != NULL: keys[] is filled from files[] first (index = position)
+// files == NULL: keys[] already holds the tuples
+// scratch: second buffer of the same size
+//
+// RETURNS: whichever buffer holds the sorted output, NULL if out of memory
+// ============================================================================
+static SortKey* radix_sort_tuples(SortKey* keys, SortKey* scratch, int count,
+                                  FileInfo* files, int threads) {
+    if (threads < 1) threads = 1;
+    if (threads > MAX_WORKER_THREADS) threads = MAX_WORKER_THREADS;
+    if (count < threads * 1024) threads = 1;   // Not worth the barriers
+
+    SortJob job = {0};
+    job.src = keys;
+    job.dst = scratch;
+    job.count = count;
+    job.threads = threads;
+    job.files = files;
+    job.hist = calloc(threads, sizeof(*job.hist));
+    job.digit_totals = calloc(RADIX_DIGITS, sizeof(*job.digit_totals));
+
+    SortWorker workers[MAX_WORKER_THREADS] = {0};
+    bool ok = job.hist && job.digit_totals;
+
+    for (int t = 0; t < threads && ok; t++) {
+        workers[t].job = &job;
+        workers[t].id = t;
+        workers[t].digit_hist = calloc(RADIX_DIGITS, sizeof(*workers[t].digit_hist));
+        if (!workers[t].digit_hist) ok = false;
+    }
+
+    SortKey* sorted = NULL;
+
+    if (ok) {
+        InitializeCriticalSection(&job.barrier.lock);
+        InitializeConditionVariable(&job.barrier.cv);
+
+        // Phase A: tuples + histograms
+        run_workers(&job, workers, BuildWorkerThread);
+
+        int passes = 0;
+        for (int d = 0; d < RADIX_DIGITS; d++) {
+            for (int b = 0; b < RADIX_BUCKETS; b++) {
+                for (int t = 0; t < threads; t++) {
+                    job.digit_totals[d][b] += workers[t].digit_hist[d][b];
+                }
+                if (job.digit_totals[d][b] == (size_t)count) job.skip[d] = true;
+            }
+            if (!job.skip[d]) passes++;
+        }
+
+        // Phase B: radix passes (may start fewer threads than phase A)
+        job.threads = threads;
+        run_workers(&job, workers, SortWorkerThread);
+
+        DeleteCriticalSection(&job.barrier.lock);
+
+        // Each executed pass swaps buffers
+        sorted = (passes % 2 == 0) ? keys : scratch;
+    }
+
+    for (int t = 0; t < threads; t++) free(workers[t].digit_hist);
+    free(job.hist);
+    free(job.digit_totals);
+
+    return sorted;
+}
+
+// ============================================================================
+// SORT PREBUILT KEYS
+//
+// Entry point for callers that already hold compact tuples (benchmarks,
+// merged shard indexes). Order: (size, digest), stable by input position.
+// ============================================================================
+SortKey* sort_keys_parallel(SortKey* keys, SortKey* scratch, int count, int threads) {
+    if (!keys || !scratch || count <= 0) return keys;
+    if (threads <= 0) threads = get_worker_count();
+
+    return radix_sort_tuples(keys, scratch, count, NULL, threads);
+}
+
+// ============================================================================
+// FIND DUPLICATES (SORT-BASED)
+//
+// ALGORITHM:
+// Phase 1: Build (size, digest, index) tuples       O(n), parallel
+// Phase 2: LSD radix sort, skipping constant bytes  O(passes * n), parallel
+// Phase 3: Linear scan for runs of equal keys       O(n)
+// Phase 4: Extract groups                           O(duplicates)
+//
+// MEMORY: 2 * n * sizeof(SortKey) = 48n bytes, allocated up front
+// ============================================================================
+static DuplicateResults group_sorted(FileInfo* files, int count, int threads) {
+    DuplicateResults results = {0};
+
+    if (!files || count <= 1) {
+        return results;
+    }
+
+    if (threads <= 0) threads = get_worker_count();
+
+    SortKey* keys = (SortKey*)malloc(count * sizeof(SortKey));
+    SortKey* scratch = (SortKey*)malloc(count * sizeof(SortKey));
+    if (!keys || !scratch) {
+        free(keys);
+        free(scratch);
+        return results;
+    }
+
+    // ========================================================================
+    // PHASE 1 + 2: BUILD AND SORT
+    // ========================================================================
+    SortKey* sorted = radix_sort_tuples(keys, scratch, count, files, threads);
+    if (!sorted) {
+        free(keys);
+        free(scratch);
+        return results;
+    }
+
+    // ========================================================================
+    // PHASE 3: COUNT RUNS
+    // ========================================================================
+    // Failed hashes carry no real digest and may share a key with a real
+    // file, so they are dropped from runs rather than grouped
+    int group_count = 0;
+    int member_count = 0;
+    for (int i = 0; i < count; ) {
+        int j = i;
+        int valid = 0;
+        while (j < count && sorted[j].digest == sorted[i].digest &&
+               sorted[j].size == sorted[i].size) {
+            if (strncmp(files[sorted[j].index].hash, "ERROR", 5) != 0) valid++;
+            j++;
+        }
+        if (valid > 1) {
+            group_count++;
+            member_count += valid;
+        }
+        i = j;
+    }
+
+    if (group_count == 0) {
+        free(keys);
+        free(scratch);
+        return results;
+    }
+
+    // ========================================================================
+    // PHASE 4: EXTRACT DUPLICATE GROUPS
+    // Groups are spans of one member array that indexes files[]
+    // ========================================================================
+    results.groups = (DuplicateGroup*)malloc(group_count * sizeof(DuplicateGroup));
+    results.members = (int*)malloc(member_count * sizeof(int));
+    if (!results.groups || !results.members) {
+        free_duplicate_results(&results);
+        free(keys);
+        free(scratch);
+        return results;
+    }
+    results.capacity = group_count;
+    results.files = files;
+
+    int* next = results.members;
+    for (int i = 0; i < count; ) {
+        int j = i;
+        int valid = 0;
+        while (j < count && sorted[j].digest == sorted[i].digest &&
+               sorted[j].size == sorted[i].size) {
+            if (strncmp(files[sorted[j].index].hash, "ERROR", 5) != 0) valid++;
+            j++;
+        }
+
+        if (valid > 1) {
+            DuplicateGroup* group = &results.groups[results.count++];
+            group->members = next;
+            group->count = 0;
+            group->size = (long long)sorted[i].size;
+            for (int k = i; k < j; k++) {
+                if (strncmp(files[sorted[k].index].hash, "ERROR", 5) != 0) {
+                    group->members[group->count++] = (int)sorted[k].index;
+                }
+            }
+            next += group->count;
+        }
+        i = j;
+    }
+
+    free(keys);
+    free(scratch);
+    return results;
+}
+
+DuplicateResults find_duplicates_sorted(FileInfo* files, int count, int threads) {
+    TELEMETRY_START(t);
+    DuplicateResults results = group_sorted(files, count, threads);
+    TELEMETRY_STOP(TELEMETRY_GROUP, t);
+    return results;
+}
+
+/*
+ * ============================================================================
+ * SORT VS HASH GROUPING
+ * ============================================================================
+ *
+ * PASSES:
+ * -------
+ * 16 key bytes, but a byte that is equal in every key is skipped (its
+ * histogram has one bucket holding n). File sizes rarely exceed 2^40,
+ * so the top 3 size bytes are usually skipped: ~13 passes.
+ *
+ * PARALLEL SCALING:
+ * -----------------
+ * Each pass reads n tuples and writes n tuples; threads own disjoint input
+ * slices and disjoint output ranges, so no locks or atomics are needed
+ * inside a pass - only two barriers per pass.
+ *
+ * WHEN TO PREFER IT:
+ * ------------------
+ * - Memory must be bounded in advance (48 bytes per file, no rehash)
+ * - Output order must be reproducible between runs
+ * - Many cores available: hash-table inserts are random access and
+ *   contend on memory latency; radix passes are streaming
+ *
+ * ============================================================================
+ */
@@ -0,0 +1,283 @@
+/*
+ * STREAM.C - Online Duplicate Index filled while the scan runs
+ *
+ * DSA CONCEPTS DEMONSTRATED:
+ * 1. Online Algorithm (answer grows with the input, no final pass needed)
+ * 2. Lock Striping (one lock per digest range instead of one global lock)
+ * 3. Hash Table with Open Addressing (dup_table.c, one per stripe)
+ * 4. Dynamic Arrays with Amortized Doubling
+ *
+ * ALGORITHM: Every file is inserted as soon as its hash is known. A file
+ * whose key is already present turns a singleton into a group (or grows
+ * one), and the owner is told through a callback, so duplicates show up
+ * minutes or hours before the scan ends.
+ */
+
+#include "common.h"
+
+// ============================================================================
+// STREAM GROUP
+//
+// One per distinct (digest, size). Singletons keep their only member in
+// `first` and allocate nothing; most files never get a second member.
+// ============================================================================
+typedef struct {
+    int first;
+    int* members;            // NULL until the second member arrives
+    int count;
+    int capacity;
+} StreamGroup;
+
+// ============================================================================
+// STRIPE
+//
+// Files are routed to a stripe by the high digest bits, so two inserts
+// only contend when they hit the same 1/STREAM_STRIPES of the key space.
+// ============================================================================
+typedef struct {
+    CRITICAL_SECTION lock;
+    DupTable table;          // Key -> index into groups[]
+    StreamGroup* groups;
+    int group_count;
+    int group_capacity;
+    int duplicate_groups;    // Groups with 2+ members
+    int duplicate_members;   // Members of those groups
+} Stripe;
+
+struct StreamIndex {
+    Stripe stripes[STREAM_STRIPES];
+    GroupFoundCallback callback;
+    void* context;
+};
+
+static int stripe_of(uint64_t digest) {
+    return (int)((digest >> 32) * STREAM_STRIPES >> 32);
+}
+
+// ============================================================================
+// CREATE / DESTROY
+// ============================================================================
+StreamIndex* stream_index_create(GroupFoundCallback callback, void* context) {
+    StreamIndex* index = (StreamIndex*)calloc(1, sizeof(StreamIndex));
+    if (!index) return NULL;
+
+    for (int s = 0; s < STREAM_STRIPES; s++) {
+        if (!dup_table_init(&index->stripes[s].table, STREAM_INITIAL_KEYS)) {
+            for (int t = 0; t < s; t++) {
+                dup_table_free(&index->stripes[t].table);
+                DeleteCriticalSection(&index->stripes[t].lock);
+            }
+            free(index);
+            return NULL;
+        }
+        InitializeCriticalSection(&index->stripes[s].lock);
+    }
+
+    index->callback = callback;
+    index->context = context;
+    return index;
+}
+
+void stream_index_destroy(StreamIndex* index) {
+    if (!index) return;
+
+    for (int s = 0; s < STREAM_STRIPES; s++) {
+        Stripe* stripe = &index->stripes[s];
+        for (int g = 0; g < stripe->group_count; g++) {
+            free(stripe->groups[g].members);
+        }
+        free(stripe->groups);
+        dup_table_free(&stripe->table);
+        DeleteCriticalSection(&stripe->lock);
+    }
+    free(index);
+}
+
+// ============================================================================
+// ADD MEMBER (stripe lock held)
+//
+// RETURNS: new member count of the group, 0 if out of memory
+// ============================================================================
+static int add_member(StreamGroup* group, int file_idx) {
+    if (group->count == 1) {
+        group->members = (int*)malloc(4 * sizeof(int));
+        if (!group->members) return 0;
+        group->members[0] = group->first;
+        group->capacity = 4;
+    } else if (group->count >= group->capacity) {
+        int new_capacity = group->capacity * 2;
+        int* grown = (int*)realloc(group->members, new_capacity * sizeof(int));
+        if (!grown) return 0;
+        group->members = grown;
+        group->capacity = new_capacity;
+    }
+
+    group->members[group->count++] = file_idx;
+    return group->count;
+}
+
+// ============================================================================
+// ADD FILE
+//
+// Call once per file, after files[file_idx] is completely written.
+// Files that failed to hash are ignored. Safe to call from several
+// threads at once; the callback runs on the calling thread, outside
+// the stripe lock.
+// ============================================================================
+void stream_index_add(StreamIndex* index, const FileInfo* files, int file_idx) {
+    if (!index || !files) return;
+
+    const FileInfo* file = &files[file_idx];
+    if (strncmp(file->hash, "ERROR", 5) == 0) return;
+
+    Stripe* stripe = &index->stripes[stripe_of(file->digest)];
+    int found = 0;
+
+    EnterCriticalSection(&stripe->lock);
+
+    // Make room for a new group first, so a key is never in the table
+    // without its group (ids would drift apart)
+    if (stripe->group_count >= stripe->group_capacity) {
+        int new_capacity = stripe->group_capacity ? stripe->group_capacity * 2 : 256;
+        StreamGroup* grown = (StreamGroup*)realloc(stripe->groups,
+                                                   new_capacity * sizeof(StreamGroup));
+        if (!grown) {
+            LeaveCriticalSection(&stripe->lock);
+            return;
+        }
+        stripe->groups = grown;
+        stripe->group_capacity = new_capacity;
+    }
+
+    int g = dup_table_insert(&stripe->table, file->digest, file->size);
+    if (g >= 0 && g < stripe->group_count) {
+        found = add_member(&stripe->groups[g], file_idx);
+        if (found == 2) {
+            stripe->duplicate_groups++;
+            stripe->duplicate_members += 2;
+        } else if (found > 2) {
+            stripe->duplicate_members++;
+        }
+    } else if (g == stripe->group_count) {
+        // New key: group ids are handed out in first-seen order
+        StreamGroup* group = &stripe->groups[stripe->group_count++];
+        memset(group, 0, sizeof(StreamGroup));
+        group->first = file_idx;
+        group->count = 1;
+    }
+
+    LeaveCriticalSection(&stripe->lock);
+
+    if (found >= 2 && index->callback) {
+        index->callback(index->context, file, found);
+    }
+}
+
+// ============================================================================
+// RETIRE GROUP
+//
+// Called after a group has been acted on (deleted, moved, linked) while
+// the scan is still running. The group shrinks back to its first member,
+// so it is not offered again, but later copies still form a new group.
+// ============================================================================
+void stream_index_retire(StreamIndex* index, uint64_t digest, long long size) {
+    if (!index) return;
+
+    Stripe* stripe = &index->stripes[stripe_of(digest)];
+    EnterCriticalSection(&stripe->lock);
+
+    int g = dup_table_find(&stripe->table, digest, size);
+    if (g >= 0 && g < stripe->group_count && stripe->groups[g].count > 1) {
+        StreamGroup* group = &stripe->groups[g];
+        stripe->duplicate_groups--;
+        stripe->duplicate_members -= group->count;
+        group->first = group->members[0];
+        group->count = 1;
+        free(group->members);
+        group->members = NULL;
+        group->capacity = 0;
+    }
+
+    LeaveCriticalSection(&stripe->lock);
+}
+
+// ============================================================================
+// SNAPSHOT
+//
+// Collects every group with 2+ members into a DuplicateResults, with the
+// TOP_GROUPS_DEFAULT largest reclaimable sizes first, so the groups worth
+// reviewing early are at the top. Members index `files` (the scan's table,
+// which only grows while the scan runs), so only indices are copied.
+// Stripes are locked one at a time, so the scan is never stalled for the
+// whole copy.
+//
+// Files are hashed by several workers, so members arrive in any order;
+// each group is put back in file order, so member 0 (the file actions
+// keep) is the first one the scan found, as it would be scanning serially.
+// ============================================================================
+static int compare_index(const void* a, const void* b) {
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+static bool reserve(void** array, int* capacity, int needed, size_t item_size) {
+    if (needed <= *capacity) return true;
+
+    int new_capacity = *capacity ? *capacity : 16;
+    while (new_capacity < needed) new_capacity *= 2;
+
+    void* grown = realloc(*array, new_capacity * item_size);
+    if (!grown) return false;
+
+    *array = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+DuplicateResults stream_index_snapshot(StreamIndex* index, FileInfo* files) {
+    DuplicateResults results = {0};
+    if (!index || !files) return results;
+
+    int member_count = 0;
+    int member_capacity = 0;
+
+    for (int s = 0; s < STREAM_STRIPES; s++) {
+        Stripe* stripe = &index->stripes[s];
+        EnterCriticalSection(&stripe->lock);
+
+        if (!reserve((void**)&results.groups, &results.capacity,
+                     results.count + stripe->duplicate_groups, sizeof(DuplicateGroup)) ||
+            !reserve((void**)&results.members, &member_capacity,
+                     member_count + stripe->duplicate_members, sizeof(int))) {
+            LeaveCriticalSection(&stripe->lock);
+            break;
+        }
+
+        for (int g = 0; g < stripe->group_count; g++) {
+            const StreamGroup* sg = &stripe->groups[g];
+            if (sg->count <= 1) continue;
+
+            // members pointers are set once the array stops moving
+            DuplicateGroup* group = &results.groups[results.count++];
+            group->count = sg->count;
+            group->size = files[sg->first].size;
+            memcpy(results.members + member_count, sg->members, sg->count * sizeof(int));
+            qsort(results.members + member_count, sg->count, sizeof(int), compare_index);
+            member_count += sg->count;
+        }
+
+        LeaveCriticalSection(&stripe->lock);
+    }
+
+    int next = 0;
+    for (int g = 0; g < results.count; g++) {
+        results.groups[g].members = results.members + next;
+        next += results.groups[g].count;
+    }
+    results.files = files;
+
+    // Logical savings only: no file is opened while the scan runs
+    rank_results_by_savings(&results, TOP_GROUPS_DEFAULT, false);
+    return results;
+}
@@ -0,0 +1,336 @@
+/*
+ * TELEMETRY.C - Per-Thread Stage Timers and Counters
+ *
+ * DSA CONCEPTS DEMONSTRATED:
+ * 1. Thread-Local Records (each thread writes only its own record, a
+ *    cache line of its own, so counting never contends)
+ * 2. Lock-Free Push-Only List (records are linked in with one
+ *    compare-and-swap and never unlinked, so readers walk it unlocked)
+ * 3. Free-Slot Reuse (a record is handed to the next new thread once its
+ *    thread exits; parallel_for starts fresh threads on every call)
+ *
+ * WHY: A scan is enumerate -> open -> read -> hash -> group, then the
+ * actions; which one dominates depends on the disk, the share, the file
+ * sizes and the thread count. The engine marks each stage with
+ * TELEMETRY_START / TELEMETRY_STOP (common.h) and counts syscalls, bytes
+ * read, cache hits and queue waits with TELEMETRY_COUNT. This file sums
+ * them into a JSON report at the end of a run and, optionally, into
+ * periodic snapshots (one JSON object per line) while it runs.
+ *
+ * Only compiled with -DDEDUP_TELEMETRY. Without it the macros expand to
+ * nothing and this file is empty, so a normal build pays nothing at all.
+ *
+ * Stage seconds are thread-seconds: four workers hashing for one second
+ * report four seconds of "hash". Comparing a stage's seconds with
+ * elapsed_seconds * threads shows how busy the workers were.
+ */
+
+#include "common.h"
+
+#ifdef DEDUP_TELEMETRY
+
+#ifdef _WIN32
+#include <malloc.h>    // _aligned_malloc
+#endif
+
+typedef struct DECLSPEC_ALIGN(CACHE_LINE_SIZE) TelemetryRecord {
+    volatile LONG64 ticks[TELEMETRY_STAGE_COUNT];
+    volatile LONG64 calls[TELEMETRY_STAGE_COUNT];
+    volatile LONG64 counters[TELEMETRY_COUNTER_COUNT];
+    struct TelemetryRecord* next;
+    volatile LONG in_use;         // A live thread owns this record
+    int id;
+} TelemetryRecord;
+
+// One reading of one record, or the sum of all of them
+typedef struct {
+    long long ticks[TELEMETRY_STAGE_COUNT];
+    long long calls[TELEMETRY_STAGE_COUNT];
+    long long counters[TELEMETRY_COUNTER_COUNT];
+} TelemetryTotals;
+
+static const char* const STAGE_NAMES[TELEMETRY_STAGE_COUNT] = {
+    "enumerate", "open", "read", "hash", "group", "action", "queue_wait"
+};
+
+static const char* const COUNTER_NAMES[TELEMETRY_COUNTER_COUNT] = {
+    "syscalls", "bytes_read", "cache_hits", "cache_misses", "queue_waits"
+};
+
+static INIT_ONCE g_telemetry_once = INIT_ONCE_STATIC_INIT;
+static DWORD g_record_slot = FLS_OUT_OF_INDEXES;
+static TelemetryRecord* volatile g_records = NULL;
+static volatile LONG g_record_count = 0;
+static LARGE_INTEGER g_frequency;
+static volatile LONG64 g_epoch;
+
+static HANDLE g_snapshot_thread = NULL;
+static HANDLE g_snapshot_stop = NULL;
+static FILE* g_snapshot_file = NULL;
+static DWORD g_snapshot_interval = TELEMETRY_SNAPSHOT_MS;
+
+// ============================================================================
+// THREAD RECORDS
+//
+// A thread finds its record through a fiber-local slot. The slot's
+// destructor runs when the thread exits and marks the record free; the
+// counts stay in it and keep adding up under the next thread.
+// ============================================================================
+static VOID WINAPI release_record(PVOID data) {
+    InterlockedExchange(&((TelemetryRecord*)data)->in_use, 0);
+}
+
+static BOOL CALLBACK init_telemetry(PINIT_ONCE once, PVOID param, PVOID* context) {
+    (void)once; (void)param; (void)context;
+    QueryPerformanceFrequency(&g_frequency);
+    g_epoch = telemetry_now();
+    g_record_slot = FlsAlloc(release_record);
+    return TRUE;
+}
+
+static TelemetryRecord* thread_record(void) {
+    InitOnceExecuteOnce(&g_telemetry_once, init_telemetry, NULL, NULL);
+    if (g_record_slot == FLS_OUT_OF_INDEXES) return NULL;
+
+    TelemetryRecord* record = (TelemetryRecord*)FlsGetValue(g_record_slot);
+    if (record) return record;
+
+    // A record left behind by an exited thread
+    for (record = g_records; record; record = record->next) {
+        if (InterlockedCompareExchange(&record->in_use, 1, 0) == 0) break;
+    }
+
+    if (!record) {
+        record = (TelemetryRecord*)_aligned_malloc(sizeof(TelemetryRecord), CACHE_LINE_SIZE);
+        if (!record) return NULL;
+        memset(record, 0, sizeof(TelemetryRecord));
+        record->in_use = 1;
+        record->id = InterlockedIncrement(&g_record_count) - 1;
+
+        TelemetryRecord* head;
+        do {
+            head = g_records;
+            record->next = head;
+        } while (InterlockedCompareExchangePointer((PVOID volatile*)&g_records,
+                                                   record, head) != head);
+    }
+
+    FlsSetValue(g_record_slot, record);
+    return record;
+}
+
+// ============================================================================
+// HOT PATH (behind the TELEMETRY_* macros)
+// ============================================================================
+long long telemetry_now(void) {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return now.QuadPart;
+}
+
+// Adds the time since start to stage; returns the end time, so the next
+// stage can start from it without reading the clock again
+long long telemetry_stop(TelemetryStage stage, long long start) {
+    long long now = telemetry_now();
+    TelemetryRecord* record = thread_record();
+    if (record) {
+        InterlockedExchangeAdd64(&record->ticks[stage], now - start);
+        InterlockedIncrement64(&record->calls[stage]);
+    }
+    return now;
+}
+
+void telemetry_count(TelemetryCounter counter, long long n) {
+    TelemetryRecord* record = thread_record();
+    if (record) InterlockedExchangeAdd64(&record->counters[counter], n);
+}
+
+// Between runs: counts from threads still working would be lost
+void telemetry_reset(void) {
+    InitOnceExecuteOnce(&g_telemetry_once, init_telemetry, NULL, NULL);
+
+    for (TelemetryRecord* record = g_records; record; record = record->next) {
+        for (int s = 0; s < TELEMETRY_STAGE_COUNT; s++) {
+            InterlockedExchange64(&record->ticks[s], 0);
+            InterlockedExchange64(&record->calls[s], 0);
+        }
+        for (int c = 0; c < TELEMETRY_COUNTER_COUNT; c++) {
+            InterlockedExchange64(&record->counters[c], 0);
+        }
+    }
+    InterlockedExchange64(&g_epoch, telemetry_now());
+}
+
+// ============================================================================
+// READING
+// ============================================================================
+static long long read64(volatile LONG64* value) {
+    return InterlockedCompareExchange64(value, 0, 0);
+}
+
+static bool read_record(TelemetryRecord* record, TelemetryTotals* totals) {
+    bool used = false;
+    for (int s = 0; s < TELEMETRY_STAGE_COUNT; s++) {
+        totals->ticks[s] = read64(&record->ticks[s]);
+        totals->calls[s] = read64(&record->calls[s]);
+        if (totals->calls[s]) used = true;
+    }
+    for (int c = 0; c < TELEMETRY_COUNTER_COUNT; c++) {
+        totals->counters[c] = read64(&record->counters[c]);
+        if (totals->counters[c]) used = true;
+    }
+    return used;
+}
+
+static void add_totals(TelemetryTotals* sum, const TelemetryTotals* part) {
+    for (int s = 0; s < TELEMETRY_STAGE_COUNT; s++) {
+        sum->ticks[s] += part->ticks[s];
+        sum->calls[s] += part->calls[s];
+    }
+    for (int c = 0; c < TELEMETRY_COUNTER_COUNT; c++) {
+        sum->counters[c] += part->counters[c];
+    }
+}
+
+static double elapsed_seconds(void) {
+    return (double)(telemetry_now() - read64(&g_epoch)) / (double)g_frequency.QuadPart;
+}
+
+// ============================================================================
+// JSON
+// ============================================================================
+// "stages":{"enumerate":{"calls":n,"seconds":s},...},"counters":{...}
+static void write_body(FILE* out, const TelemetryTotals* totals) {
+    fprintf(out, "\"stages\":{");
+    for (int s = 0; s < TELEMETRY_STAGE_COUNT; s++) {
+        fprintf(out, "%s\"%s\":{\"calls\":%lld,\"seconds\":%.6f}",
+                s ? "," : "", STAGE_NAMES[s], totals->calls[s],
+                (double)totals->ticks[s] / (double)g_frequency.QuadPart);
+    }
+    fprintf(out, "},\"counters\":{");
+    for (int c = 0; c < TELEMETRY_COUNTER_COUNT; c++) {
+        fprintf(out, "%s\"%s\":%lld", c ? "," : "", COUNTER_NAMES[c], totals->counters[c]);
+    }
+    fprintf(out, "}");
+}
+
+// ============================================================================
+// REPORT (end of run)
+//
+// {"version":1, "elapsed_seconds":..., "timer_resolution_ns":...,
+//  "stages":{...}, "counters":{...},      totals over all threads
+//  "threads":[{"id":0, "stages":{...}, "counters":{...}}, ...]}
+//
+// Only records that counted something are listed.
+// ============================================================================
+bool telemetry_write_report(const char* path) {
+    if (!path) return false;
+    InitOnceExecuteOnce(&g_telemetry_once, init_telemetry, NULL, NULL);
+
+    FILE* out = fopen(path, "w");
+    if (!out) return false;
+
+    TelemetryTotals sum;
+    memset(&sum, 0, sizeof(sum));
+    for (TelemetryRecord* record = g_records; record; record = record->next) {
+        TelemetryTotals part;
+        read_record(record, &part);
+        add_totals(&sum, &part);
+    }
+
+    fprintf(out, "{\"version\":%d,\"elapsed_seconds\":%.6f,\"timer_resolution_ns\":%.1f,\n",
+            TELEMETRY_VERSION, elapsed_seconds(), 1e9 / (double)g_frequency.QuadPart);
+    write_body(out, &sum);
+    fprintf(out, ",\n\"threads\":[");
+
+    // The list is newest first; print by id
+    int listed = 0;
+    for (int id = 0; id < g_record_count; id++) {
+        for (TelemetryRecord* record = g_records; record; record = record->next) {
+            if (record->id != id) continue;
+
+            TelemetryTotals part;
+            if (read_record(record, &part)) {
+                fprintf(out, "%s\n{\"id\":%d,", listed++ ? "," : "", id);
+                write_body(out, &part);
+                fprintf(out, "}");
+            }
+            break;
+        }
+    }
+    fprintf(out, "\n]}\n");
+
+    bool ok = !ferror(out);
+    return fclose(out) == 0 && ok;
+}
+
+// ============================================================================
+// SNAPSHOTS (while running)
+//
+// A background thread appends one line per interval:
+//   {"elapsed_seconds":..., "stages":{...}, "counters":{...}}
+// plus a last one when stopped, so the series always reaches the end.
+// ============================================================================
+static void write_snapshot(void) {
+    TelemetryTotals sum;
+    memset(&sum, 0, sizeof(sum));
+    for (TelemetryRecord* record = g_records; record; record = record->next) {
+        TelemetryTotals part;
+        read_record(record, &part);
+        add_totals(&sum, &part);
+    }
+
+    fprintf(g_snapshot_file, "{\"elapsed_seconds\":%.6f,", elapsed_seconds());
+    write_body(g_snapshot_file, &sum);
+    fprintf(g_snapshot_file, "}\n");
+    fflush(g_snapshot_file);
+}
+
+static DWORD WINAPI SnapshotThread(LPVOID param) {
+    (void)param;
+    while (WaitForSingleObject(g_snapshot_stop, g_snapshot_interval) == WAIT_TIMEOUT) {
+        write_snapshot();
+    }
+    return 0;
+}
+
+// One snapshot series at a time; path is appended to
+bool telemetry_start_snapshots(const char* path, DWORD interval_ms) {
+    if (!path || g_snapshot_thread) return false;
+    InitOnceExecuteOnce(&g_telemetry_once, init_telemetry, NULL, NULL);
+
+    g_snapshot_file = fopen(path, "a");
+    if (!g_snapshot_file) return false;
+
+    g_snapshot_interval = interval_ms > 0 ? interval_ms : TELEMETRY_SNAPSHOT_MS;
+    g_snapshot_stop = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (g_snapshot_stop) {
+        g_snapshot_thread = CreateThread(NULL, 0, SnapshotThread, NULL, 0, NULL);
+    }
+
+    if (!g_snapshot_thread) {
+        if (g_snapshot_stop) CloseHandle(g_snapshot_stop);
+        g_snapshot_stop = NULL;
+        fclose(g_snapshot_file);
+        g_snapshot_file = NULL;
+        return false;
+    }
+    return true;
+}
+
+void telemetry_stop_snapshots(void) {
+    if (!g_snapshot_thread) return;
+
+    SetEvent(g_snapshot_stop);
+    WaitForSingleObject(g_snapshot_thread, INFINITE);
+    CloseHandle(g_snapshot_thread);
+    CloseHandle(g_snapshot_stop);
+    g_snapshot_thread = NULL;
+    g_snapshot_stop = NULL;
+
+    write_snapshot();
+    fclose(g_snapshot_file);
+    g_snapshot_file = NULL;
+}
+
+#endif // DEDUP_TELEMETRY
@@ -0,0 +1,1030 @@
+/*
+ * WATCH.C - Live Duplicate Index kept current by change notifications
+ *
+ * DSA CONCEPTS DEMONSTRATED:
+ * 1. Incremental Maintenance (update only what changed)
+ * 2. Hash Tables with Separate Chaining and Rehashing
+ * 3. Event Coalescing (set-based deduplication of events)
+ * 4. Producer/Consumer (OS notifications -> index updates)
+ * 5. Prefix Re-keying (a renamed folder moves its records, no disk I/O)
+ *
+ * ALGORITHM: One full scan seeds the index. After that, every change
+ * notification only touches the file record and the duplicate group it
+ * belongs to, so keeping results current costs O(changes), not O(files).
+ */
+
+#include "common.h"
+
+// ============================================================================
+// CONTENT NODE
+//
+// One node per distinct (hash, size) pair. Unlike filter.c the index is
+// long-lived, so members can also leave a node when a file changes.
+// ============================================================================
+typedef struct ContentNode {
+    char hash[HASH_LENGTH];
+    long long size;
+    int* file_indices;
+    int count;
+    int capacity;
+    struct ContentNode* next;
+} ContentNode;
+
+// ============================================================================
+// PATH NODE
+//
+// Maps a path back to its slot in the file table (chained hash table)
+// ============================================================================
+typedef struct PathNode {
+    int file_idx;
+    struct PathNode* next;
+} PathNode;
+
+// ============================================================================
+// PENDING CHANGE SET
+//
+// Paths reported by the OS since the last flush. A burst of notifications
+// for one file (create, size, write, write...) collapses into one entry,
+// keeping the strongest kind. Renames are applied in arrival order and
+// never coalesced.
+// ============================================================================
+typedef enum {
+    CHANGE_REFRESH,              // File changed, or one directory's listing did
+    CHANGE_ADDED,                // Appeared from outside the index: walk it
+    CHANGE_RESYNC,               // Notification buffer overflowed for a root
+    CHANGE_RENAME                // from -> path, re-keyed in memory
+} ChangeKind;
+
+typedef struct PendingEntry {
+    char* path;
+    char* from;                  // CHANGE_RENAME only
+    ChangeKind kind;
+    struct PendingEntry* next;
+} PendingEntry;
+
+typedef struct {
+    PendingEntry* buckets[WATCH_PENDING_BUCKETS];
+    PendingEntry** items;
+    int count;
+    int capacity;
+} PendingSet;
+
+typedef struct {
+    HANDLE dir;
+    OVERLAPPED ov;
+    DWORD* buffer;               // DWORD-aligned for FILE_NOTIFY_INFORMATION
+    char path[MAX_PATH_LENGTH];
+    char rename_from[MAX_PATH_LENGTH];  // Old name awaiting its new name
+} WatchRoot;
+
+struct LiveIndex {
+    // File table (slots are reused through the free list)
+    FileInfo* files;
+    ContentNode** owner;         // Content node each slot belongs to
+    int* seen;                   // Sweep generation, used for resync
+    int count;
+    int capacity;
+    int* free_slots;
+    int free_count;
+
+    // Path -> slot
+    PathNode** path_table;
+    int path_buckets;
+    int live_files;
+
+    // (hash, size) -> members
+    ContentNode** content_table;
+    int content_buckets;
+    int content_nodes;
+
+    ScanMode mode;
+    CRITICAL_SECTION lock;
+
+    // Watcher state
+    ScanConfig config;
+    WatchRoot roots[MAX_DIRECTORIES];
+    int root_count;
+    HANDLE thread;
+    HANDLE stop_event;
+    IndexChangedCallback callback;
+    void* context;
+    int sweep_gen;
+};
+
+// ============================================================================
+// CASE-INSENSITIVE DJB2
+//
+// Windows paths compare case-insensitively, so fold before hashing
+// ============================================================================
+static unsigned int path_hash(const char* str) {
+    unsigned int hash = 5381;
+    int c;
+
+    while ((c = (unsigned char)*str++)) {
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        hash = ((hash << 5) + hash) + c;
+    }
+    return hash;
+}
+
+static unsigned int content_hash(const char* hash_str, long long size) {
+    unsigned int hash = 5381;
+    int c;
+
+    while ((c = *hash_str++)) {
+        hash = ((hash << 5) + hash) + c;
+    }
+    return hash ^ (unsigned int)(size ^ (size >> 32));
+}
+
+// ============================================================================
+// REHASH (DOUBLING STRATEGY)
+//
+// Keeps load factor <= 1 as the index grows: O(n) per doubling,
+// O(1) amortized per insertion.
+// ============================================================================
+static void rehash_paths(LiveIndex* index) {
+    int new_buckets = index->path_buckets * 2;
+    PathNode** table = (PathNode**)calloc(new_buckets, sizeof(PathNode*));
+    if (!table) return;  // Keep working with longer chains
+
+    for (int i = 0; i < index->path_buckets; i++) {
+        PathNode* node = index->path_table[i];
+        while (node) {
+            PathNode* next = node->next;
+            unsigned int b = path_hash(index->files[node->file_idx].path) % new_buckets;
+            node->next = table[b];
+            table[b] = node;
+            node = next;
+        }
+    }
+
+    free(index->path_table);
+    index->path_table = table;
+    index->path_buckets = new_buckets;
+}
+
+static void rehash_content(LiveIndex* index) {
+    int new_buckets = index->content_buckets * 2;
+    ContentNode** table = (ContentNode**)calloc(new_buckets, sizeof(ContentNode*));
+    if (!table) return;
+
+    for (int i = 0; i < index->content_buckets; i++) {
+        ContentNode* node = index->content_table[i];
+        while (node) {
+            ContentNode* next = node->next;
+            unsigned int b = content_hash(node->hash, node->size) % new_buckets;
+            node->next = table[b];
+            table[b] = node;
+            node = next;
+        }
+    }
+
+    free(index->content_table);
+    index->content_table = table;
+    index->content_buckets = new_buckets;
+}
+
+static int lookup_path(LiveIndex* index, const char* path) {
+    unsigned int b = path_hash(path) % index->path_buckets;
+
+    for (PathNode* node = index->path_table[b]; node; node = node->next) {
+        if (_stricmp(index->files[node->file_idx].path, path) == 0) {
+            return node->file_idx;
+        }
+    }
+    return -1;
+}
+
+// ============================================================================
+// ATTACH / DETACH A SLOT TO ITS CONTENT GROUP
+//
+// Return the member count of the group touched, so the caller can tell
+// whether any duplicate group actually changed.
+// ============================================================================
+static int attach_content(LiveIndex* index, int idx) {
+    FileInfo* info = &index->files[idx];
+    index->owner[idx] = NULL;
+
+    if (strncmp(info->hash, "ERROR", 5) == 0) {
+        return 0;
+    }
+
+    unsigned int b = content_hash(info->hash, info->size) % index->content_buckets;
+    ContentNode* node = index->content_table[b];
+
+    while (node) {
+        if (node->size == info->size && strcmp(node->hash, info->hash) == 0) {
+            break;
+        }
+        node = node->next;
+    }
+
+    if (!node) {
+        node = (ContentNode*)calloc(1, sizeof(ContentNode));
+        if (!node) return 0;
+
+        strcpy(node->hash, info->hash);
+        node->size = info->size;
+        node->next = index->content_table[b];
+        index->content_table[b] = node;
+        index->content_nodes++;
+    }
+
+    if (node->count >= node->capacity) {
+        int new_capacity = node->capacity ? node->capacity * 2 : 4;
+        int* grown = (int*)realloc(node->file_indices, new_capacity * sizeof(int));
+        if (!grown) return 0;
+        node->file_indices = grown;
+        node->capacity = new_capacity;
+    }
+
+    node->file_indices[node->count++] = idx;
+    index->owner[idx] = node;
+
+    if (index->content_nodes > index->content_buckets) {
+        rehash_content(index);
+    }
+
+    return node->count;
+}
+
+static int detach_content(LiveIndex* index, int idx) {
+    ContentNode* node = index->owner[idx];
+    if (!node) return 0;
+
+    int before = node->count;
+
+    // Swap-remove: order inside a group carries no meaning
+    for (int i = 0; i < node->count; i++) {
+        if (node->file_indices[i] == idx) {
+            node->file_indices[i] = node->file_indices[--node->count];
+            break;
+        }
+    }
+
+    // Empty nodes stay in the chain; the same content often comes back
+    // (e.g. save-via-rename) and snapshots skip them anyway.
+    index->owner[idx] = NULL;
+    return before;
+}
+
+// ============================================================================
+// FILE TABLE SLOTS
+// ============================================================================
+static int alloc_slot(LiveIndex* index) {
+    if (index->free_count > 0) {
+        return index->free_slots[--index->free_count];
+    }
+
+    if (index->count >= index->capacity) {
+        int new_capacity = index->capacity * 2;
+        FileInfo* files = (FileInfo*)realloc(index->files, new_capacity * sizeof(FileInfo));
+        if (!files) return -1;
+        index->files = files;
+
+        ContentNode** owner = (ContentNode**)realloc(index->owner, new_capacity * sizeof(ContentNode*));
+        if (!owner) return -1;
+        index->owner = owner;
+
+        int* seen = (int*)realloc(index->seen, new_capacity * sizeof(int));
+        if (!seen) return -1;
+        index->seen = seen;
+
+        int* free_slots = (int*)realloc(index->free_slots, new_capacity * sizeof(int));
+        if (!free_slots) return -1;
+        index->free_slots = free_slots;
+
+        index->capacity = new_capacity;
+    }
+
+    return index->count++;
+}
+
+static int add_file(LiveIndex* index, const FileInfo* info) {
+    int idx = alloc_slot(index);
+    if (idx < 0) return 0;
+
+    PathNode* pnode = (PathNode*)malloc(sizeof(PathNode));
+    if (!pnode) {
+        index->free_slots[index->free_count++] = idx;
+        return 0;
+    }
+
+    index->files[idx] = *info;
+    index->seen[idx] = index->sweep_gen;
+
+    unsigned int b = path_hash(info->path) % index->path_buckets;
+    pnode->file_idx = idx;
+    pnode->next = index->path_table[b];
+    index->path_table[b] = pnode;
+    index->live_files++;
+
+    if (index->live_files > index->path_buckets) {
+        rehash_paths(index);
+    }
+
+    return attach_content(index, idx);
+}
+
+static int remove_file(LiveIndex* index, int idx) {
+    int touched = detach_content(index, idx);
+
+    unsigned int b = path_hash(index->files[idx].path) % index->path_buckets;
+    PathNode** link = &index->path_table[b];
+
+    while (*link) {
+        if ((*link)->file_idx == idx) {
+            PathNode* dead = *link;
+            *link = dead->next;
+            free(dead);
+            break;
+        }
+        link = &(*link)->next;
+    }
+
+    index->files[idx].path[0] = '\0';
+    index->free_slots[index->free_count++] = idx;
+    index->live_files--;
+
+    return touched;
+}
+
+// ============================================================================
+// CREATE / DESTROY
+// ============================================================================
+LiveIndex* live_index_create(const FileInfo* files, int count, ScanMode mode) {
+    LiveIndex* index = (LiveIndex*)calloc(1, sizeof(LiveIndex));
+    if (!index) return NULL;
+
+    int capacity = count > 1024 ? count * 2 : 2048;
+    int buckets = 1024;
+    while (buckets < count) buckets *= 2;
+
+    index->files = (FileInfo*)malloc(capacity * sizeof(FileInfo));
+    index->owner = (ContentNode**)calloc(capacity, sizeof(ContentNode*));
+    index->seen = (int*)calloc(capacity, sizeof(int));
+    index->free_slots = (int*)malloc(capacity * sizeof(int));
+    index->path_table = (PathNode**)calloc(buckets, sizeof(PathNode*));
+    index->content_table = (ContentNode**)calloc(buckets, sizeof(ContentNode*));
+
+    if (!index->files || !index->owner || !index->seen || !index->free_slots ||
+        !index->path_table || !index->content_table) {
+        free(index->files);
+        free(index->owner);
+        free(index->seen);
+        free(index->free_slots);
+        free(index->path_table);
+        free(index->content_table);
+        free(index);
+        return NULL;
+    }
+
+    index->capacity = capacity;
+    index->path_buckets = buckets;
+    index->content_buckets = buckets;
+    index->mode = mode;
+    InitializeCriticalSection(&index->lock);
+
+    for (int i = 0; i < count; i++) {
+        if (files && lookup_path(index, files[i].path) < 0) {
+            add_file(index, &files[i]);
+        }
+    }
+
+    return index;
+}
+
+void live_index_destroy(LiveIndex* index) {
+    if (!index) return;
+
+    watch_stop(index);
+
+    for (int i = 0; i < index->path_buckets; i++) {
+        PathNode* node = index->path_table[i];
+        while (node) {
+            PathNode* next = node->next;
+            free(node);
+            node = next;
+        }
+    }
+
+    for (int i = 0; i < index->content_buckets; i++) {
+        ContentNode* node = index->content_table[i];
+        while (node) {
+            ContentNode* next = node->next;
+            free(node->file_indices);
+            free(node);
+            node = next;
+        }
+    }
+
+    DeleteCriticalSection(&index->lock);
+    free(index->path_table);
+    free(index->content_table);
+    free(index->files);
+    free(index->owner);
+    free(index->seen);
+    free(index->free_slots);
+    free(index);
+}
+
+// ============================================================================
+// SNAPSHOT
+//
+// Same output shape as find_duplicates, built straight from the live
+// groups instead of rebuilding a hash table over every file. The index
+// keeps changing after this returns, so the members' records are copied
+// into a table owned by the results.
+// ============================================================================
+DuplicateResults live_index_snapshot(LiveIndex* index) {
+    DuplicateResults results = {0};
+    if (!index) return results;
+
+    EnterCriticalSection(&index->lock);
+
+    int group_count = 0;
+    int member_count = 0;
+    for (int i = 0; i < index->content_buckets; i++) {
+        for (ContentNode* node = index->content_table[i]; node; node = node->next) {
+            if (node->count > 1) {
+                group_count++;
+                member_count += node->count;
+            }
+        }
+    }
+
+    if (group_count > 0) {
+        results.groups = (DuplicateGroup*)malloc(group_count * sizeof(DuplicateGroup));
+        results.members = (int*)malloc(member_count * sizeof(int));
+        results.files = (FileInfo*)malloc(member_count * sizeof(FileInfo));
+        results.owns_files = true;
+    }
+
+    if (results.groups && results.members && results.files) {
+        results.capacity = group_count;
+        int next = 0;
+
+        for (int i = 0; i < index->content_buckets; i++) {
+            for (ContentNode* node = index->content_table[i]; node; node = node->next) {
+                if (node->count <= 1) continue;
+
+                DuplicateGroup* group = &results.groups[results.count++];
+                group->members = results.members + next;
+                group->count = node->count;
+                group->size = node->size;
+                for (int j = 0; j < node->count; j++) {
+                    results.files[next] = index->files[node->file_indices[j]];
+                    results.members[next] = next;
+                    next++;
+                }
+            }
+        }
+    } else {
+        free_duplicate_results(&results);
+    }
+
+    LeaveCriticalSection(&index->lock);
+    return results;
+}
+
+int live_index_file_count(LiveIndex* index) {
+    if (!index) return 0;
+
+    EnterCriticalSection(&index->lock);
+    int count = index->live_files;
+    LeaveCriticalSection(&index->lock);
+
+    return count;
+}
+
+// ============================================================================
+// REFRESH ONE FILE
+//
+// Stat and hash happen outside the lock; only the table update is locked.
+// An unchanged size + timestamp means the event was noise (attribute
+// change, metadata flush) and the file is not re-read.
+//
+// RETURNS: true if a duplicate group gained or lost a member
+// ============================================================================
+static bool refresh_file(LiveIndex* index, const char* path,
+                         const WIN32_FILE_ATTRIBUTE_DATA* data) {
+    FileInfo info;
+    strncpy(info.path, path, MAX_PATH_LENGTH - 1);
+    info.path[MAX_PATH_LENGTH - 1] = '\0';
+    info.size = ((long long)data->nFileSizeHigh << 32) | data->nFileSizeLow;
+    info.modified = FileTimeToTimeT(&data->ftLastWriteTime);
+
+    EnterCriticalSection(&index->lock);
+    int idx = lookup_path(index, path);
+    if (idx >= 0) {
+        index->seen[idx] = index->sweep_gen;
+        if (index->files[idx].size == info.size &&
+            index->files[idx].modified == info.modified) {
+            LeaveCriticalSection(&index->lock);
+            return false;
+        }
+    }
+    LeaveCriticalSection(&index->lock);
+
+    info.links = 0;
+    info.digest = compute_hash_ex(path, info.hash, index->mode, NULL, NULL, &info);
+
+    EnterCriticalSection(&index->lock);
+    int before = 0;
+    idx = lookup_path(index, path);
+    if (idx >= 0) {
+        before = remove_file(index, idx);
+    }
+    int after = add_file(index, &info);
+    LeaveCriticalSection(&index->lock);
+
+    return before > 1 || after > 1;
+}
+
+static bool forget_path(LiveIndex* index, const char* path) {
+    bool changed = false;
+    size_t len = strlen(path);
+
+    EnterCriticalSection(&index->lock);
+
+    int idx = lookup_path(index, path);
+    if (idx >= 0) {
+        changed = remove_file(index, idx) > 1;
+    } else {
+        // Might have been a directory: drop everything below it
+        for (int i = 0; i < index->count; i++) {
+            const char* p = index->files[i].path;
+            if (p[0] && _strnicmp(p, path, len) == 0 && p[len] == '\\') {
+                if (remove_file(index, i) > 1) changed = true;
+            }
+        }
+    }
+
+    LeaveCriticalSection(&index->lock);
+    return changed;
+}
+
+// ============================================================================
+// REFRESH A PATH (FILE OR DIRECTORY)
+//
+// With recurse, walks the whole subtree (DFS): only for directories that
+// are new to the index or a resync. Otherwise a directory is listed one
+// level deep: its files are refreshed, its subdirectories are left alone,
+// because the recursive watch reports changes inside them separately.
+// ============================================================================
+static bool refresh_path(LiveIndex* index, const char* path, bool recurse) {
+    if (is_excluded(&index->config.exclusions, path)) {
+        return false;
+    }
+
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &data)) {
+        return forget_path(index, path);
+    }
+
+    if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        return refresh_file(index, path, &data);
+    }
+
+    char search_path[MAX_PATH_LENGTH];
+    int len = snprintf(search_path, MAX_PATH_LENGTH, "%s\\*", path);
+    if (len >= MAX_PATH_LENGTH - 1) return false;
+
+    WIN32_FIND_DATAA ffd;
+    HANDLE hFind = FindFirstFileA(search_path, &ffd);
+    if (hFind == INVALID_HANDLE_VALUE) return false;
+
+    bool changed = false;
+    do {
+        if (strcmp(ffd.cFileName, ".") == 0 || strcmp(ffd.cFileName, "..") == 0) {
+            continue;
+        }
+
+        char full_path[MAX_PATH_LENGTH];
+        len = snprintf(full_path, MAX_PATH_LENGTH, "%s\\%s", path, ffd.cFileName);
+        if (len >= MAX_PATH_LENGTH - 1) continue;
+
+        if (ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            if (recurse && index->config.directories.include_subdirs &&
+                refresh_path(index, full_path, true)) {
+                changed = true;
+            }
+        } else {
+            WIN32_FILE_ATTRIBUTE_DATA fdata;
+            fdata.dwFileAttributes = ffd.dwFileAttributes;
+            fdata.ftLastWriteTime = ffd.ftLastWriteTime;
+            fdata.nFileSizeHigh = ffd.nFileSizeHigh;
+            fdata.nFileSizeLow = ffd.nFileSizeLow;
+            if (!is_excluded(&index->config.exclusions, full_path) &&
+                refresh_file(index, full_path, &fdata)) {
+                changed = true;
+            }
+        }
+    } while (FindNextFileA(hFind, &ffd));
+
+    FindClose(hFind);
+    return changed;
+}
+
+// ============================================================================
+// RENAME A PATH (RE-KEY BY PREFIX)
+//
+// A rename inside the watched tree leaves every file's contents alone, so
+// the records under the old name (the file itself, or everything below a
+// folder) only move to new path keys; nothing is read from disk. If the
+// index has nothing under the old name (it was excluded or never seen),
+// the new name is walked like an addition.
+// ============================================================================
+static bool rename_path(LiveIndex* index, const char* from, const char* to) {
+    if (is_excluded(&index->config.exclusions, to)) {
+        return forget_path(index, from);
+    }
+
+    size_t from_len = strlen(from);
+    bool changed = false;
+    bool moved = false;
+
+    EnterCriticalSection(&index->lock);
+
+    // Whatever the rename replaced is gone (unless only the case changed)
+    int idx = _stricmp(from, to) != 0 ? lookup_path(index, to) : -1;
+    if (idx >= 0 && remove_file(index, idx) > 1) changed = true;
+
+    for (int i = 0; i < index->count; i++) {
+        const char* p = index->files[i].path;
+        if (!p[0] || _strnicmp(p, from, from_len) != 0 ||
+            (p[from_len] != '\0' && p[from_len] != '\\')) {
+            continue;
+        }
+
+        char renamed[MAX_PATH_LENGTH];
+        int len = snprintf(renamed, MAX_PATH_LENGTH, "%s%s", to, p + from_len);
+        bool grouped = index->owner[i] && index->owner[i]->count > 1;
+
+        // Unlink from the old path's chain, relink under the new one
+        unsigned int b = path_hash(p) % index->path_buckets;
+        PathNode** link = &index->path_table[b];
+        while (*link && (*link)->file_idx != i) link = &(*link)->next;
+        PathNode* node = *link;
+        if (!node) continue;
+
+        if (len >= MAX_PATH_LENGTH - 1 ||
+            is_excluded(&index->config.exclusions, renamed)) {
+            if (remove_file(index, i) > 1) changed = true;
+            continue;
+        }
+
+        *link = node->next;
+        memcpy(index->files[i].path, renamed, (size_t)len + 1);
+        b = path_hash(renamed) % index->path_buckets;
+        node->next = index->path_table[b];
+        index->path_table[b] = node;
+
+        moved = true;
+        if (grouped) changed = true;
+    }
+
+    LeaveCriticalSection(&index->lock);
+
+    // Not known under the old name: walk it. Known: a stat (or one level
+    // listing) catches writes made after the rename in the same batch.
+    if (refresh_path(index, to, !moved)) changed = true;
+    return changed;
+}
+
+// ============================================================================
+// RESYNC A ROOT
+//
+// When the notification buffer overflows, individual events are lost.
+// Walk the root again (unchanged files are skipped by size + timestamp)
+// and drop every record under it that the walk did not see.
+// ============================================================================
+static bool resync_root(LiveIndex* index, const char* root) {
+    size_t len = strlen(root);
+
+    EnterCriticalSection(&index->lock);
+    int gen = ++index->sweep_gen;
+    LeaveCriticalSection(&index->lock);
+
+    bool changed = refresh_path(index, root, true);
+
+    EnterCriticalSection(&index->lock);
+    for (int i = 0; i < index->count; i++) {
+        const char* p = index->files[i].path;
+        if (p[0] && index->seen[i] != gen &&
+            _strnicmp(p, root, len) == 0 && p[len] == '\\') {
+            if (remove_file(index, i) > 1) changed = true;
+        }
+    }
+    LeaveCriticalSection(&index->lock);
+
+    return changed;
+}
+
+// ============================================================================
+// PENDING SET OPERATIONS
+// ============================================================================
+static void pending_add(PendingSet* set, const char* path, ChangeKind kind,
+                        const char* from) {
+    unsigned int b = path_hash(path) % WATCH_PENDING_BUCKETS;
+
+    for (PendingEntry* e = set->buckets[b]; kind != CHANGE_RENAME && e; e = e->next) {
+        if (_stricmp(e->path, path) == 0) {
+            if (kind > e->kind) e->kind = kind;
+            return;  // Coalesced with an earlier event
+        }
+    }
+
+    if (set->count >= set->capacity) {
+        int new_capacity = set->capacity ? set->capacity * 2 : 64;
+        PendingEntry** items = (PendingEntry**)realloc(set->items, new_capacity * sizeof(PendingEntry*));
+        if (!items) return;
+        set->items = items;
+        set->capacity = new_capacity;
+    }
+
+    PendingEntry* e = (PendingEntry*)malloc(sizeof(PendingEntry));
+    if (!e) return;
+    e->path = _strdup(path);
+    e->from = from ? _strdup(from) : NULL;
+    if (!e->path || (from && !e->from)) {
+        free(e->path);
+        free(e->from);
+        free(e);
+        return;
+    }
+    e->kind = kind;
+    e->next = NULL;
+    if (kind != CHANGE_RENAME) {
+        e->next = set->buckets[b];
+        set->buckets[b] = e;
+    }
+    set->items[set->count++] = e;
+}
+
+static void pending_free(PendingEntry* e) {
+    free(e->path);
+    free(e->from);
+    free(e);
+}
+
+static bool pending_flush(LiveIndex* index, PendingSet* set) {
+    bool changed = false;
+
+    for (int i = 0; i < set->count; i++) {
+        PendingEntry* e = set->items[i];
+        bool touched = false;
+        switch (e->kind) {
+            case CHANGE_REFRESH: touched = refresh_path(index, e->path, false); break;
+            case CHANGE_ADDED:   touched = refresh_path(index, e->path, true); break;
+            case CHANGE_RESYNC:  touched = resync_root(index, e->path); break;
+            case CHANGE_RENAME:  touched = rename_path(index, e->from, e->path); break;
+        }
+        if (touched) changed = true;
+        pending_free(e);
+    }
+
+    memset(set->buckets, 0, sizeof(set->buckets));
+    set->count = 0;
+    return changed;
+}
+
+// ============================================================================
+// NOTIFICATION PARSING
+//
+// FILE_NOTIFY_INFORMATION records are variable length and chained by
+// NextEntryOffset; names are UTF-16 and relative to the watched root.
+// A rename arrives as an OLD_NAME record followed by a NEW_NAME record
+// (possibly in the next buffer, hence rename_from lives in the root).
+// Moves into or out of the tree arrive as ADDED / REMOVED instead.
+// ============================================================================
+static void collect_events(WatchRoot* root, DWORD bytes, PendingSet* pending) {
+    BYTE* cursor = (BYTE*)root->buffer;
+
+    for (;;) {
+        FILE_NOTIFY_INFORMATION* fni = (FILE_NOTIFY_INFORMATION*)cursor;
+
+        char relative[MAX_PATH_LENGTH];
+        int n = WideCharToMultiByte(CP_ACP, 0, fni->FileName,
+                                    (int)(fni->FileNameLength / sizeof(WCHAR)),
+                                    relative, MAX_PATH_LENGTH - 1, NULL, NULL);
+        if (n > 0) {
+            relative[n] = '\0';
+
+            char full_path[MAX_PATH_LENGTH];
+            int len = snprintf(full_path, MAX_PATH_LENGTH, "%s\\%s", root->path, relative);
+            if (len < MAX_PATH_LENGTH - 1) {
+                switch (fni->Action) {
+                    case FILE_ACTION_RENAMED_OLD_NAME:
+                        if (root->rename_from[0]) {
+                            pending_add(pending, root->rename_from, CHANGE_REFRESH, NULL);
+                        }
+                        strcpy(root->rename_from, full_path);
+                        break;
+                    case FILE_ACTION_RENAMED_NEW_NAME:
+                        if (root->rename_from[0]) {
+                            pending_add(pending, full_path, CHANGE_RENAME, root->rename_from);
+                            root->rename_from[0] = '\0';
+                        } else {
+                            pending_add(pending, full_path, CHANGE_ADDED, NULL);
+                        }
+                        break;
+                    case FILE_ACTION_ADDED:
+                        pending_add(pending, full_path, CHANGE_ADDED, NULL);
+                        break;
+                    default:
+                        pending_add(pending, full_path, CHANGE_REFRESH, NULL);
+                        break;
+                }
+            }
+        }
+
+        if (fni->NextEntryOffset == 0 || (DWORD)(cursor - (BYTE*)root->buffer) >= bytes) {
+            break;
+        }
+        cursor += fni->NextEntryOffset;
+    }
+}
+
+static bool issue_read(LiveIndex* index, WatchRoot* root) {
+    DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME |
+                   FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE;
+
+    ResetEvent(root->ov.hEvent);
+    return ReadDirectoryChangesW(root->dir, root->buffer, WATCH_BUFFER_SIZE,
+                                 index->config.directories.include_subdirs,
+                                 filter, NULL, &root->ov, NULL) != 0;
+}
+
+// ============================================================================
+// WATCH THREAD
+//
+// Waits on the stop event plus one overlapped read per root. Events are
+// only applied after the tree has been quiet for WATCH_COALESCE_MS (or at
+// most WATCH_MAX_DELAY_MS under constant churn), so a file being written
+// in many small appends is hashed once instead of once per append.
+// ============================================================================
+static DWORD WINAPI WatchThread(LPVOID param) {
+    LiveIndex* index = (LiveIndex*)param;
+    PendingSet pending = {0};
+
+    HANDLE handles[MAX_DIRECTORIES + 1];
+    handles[0] = index->stop_event;
+    for (int i = 0; i < index->root_count; i++) {
+        handles[i + 1] = index->roots[i].ov.hEvent;
+    }
+
+    DWORD first_pending = 0;
+
+    for (;;) {
+        DWORD timeout = INFINITE;
+        if (pending.count > 0) {
+            DWORD waited = GetTickCount() - first_pending;
+            timeout = waited >= WATCH_MAX_DELAY_MS ? 0 : WATCH_COALESCE_MS;
+        }
+
+        DWORD w = WaitForMultipleObjects(index->root_count + 1, handles, FALSE, timeout);
+
+        if (w == WAIT_OBJECT_0 || w == WAIT_FAILED) {
+            break;
+        }
+
+        if (w == WAIT_TIMEOUT) {
+            if (pending_flush(index, &pending) && index->callback) {
+                index->callback(index->context);
+            }
+            continue;
+        }
+
+        WatchRoot* root = &index->roots[w - WAIT_OBJECT_0 - 1];
+        DWORD bytes = 0;
+
+        if (pending.count == 0) {
+            first_pending = GetTickCount();
+        }
+
+        if (!GetOverlappedResult(root->dir, &root->ov, &bytes, FALSE) || bytes == 0) {
+            // Overflow (ERROR_NOTIFY_ENUM_DIR): events were dropped
+            root->rename_from[0] = '\0';
+            pending_add(&pending, root->path, CHANGE_RESYNC, NULL);
+        } else {
+            collect_events(root, bytes, &pending);
+        }
+
+        issue_read(index, root);
+    }
+
+    // Discard unapplied events; the index is being torn down
+    for (int i = 0; i < pending.count; i++) {
+        pending_free(pending.items[i]);
+    }
+    free(pending.items);
+
+    return 0;
+}
+
+// ============================================================================
+// START / STOP WATCHING
+// ============================================================================
+bool watch_start(LiveIndex* index, const ScanConfig* config,
+                 IndexChangedCallback callback, void* context) {
+    if (!index || !config || index->thread) return false;
+
+    index->config = *config;
+    index->callback = callback;
+    index->context = context;
+    index->root_count = 0;
+
+    for (int i = 0; i < config->directories.count; i++) {
+        WatchRoot* root = &index->roots[index->root_count];
+        memset(root, 0, sizeof(WatchRoot));
+        strcpy(root->path, config->directories.paths[i]);
+
+        root->dir = CreateFileA(root->path, FILE_LIST_DIRECTORY,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                NULL, OPEN_EXISTING,
+                                FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+        if (root->dir == INVALID_HANDLE_VALUE) continue;
+
+        root->buffer = (DWORD*)malloc(WATCH_BUFFER_SIZE);
+        root->ov.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+
+        if (!root->buffer || !root->ov.hEvent || !issue_read(index, root)) {
+            if (root->ov.hEvent) CloseHandle(root->ov.hEvent);
+            free(root->buffer);
+            CloseHandle(root->dir);
+            continue;
+        }
+
+        index->root_count++;
+    }
+
+    if (index->root_count == 0) return false;
+
+    index->stop_event = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (index->stop_event) {
+        index->thread = CreateThread(NULL, 0, WatchThread, index, 0, NULL);
+    }
+
+    if (!index->thread) {
+        watch_stop(index);
+        return false;
+    }
+
+    return true;
+}
+
+void watch_stop(LiveIndex* index) {
+    if (!index) return;
+
+    if (index->thread) {
+        SetEvent(index->stop_event);
+        WaitForSingleObject(index->thread, INFINITE);
+        CloseHandle(index->thread);
+        index->thread = NULL;
+    }
+
+    for (int i = 0; i < index->root_count; i++) {
+        WatchRoot* root = &index->roots[i];
+
+        // Outstanding reads must finish before the buffer is released
+        CancelIo(root->dir);
+        DWORD bytes;
+        GetOverlappedResult(root->dir, &root->ov, &bytes, TRUE);
+
+        CloseHandle(root->ov.hEvent);
+        CloseHandle(root->dir);
+        free(root->buffer);
+    }
+    index->root_count = 0;
+
+    if (index->stop_event) {
+        CloseHandle(index->stop_event);
+        index->stop_event = NULL;
+    }
+}
+
+/*
+ * ============================================================================
+ * WATCH MODE NOTES
+ * ============================================================================
+ *
+ * COST PER CHANGE:
+ * ----------------
+ * - Path lookup: O(1) average (chained table, load factor <= 1)
+ * - Rehash: only if size or timestamp moved
+ * - Group update: O(group size) for the swap-remove
+ *
+ * COALESCING:
+ * -----------
+ * The pending set deduplicates paths, so N notifications for one file
+ * cost one stat and at most one hash per flush window.
+ *
+ * LOST EVENTS:
+ * ------------
+ * ReadDirectoryChangesW reports an overflow with a zero-byte completion.
+ * The whole root is then resynced; unchanged files cost only a stat.
+ *
+ * ============================================================================
+ */